@@ -2,6 +2,7 @@
 #define MORTON_CODE_H
 
 #include <cassert>
+#include <array>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
@@ -13,10 +14,35 @@
 #include "omicron/memory/memory_utils.h"
 #include "omicron/memory/global_malloc.h"
 
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+	#include <immintrin.h>
+	#define MORTON_BMI2
+#endif
+
 namespace omicron::basic
 {
     using namespace std;
     
+	#ifdef MORTON_BMI2
+		/** BMI2 bit deposit and extract, used to interleave and deinterleave 64-bit codes when the CPU supports it. The
+		 * support is checked once at runtime, so binaries still run on CPUs without BMI2. */
+		class Bmi2
+		{
+		public:
+			static bool isSupported()
+			{
+				static const bool supported = __builtin_cpu_supports( "bmi2" );
+				return supported;
+			}
+			
+			__attribute__(( target( "bmi2" ) ))
+			static unsigned long deposit( unsigned long x, unsigned long mask ) { return _pdep_u64( x, mask ); }
+			
+			__attribute__(( target( "bmi2" ) ))
+			static unsigned long extract( unsigned long x, unsigned long mask ) { return _pext_u64( x, mask ); }
+		};
+	#endif
+	
 	// Forward declaration.
 	template< typename T > class MortonCode;
 	
@@ -38,7 +64,9 @@ namespace omicron::basic
 	class MortonCode
 	{
 	public:
-		MortonCode();
+		using Coords = array< T, 3 >;
+		
+		constexpr MortonCode();
 		
 		//TODO: Put move constructors here.
 		void* operator new( size_t size );
@@ -62,10 +90,30 @@ namespace omicron::basic
 		// TODO: Use a template to specify a vec3 type here.
 		vector<T> decode() const;
 		
+		/** Decodes this morton code into 3 coordinates without allocation. Use this when the level of code is known
+		 * a priori. */
+		Coords decodeArray( const unsigned int& level ) const;
+		
+		/** Decodes this morton code into 3 coordinates without allocation. */
+		Coords decodeArray() const;
+		
 		/** Computes the level of this code. */
 		uint getLevel() const;
 		
-		T getBits() const;
+		constexpr T getBits() const;
+		
+		/** @returns the parent of this code. Prefer it over traverseUp(), which allocates. */
+		constexpr MortonCode parent() const;
+		
+		/** @param i is the child index, from 0 to 7.
+		 * @returns the i-th child of this code. Prefer it over traverseDown(), which allocates. */
+		constexpr MortonCode child( const int i ) const;
+		
+		/** @returns the first child of this code, which has the bits of the code appended with 000. */
+		constexpr MortonCode firstChild() const;
+		
+		/** @returns the last child of this code, which has the bits of the code appended with 111. */
+		constexpr MortonCode lastChild() const;
 		
 		shared_ptr< MortonCode< T > > traverseUp() const;
 		vector< shared_ptr< MortonCode< T > >  > traverseDown() const;
@@ -141,7 +189,7 @@ namespace omicron::basic
 	};
 	
 	template< typename T >
-	inline MortonCode< T >::MortonCode()
+	inline constexpr MortonCode< T >::MortonCode()
 	: m_bits( 0 )
 	{}
 	
@@ -192,16 +240,8 @@ namespace omicron::basic
 	template <typename T>
 	inline vector<T> MortonCode<T>::decode(const unsigned int& level) const
 	{
-		vector<T> coords(3);
-		
-		T clearPrefixMask = (T(1) << T(3 * level)) - 1;
-		T bits = m_bits & clearPrefixMask;
-		
-		coords[0] = compact3(bits);
-		coords[1] = compact3(bits >> 1);
-		coords[2] = compact3(bits >> 2);
-		
-		return coords;
+		Coords coords = decodeArray( level );
+		return vector<T>( coords.begin(), coords.end() );
 	}
 	
 	template <typename T>
@@ -212,16 +252,56 @@ namespace omicron::basic
 	}
 	
 	template <typename T>
-	inline T MortonCode<T>::getBits() const{ return m_bits; }
+	inline typename MortonCode< T >::Coords MortonCode< T >::decodeArray( const unsigned int& level ) const
+	{
+		T clearPrefixMask = (T(1) << T(3 * level)) - 1;
+		T bits = m_bits & clearPrefixMask;
+		
+		return Coords{ compact3( bits ), compact3( bits >> 1 ), compact3( bits >> 2 ) };
+	}
 	
 	template <typename T>
-	inline MortonCodePtr<T> MortonCode<T>::traverseUp() const
+	inline typename MortonCode< T >::Coords MortonCode< T >::decodeArray() const
+	{
+		return decodeArray( getLevel() );
+	}
+	
+	template <typename T>
+	inline constexpr T MortonCode<T>::getBits() const{ return m_bits; }
+	
+	template <typename T>
+	inline constexpr MortonCode< T > MortonCode< T >::parent() const
 	{
 		assert( m_bits > 1 );
-		T bits = m_bits >> 3;
-		MortonCodePtr<T> parentMorton = makeManaged< MortonCode< T > >();
-		parentMorton->build(bits);
-		return parentMorton;
+		MortonCode< T > code;
+		code.m_bits = m_bits >> 3;
+		return code;
+	}
+	
+	template <typename T>
+	inline constexpr MortonCode< T > MortonCode< T >::child( const int i ) const
+	{
+		MortonCode< T > code;
+		code.m_bits = ( m_bits << 3 ) | T( i & 0x7 );
+		return code;
+	}
+	
+	template <typename T>
+	inline constexpr MortonCode< T > MortonCode< T >::firstChild() const
+	{
+		return child( 0 );
+	}
+	
+	template <typename T>
+	inline constexpr MortonCode< T > MortonCode< T >::lastChild() const
+	{
+		return child( 7 );
+	}
+	
+	template <typename T>
+	inline MortonCodePtr<T> MortonCode<T>::traverseUp() const
+	{
+		return makeManaged< MortonCode< T > >( parent() );
 	}
 	
 	template <typename T>
@@ -240,9 +320,7 @@ namespace omicron::basic
 		
 		for (int i = 0; i < 8; ++i)
 		{
-			MortonCodePtr<T> child = makeManaged< MortonCode< T > >();
-			child->build(shifted | i);
-			children[i] = child;
+			children[i] = makeManaged< MortonCode< T > >( child( i ) );
 		}
 		
 		return children;
@@ -279,17 +357,13 @@ namespace omicron::basic
 	template <typename T>
 	inline MortonCodePtr< T > MortonCode< T >::getFirstChild() const
 	{
-		MortonCodePtr< T > firstChild = makeManaged< MortonCode< T > >();
-		firstChild->build( m_bits << 3 );
-		return firstChild;
+		return makeManaged< MortonCode< T > >( firstChild() );
 	}
 	
 	template <typename T>
 	inline MortonCodePtr< T > MortonCode< T >::getLastChild() const
 	{
-		MortonCodePtr< T > lastChild = makeManaged< MortonCode< T > >();
-		lastChild->build( ( m_bits << 3 ) | ( T ) 0x7 );
-		return lastChild;
+		return makeManaged< MortonCode< T > >( lastChild() );
 	}
 	
 	template <typename T>
@@ -382,7 +456,7 @@ namespace omicron::basic
 			while( code.getBits() != 1 )
 			{
 				ss << "0x" << hex << code.getBits() << dec << "->";
-				code = *code.traverseUp();
+				code = code.parent();
 			}
 			ss << "0x" << hex << code.getBits() << dec;
 		}
@@ -391,7 +465,7 @@ namespace omicron::basic
 			while( code.getBits() != 1 )
 			{
 				ss << code << dec << " -> ";
-				code = *code.traverseUp();
+				code = code.parent();
 			}
 			ss << code << dec;
 		}
@@ -462,6 +536,14 @@ namespace omicron::basic
 	inline unsigned long MortonCode< unsigned long >::spread3(unsigned long x)
 	{
 		x &= 0x1fffffUL;
+		
+		#ifdef MORTON_BMI2
+			if( Bmi2::isSupported() )
+			{
+				return Bmi2::deposit( x, 0x1249249249249249UL );
+			}
+		#endif
+		
 		x = (x | x << 32UL) & 0x1f00000000ffffUL;
 		x = (x | x << 16UL) & 0x1f0000ff0000ffUL;
 		x = (x | x << 8UL) & 0x100f00f00f00f00fUL;
@@ -486,6 +568,13 @@ namespace omicron::basic
 	template <>
 	inline unsigned long MortonCode< unsigned long >::compact3(unsigned long x) const
 	{
+		#ifdef MORTON_BMI2
+			if( Bmi2::isSupported() )
+			{
+				return Bmi2::extract( x, 0x1249249249249249UL );
+			}
+		#endif
+		
 		x &= 0x1249249249249249UL;
 		x = (x ^ x >> 2UL) & 0x10c30c30c30c30c3UL;
 		x = (x ^ x >> 4UL) & 0x100f00f00f00f00fUL;
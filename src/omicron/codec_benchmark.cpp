@@ -0,0 +1,159 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include "omicron/basic/morton_code.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "omicron/disk/ply_point_reader.h"
+#include "omicron/disk/point_codec.h"
+#include "omicron/hierarchy/octree_dim_calculator.h"
+
+using namespace std;
+using namespace omicron;
+using namespace omicron::disk;
+using namespace omicron::hierarchy;
+
+using Morton = MediumMortonCode;
+using PointArray = vector< Point, TbbAllocator< Point > >;
+using SurfelArray = vector< Surfel, TbbAllocator< Surfel > >;
+
+/** Throughput and compression of a codec configuration. Throughputs are relative to the raw element size. */
+typedef struct CodecResult
+{
+	double m_encodeMBs;
+	double m_decodeMBs;
+	double m_ratio;
+	double m_bitsPerElement;
+} CodecResult;
+
+double elapsedSeconds( const chrono::high_resolution_clock::time_point& start )
+{
+	return chrono::duration< double >( chrono::high_resolution_clock::now() - start ).count();
+}
+
+/** Encodes and decodes the elements in blocks of blockSize, as node contents or sorter chunks.
+ * @throws runtime_error if the decoded size does not match. */
+template< typename Vector >
+CodecResult benchmarkCodec( const Vector& elements, const PointCodec& codec, const size_t blockSize,
+							const int repetitions )
+{
+	using Element = typename Vector::value_type;
+
+	ByteVector encoded;
+	double encodeTime = numeric_limits< double >::max();
+	double decodeTime = numeric_limits< double >::max();
+
+	for( int rep = 0; rep < repetitions; ++rep )
+	{
+		encoded.clear();
+
+		auto start = chrono::high_resolution_clock::now();
+		for( size_t i = 0; i < elements.size(); i += blockSize )
+		{
+			codec.encode( elements.data() + i, std::min( blockSize, elements.size() - i ), encoded );
+		}
+		encodeTime = std::min( encodeTime, elapsedSeconds( start ) );
+
+		size_t nDecoded = 0ul;
+		start = chrono::high_resolution_clock::now();
+		const uint8_t* ptr = encoded.data();
+		while( ptr != encoded.data() + encoded.size() )
+		{
+			nDecoded += PointCodec::decode< Vector >( ptr, encoded.data() + encoded.size() ).size();
+		}
+		decodeTime = std::min( decodeTime, elapsedSeconds( start ) );
+
+		if( nDecoded != elements.size() )
+		{
+			throw runtime_error( "Decoded size does not match the encoded one." );
+		}
+	}
+
+	double rawMB = double( elements.size() * sizeof( Element ) ) / ( 1024. * 1024. );
+
+	CodecResult result;
+	result.m_encodeMBs = rawMB / encodeTime;
+	result.m_decodeMBs = rawMB / decodeTime;
+	result.m_ratio = double( elements.size() * sizeof( Element ) ) / double( encoded.size() );
+	result.m_bitsPerElement = double( encoded.size() * 8 ) / double( elements.size() );
+
+	return result;
+}
+
+void printResult( const string& name, const CodecResult& result )
+{
+	cout << left << setw( 28 ) << name << right << fixed << setprecision( 1 )
+		 << setw( 12 ) << result.m_encodeMBs << setw( 12 ) << result.m_decodeMBs
+		 << setw( 10 ) << setprecision( 2 ) << result.m_ratio
+		 << setw( 12 ) << setprecision( 1 ) << result.m_bitsPerElement << endl;
+}
+
+int main( int argc, char** argv )
+{
+	setlocale( LC_NUMERIC, "C" );
+
+	if( argc < 2 )
+	{
+		cerr << "Usage: " << argv[ 0 ] << " <dataset .ply> [max level = 10] [block points = 4096]"
+			 << " [near-lossless position bits = 16] [repetitions = 3]" << endl
+			 << "Points are normalized and sorted in morton order before encoding, as in the sorter chunks." << endl;
+		return 1;
+	}
+
+	const string filename = argv[ 1 ];
+	const uint maxLvl = ( argc > 2 ) ? stoul( argv[ 2 ] ) : 10u;
+	const size_t blockSize = ( argc > 3 ) ? stoul( argv[ 3 ] ) : 4096ul;
+	const uint positionBits = ( argc > 4 ) ? stoul( argv[ 4 ] ) : 16u;
+	const int repetitions = ( argc > 5 ) ? stoi( argv[ 5 ] ) : 3;
+
+	try
+	{
+		PointArray points;
+		OctreeDimCalculator< Morton > dimCalc;
+		PlyPointReader( filename ).read(
+			[ & ]( const Point& p )
+			{
+				points.push_back( p );
+				dimCalc.insertPoint( p );
+			}
+		);
+
+		if( points.empty() )
+		{
+			throw runtime_error( filename + " has no points." );
+		}
+
+		DimOriginScale< Morton > dimOriginScale = dimCalc.dimensions( maxLvl );
+		for( Point& p : points )
+		{
+			dimOriginScale.scale( p );
+		}
+		MortonRadixSorter< Morton >( dimOriginScale.dimensions() ).sort( points.begin(), points.end() );
+
+		SurfelArray surfels;
+		surfels.reserve( points.size() );
+		for( const Point& p : points )
+		{
+			surfels.push_back( Surfel( p ) );
+		}
+
+		cout << "Points: " << points.size() << " Block points: " << blockSize << endl << endl
+			 << left << setw( 28 ) << "Codec" << right << setw( 12 ) << "Enc MB/s" << setw( 12 ) << "Dec MB/s"
+			 << setw( 10 ) << "Ratio" << setw( 12 ) << "Bits/elem" << endl;
+
+		PointCodec lossless;
+		PointCodec nearLossless( PointCodec::NEAR_LOSSLESS, positionBits );
+		string nearLosslessName = "near-lossless " + to_string( positionBits ) + " bits";
+
+		printResult( "points lossless", benchmarkCodec( points, lossless, blockSize, repetitions ) );
+		printResult( "points " + nearLosslessName, benchmarkCodec( points, nearLossless, blockSize, repetitions ) );
+		printResult( "surfels lossless", benchmarkCodec( surfels, lossless, blockSize, repetitions ) );
+		printResult( "surfels " + nearLosslessName, benchmarkCodec( surfels, nearLossless, blockSize, repetitions ) );
+	}
+	catch( const exception& e )
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
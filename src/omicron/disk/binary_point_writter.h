@@ -0,0 +1,175 @@
+#ifndef BINARY_POINT_WRITTER_H
+#define BINARY_POINT_WRITTER_H
+
+#include <fstream>
+#include "omicron/disk/mmap_point_reader.h"
+#include "omicron/disk/ply_point_reader.h"
+#include "omicron/hierarchy/octree_dimensions.h"
+
+namespace omicron::disk
+{
+	using namespace hierarchy;
+
+	/** Writter for binary sorted point files. The header is written at destruction, when the point count and morton
+	 * bounds are known. Only the first and last points have their morton codes computed.
+	 * @param Morton is the MortonCode type used to compute the morton bounds in the header. */
+	template< typename Morton >
+	class BinaryPointWritter
+	{
+	public:
+		using OctreeDim = OctreeDimensions< Morton >;
+
+		/** @param filename is the output file.
+		 * @param dim is the octree dimensions of the points.
+		 * @param hasNormals indicates if point normals should be written.
+		 * @throws runtime_error if the file cannot be opened. */
+		BinaryPointWritter( const string& filename, const OctreeDim& dim, bool hasNormals = true );
+
+		~BinaryPointWritter();
+
+		void write( const Point& p );
+
+		/** Writes a batch of points. Records are written with a single stream write if the file has normals. */
+		void write( const PointBatch& batch );
+
+		const string& filename() { return m_filename; }
+
+		/** Converts a .ply point file into a binary point file. Point order is kept.
+		 * @param plyFilename is the .ply file. Its points are expected to be normalized into dim.
+		 * @param outFilename is the binary point file.
+		 * @param dim is the octree dimensions of the points. */
+		static void convertPly( const string& plyFilename, const string& outFilename, const OctreeDim& dim );
+
+		/** @returns the header of a file with points in dim, without point count and morton bounds. */
+		static BinaryPointHeader createHeader( const OctreeDim& dim, bool hasNormals );
+
+	private:
+		// Size of the file stream buffer.
+		static constexpr size_t BUFFER_SIZE = 1ul << 22;
+
+		string m_filename;
+		ofstream m_file;
+		unique_ptr< char[] > m_buffer;
+		BinaryPointHeader m_header;
+		OctreeDim m_dim;
+		/** Last written point. Its morton code is computed at destruction. */
+		Point m_lastPoint;
+	};
+
+	template< typename Morton >
+	BinaryPointWritter< Morton >::BinaryPointWritter( const string& filename, const OctreeDim& dim, bool hasNormals )
+	: m_filename( filename ),
+	m_buffer( new char[ BUFFER_SIZE ] ),
+	m_dim( dim )
+	{
+		m_file.rdbuf()->pubsetbuf( m_buffer.get(), BUFFER_SIZE );
+		m_file.open( m_filename, ofstream::out | ofstream::binary | ofstream::trunc );
+
+		if( !m_file )
+		{
+			throw runtime_error( m_filename + ": cannot open binary point file to write." );
+		}
+
+		m_header = createHeader( m_dim, hasNormals );
+
+		// Placeholder, rewritten at destruction.
+		m_file.write( reinterpret_cast< const char* >( &m_header ), sizeof( BinaryPointHeader ) );
+	}
+
+	template< typename Morton >
+	BinaryPointWritter< Morton >::~BinaryPointWritter()
+	{
+		if( m_header.m_nPoints > 0 )
+		{
+			m_header.m_lastMorton = m_dim.calcMorton( m_lastPoint ).getBits();
+		}
+
+		m_file.seekp( 0 );
+		m_file.write( reinterpret_cast< const char* >( &m_header ), sizeof( BinaryPointHeader ) );
+		m_file.close();
+	}
+
+	template< typename Morton >
+	inline void BinaryPointWritter< Morton >::write( const Point& p )
+	{
+		if( m_header.m_nPoints == 0 )
+		{
+			m_header.m_firstMorton = m_dim.calcMorton( p ).getBits();
+		}
+		m_lastPoint = p;
+		++m_header.m_nPoints;
+
+		if( m_header.hasNormals() )
+		{
+			m_file.write( reinterpret_cast< const char* >( &p ), sizeof( Point ) );
+		}
+		else
+		{
+			m_file.write( reinterpret_cast< const char* >( p.getPos().data() ), 3 * sizeof( float ) );
+		}
+	}
+
+	template< typename Morton >
+	inline void BinaryPointWritter< Morton >::write( const PointBatch& batch )
+	{
+		if( batch.size() == 0 )
+		{
+			return;
+		}
+
+		if( m_header.m_nPoints == 0 )
+		{
+			m_header.m_firstMorton = m_dim.calcMorton( batch[ 0 ] ).getBits();
+		}
+		m_lastPoint = batch[ batch.size() - 1 ];
+		m_header.m_nPoints += batch.size();
+
+		if( m_header.hasNormals() )
+		{
+			m_file.write( reinterpret_cast< const char* >( batch.begin() ), batch.size() * sizeof( Point ) );
+		}
+		else
+		{
+			for( const Point& p : batch )
+			{
+				m_file.write( reinterpret_cast< const char* >( p.getPos().data() ), 3 * sizeof( float ) );
+			}
+		}
+	}
+
+	template< typename Morton >
+	void BinaryPointWritter< Morton >::convertPly( const string& plyFilename, const string& outFilename,
+												   const OctreeDim& dim )
+	{
+		auto now = Profiler::now( "Ply to binary conversion" );
+
+		PlyPointReader reader( plyFilename );
+		BinaryPointWritter writter( outFilename, dim, reader.hasNormals() );
+
+		reader.read(
+			[ & ]( const Point& p )
+			{
+				writter.write( p );
+			}
+		);
+
+		Profiler::elapsedTime( now, "Ply to binary conversion" );
+	}
+
+	template< typename Morton >
+	BinaryPointHeader BinaryPointWritter< Morton >::createHeader( const OctreeDim& dim, bool hasNormals )
+	{
+		BinaryPointHeader header;
+		header.m_flags = hasNormals ? BinaryPointHeader::HAS_NORMALS_FLAG : 0u;
+		header.m_mortonLvl = dim.m_nodeLvl;
+		for( int i = 0; i < 3; ++i )
+		{
+			header.m_origin[ i ] = dim.m_origin[ i ];
+			header.m_size[ i ] = dim.m_size[ i ];
+		}
+
+		return header;
+	}
+}
+
+#endif
@@ -28,7 +28,8 @@ namespace omicron::disk
         ExternalSortReader( const string& inputFilename, uint maxLevel );
         
         /** Performs the second phase, calling onPointSorted for each point merged. */
-        void read( const function< void( const Point& ) >& onPointSorted ) override;
+        void readBatches( const function< void( const PointBatch& ) >& onBatchSorted,
+                          ulong batchSize = DEFAULT_BATCH_SIZE ) override;
     
         const OctreeDim& dimensions() const { return *m_comp; }
     
@@ -78,7 +79,8 @@ namespace omicron::disk
     }
     
     template< typename Morton >
-    void ExternalSortReader< Morton >::read( const function< void( const Point& ) >& onPointSorted )
+    void ExternalSortReader< Morton >::readBatches( const function< void( const PointBatch& ) >& onBatchSorted,
+                                                    ulong batchSize )
     {
         using RunsMerger = runs_merger< typename RunsCreator::sorted_runs_type >;
         
@@ -90,11 +92,13 @@ namespace omicron::disk
         
         start = Profiler::now( "STXXL::runs_merger output." );
         
+        PointBatcher batcher( onBatchSorted, batchSize );
         while( !runsMerger.empty() )
         {
-            onPointSorted( *runsMerger );
+            batcher.push( *runsMerger );
             ++runsMerger;
         }
+        batcher.flush();
     
         m_readTime = Profiler::elapsedTime( start, "STXXL::runs_merger output." );
     }
@@ -39,7 +39,8 @@ namespace omicron::disk
 		
 		HeapPointReader( const string& filename, uint leafLvl );
 		
-		void read( const function< void( const Point& ) >& onPointDone ) override;
+		void readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+						  ulong batchSize = DEFAULT_BATCH_SIZE ) override;
 	
 		const Dim& dimensions() const { return m_dim; }
 		
@@ -71,10 +72,13 @@ namespace omicron::disk
 	}
 
 	template< typename Morton >
-	void HeapPointReader< Morton >::read( const function< void( const Point& ) >& onPointDone )
+	void HeapPointReader< Morton >::readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+												 ulong batchSize )
 	{
 		auto now = Profiler::now( "Heap sorter point reading" );
 		
+		PointBatcher batcher( onBatchDone, batchSize );
+		
 		while( !m_heap->empty() )
 		{
 			// DEBUG
@@ -82,10 +86,11 @@ namespace omicron::disk
 // 				cout << "s: " << m_heap->size() << endl;
 // 			}
 			
-			onPointDone( m_heap->top() );
+			batcher.push( m_heap->top() );
 			
 			m_heap->pop();
 		}
+		batcher.flush();
 		
 		m_readTime = Profiler::elapsedTime( now, "Heap sorter point reading" );
 	}
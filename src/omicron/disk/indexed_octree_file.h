@@ -0,0 +1,323 @@
+#ifndef INDEXED_OCTREE_FILE_H
+#define INDEXED_OCTREE_FILE_H
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "omicron/hierarchy/o1_octree_node.h"
+#include "omicron/hierarchy/octree_dimensions.h"
+#include "omicron/renderer/splat_renderer/quantized_surfels.h"
+#include "omicron/util/profiler.h"
+
+namespace omicron::disk
+{
+	using namespace std;
+	using namespace hierarchy;
+
+	/** Header of the indexed octree file (version 2 of the binary octree file). The header is followed by the node table
+	 * and by the node contents, which are contiguous blobs of raw surfels or of QuantizedSurfels serializations. */
+	typedef struct IndexedOctreeHeader
+	{
+		static constexpr char MAGIC[ 8 ] = { 'O', 'M', 'C', 'R', 'N', 'O', 'C', 'T' };
+		static constexpr uint32_t VERSION = 2u;
+		/** Node contents are QuantizedSurfels serializations instead of raw surfels. */
+		static constexpr uint32_t QUANTIZED_FLAG = 0x1u;
+
+		IndexedOctreeHeader()
+		{
+			memset( this, 0, sizeof( IndexedOctreeHeader ) );
+			memcpy( m_magic, MAGIC, sizeof( MAGIC ) );
+			m_version = VERSION;
+		}
+
+		bool isQuantized() const { return m_flags & QUANTIZED_FLAG; }
+
+		char m_magic[ 8 ];
+		uint32_t m_version;
+		/** Octree depth. Morton codes in the node table are computed with the dimensions of each node level. */
+		uint32_t m_depth;
+		uint64_t m_nNodes;
+		/** Offset of the contents section in bytes, from the file beginning. */
+		uint64_t m_contentsOffset;
+		float m_origin[ 3 ];
+		float m_size[ 3 ];
+		uint32_t m_flags;
+		uint8_t m_reserved[ 4 ];
+	} IndexedOctreeHeader;
+
+	/** Node table entry. The table is in breadth-first order, so it is sorted by morton code and sibling groups are
+	 * contiguous. */
+	typedef struct IndexedOctreeEntry
+	{
+		static constexpr uint32_t IS_LEAF_FLAG = 0x1u;
+
+		bool isLeaf() const { return m_flags & IS_LEAF_FLAG; }
+
+		uint64_t m_morton;
+		/** Index of the first child in the table and number of children. */
+		uint32_t m_firstChild;
+		uint32_t m_nChildren;
+		/** Offset of the node contents in the contents section, in bytes, and number of contents. */
+		uint64_t m_contentsOffset;
+		uint32_t m_nContents;
+		uint32_t m_flags;
+	} IndexedOctreeEntry;
+
+	static_assert( sizeof( IndexedOctreeHeader ) == 64, "Indexed octree header should have 64 bytes." );
+	static_assert( sizeof( IndexedOctreeEntry ) == 32, "Indexed octree entry should have 32 bytes." );
+	static_assert( sizeof( Surfel ) == 9 * sizeof( float ), "Surfel layout should match indexed octree contents." );
+
+	/** Reader for indexed octree files. The file is mapped into memory at constructor, so opening is independent of the
+	 * octree size. Nodes are paged in by sibling group: the contents of a group are copied from the mapping only when
+	 * the group is requested.
+	 * @param Morton is the MortonCode type. */
+	template< typename Morton >
+	class IndexedOctreeFile
+	{
+	public:
+		using Node = O1OctreeNode< Surfel >;
+		using NodeArray = typename Node::NodeArray;
+		using NodePtr = shared_ptr< Node >;
+		using OctreeDim = OctreeDimensions< Morton >;
+
+		/** Maps the file and validates its header.
+		 * @throws runtime_error if the file cannot be mapped or its header is invalid. */
+		IndexedOctreeFile( const string& filename );
+
+		~IndexedOctreeFile();
+
+		IndexedOctreeFile( const IndexedOctreeFile& ) = delete;
+		IndexedOctreeFile& operator=( const IndexedOctreeFile& ) = delete;
+
+		/** @returns true if the file begins with the indexed octree magic. */
+		static bool isIndexed( const string& filename );
+
+		const IndexedOctreeHeader& header() const { return m_header; }
+
+		/** @returns the octree dimensions at the deepest level. */
+		OctreeDim dim() const;
+
+		uint64_t nNodes() const { return m_header.m_nNodes; }
+
+		const IndexedOctreeEntry& entry( const uint64_t nodeIdx ) const { return m_entries[ nodeIdx ]; }
+
+		/** @returns the index of the node with the given morton code or nNodes() if there is none. */
+		uint64_t find( const Morton& morton ) const;
+
+		/** @returns a root node with its contents. Its children are not paged in. */
+		NodePtr loadRoot() const;
+
+		/** Pages in the children of node. The children contents are copied from the mapping and their own children are
+		 * not paged in.
+		 * @param morton is node's morton code.
+		 * @returns false if node is not in the file or is a leaf. */
+		bool pageIn( Node& node, const Morton& morton ) const;
+
+		/** @returns the root with all the hierarchy paged in. */
+		NodePtr loadAll() const;
+
+	private:
+		Node createNode( const uint64_t nodeIdx ) const;
+
+		void pageInChildren( Node& node, const uint64_t nodeIdx ) const;
+
+		void pageInSubtree( Node& node, const uint64_t nodeIdx ) const;
+
+		string m_filename;
+		IndexedOctreeHeader m_header;
+		void* m_mapping;
+		size_t m_mappingSize;
+		const IndexedOctreeEntry* m_entries;
+		const char* m_contents;
+	};
+
+	template< typename Morton >
+	IndexedOctreeFile< Morton >::IndexedOctreeFile( const string& filename )
+	: m_filename( filename ),
+	m_mapping( MAP_FAILED ),
+	m_mappingSize( 0 ),
+	m_entries( nullptr ),
+	m_contents( nullptr )
+	{
+		int fd = open( m_filename.c_str(), O_RDONLY );
+		if( fd == -1 )
+		{
+			throw runtime_error( m_filename + ": cannot open indexed octree file." );
+		}
+
+		struct stat fileStat;
+		if( fstat( fd, &fileStat ) == -1 || fileStat.st_size < sizeof( IndexedOctreeHeader ) )
+		{
+			close( fd );
+			throw runtime_error( m_filename + ": indexed octree file is too small to have a header." );
+		}
+
+		m_mappingSize = fileStat.st_size;
+		m_mapping = mmap( nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd );
+
+		if( m_mapping == MAP_FAILED )
+		{
+			throw runtime_error( m_filename + ": cannot map indexed octree file." );
+		}
+
+		memcpy( &m_header, m_mapping, sizeof( IndexedOctreeHeader ) );
+
+		if( memcmp( m_header.m_magic, IndexedOctreeHeader::MAGIC, sizeof( IndexedOctreeHeader::MAGIC ) )
+			|| m_header.m_version != IndexedOctreeHeader::VERSION )
+		{
+			munmap( m_mapping, m_mappingSize );
+			throw runtime_error( m_filename + ": invalid indexed octree file header." );
+		}
+
+		if( m_header.m_nNodes == 0
+			|| m_header.m_contentsOffset < sizeof( IndexedOctreeHeader ) + m_header.m_nNodes * sizeof( IndexedOctreeEntry )
+			|| m_header.m_contentsOffset > m_mappingSize )
+		{
+			munmap( m_mapping, m_mappingSize );
+			throw runtime_error( m_filename + ": indexed octree file is truncated." );
+		}
+
+		const char* bytes = static_cast< const char* >( m_mapping );
+		m_entries = reinterpret_cast< const IndexedOctreeEntry* >( bytes + sizeof( IndexedOctreeHeader ) );
+		m_contents = bytes + m_header.m_contentsOffset;
+
+		// Sibling groups are paged in randomly while the front is tracked. The node table is needed for every page in.
+		madvise( m_mapping, m_mappingSize, MADV_RANDOM );
+		madvise( m_mapping, m_header.m_contentsOffset, MADV_WILLNEED );
+	}
+
+	template< typename Morton >
+	IndexedOctreeFile< Morton >::~IndexedOctreeFile()
+	{
+		if( m_mapping != MAP_FAILED )
+		{
+			munmap( m_mapping, m_mappingSize );
+		}
+	}
+
+	template< typename Morton >
+	bool IndexedOctreeFile< Morton >::isIndexed( const string& filename )
+	{
+		ifstream file( filename, ifstream::in | ifstream::binary );
+		char magic[ sizeof( IndexedOctreeHeader::MAGIC ) ];
+		file.read( magic, sizeof( magic ) );
+
+		return file && memcmp( magic, IndexedOctreeHeader::MAGIC, sizeof( magic ) ) == 0;
+	}
+
+	template< typename Morton >
+	inline typename IndexedOctreeFile< Morton >::OctreeDim IndexedOctreeFile< Morton >::dim() const
+	{
+		return OctreeDim( Vec3( m_header.m_origin[ 0 ], m_header.m_origin[ 1 ], m_header.m_origin[ 2 ] ),
+						  Vec3( m_header.m_size[ 0 ], m_header.m_size[ 1 ], m_header.m_size[ 2 ] ), m_header.m_depth );
+	}
+
+	template< typename Morton >
+	inline uint64_t IndexedOctreeFile< Morton >::find( const Morton& morton ) const
+	{
+		const IndexedOctreeEntry* end = m_entries + m_header.m_nNodes;
+		const IndexedOctreeEntry* entry = lower_bound( m_entries, end, morton.getBits(),
+			[]( const IndexedOctreeEntry& entry, const uint64_t bits ) { return entry.m_morton < bits; }
+		);
+
+		return ( entry != end && entry->m_morton == morton.getBits() ) ? entry - m_entries : m_header.m_nNodes;
+	}
+
+	template< typename Morton >
+	inline typename IndexedOctreeFile< Morton >::NodePtr IndexedOctreeFile< Morton >::loadRoot() const
+	{
+		return make_shared< Node >( createNode( 0 ) );
+	}
+
+	template< typename Morton >
+	inline bool IndexedOctreeFile< Morton >::pageIn( Node& node, const Morton& morton ) const
+	{
+		uint64_t nodeIdx = find( morton );
+		if( nodeIdx == m_header.m_nNodes || m_entries[ nodeIdx ].isLeaf() )
+		{
+			return false;
+		}
+
+		pageInChildren( node, nodeIdx );
+		return true;
+	}
+
+	template< typename Morton >
+	typename IndexedOctreeFile< Morton >::NodePtr IndexedOctreeFile< Morton >::loadAll() const
+	{
+		auto now = util::Profiler::now( "Indexed octree file reading" );
+
+		NodePtr root = loadRoot();
+		pageInSubtree( *root, 0 );
+
+		util::Profiler::elapsedTime( now, "Indexed octree file reading" );
+
+		return root;
+	}
+
+	template< typename Morton >
+	inline typename IndexedOctreeFile< Morton >::Node IndexedOctreeFile< Morton >::createNode( const uint64_t nodeIdx )
+	const
+	{
+		const IndexedOctreeEntry& entry = m_entries[ nodeIdx ];
+		const char* contents = m_contents + entry.m_contentsOffset;
+		size_t contentsSize = m_header.isQuantized() ? QuantizedSurfels::serializedSize( entry.m_nContents )
+													 : entry.m_nContents * sizeof( Surfel );
+
+		if( contents + contentsSize > static_cast< const char* >( m_mapping ) + m_mappingSize )
+		{
+			throw runtime_error( m_filename + ": node contents are out of the indexed octree file." );
+		}
+
+		if( m_header.isQuantized() )
+		{
+			return Node( QuantizedSurfels( contents ).decode(), entry.isLeaf() );
+		}
+
+		typename Node::ContentsArray array( entry.m_nContents );
+		memcpy( array.data(), contents, contentsSize );
+
+		return Node( std::move( array ), entry.isLeaf() );
+	}
+
+	template< typename Morton >
+	void IndexedOctreeFile< Morton >::pageInChildren( Node& node, const uint64_t nodeIdx ) const
+	{
+		const IndexedOctreeEntry& entry = m_entries[ nodeIdx ];
+		NodeArray children( entry.m_nChildren );
+
+		for( uint32_t i = 0; i < entry.m_nChildren; ++i )
+		{
+			children[ i ] = createNode( entry.m_firstChild + i );
+			children[ i ].setParent( &node );
+		}
+
+		node.setChildren( std::move( children ) );
+	}
+
+	template< typename Morton >
+	void IndexedOctreeFile< Morton >::pageInSubtree( Node& node, const uint64_t nodeIdx ) const
+	{
+		const IndexedOctreeEntry& entry = m_entries[ nodeIdx ];
+		if( entry.isLeaf() )
+		{
+			return;
+		}
+
+		pageInChildren( node, nodeIdx );
+
+		for( uint32_t i = 0; i < entry.m_nChildren; ++i )
+		{
+			pageInSubtree( node.child()[ i ], entry.m_firstChild + i );
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef MMAP_POINT_READER_H
+#define MMAP_POINT_READER_H
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "omicron/basic/point.h"
+#include "omicron/disk/point_reader.h"
+#include "omicron/util/profiler.h"
+
+namespace omicron::disk
+{
+	using namespace std;
+	using namespace util;
+
+	/** Header of the binary sorted point file. Points follow the header as fixed-stride records. Records have the
+	 * normal followed by the position if the file has normals, or only the position otherwise, both as 3 floats. This is
+	 * the same layout of Point, so records can be used as Points directly from the file mapping. */
+	typedef struct BinaryPointHeader
+	{
+		static constexpr char MAGIC[ 8 ] = { 'O', 'M', 'C', 'R', 'N', 'P', 'T', 'S' };
+		static constexpr uint32_t VERSION = 1u;
+		static constexpr uint32_t HAS_NORMALS_FLAG = 0x1u;
+		/** File extension used to identify binary point files. */
+		static constexpr const char* EXTENSION = ".bpts";
+
+		BinaryPointHeader()
+		{
+			memset( this, 0, sizeof( BinaryPointHeader ) );
+			memcpy( m_magic, MAGIC, sizeof( MAGIC ) );
+			m_version = VERSION;
+		}
+
+		bool hasNormals() const { return m_flags & HAS_NORMALS_FLAG; }
+
+		/** @returns the size of a point record in bytes. */
+		size_t stride() const { return ( hasNormals() ? 6 : 3 ) * sizeof( float ); }
+
+		/** @returns true if filename has the binary point file extension. */
+		static bool isBinaryPointFile( const string& filename )
+		{
+			size_t extLength = strlen( EXTENSION );
+			return filename.size() >= extLength
+				&& filename.compare( filename.size() - extLength, extLength, EXTENSION ) == 0;
+		}
+
+		char m_magic[ 8 ];
+		uint32_t m_version;
+		uint32_t m_flags;
+		uint64_t m_nPoints;
+		/** Morton code bits of the first and last point, so the file can be checked against octree dimensions. */
+		uint64_t m_firstMorton;
+		uint64_t m_lastMorton;
+		/** Octree level used to compute the morton codes. */
+		uint32_t m_mortonLvl;
+		float m_origin[ 3 ];
+		float m_size[ 3 ];
+		// Pads the header so the records are cache line aligned in the mapping.
+		uint8_t m_reserved[ 60 ];
+	} BinaryPointHeader;
+
+	static_assert( sizeof( BinaryPointHeader ) == 128, "Binary point records should begin at a cache line boundary." );
+	static_assert( sizeof( Point ) == 6 * sizeof( float ), "Point layout should match binary point records." );
+
+	/** Reader for binary sorted point files. The file is mapped into memory at constructor and unmapped at destructor.
+	 * Files with normals are zero-copy: the Points passed to the callback are the records in the mapping. */
+	class MmapPointReader
+	: public PointReader
+	{
+	public:
+		/** Maps the file and validates its header.
+		 * @throws runtime_error if the file cannot be mapped or its header is invalid. */
+		MmapPointReader( const string& filename );
+
+		~MmapPointReader();
+
+		MmapPointReader( const MmapPointReader& ) = delete;
+		MmapPointReader& operator=( const MmapPointReader& ) = delete;
+
+		/** Files with normals are read without copies: batches point into the mapping. */
+		void readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+						  ulong batchSize = DEFAULT_BATCH_SIZE ) override;
+
+		long getNumPoints() const { return m_header.m_nPoints; }
+
+		bool hasNormals() const { return m_header.hasNormals(); }
+
+		const BinaryPointHeader& header() const { return m_header; }
+
+		/** @returns the points in the mapping if the file has normals, nullptr otherwise. Valid while the reader lives. */
+		const Point* points() const
+		{
+			return hasNormals() ? reinterpret_cast< const Point* >( m_records ) : nullptr;
+		}
+
+	private:
+		string m_filename;
+		BinaryPointHeader m_header;
+		void* m_mapping;
+		size_t m_mappingSize;
+		const char* m_records;
+	};
+
+	inline MmapPointReader::MmapPointReader( const string& filename )
+	: m_filename( filename ),
+	m_mapping( MAP_FAILED ),
+	m_mappingSize( 0 ),
+	m_records( nullptr )
+	{
+		auto now = Profiler::now( "MmapPointReader init" );
+
+		int fd = open( m_filename.c_str(), O_RDONLY );
+		if( fd == -1 )
+		{
+			throw runtime_error( m_filename + ": cannot open binary point file." );
+		}
+
+		struct stat fileStat;
+		if( fstat( fd, &fileStat ) == -1 || fileStat.st_size < sizeof( BinaryPointHeader ) )
+		{
+			close( fd );
+			throw runtime_error( m_filename + ": binary point file is too small to have a header." );
+		}
+
+		m_mappingSize = fileStat.st_size;
+		m_mapping = mmap( nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd );
+
+		if( m_mapping == MAP_FAILED )
+		{
+			throw runtime_error( m_filename + ": cannot map binary point file." );
+		}
+
+		memcpy( &m_header, m_mapping, sizeof( BinaryPointHeader ) );
+
+		if( memcmp( m_header.m_magic, BinaryPointHeader::MAGIC, sizeof( BinaryPointHeader::MAGIC ) )
+			|| m_header.m_version != BinaryPointHeader::VERSION )
+		{
+			munmap( m_mapping, m_mappingSize );
+			throw runtime_error( m_filename + ": invalid binary point file header." );
+		}
+
+		if( m_mappingSize < sizeof( BinaryPointHeader ) + m_header.m_nPoints * m_header.stride() )
+		{
+			munmap( m_mapping, m_mappingSize );
+			throw runtime_error( m_filename + ": binary point file is truncated." );
+		}
+
+		m_records = static_cast< const char* >( m_mapping ) + sizeof( BinaryPointHeader );
+
+		// The points are read once, in order.
+		madvise( m_mapping, m_mappingSize, MADV_SEQUENTIAL );
+
+		m_initTime = Profiler::elapsedTime( now, "MmapPointReader init" );
+	}
+
+	inline MmapPointReader::~MmapPointReader()
+	{
+		if( m_mapping != MAP_FAILED )
+		{
+			munmap( m_mapping, m_mappingSize );
+		}
+	}
+
+	inline void MmapPointReader::readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+											  ulong batchSize )
+	{
+		auto now = Profiler::now( "MmapPointReader read" );
+
+		if( hasNormals() )
+		{
+			const Point* points = this->points();
+			for( ulong i = 0; i < m_header.m_nPoints; i += batchSize )
+			{
+				onBatchDone( PointBatch( points + i, std::min( batchSize, m_header.m_nPoints - i ) ) );
+			}
+		}
+		else
+		{
+			PointBatcher batcher( onBatchDone, batchSize );
+			const float* pos = reinterpret_cast< const float* >( m_records );
+			for( ulong i = 0; i < m_header.m_nPoints; ++i, pos += 3 )
+			{
+				// Same default normal as PlyPointReader.
+				batcher.push( Point( Vec3( 1.f, 0.f, 0.f ), Vec3( pos[ 0 ], pos[ 1 ], pos[ 2 ] ) ) );
+			}
+			batcher.flush();
+		}
+
+		m_readTime = Profiler::elapsedTime( now, "MmapPointReader read" );
+	}
+}
+
+#endif
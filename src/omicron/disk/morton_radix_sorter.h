@@ -0,0 +1,184 @@
+#ifndef MORTON_RADIX_SORTER_H
+#define MORTON_RADIX_SORTER_H
+
+#include <omp.h>
+#include <array>
+#include <vector>
+#include "omicron/basic/point.h"
+#include "omicron/hierarchy/octree_dimensions.h"
+
+namespace omicron::disk
+{
+	using namespace std;
+	using namespace hierarchy;
+
+	/** Sorts points in z order computing each point's morton code only once. The codes are used as keys of a parallel
+	 * LSD radix sort, which also carries the point indices. The points are permuted in place afterwards, so the only
+	 * extra memory is the keys and the radix sort buffer.
+	 * @param Morton is the MortonCode type. */
+	template< typename Morton >
+	class MortonRadixSorter
+	{
+	public:
+		using OctreeDim = OctreeDimensions< Morton >;
+
+		/** Radix sort key and its point index. */
+		typedef struct MortonKey
+		{
+			ulong m_key;
+			ulong m_index;
+		} MortonKey;
+
+		using KeyVector = vector< MortonKey, TbbAllocator< MortonKey > >;
+
+		MortonRadixSorter( const OctreeDim& dim )
+		: m_dim( dim )
+		{}
+
+		/** Sorts the points in [ begin, end ). The sort is stable. */
+		template< typename RandomIt >
+		void sort( RandomIt begin, RandomIt end ) const;
+
+		/** @returns the memory used by sort() per point, besides the points themselves. */
+		static constexpr ulong sortBytesPerPoint() { return 2ul * sizeof( MortonKey ); }
+
+		/** Computes the morton code of each point in [ begin, end ) in parallel. */
+		template< typename RandomIt >
+		KeyVector computeKeys( RandomIt begin, RandomIt end ) const;
+
+		/** Sorts keys by m_key with a stable parallel LSD radix sort with 8-bit digits. */
+		void sortKeys( KeyVector& keys ) const;
+
+		/** @returns the number of significant bits of the keys: 3 per level plus the morton code's leading bit. */
+		int keyBits() const { return 3 * m_dim.m_nodeLvl + 1; }
+
+	private:
+		static constexpr int DIGIT_BITS = 8;
+		static constexpr int N_DIGITS = 1 << DIGIT_BITS;
+
+		using Histogram = array< ulong, N_DIGITS >;
+
+		OctreeDim m_dim;
+	};
+
+	template< typename Morton >
+	template< typename RandomIt >
+	void MortonRadixSorter< Morton >::sort( RandomIt begin, RandomIt end ) const
+	{
+		using Value = typename iterator_traits< RandomIt >::value_type;
+
+		ulong nPoints = end - begin;
+		KeyVector keys = computeKeys( begin, end );
+		sortKeys( keys );
+
+		// Position i receives the point at keys[ i ].m_index. The permutation is applied following its cycles, marking
+		// each placed position by pointing its index to itself.
+		for( ulong i = 0ul; i < nPoints; ++i )
+		{
+			if( keys[ i ].m_index == i )
+			{
+				continue;
+			}
+
+			Value first = std::move( begin[ i ] );
+			ulong pos = i;
+			while( keys[ pos ].m_index != i )
+			{
+				ulong src = keys[ pos ].m_index;
+				begin[ pos ] = std::move( begin[ src ] );
+				keys[ pos ].m_index = pos;
+				pos = src;
+			}
+			begin[ pos ] = std::move( first );
+			keys[ pos ].m_index = pos;
+		}
+	}
+
+	template< typename Morton >
+	template< typename RandomIt >
+	typename MortonRadixSorter< Morton >::KeyVector MortonRadixSorter< Morton >
+	::computeKeys( RandomIt begin, RandomIt end ) const
+	{
+		long nPoints = end - begin;
+		KeyVector keys( nPoints );
+
+		#pragma omp parallel for
+		for( long i = 0; i < nPoints; ++i )
+		{
+			keys[ i ].m_key = m_dim.calcMorton( begin[ i ] ).getBits();
+			keys[ i ].m_index = i;
+		}
+
+		return keys;
+	}
+
+	template< typename Morton >
+	void MortonRadixSorter< Morton >::sortKeys( KeyVector& keys ) const
+	{
+		ulong nKeys = keys.size();
+		KeyVector buffer( nKeys );
+		vector< Histogram > histograms( omp_get_max_threads() );
+
+		for( int shift = 0; shift < keyBits(); shift += DIGIT_BITS )
+		{
+			bool skipPass = false;
+
+			#pragma omp parallel num_threads( histograms.size() )
+			{
+				int threadIdx = omp_get_thread_num();
+				int nThreads = omp_get_num_threads();
+				ulong blockBegin = nKeys * threadIdx / nThreads;
+				ulong blockEnd = nKeys * ( threadIdx + 1 ) / nThreads;
+
+				Histogram& histogram = histograms[ threadIdx ];
+				histogram.fill( 0ul );
+
+				for( ulong i = blockBegin; i < blockEnd; ++i )
+				{
+					++histogram[ ( keys[ i ].m_key >> shift ) & ( N_DIGITS - 1 ) ];
+				}
+
+				#pragma omp barrier
+
+				#pragma omp single
+				{
+					// Exclusive prefix sum in digit-major order, so each thread scatters its block after the blocks of
+					// the previous threads for the same digit. This keeps the sort stable.
+					ulong offset = 0ul;
+					for( int digit = 0; digit < N_DIGITS; ++digit )
+					{
+						ulong digitCount = 0ul;
+						for( int t = 0; t < nThreads; ++t )
+						{
+							ulong count = histograms[ t ][ digit ];
+							histograms[ t ][ digit ] = offset;
+							offset += count;
+							digitCount += count;
+						}
+
+						// All keys have the same digit. The pass would not change the order.
+						if( digitCount == nKeys )
+						{
+							skipPass = true;
+						}
+					}
+				}
+
+				if( !skipPass )
+				{
+					for( ulong i = blockBegin; i < blockEnd; ++i )
+					{
+						buffer[ histogram[ ( keys[ i ].m_key >> shift ) & ( N_DIGITS - 1 ) ]++ ] = keys[ i ];
+					}
+				}
+			}
+
+			if( !skipPass )
+			{
+				keys.swap( buffer );
+			}
+		}
+	}
+}
+
+#endif
@@ -2,6 +2,9 @@
 #define OCTREE_FILE_WRITER_H
 
 #include <queue>
+#include "omicron/disk/indexed_octree_file.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "omicron/disk/point_codec.h"
 #include "omicron/hierarchy/o1_octree_node.h"
 #include "omicron/hierarchy/octree_dimensions.h"
 #include "omicron/hierarchy/hierarchy_creation_log.h"
@@ -28,7 +31,28 @@ namespace omicron::disk
 		 * @param root the root node of the octree. */
 		void writeBreadth( const string& filename, const Node& root );
 
-		/** Reads an octree file written previously by writeDepth() or writeBreadth().
+		/** Writes an indexed octree file, which can be mapped and paged in by IndexedOctreeFile. The file has a node
+		 * table in breadth-first order followed by the node contents.
+		 * @param filename path to the file to be written with the octree.
+		 * @param root the root node of the octree.
+		 * @param dimensions contains the octree dimensions used to calculate morton codes from node data.
+		 * @param quantizeFlag indicates that node contents should be written as QuantizedSurfels, relative to the node
+		 * boxes. Halves the contents size, with precision loss. */
+		void writeIndexed( const string& filename, const Node& root, const OctreeDimensions<Morton>& dimensions,
+						   bool quantizeFlag = false );
+
+		/** Writes a compressed octree file in breadth-first order. Node contents are PointCodec blocks, sorted in the
+		 * morton order of their bounding boxes before encoding, so consecutive elements are close and their deltas small.
+		 * Structure: | magic | node data |, with node data being | leaf flag | number of children | contents block |.
+		 * @param filename path to the file to be written with the octree.
+		 * @param root the root node of the octree.
+		 * @param codec is the codec used to compress node contents. */
+		void writeCompressed( const string& filename, const Node& root, const PointCodec& codec = PointCodec() );
+
+		/** @returns true if the file was written by writeCompressed(). */
+		static bool isCompressed( const string& filename );
+
+		/** Reads an octree file written previously by writeDepth(), writeBreadth(), writeIndexed() or writeCompressed().
 		 * @param filename path to the octree binary file.
 		 * @returns a pointer to the read octree. */
 		NodePtr read( const string& filename );
@@ -57,6 +81,14 @@ namespace omicron::disk
 		void readBreadthFirst(
 			NodePtr& root, ifstream& file, const function< void(const typename Node::NodeArray&) >& onSiblingGroupRead = [](const typename Node::NodeArray&){});
 
+		// Reads the nodes of a file written by writeCompressed().
+		NodePtr readCompressed( const string& filename );
+
+		// Sorts surfels in the morton order of their bounding box, at the deepest level of Morton.
+		static void sortInBox( vector< Surfel >& surfels );
+
+		static constexpr char COMPRESSED_MAGIC[ 8 ] = { 'O', 'M', 'C', 'R', 'N', 'C', 'M', 'P' };
+
 		// Asynchronous read variables.
 		FuturePtr m_future;
 		NodePtr m_root;
@@ -123,9 +155,195 @@ namespace omicron::disk
 		}
 	}
 
+	template<typename Morton>
+	inline void OctreeFile<Morton>::writeIndexed( const string& filename, const OctreeFile::Node& root,
+												  const OctreeDimensions<Morton>& dimensions, bool quantizeFlag )
+	{
+		cout << "Saving indexed binary octree to " << filename << endl << endl;
+		
+		ofstream file( filename, ofstream::out | ofstream::binary );
+		
+		if( file.fail() )
+		{
+			stringstream ss; ss << filename << " could not be opened properly.";
+			throw logic_error( ss.str() );
+		}
+		
+		// Breadth-first traversal. Children of a node are pushed in order, so the table is sorted by morton code and
+		// the children of the i-th inner node follow the children of the previous inner nodes.
+		vector<const Node*> nodes;
+		vector<IndexedOctreeEntry> entries;
+		
+		nodes.push_back( &root );
+		entries.push_back( IndexedOctreeEntry() );
+		entries[ 0 ].m_morton = 0x1;
+		
+		vector<uint> levels( 1, 0u );
+		uint64_t contentsSize = 0ul;
+		
+		for( size_t i = 0; i < nodes.size(); ++i )
+		{
+			const Node& node = *nodes[ i ];
+			IndexedOctreeEntry& entry = entries[ i ];
+			
+			entry.m_contentsOffset = contentsSize;
+			entry.m_nContents = node.getContents().size();
+			entry.m_flags = node.isLeaf() ? IndexedOctreeEntry::IS_LEAF_FLAG : 0u;
+			entry.m_firstChild = nodes.size();
+			entry.m_nChildren = node.child().size();
+			contentsSize += quantizeFlag ? QuantizedSurfels::serializedSize( entry.m_nContents )
+										 : entry.m_nContents * sizeof( Surfel );
+			
+			if( node.child().empty() )
+			{
+				continue;
+			}
+			
+			uint childLvl = levels[ i ] + 1;
+			OctreeDimensions<Morton> childLvlDim( dimensions, childLvl );
+			
+			for( const Node& child : node.child() )
+			{
+				if( child.getContents().empty() )
+				{
+					throw logic_error( "Indexed octree files cannot have non-root nodes without contents." );
+				}
+				
+				IndexedOctreeEntry childEntry;
+				childEntry.m_morton = childLvlDim.calcMorton( child ).getBits();
+				
+				nodes.push_back( &child );
+				entries.push_back( childEntry );
+				levels.push_back( childLvl );
+			}
+		}
+		
+		IndexedOctreeHeader header;
+		header.m_depth = dimensions.m_nodeLvl;
+		header.m_flags = quantizeFlag ? IndexedOctreeHeader::QUANTIZED_FLAG : 0u;
+		header.m_nNodes = entries.size();
+		header.m_contentsOffset = sizeof( IndexedOctreeHeader ) + entries.size() * sizeof( IndexedOctreeEntry );
+		for( int i = 0; i < 3; ++i )
+		{
+			header.m_origin[ i ] = dimensions.m_origin[ i ];
+			header.m_size[ i ] = dimensions.m_size[ i ];
+		}
+		
+		file.write( reinterpret_cast< const char* >( &header ), sizeof( IndexedOctreeHeader ) );
+		file.write( reinterpret_cast< const char* >( entries.data() ), entries.size() * sizeof( IndexedOctreeEntry ) );
+		
+		for( size_t i = 0; i < nodes.size(); ++i )
+		{
+			const typename Node::ContentsArray& contents = nodes[ i ]->getContents();
+			
+			if( quantizeFlag )
+			{
+				// The box is the node's morton box, extended in case some content is outside it.
+				Morton morton; morton.build( entries[ i ].m_morton );
+				AlignedBox3f box = OctreeDimensions<Morton>( dimensions, levels[ i ] ).getMortonBoundaries( morton );
+				for( const Surfel& surfel : contents )
+				{
+					box.extend( surfel.c );
+				}
+				
+				QuantizedSurfels( contents, box ).persist( file );
+			}
+			else
+			{
+				file.write( reinterpret_cast< const char* >( contents.data() ), contents.size() * sizeof( Surfel ) );
+			}
+		}
+	}
+
+	template<typename Morton>
+	inline void OctreeFile<Morton>::writeCompressed( const string& filename, const OctreeFile::Node& root,
+													 const PointCodec& codec )
+	{
+		cout << "Saving compressed binary octree to " << filename << endl << endl;
+		
+		ofstream file( filename, ofstream::out | ofstream::binary );
+		
+		if( file.fail() )
+		{
+			stringstream ss; ss << filename << " could not be opened properly.";
+			throw logic_error( ss.str() );
+		}
+		
+		file.write( COMPRESSED_MAGIC, sizeof( COMPRESSED_MAGIC ) );
+		
+		vector< Surfel > sorted;
+		std::queue<const Node*> q;
+		q.push(&root);
+		
+		while(!q.empty())
+		{
+			const Node* node = q.front();
+			q.pop();
+			
+			bool isLeaf = node->isLeaf();
+			uint nChildren = node->child().size();
+			Binary::write( file, isLeaf );
+			Binary::write( file, nChildren );
+			
+			const typename Node::ContentsArray& contents = node->getContents();
+			sorted.assign( contents.data(), contents.data() + contents.size() );
+			sortInBox( sorted );
+			codec.write( file, sorted.data(), sorted.size() );
+			
+			for(const Node& child : node->child())
+			{
+				q.push(&child);
+			}
+		}
+	}
+
+	template<typename Morton>
+	inline void OctreeFile<Morton>::sortInBox( vector< Surfel >& surfels )
+	{
+		if( surfels.size() < 2 )
+		{
+			return;
+		}
+		
+		AlignedBox3f box;
+		for( const Surfel& surfel : surfels )
+		{
+			box.extend( surfel.c );
+		}
+		
+		// The box is enlarged so surfels on its max faces are still inside and flat boxes have no zero sizes.
+		Vec3 size = box.sizes() * 1.001f + Vec3::Constant( 1.e-6f );
+		OctreeDimensions<Morton> dim( box.min(), size, Morton::maxLvl() );
+		MortonRadixSorter<Morton>( dim ).sort( surfels.begin(), surfels.end() );
+	}
+	
+	template<typename Morton>
+	bool OctreeFile<Morton>::isCompressed( const string& filename )
+	{
+		ifstream file( filename, ifstream::in | ifstream::binary );
+		char magic[ sizeof( COMPRESSED_MAGIC ) ];
+		file.read( magic, sizeof( magic ) );
+		
+		return file && memcmp( magic, COMPRESSED_MAGIC, sizeof( magic ) ) == 0;
+	}
+
 	template<typename Morton>
 	inline typename OctreeFile<Morton>::NodePtr OctreeFile<Morton>::read( const string& filename )
 	{
+		if( IndexedOctreeFile<Morton>::isIndexed( filename ) )
+		{
+			cout << "Indexed format detected." << endl << endl;
+			
+			return IndexedOctreeFile<Morton>( filename ).loadAll();
+		}
+		
+		if( isCompressed( filename ) )
+		{
+			cout << "Compressed format detected." << endl << endl;
+			
+			return readCompressed( filename );
+		}
+		
 		pair<ifstream, bool> fileAndHeader = readHeader(filename);
 		ifstream file(std::move(fileAndHeader.first));
 		bool isDepth = fileAndHeader.second;
@@ -159,9 +377,9 @@ namespace omicron::disk
 		m_octreeDim = dimensions;
 		m_onLevelDone = onLevelDone;
 
-		if(isDepth)
+		if(isDepth || IndexedOctreeFile<Morton>::isIndexed(filename) || isCompressed(filename))
 		{
-			throw logic_error("Octree file must have breadth-first ordered contents to be read asynchronously.");
+			throw logic_error("Octree file must have breadth-first ordered contents to be read asynchronously. Indexed files should be paged in with IndexedOctreeFile and compressed files should be read with read().");
 		}
 		else
 		{
@@ -227,6 +445,54 @@ namespace omicron::disk
 		return pair<ifstream, bool>(std::move(file), isDepth);
 	}
 
+	template<typename Morton>
+	inline typename OctreeFile<Morton>::NodePtr OctreeFile<Morton>::readCompressed( const string& filename )
+	{
+		ifstream file( filename, ifstream::in | ifstream::binary );
+		file.seekg( sizeof( COMPRESSED_MAGIC ) );
+		
+		auto readNode = [ & ]( uint& nChildren )
+		{
+			bool isLeaf;
+			Binary::read( file, isLeaf );
+			Binary::read( file, nChildren );
+			
+			return Node( PointCodec::read< typename Node::ContentsArray >( file ), isLeaf );
+		};
+		
+		uint nRootChildren;
+		NodePtr root = make_shared<Node>( readNode( nRootChildren ) );
+		
+		std::queue<pair<Node*, uint>> q;
+		if( nRootChildren > 0 )
+		{
+			q.push( pair<Node*, uint>( root.get(), nRootChildren ) );
+		}
+		
+		while(!q.empty())
+		{
+			Node* node = q.front().first;
+			typename Node::NodeArray children(q.front().second);
+			q.pop();
+			
+			for(typename Node::NodeArray::iterator it = children.begin(); it != children.end(); ++it)
+			{
+				uint nChildren;
+				*it = readNode( nChildren );
+				it->setParent(node);
+				
+				if( nChildren > 0 )
+				{
+					q.push( pair<Node*, uint>( it, nChildren ) );
+				}
+			}
+			
+			node->setChildren(std::move(children));
+		}
+		
+		return root;
+	}
+
 	template<typename Morton>
 	inline void OctreeFile<Morton>::readBreadthFirst(NodePtr& root, ifstream& file, const function< void(const typename Node::NodeArray&) >& onSiblingGroupRead)
 	{
@@ -3,11 +3,17 @@
 
 #include <jsoncpp/json/json.h>
 #include <fstream>
+#include <future>
+#include <mutex>
 #include <queue>
 #include "omicron/disk/ply_point_reader.h"
 #include "omicron/disk/ply_point_writter.h"
+#include "omicron/disk/binary_point_writter.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "omicron/disk/point_codec.h"
 #include "omicron/util/profiler.h"
 #include "omicron/hierarchy/octree_dimensions.h"
+#include "omicron/hierarchy/reconstruction_config.h"
 
 using namespace std;
 using namespace util;
@@ -16,9 +22,11 @@ namespace omicron::disk
 {
     using namespace hierarchy;
     
-	/** Out-of-core point sorter. Uses a simple k-way merge as the external sorting algorithm, dividin the data in k chunks,
-	 * applying a first pass where a parallel quicksort sorts each chunk and a second pass where the chunks are k-way merged
-	 * as the final result.*/
+	/** Out-of-core point sorter. Uses a k-way merge as the external sorting algorithm, dividing the data in k sorted runs
+	 * of chunk files. In the first pass a parallel radix sort sorts each run. In the second pass the morton code space is
+	 * partitioned into ranges, using splitters chosen from key samples of the chunks. The points in each range are counted,
+	 * so each range is k-way merged independently in parallel directly into its position in the sorted file, which has
+	 * fixed size records. */
 	template< typename Morton >
 	class OocPointSorter
 	{
@@ -34,69 +42,168 @@ namespace omicron::disk
 		 @param lvl is the octree level used to compute morton code for sorting.
 		 @param totalSize is the estimation of plyFolder's contents total size. This is used for calculating chunk size.
 		 In bytes.
-		 @param memoryQuota is the available memory for reading the points. Memory for sorting and writting a chunk should
-		 be left. In bytes. */
+		 @param memoryQuota is the available memory for reading and sorting the points. Memory for writting a chunk should
+		 be left. In bytes.
+		 @param config has the number of threads used for sorting and merging. */
 		OocPointSorter( const string& plyGroupFile, const string& plyOutputFolder, int lvl, const ulong totalSize,
-						const ulong memoryQuota );
+						const ulong memoryQuota, const ReconstructionConfig& config = ReconstructionConfig() );
 		
 		OocPointSorter( const string& plyGroupFile, const string& plyOutputFolder, const OctreeDim& dim,
-						const ulong totalSize, const ulong memoryQuota );
+						const ulong totalSize, const ulong memoryQuota,
+						const ReconstructionConfig& config = ReconstructionConfig() );
 		
 		/** Sorts the points.
 		 * @param eraseChunkFiles is true if the temporary chunk files are expected to be deleted after sorting, false
 		 * otherwise.
+		 * @param binaryOutputFlag is true if the sorted points should be written as a binary point file, which can be
+		 * read by MmapPointReader, false if they should be written as a .ply file.
 		 * @returns the json written to the resulting octree file. */
-		Json::Value sort( bool eraseChunkFilesFlag = true );
+		Json::Value sort( bool eraseChunkFilesFlag = true, bool binaryOutputFlag = false );
 		
 		/** Erases the chunk files. */
 		void eraseChunkFiles();
 		
+		/** Compresses the temporary chunk files with codec instead of writing them as .ply files. Should be called
+		 * before sort(). Callers honoring ReconstructionConfig::m_pointCompression pass
+		 * PointCodec::fromCompression() unless it is NO_COMPRESSION. */
+		void setChunkCodec( const PointCodec& codec ) { m_chunkCodec = codec; m_compressChunksFlag = true; }
+		
 		const OctreeDim& comp() { return m_comp; }
 		
 	private:
 		using PointVector = vector< Point, TbbAllocator< Point > >;
-		using ChunkVector = vector< PointVector, TbbAllocator< PointVector > >;
+		using KeyVector = vector< ulong, TbbAllocator< ulong > >;
 		
-		// Min heap entry.
-		typedef struct MergeEntry
+		// Number of key samples taken from each chunk to choose the merge splitters.
+		static constexpr int SAMPLES_PER_CHUNK = 64;
+		// Number of merge ranges per thread. More ranges than threads balance ranges with different densities.
+		static constexpr int RANGES_PER_THREAD = 4;
+		// Number of points in the output buffer of each merge range.
+		static constexpr ulong OUTPUT_BUFFER_POINTS = 1ul << 16;
+		
+		// Morton code bounds, size and key samples of a sorted chunk file.
+		typedef struct ChunkInfo
 		{
-			using Iter = typename PointVector::iterator;
+			ulong m_firstKey;
+			ulong m_lastKey;
+			ulong m_size;
+			KeyVector m_samples;
+		} ChunkInfo;
+		
+		// Range of morton codes [ m_begin, m_end ) merged independently. The last range also contains m_end.
+		typedef struct MergeRange
+		{
+			bool contains( const ulong key ) const { return key >= m_begin && ( m_isLast || key < m_end ); }
 			
-			MergeEntry( PointVector* points, const Iter iter, const int chunkIdx )
-			: m_points( points ),
-			m_iter( iter ),
-			m_chunkIdx( chunkIdx )
-			{}
+			bool overlaps( const ChunkInfo& info ) const
+			{
+				return info.m_lastKey >= m_begin && ( m_isLast || info.m_firstKey < m_end );
+			}
+			
+			ulong m_begin;
+			ulong m_end;
+			bool m_isLast;
+		} MergeRange;
+		
+		/** Sorted run of a chunk group, restricted to the chunks that overlap a merge range. The next chunk is read
+		 * asynchronously while the current one is merged. */
+		class RunStream
+		{
+		public:
+			RunStream( const OocPointSorter& sorter, const MergeRange& range, const int firstChunk, const int endChunk );
+			
+			/** @returns false when all points of the run in the range were consumed. */
+			bool valid() const { return m_valid; }
+			
+			const Point& point() const { return m_chunk[ m_pointIdx ]; }
+			
+			ulong key() const { return m_key; }
+			
+			void advance();
+			
+		private:
+			void prefetch();
 			
-			PointVector* m_points;
-			Iter m_iter;
+			/** Swaps the prefetched chunk in and skips its points before the range. */
+			void loadNextChunk();
+			
+			void updateKey();
+			
+			const OocPointSorter& m_sorter;
+			const MergeRange& m_range;
+			PointVector m_chunk;
+			future< PointVector > m_nextChunk;
 			int m_chunkIdx;
-		} MergeEntry;
+			int m_endChunk;
+			ulong m_pointIdx;
+			ulong m_key;
+			bool m_valid;
+		};
 		
-		// Min heap comparator.
-		typedef struct Comparator
+		// Min heap entry.
+		typedef struct MergeEntry
 		{
-			Comparator( const OctreeDim& dim )
-			: m_dim( dim ) {}
+			MergeEntry( RunStream* run, const int runIdx )
+			: m_key( run->key() ),
+			m_run( run ),
+			m_runIdx( runIdx )
+			{}
 			
-			bool operator()( const MergeEntry& entry0, const MergeEntry& entry1 ) const
+			// Min heap comparator. Ties are broken by run so the merge is deterministic.
+			bool operator>( const MergeEntry& other ) const
 			{
-				return m_dim( *entry1.m_iter, *entry0.m_iter );
+				return m_key > other.m_key || ( m_key == other.m_key && m_runIdx > other.m_runIdx );
 			}
 			
-			const OctreeDim& m_dim;
-		} Comparator;
+			ulong m_key;
+			RunStream* m_run;
+			int m_runIdx;
+		} MergeEntry;
 		
 		using HeapContainer = vector< MergeEntry, TbbAllocator< MergeEntry > >;
-		using MinHeap = priority_queue< MergeEntry, HeapContainer, Comparator >;
+		using MinHeap = priority_queue< MergeEntry, HeapContainer, greater< MergeEntry > >;
+		
+		// Layout of the sorted file. Records have fixed size, so the record of any point index can be sought.
+		typedef struct RecordFormat
+		{
+			void encode( const Point& p, char* record ) const;
+			
+			size_t m_headerSize;
+			size_t m_stride;
+			bool m_isBinary;
+			// Property types of .ply records.
+			vector< e_ply_type > m_plyTypes;
+		} RecordFormat;
 		
 		void initChunkData( const ulong totalSize, const ulong memoryQuota );
 		
 		void writeChunkGroup( PointVector& chunk, typename PointVector::iterator& currentIter, const ulong& readPoints,
-							  int& nChunks, const Reader& reader ) const;
-
+							  int& nChunks, const Reader& reader );
+		
 		PointVector readChunk( const int chunkIdx ) const;
 		
+		/** Chooses the merge ranges from the chunk key samples. */
+		vector< MergeRange > chooseMergeRanges() const;
+		
+		/** @returns the index of the first point of each range in the sorted file, followed by the total number of
+		 * points. */
+		vector< ulong > countRangeOffsets( const vector< MergeRange >& ranges ) const;
+		
+		/** Creates the sorted file with its header.
+		 * @returns the record format of the file. */
+		RecordFormat writeSortedHeader( const string& sortedFilename, const Reader& headerReader,
+										const bool binaryOutputFlag ) const;
+		
+		/** K-way merges the points of all runs inside range into the sorted file, starting at record index offset.
+		 * @param nPoints is the number of points counted in the range. */
+		void mergeRange( const MergeRange& range, const ulong offset, const ulong nPoints,
+						 const string& sortedFilename, const RecordFormat& format ) const;
+		
+		string chunkFilename( const int chunkIdx ) const;
+		
+		/** @returns the .ply file whose header is used for the sorted file. */
+		string headerFilename() const;
+		
 		OctreeDim m_comp;
 		string m_plyGroupFile;
 		string m_plyOutputFolder;
@@ -107,17 +214,26 @@ namespace omicron::disk
 		ulong m_pointsPerChunk;
 		int m_chunksPerGroup;
 		int m_groups;
+		int m_nThreads;
+		
+		// Info of all chunks, in chunk file order.
+		vector< ChunkInfo > m_chunkInfos;
 		
 		float m_scale;
+		
+		PointCodec m_chunkCodec;
+		bool m_compressChunksFlag;
 	};
 	
 	template< typename Morton >
 	OocPointSorter< Morton >
 	::OocPointSorter( const string& plyGroupFile, const string& plyOutputFolder, int lvl, const ulong totalSize,
-					  const ulong memoryQuota )
+					  const ulong memoryQuota, const ReconstructionConfig& config )
 	: m_plyGroupFile( plyGroupFile ),
 	m_plyOutputFolder( plyOutputFolder ),
-	m_totalPoints( 0ul )
+	m_totalPoints( 0ul ),
+	m_nThreads( config.m_oocSortThreads ),
+	m_compressChunksFlag( false )
 	{
 		if( m_plyGroupFile.find( ".gp" ) == m_plyGroupFile.npos )
 		{
@@ -170,12 +286,14 @@ namespace omicron::disk
 	template< typename Morton >
 	OocPointSorter< Morton >
 	::OocPointSorter( const string& plyGroupFile, const string& plyOutputFolder, const OctreeDim& dim,
-					  const ulong totalSize, const ulong memoryQuota )
+					  const ulong totalSize, const ulong memoryQuota, const ReconstructionConfig& config )
 	: m_plyGroupFile( plyGroupFile ),
 	m_plyOutputFolder( plyOutputFolder ),
 	m_comp( dim ),
 	m_origin( 0.f, 0.f, 0.f ),
-	m_scale( 1.f )
+	m_nThreads( config.m_oocSortThreads ),
+	m_scale( 1.f ),
+	m_compressChunksFlag( false )
 	{
 		string plyFilename;
 		ifstream ifs( plyGroupFile );
@@ -188,19 +306,21 @@ namespace omicron::disk
 	}
 	
 	template< typename Morton >
-	Json::Value OocPointSorter< Morton >::sort( bool eraseChunkFilesFlag )
+	Json::Value OocPointSorter< Morton >::sort( bool eraseChunkFilesFlag, bool binaryOutputFlag )
 	{
-		omp_set_num_threads( 8 );
+		omp_set_num_threads( m_nThreads );
 		
 		int nameBeginIdx = ( m_plyGroupFile.find_last_of( '/' ) == m_plyGroupFile.npos ) ? 0
 							: m_plyGroupFile.find_last_of( '/' ) + 1;
 		int nameEndIdx = m_plyGroupFile.find_last_of( '.' );
 		string datasetName = m_plyGroupFile.substr( nameBeginIdx, nameEndIdx - nameBeginIdx );
-		string sortedFilename = m_plyOutputFolder + "/" + datasetName + ".ply";
+		string sortedFilename = m_plyOutputFolder + "/" + datasetName
+								+ ( binaryOutputFlag ? BinaryPointHeader::EXTENSION : ".ply" );
 		
 		auto start = Profiler::now( "Chunk sorting" );
 		
 		int nChunks = 0;
+		m_chunkInfos.clear();
 		{
 			ulong readPoints = 0;
 			ifstream groupFile( m_plyGroupFile );
@@ -258,54 +378,16 @@ namespace omicron::disk
 		start = Profiler::now( "Chunk merging" );
 		
 		{
-			// K-way merge chunks
-			ChunkVector chunkVector( m_groups );
-			Comparator comparator( m_comp );
-			HeapContainer heapContainer;
-			MinHeap minHeap( comparator, heapContainer );
-			int chunkGroupIdx = 0;
-			
-			// Init the k chunks to start merging.
-			for( PointVector& chunk : chunkVector )
-			{
-				int chunkIdx = chunkGroupIdx++ * m_chunksPerGroup;
-				
-				if( chunkIdx < nChunks )
-				{
-					chunk = readChunk( chunkIdx );
-					minHeap.push( MergeEntry( &chunk, chunk.begin(), chunkIdx ) );
-				}
-			}
+			vector< MergeRange > ranges = chooseMergeRanges();
+			vector< ulong > rangeOffsets = countRangeOffsets( ranges );
 			
-			Writter resultWritter( Reader( m_plyOutputFolder + "/sorted_chunk0.ply" ), sortedFilename, m_totalPoints );
+			RecordFormat format = writeSortedHeader( sortedFilename, Reader( headerFilename() ), binaryOutputFlag );
 			
-			while( !minHeap.empty() )
+			#pragma omp parallel for schedule( dynamic ) num_threads( m_nThreads )
+			for( int i = 0; i < ranges.size(); ++i )
 			{
-				MergeEntry entry = minHeap.top();
-				minHeap.pop();
-				
-				resultWritter.write( *entry.m_iter );
-				
-				typename MergeEntry::Iter nextIter = next( entry.m_iter );
-				
-				if( nextIter == entry.m_points->end() )
-				{
-					// Get next available chunk.
-					int currentChunkGroupIdx = float( entry.m_chunkIdx++ ) / float( m_chunksPerGroup );
-					int nextChunkGroupIdx = float( entry.m_chunkIdx ) / float( m_chunksPerGroup );
-					
-					if( currentChunkGroupIdx == nextChunkGroupIdx && entry.m_chunkIdx < nChunks )
-					{
-						*entry.m_points = readChunk( entry.m_chunkIdx );
-						entry.m_iter = entry.m_points->begin();
-						minHeap.push( entry );
-					}
-				}
-				else
-				{
-					entry.m_iter = nextIter;
-					minHeap.push( entry );
-				}
+				mergeRange( ranges[ i ], rangeOffsets[ i ], rangeOffsets[ i + 1 ] - rangeOffsets[ i ], sortedFilename,
+							format );
 			}
 		}
 		
@@ -341,9 +423,15 @@ namespace omicron::disk
 	template< typename Morton >
 	void OocPointSorter< Morton >::initChunkData( const ulong totalSize, const ulong memoryQuota )
 	{
-		m_groups =  ceil( float( totalSize ) / float( memoryQuota ) );
+		// A group is sorted in memory, so the quota should fit its points and the radix sort keys.
+		float pointBytes = float( sizeof( Point ) + MortonRadixSorter< Morton >::sortBytesPerPoint() );
+		float sortBytes = float( m_totalPoints ) * pointBytes;
+		m_groups =  ceil( std::max( float( totalSize ), sortBytes ) / float( memoryQuota ) );
 		m_pointsPerChunkGroup = ceil( float( m_totalPoints ) / float( m_groups ) );
-		m_pointsPerChunk = ceil( float( m_pointsPerChunkGroup ) / float( m_groups ) );
+		// Each merging thread holds the current and the prefetched chunk of each group, so chunks are divided by the
+		// number of merging threads and buffers to keep the merge in the memory quota. Smaller chunks also let each
+		// range read only the chunks that overlap it, instead of whole groups.
+		m_pointsPerChunk = ceil( float( m_pointsPerChunkGroup ) / float( m_groups * 2 * m_nThreads ) );
 		m_chunksPerGroup = ceil( float( m_pointsPerChunkGroup ) / float( m_pointsPerChunk ) );
 		
 		// Debug
@@ -361,18 +449,17 @@ namespace omicron::disk
 		// Erase temporary chunk files.
 		for( int i = 0; i < nChunks; ++i )
 		{
-			stringstream ss; ss << m_plyOutputFolder << "/sorted_chunk" << i << ".ply";
-			remove( ss.str().c_str() );
+			remove( chunkFilename( i ).c_str() );
 		}
 	}
 	
 	template< typename Morton >
 	inline void OocPointSorter< Morton >
 	::writeChunkGroup( PointVector& chunk, typename PointVector::iterator& currentIter, const ulong& readPoints,
-					   int& nChunks, const Reader& reader ) const 
+					   int& nChunks, const Reader& reader )
 	{
 		// Sort chunk.
-		std::sort( chunk.begin(), chunk.end(), m_comp );
+		MortonRadixSorter< Morton >( m_comp ).sort( chunk.begin(), chunk.end() );
 		
 		auto chunkIter = chunk.begin();
 		
@@ -387,13 +474,39 @@ namespace omicron::disk
 			ulong chunkSize = ( pointsLeftInGroup < m_pointsPerChunk ) ? pointsLeftInGroup : m_pointsPerChunk;
 			pointsLeftInGroup -= chunkSize;
 			
-			stringstream ss; ss << m_plyOutputFolder << "/sorted_chunk" << nChunks++ << ".ply";
-			cout << "Writting chunk with size " << chunkSize << " at " << ss.str() << endl << endl;
-			Writter writter( reader, ss.str(), chunkSize );
+			string filename = chunkFilename( nChunks++ );
+			cout << "Writting chunk with size " << chunkSize << " at " << filename << endl << endl;
 			
-			for( int i = 0; i < chunkSize; ++i )
+			ChunkInfo info;
+			info.m_firstKey = m_comp.calcMorton( *chunkIter ).getBits();
+			info.m_lastKey = m_comp.calcMorton( *( chunkIter + ( chunkSize - 1 ) ) ).getBits();
+			info.m_size = chunkSize;
+			
+			ulong sampleStep = std::max( 1ul, chunkSize / SAMPLES_PER_CHUNK );
+			for( ulong i = 0; i < chunkSize; i += sampleStep )
+			{
+				info.m_samples.push_back( m_comp.calcMorton( *( chunkIter + i ) ).getBits() );
+			}
+			m_chunkInfos.push_back( std::move( info ) );
+			
+			if( m_compressChunksFlag )
+			{
+				ofstream file( filename, ofstream::out | ofstream::binary | ofstream::trunc );
+				if( !file )
+				{
+					throw runtime_error( filename + ": cannot open chunk file to write." );
+				}
+				
+				m_chunkCodec.write( file, &*chunkIter, chunkSize );
+				chunkIter += chunkSize;
+			}
+			else
 			{
-				writter.write( *chunkIter++ );
+				Writter writter( reader, filename, chunkSize );
+				for( int i = 0; i < chunkSize; ++i )
+				{
+					writter.write( *chunkIter++ );
+				}
 			}
 		}
 		
@@ -406,12 +519,22 @@ namespace omicron::disk
 	inline typename OocPointSorter< Morton >::PointVector OocPointSorter< Morton >
 	::readChunk( const int chunkIdx ) const 
 	{
+		if( m_compressChunksFlag )
+		{
+			ifstream file( chunkFilename( chunkIdx ), ifstream::in | ifstream::binary );
+			if( !file )
+			{
+				throw runtime_error( chunkFilename( chunkIdx ) + ": cannot open chunk file to read." );
+			}
+			
+			return PointCodec::read< PointVector >( file );
+		}
+		
 		ulong readPoints = 0;
 		PointVector chunk( m_pointsPerChunk );
 		auto iter = chunk.begin();
 		
-		stringstream ss; ss << m_plyOutputFolder << "/sorted_chunk" << chunkIdx << ".ply";
-		Reader reader( ss.str() );
+		Reader reader( chunkFilename( chunkIdx ) );
 		reader.read(
 			[ & ]( const Point& p )
 			{
@@ -427,6 +550,351 @@ namespace omicron::disk
 		
 		return chunk;
 	}
+	
+	template< typename Morton >
+	vector< typename OocPointSorter< Morton >::MergeRange > OocPointSorter< Morton >::chooseMergeRanges() const
+	{
+		KeyVector samples;
+		for( const ChunkInfo& info : m_chunkInfos )
+		{
+			samples.insert( samples.end(), info.m_samples.begin(), info.m_samples.end() );
+		}
+		std::sort( samples.begin(), samples.end() );
+		
+		// Splitters are sample quantiles. Repeated splitters would define empty ranges and are skipped.
+		int nRanges = m_nThreads * RANGES_PER_THREAD;
+		KeyVector splitters;
+		for( int i = 1; i < nRanges && !samples.empty(); ++i )
+		{
+			ulong splitter = samples[ ( i * samples.size() ) / nRanges ];
+			if( splitter > 0ul && ( splitters.empty() || splitter > splitters.back() ) )
+			{
+				splitters.push_back( splitter );
+			}
+		}
+		
+		vector< MergeRange > ranges;
+		ulong begin = 0ul;
+		for( const ulong splitter : splitters )
+		{
+			ranges.push_back( MergeRange{ begin, splitter, false } );
+			begin = splitter;
+		}
+		ranges.push_back( MergeRange{ begin, numeric_limits< ulong >::max(), true } );
+		
+		return ranges;
+	}
+	
+	template< typename Morton >
+	vector< ulong > OocPointSorter< Morton >::countRangeOffsets( const vector< MergeRange >& ranges ) const
+	{
+		auto rangeIdx = [ & ]( const ulong key )
+		{
+			return upper_bound( ranges.begin(), ranges.end(), key,
+				[]( const ulong key, const MergeRange& range ) { return key < range.m_begin; }
+			) - ranges.begin() - 1;
+		};
+		
+		vector< ulong > counts( ranges.size(), 0ul );
+		mutex countsMutex;
+		
+		// A chunk inside a single range is counted by its size, so only the chunks that cross a splitter are read.
+		#pragma omp parallel for schedule( dynamic ) num_threads( m_nThreads )
+		for( int i = 0; i < m_chunkInfos.size(); ++i )
+		{
+			const ChunkInfo& info = m_chunkInfos[ i ];
+			int firstRange = rangeIdx( info.m_firstKey );
+			int lastRange = rangeIdx( info.m_lastKey );
+			
+			if( firstRange == lastRange )
+			{
+				lock_guard< mutex > lock( countsMutex );
+				counts[ firstRange ] += info.m_size;
+				continue;
+			}
+			
+			PointVector chunk = readChunk( i );
+			vector< ulong > chunkCounts;
+			auto begin = chunk.begin();
+			for( int j = firstRange; j < lastRange; ++j )
+			{
+				ulong rangeEnd = ranges[ j ].m_end;
+				auto end = partition_point( begin, chunk.end(),
+					[ & ]( const Point& p ) { return m_comp.calcMorton( p ).getBits() < rangeEnd; }
+				);
+				chunkCounts.push_back( end - begin );
+				begin = end;
+			}
+			chunkCounts.push_back( chunk.end() - begin );
+			
+			lock_guard< mutex > lock( countsMutex );
+			for( int j = firstRange; j <= lastRange; ++j )
+			{
+				counts[ j ] += chunkCounts[ j - firstRange ];
+			}
+		}
+		
+		vector< ulong > offsets( 1, 0ul );
+		for( const ulong count : counts )
+		{
+			offsets.push_back( offsets.back() + count );
+		}
+		
+		return offsets;
+	}
+	
+	template< typename Morton >
+	typename OocPointSorter< Morton >::RecordFormat OocPointSorter< Morton >
+	::writeSortedHeader( const string& sortedFilename, const Reader& headerReader, const bool binaryOutputFlag ) const
+	{
+		RecordFormat format;
+		format.m_isBinary = binaryOutputFlag;
+		
+		if( binaryOutputFlag )
+		{
+			BinaryPointHeader header = BinaryPointWritter< Morton >::createHeader( m_comp, headerReader.hasNormals() );
+			header.m_nPoints = m_totalPoints;
+			header.m_firstMorton = numeric_limits< ulong >::max();
+			header.m_lastMorton = 0ul;
+			for( const ChunkInfo& info : m_chunkInfos )
+			{
+				header.m_firstMorton = std::min( header.m_firstMorton, info.m_firstKey );
+				header.m_lastMorton = std::max( header.m_lastMorton, info.m_lastKey );
+			}
+			
+			ofstream file( sortedFilename, ofstream::out | ofstream::binary | ofstream::trunc );
+			if( !file )
+			{
+				throw runtime_error( sortedFilename + ": cannot open binary point file to write." );
+			}
+			file.write( reinterpret_cast< const char* >( &header ), sizeof( BinaryPointHeader ) );
+			
+			format.m_headerSize = sizeof( BinaryPointHeader );
+			format.m_stride = header.stride();
+		}
+		else
+		{
+			// The writter only writes the header, which is flushed when it is closed.
+			{
+				Writter writter( headerReader, sortedFilename, m_totalPoints );
+				format.m_plyTypes = writter.propertyTypes();
+			}
+			
+			format.m_headerSize = ifstream( sortedFilename, ifstream::in | ifstream::binary | ifstream::ate ).tellg();
+			format.m_stride = Writter::recordSize( format.m_plyTypes );
+		}
+		
+		return format;
+	}
+	
+	template< typename Morton >
+	void OocPointSorter< Morton >::mergeRange( const MergeRange& range, const ulong offset, const ulong nPoints,
+											   const string& sortedFilename, const RecordFormat& format ) const
+	{
+		int nChunks = m_chunkInfos.size();
+		vector< unique_ptr< RunStream > > runs;
+		
+		// The chunks of a group are consecutive in key order, so the chunks overlapping the range are also consecutive.
+		for( int group = 0; group < m_groups; ++group )
+		{
+			int groupEnd = std::min( ( group + 1 ) * m_chunksPerGroup, nChunks );
+			int firstChunk = group * m_chunksPerGroup;
+			
+			while( firstChunk < groupEnd && !range.overlaps( m_chunkInfos[ firstChunk ] ) )
+			{
+				++firstChunk;
+			}
+			
+			int endChunk = firstChunk;
+			while( endChunk < groupEnd && range.overlaps( m_chunkInfos[ endChunk ] ) )
+			{
+				++endChunk;
+			}
+			
+			if( firstChunk < endChunk )
+			{
+				runs.emplace_back( new RunStream( *this, range, firstChunk, endChunk ) );
+			}
+		}
+		
+		HeapContainer heapContainer;
+		heapContainer.reserve( runs.size() );
+		MinHeap minHeap( greater< MergeEntry >(), std::move( heapContainer ) );
+		
+		for( int i = 0; i < runs.size(); ++i )
+		{
+			if( runs[ i ]->valid() )
+			{
+				minHeap.push( MergeEntry( runs[ i ].get(), i ) );
+			}
+		}
+		
+		// Each range has its own stream, so ranges are written concurrently at their offsets.
+		fstream file( sortedFilename, fstream::in | fstream::out | fstream::binary );
+		if( !file )
+		{
+			throw runtime_error( sortedFilename + ": cannot open sorted file to write." );
+		}
+		file.seekp( format.m_headerSize + offset * format.m_stride );
+		
+		vector< char > buffer( OUTPUT_BUFFER_POINTS * format.m_stride );
+		ulong nBuffered = 0ul;
+		ulong nWritten = 0ul;
+		
+		while( !minHeap.empty() )
+		{
+			MergeEntry entry = minHeap.top();
+			minHeap.pop();
+			
+			format.encode( entry.m_run->point(), buffer.data() + nBuffered * format.m_stride );
+			if( ++nBuffered == OUTPUT_BUFFER_POINTS )
+			{
+				file.write( buffer.data(), nBuffered * format.m_stride );
+				nWritten += nBuffered;
+				nBuffered = 0ul;
+			}
+			
+			entry.m_run->advance();
+			if( entry.m_run->valid() )
+			{
+				minHeap.push( MergeEntry( entry.m_run, entry.m_runIdx ) );
+			}
+		}
+		
+		file.write( buffer.data(), nBuffered * format.m_stride );
+		nWritten += nBuffered;
+		
+		if( nWritten != nPoints )
+		{
+			throw logic_error( "Merged range size differs from its counted size." );
+		}
+	}
+	
+	template< typename Morton >
+	inline string OocPointSorter< Morton >::chunkFilename( const int chunkIdx ) const
+	{
+		stringstream ss; ss << m_plyOutputFolder << "/sorted_chunk" << chunkIdx << ( m_compressChunksFlag ? ".pcc" : ".ply" );
+		return ss.str();
+	}
+	
+	template< typename Morton >
+	inline string OocPointSorter< Morton >::headerFilename() const
+	{
+		// Compressed chunks have no header, so the first input file is used instead.
+		if( m_compressChunksFlag )
+		{
+			string plyFilename;
+			ifstream groupFile( m_plyGroupFile );
+			getline( groupFile, plyFilename );
+			return plyFilename;
+		}
+		
+		return chunkFilename( 0 );
+	}
+	
+	template< typename Morton >
+	inline void OocPointSorter< Morton >::RecordFormat::encode( const Point& p, char* record ) const
+	{
+		if( !m_isBinary )
+		{
+			Writter::encodeRecord( m_plyTypes, p, record );
+		}
+		else if( m_stride == sizeof( Point ) )
+		{
+			memcpy( record, &p, sizeof( Point ) );
+		}
+		else
+		{
+			memcpy( record, p.getPos().data(), 3 * sizeof( float ) );
+		}
+	}
+	
+	template< typename Morton >
+	OocPointSorter< Morton >::RunStream
+	::RunStream( const OocPointSorter& sorter, const MergeRange& range, const int firstChunk, const int endChunk )
+	: m_sorter( sorter ),
+	m_range( range ),
+	m_chunkIdx( firstChunk ),
+	m_endChunk( endChunk ),
+	m_pointIdx( 0ul ),
+	m_key( 0ul ),
+	m_valid( true )
+	{
+		prefetch();
+		loadNextChunk();
+	}
+	
+	template< typename Morton >
+	inline void OocPointSorter< Morton >::RunStream::advance()
+	{
+		if( ++m_pointIdx == m_chunk.size() )
+		{
+			loadNextChunk();
+		}
+		else
+		{
+			updateKey();
+		}
+	}
+	
+	template< typename Morton >
+	inline void OocPointSorter< Morton >::RunStream::prefetch()
+	{
+		if( m_chunkIdx < m_endChunk )
+		{
+			int chunkIdx = m_chunkIdx;
+			m_nextChunk = async( launch::async, [ this, chunkIdx ]() { return m_sorter.readChunk( chunkIdx ); } );
+		}
+	}
+	
+	template< typename Morton >
+	void OocPointSorter< Morton >::RunStream::loadNextChunk()
+	{
+		if( !m_nextChunk.valid() )
+		{
+			m_chunk.clear();
+			m_valid = false;
+			return;
+		}
+		
+		m_chunk = m_nextChunk.get();
+		m_pointIdx = 0ul;
+		
+		// Only the first chunk of the run can have points before the range.
+		if( m_sorter.m_chunkInfos[ m_chunkIdx ].m_firstKey < m_range.m_begin )
+		{
+			const OctreeDim& dim = m_sorter.m_comp;
+			ulong rangeBegin = m_range.m_begin;
+			m_pointIdx = partition_point( m_chunk.begin(), m_chunk.end(),
+				[ & ]( const Point& p ) { return dim.calcMorton( p ).getBits() < rangeBegin; }
+			) - m_chunk.begin();
+		}
+		
+		++m_chunkIdx;
+		prefetch();
+		
+		if( m_pointIdx == m_chunk.size() )
+		{
+			loadNextChunk();
+		}
+		else
+		{
+			updateKey();
+		}
+	}
+	
+	template< typename Morton >
+	inline void OocPointSorter< Morton >::RunStream::updateKey()
+	{
+		m_key = m_sorter.m_comp.calcMorton( m_chunk[ m_pointIdx ] ).getBits();
+		
+		if( !m_range.contains( m_key ) )
+		{
+			// The remaining points are after the range.
+			m_valid = false;
+			m_nextChunk = future< PointVector >();
+		}
+	}
 }
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "omicron/disk/point_reader.h"
 #include "omicron/disk/point_sorter.h"
+#include "omicron/disk/morton_radix_sorter.h"
 #include "omicron/hierarchy/reconstruction_params.h"
 
 namespace omicron::disk
@@ -16,15 +17,24 @@ namespace omicron::disk
 		
 		PartialSortPointReader( const string& filename, uint leafLvl );
 		
-		void read( const function< void( const Point& ) >& onPointDone );
+		void readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+						  ulong batchSize = DEFAULT_BATCH_SIZE ) override;
 		
 		const Dim& dimensions() const { return m_pointSet.m_dim; }
 	
 	private:
 		using Sorter = PointSorter< Morton >;
 		using PointSet = disk::PointSet< Morton >;
+		using RadixSorter = MortonRadixSorter< Morton >;
+		using MortonKey = typename RadixSorter::MortonKey;
+		using KeyVector = typename RadixSorter::KeyVector;
+		
+		/** Partially sorts the keys in [ begin, end ), so [ begin, begin + m_sortedPerIter ) is sorted. */
+		void partialSortKeys( ulong begin );
 		
 		PointSet m_pointSet;
+		/** Morton codes of the points, computed once. The partial sorts are done on them. */
+		KeyVector m_keys;
 		ulong m_sortedPerIter;
 	};
 	
@@ -38,41 +48,57 @@ namespace omicron::disk
 		m_inputTime = sorter.inputTime();
 		
 		typename PointSet::PointDeque& points = *m_pointSet.m_points;
-		m_sortedPerIter = points.size() / SORTING_SEGMENTS;
+		m_sortedPerIter = std::max( 1ul, points.size() / SORTING_SEGMENTS );
 		
 		auto now = Profiler::now( "Initial partial sort" );
 		
+		m_keys = RadixSorter( m_pointSet.m_dim ).computeKeys( points.begin(), points.end() );
+		
 		// The first partial sort is done now so points are ready to be loaded at rendering starting time.
-		std::partial_sort( points.begin(), points.begin() + m_sortedPerIter, points.end(), m_pointSet.m_dim );
+		partialSortKeys( 0ul );
 		
 		m_initTime = Profiler::elapsedTime( now, "Initial partial sort" );
 	}
 
 	template< typename Morton >
-	void PartialSortPointReader< Morton >::read( const function< void( const Point& ) >& onPointDone )
+	void PartialSortPointReader< Morton >::readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+														ulong batchSize )
 	{
 		auto now = Profiler::now( "Partial sorter point reading" );
 		
 		typename PointSet::PointDeque& points = *m_pointSet.m_points;
-		typename PointSet::PointDeque::iterator endIter = points.begin() + m_sortedPerIter;
+		PointBatcher batcher( onBatchDone, batchSize );
 		
-		while( true )
+		for( ulong segmentBegin = 0ul; segmentBegin < m_keys.size(); segmentBegin += m_sortedPerIter )
 		{
-			while( points.begin() != endIter )
+			if( segmentBegin > 0ul )
 			{
-				onPointDone( points.front() );
-				points.pop_front();
+				partialSortKeys( segmentBegin );
 			}
 			
-			if( points.empty() ) break;
-			
-			endIter = ( points.size() <= m_sortedPerIter ) ? points.end() : points.begin() + m_sortedPerIter;
-			std::partial_sort( points.begin(), endIter, points.end(), m_pointSet.m_dim );
+			ulong segmentEnd = std::min( segmentBegin + m_sortedPerIter, m_keys.size() );
+			for( ulong i = segmentBegin; i < segmentEnd; ++i )
+			{
+				batcher.push( points[ m_keys[ i ].m_index ] );
+			}
 		}
+		batcher.flush();
+		
+		points.clear();
+		m_keys.clear();
 		
 		m_readTime = Profiler::elapsedTime( now, "Partial sorter point reading" );
 	}
 	
+	template< typename Morton >
+	inline void PartialSortPointReader< Morton >::partialSortKeys( ulong begin )
+	{
+		ulong end = std::min( begin + m_sortedPerIter, m_keys.size() );
+		std::partial_sort( m_keys.begin() + begin, m_keys.begin() + end, m_keys.end(),
+			[]( const MortonKey& key0, const MortonKey& key1 ) { return key0.m_key < key1.m_key; }
+		);
+	}
+	
 }
 
 #endif
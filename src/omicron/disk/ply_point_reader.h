@@ -33,12 +33,15 @@ namespace omicron::disk
 		p_ply copyHeader( const string& outFilename );
 		
 		/** Reads a .ply file. */
-		void read( const function< void( const Point& ) >& onPointDone ) override;
+		void readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+						  ulong batchSize = DEFAULT_BATCH_SIZE ) override;
 	
 		long getNumPoints() { return m_numPoints; }
+		
+		bool hasNormals() const { return m_hasNormals; }
 	
 	protected:
-		void setupAdditionalCallbacks( p_ply ply, pair< Point*, function< void( const Point& ) >* >& cbNeededData );
+		void setupAdditionalCallbacks( p_ply ply, pair< Point*, PointBatcher* >& cbNeededData );
 		
 		/** Internal customizable reading method. Should setup reading needed data, callbacks, do the reading itself and free reading
 		 * needed data.
@@ -59,7 +62,8 @@ namespace omicron::disk
 		
 		long m_numPoints;
 		
-		function< void( const Point& ) > m_onPointDone;
+		/** Batcher of the current reading. Points are sent to it by the RPly callbacks. */
+		PointBatcher* m_batcher;
 		
 		p_ply m_ply;
 		
@@ -70,6 +74,7 @@ namespace omicron::disk
 	
 	inline PlyPointReader::PlyPointReader( const string& fileName )
 	: PointReader(),
+	m_batcher( nullptr ),
 	m_filename( fileName ),
 	m_hasNormals( false )
 	{
@@ -128,11 +133,12 @@ namespace omicron::disk
 		m_initTime = Profiler::elapsedTime( now, "PlyPointReader init" );
 	}
 	
-	inline void PlyPointReader::read( const function< void( const Point& ) >& onPointDone )
+	inline void PlyPointReader::readBatches( const function< void( const PointBatch& ) >& onBatchDone, ulong batchSize )
 	{
 		auto now = Profiler::now( "PlyPointReader read" );
 		
-		m_onPointDone = onPointDone;
+		PointBatcher batcher( onBatchDone, batchSize );
+		m_batcher = &batcher;
 		
 		/* Save application locale */
 // 		const char *old_locale = setlocale( LC_NUMERIC, NULL );
@@ -148,6 +154,9 @@ namespace omicron::disk
 			throw runtime_error( "Problem while reading points." );
 		}
 		
+		batcher.flush();
+		m_batcher = nullptr;
+		
 		/* Restore application locale when done */
 // 		setlocale( LC_NUMERIC, old_locale );
 
@@ -158,7 +167,7 @@ namespace omicron::disk
 	{
 		/** Temp point used to hold intermediary incomplete data before sending it to its final destiny. */
 		Point tempPoint;
-		pair< Point*, function< void( const Point& ) >* > cbNeededData( &tempPoint, &m_onPointDone );
+		pair< Point*, PointBatcher* > cbNeededData( &tempPoint, m_batcher );
 		
 		p_ply_read_cb callback = ( m_hasNormals ) ? PlyPointReader::vertexCBNormals : PlyPointReader::vertexCBPosOnly;
 		
@@ -182,7 +191,7 @@ namespace omicron::disk
 		void *rawReadingData;
 		ply_get_argument_user_data( argument, &rawReadingData, &index );
 		
-		auto readingData = ( pair< Point*, function< void( const Point& ) >* >* ) rawReadingData;
+		auto readingData = ( pair< Point*, PointBatcher* >* ) rawReadingData;
 		
 		float value = ply_get_argument_value( argument );
 		
@@ -205,7 +214,7 @@ namespace omicron::disk
 			{
 				// Last point component. Send complete point to vector.
 				tempPoint->getNormal()[ index % 3 ] = ( float ) value;
-				( *readingData->second )( Point( tempPoint->getNormal(), tempPoint->getPos() ) );
+				readingData->second->push( *tempPoint );
 				break;
 			}
 		}
@@ -219,7 +228,7 @@ namespace omicron::disk
 		void *rawReadingData;
 		ply_get_argument_user_data( argument, &rawReadingData, &index );
 		
-		auto readingData = ( pair< Point*, function< void( const Point& ) >* >* ) rawReadingData;
+		auto readingData = ( pair< Point*, PointBatcher* >* ) rawReadingData;
 		
 		float value = ply_get_argument_value( argument );
 		
@@ -236,7 +245,7 @@ namespace omicron::disk
 			{
 				// Last point component. Send complete point to vector.
 				tempPoint->getPos()[ index ] = value;
-				( *readingData->second )( Point( Vec3( 1.f, 0.f, 0.f ), tempPoint->getPos() ) );
+				readingData->second->push( Point( Vec3( 1.f, 0.f, 0.f ), tempPoint->getPos() ) );
 				break;
 			}
 		}
@@ -15,11 +15,25 @@ namespace omicron::disk
 		void write( const Point& p );
 		const string& filename() { return m_filename; }
 		
+		/** @returns the types of the written properties, in record order. */
+		const vector< e_ply_type >& propertyTypes() const { return m_propertyTypes; }
+		
+		/** @returns the size in bytes of a binary record with properties of the given types. */
+		static size_t recordSize( const vector< e_ply_type >& types );
+		
+		/** Encodes p as a binary little endian record with properties of the given types, in the order used by
+		 * write(). This way, records can be written directly at their position in the file. */
+		static void encodeRecord( const vector< e_ply_type >& types, const Point& p, char* record );
+		
 	private:
 		void copyProperty( p_ply_property property );
 		
+		/** @returns the size in bytes of a scalar property type. */
+		static size_t typeSize( const e_ply_type type );
+		
 		string m_filename;
 		p_ply m_ply;
+		vector< e_ply_type > m_propertyTypes;
 	};
 	
 	inline PlyPointWritter::PlyPointWritter( const Reader& reader, const string& filename, ulong nPoints )
@@ -80,6 +94,59 @@ namespace omicron::disk
 			{
 				throw runtime_error( "Cannot copy property to .ply header." );
 			}
+			m_propertyTypes.push_back( type );
+		}
+	}
+	
+	inline size_t PlyPointWritter::recordSize( const vector< e_ply_type >& types )
+	{
+		size_t size = 0;
+		for( const e_ply_type type : types )
+		{
+			size += typeSize( type );
+		}
+		
+		return size;
+	}
+	
+	inline void PlyPointWritter::encodeRecord( const vector< e_ply_type >& types, const Point& p, char* record )
+	{
+		const Vec3& pos = p.getPos();
+		const Vec3& normal = p.getNormal();
+		double values[ 6 ] = { pos.x(), pos.y(), pos.z(), normal.x(), normal.y(), normal.z() };
+		
+		auto encode = [ & ]( const auto value )
+		{
+			memcpy( record, &value, sizeof( value ) );
+			record += sizeof( value );
+		};
+		
+		for( int i = 0; i < types.size(); ++i )
+		{
+			switch( types[ i ] )
+			{
+				case PLY_INT8: case PLY_CHAR: encode( int8_t( values[ i ] ) ); break;
+				case PLY_UINT8: case PLY_UCHAR: encode( uint8_t( values[ i ] ) ); break;
+				case PLY_INT16: case PLY_SHORT: encode( int16_t( values[ i ] ) ); break;
+				case PLY_UINT16: case PLY_USHORT: encode( uint16_t( values[ i ] ) ); break;
+				case PLY_INT32: case PLY_INT: encode( int32_t( values[ i ] ) ); break;
+				case PLY_UIN32: case PLY_UINT: encode( uint32_t( values[ i ] ) ); break;
+				case PLY_FLOAT32: case PLY_FLOAT: encode( float( values[ i ] ) ); break;
+				case PLY_FLOAT64: case PLY_DOUBLE: encode( values[ i ] ); break;
+				default: throw logic_error( "List properties cannot be encoded in fixed size records." );
+			}
+		}
+	}
+	
+	inline size_t PlyPointWritter::typeSize( const e_ply_type type )
+	{
+		switch( type )
+		{
+			case PLY_INT8: case PLY_UINT8: case PLY_CHAR: case PLY_UCHAR: return 1;
+			case PLY_INT16: case PLY_UINT16: case PLY_SHORT: case PLY_USHORT: return 2;
+			case PLY_INT32: case PLY_UIN32: case PLY_INT: case PLY_UINT: case PLY_FLOAT32: case PLY_FLOAT: return 4;
+			case PLY_FLOAT64: case PLY_DOUBLE: return 8;
+			default: throw logic_error( "List properties have no fixed size." );
 		}
 	}
 }
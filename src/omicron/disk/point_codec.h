@@ -0,0 +1,495 @@
+#ifndef POINT_CODEC_H
+#define POINT_CODEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include "omicron/basic/point.h"
+#include "omicron/hierarchy/reconstruction_params.h"
+#include "omicron/renderer/splat_renderer/quantized_surfels.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+#include "omicron/util/rans_coder.h"
+
+namespace omicron::disk
+{
+	using namespace std;
+	using util::ByteVector;
+	using util::RansCoder;
+
+	/** Attribute access for the elements compressed by PointCodec. Each element has a position and N_VECTORS direction
+	 * vectors with arbitrary lengths. */
+	template< typename Element >
+	struct PointCodecTraits;
+
+	template<>
+	struct PointCodecTraits< Point >
+	{
+		static constexpr int N_VECTORS = 1;
+
+		static const Vec3& pos( const Point& point ) { return point.getPos(); }
+
+		static const Vec3& vector( const Point& point, int ) { return point.getNormal(); }
+
+		static Point build( const Vec3& pos, const Vec3* vectors ) { return Point( vectors[ 0 ], pos ); }
+	};
+
+	template<>
+	struct PointCodecTraits< Surfel >
+	{
+		static constexpr int N_VECTORS = 2;
+
+		static const Vec3& pos( const Surfel& surfel ) { return surfel.c; }
+
+		static const Vec3& vector( const Surfel& surfel, int i ) { return ( i == 0 ) ? surfel.u : surfel.v; }
+
+		static Surfel build( const Vec3& pos, const Vec3* vectors ) { return Surfel( pos, vectors[ 0 ], vectors[ 1 ] ); }
+	};
+
+	/** Compression codec for node contents and point chunks. Each call to encode() produces an independent block.
+	 *
+	 * In LOSSLESS mode the float bit patterns of each component are delta coded against the previous element. In
+	 * NEAR_LOSSLESS mode positions are quantized to positionBits per axis relative to the block box and interleaved
+	 * into morton codes, which are delta coded. Vectors are octahedral-encoded with 16 bits per coordinate and their
+	 * lengths are quantized to 16 bits relative to the longest vector in the block, as in QuantizedSurfels. In both
+	 * modes the deltas are zigzag varints and each attribute stream is entropy coded with RansCoder. Element order is
+	 * preserved, so inputs sorted in morton order compress best.
+	 *
+	 * Block layout: | version | mode | number of vectors | position bits | varint size | quantization header | position
+	 * stream | vector streams |. The quantization header only exists in NEAR_LOSSLESS mode and has the box origin and
+	 * extent and the maximum length of each vector. */
+	class PointCodec
+	{
+	public:
+		enum Mode : uint8_t
+		{
+			LOSSLESS,
+			NEAR_LOSSLESS
+		};
+
+		/** Positions are interleaved into 63-bit morton codes. */
+		static constexpr uint MAX_POSITION_BITS = 21u;
+
+		/** Ctor.
+		 * @param positionBits is the position quantization per axis in NEAR_LOSSLESS mode.
+		 * @throws logic_error if positionBits is not in [ 1, MAX_POSITION_BITS ]. */
+		PointCodec( Mode mode = LOSSLESS, uint positionBits = MAX_POSITION_BITS );
+
+		/** Creates the codec of a configured point compression, such as ReconstructionConfig::m_pointCompression.
+		 * @throws logic_error for NO_COMPRESSION. */
+		static PointCodec fromCompression( const PointCompression compression, const uint positionBits );
+
+		Mode mode() const { return m_mode; }
+
+		uint positionBits() const { return m_positionBits; }
+
+		/** Appends the block of elements [ elements, elements + n ) to out. */
+		template< typename Element >
+		void encode( const Element* elements, const size_t n, ByteVector& out ) const;
+
+		/** Decodes a block, advancing ptr past it. The block mode is read from the block itself.
+		 * @param Container is a container of Point or Surfel constructible with its size, such as Array or vector.
+		 * @throws runtime_error if the block is malformed or has elements of another type. */
+		template< typename Container >
+		static Container decode( const uint8_t*& ptr, const uint8_t* end );
+
+		/** Binary persistence of a block. Structure: | block size | block |. */
+		template< typename Element >
+		void write( ostream& out, const Element* elements, const size_t n ) const;
+
+		/** Reads a block writen with write(). */
+		template< typename Container >
+		static Container read( istream& input );
+
+		/** @returns the maximum position error per axis in NEAR_LOSSLESS mode, given the block box extent. */
+		static Vec3 maxPositionError( const Vec3& extent, uint positionBits )
+		{
+			return extent / float( 1ul << ( positionBits + 1 ) );
+		}
+
+	private:
+		/** Version 2 rejects rANS blocks with a single symbol of frequency PROB_SCALE. */
+		static constexpr uint8_t VERSION = 2u;
+		static constexpr uint32_t VECTOR_QUANTIZATION_MAX = 0xFFFFu;
+
+		/** Spreads the lower 21 bits of x so there are 2 zero bits between each. */
+		static uint64_t splitBy3( uint64_t x );
+
+		static uint64_t compactBy3( uint64_t x );
+
+		static void appendFloat( ByteVector& out, float value );
+
+		static float readFloat( const uint8_t*& ptr, const uint8_t* end );
+
+		static uint32_t floatBits( float value ) { uint32_t bits; memcpy( &bits, &value, sizeof( float ) ); return bits; }
+
+		static float bitsFloat( uint32_t bits ) { float value; memcpy( &value, &bits, sizeof( float ) ); return value; }
+
+		static uint16_t quantizeUnit( float value ) // value in [ 0, 1 ].
+		{
+			value = std::min( std::max( value, 0.f ), 1.f );
+			return uint16_t( value * VECTOR_QUANTIZATION_MAX + 0.5f );
+		}
+
+		/** Appends the zigzag varint of value - previous and updates previous. */
+		static void appendDelta( ByteVector& stream, int64_t value, int64_t& previous )
+		{
+			util::writeVarint( stream, util::zigzag( value - previous ) );
+			previous = value;
+		}
+
+		static int64_t readDelta( const uint8_t*& ptr, const uint8_t* end, int64_t& previous )
+		{
+			previous += util::unzigzag( util::readVarint( ptr, end ) );
+			return previous;
+		}
+
+		Mode m_mode;
+		uint m_positionBits;
+	};
+
+	inline PointCodec::PointCodec( Mode mode, uint positionBits )
+	: m_mode( mode ),
+	m_positionBits( positionBits )
+	{
+		if( positionBits == 0u || positionBits > MAX_POSITION_BITS )
+		{
+			throw logic_error( "Position bits should be in [ 1, 21 ]." );
+		}
+	}
+
+	inline PointCodec PointCodec::fromCompression( const PointCompression compression, const uint positionBits )
+	{
+		switch( compression )
+		{
+			case LOSSLESS_COMPRESSION: return PointCodec( LOSSLESS, positionBits );
+			case NEAR_LOSSLESS_COMPRESSION: return PointCodec( NEAR_LOSSLESS, positionBits );
+			default: throw logic_error( "Uncompressed points have no codec." );
+		}
+	}
+
+	template< typename Element >
+	void PointCodec::encode( const Element* elements, const size_t n, ByteVector& out ) const
+	{
+		using Traits = PointCodecTraits< Element >;
+
+		out.push_back( VERSION );
+		out.push_back( m_mode );
+		out.push_back( uint8_t( Traits::N_VECTORS ) );
+		out.push_back( uint8_t( m_positionBits ) );
+		util::writeVarint( out, n );
+
+		ByteVector stream;
+		stream.reserve( 4 * n );
+
+		if( m_mode == LOSSLESS )
+		{
+			int64_t previousPos[ 3 ] = { 0, 0, 0 };
+			for( size_t i = 0; i < n; ++i )
+			{
+				const Vec3& pos = Traits::pos( elements[ i ] );
+				for( int axis = 0; axis < 3; ++axis )
+				{
+					appendDelta( stream, floatBits( pos[ axis ] ), previousPos[ axis ] );
+				}
+			}
+			RansCoder::encode( stream.data(), stream.size(), out );
+
+			for( int v = 0; v < Traits::N_VECTORS; ++v )
+			{
+				stream.clear();
+				int64_t previous[ 3 ] = { 0, 0, 0 };
+				for( size_t i = 0; i < n; ++i )
+				{
+					const Vec3& vec = Traits::vector( elements[ i ], v );
+					for( int axis = 0; axis < 3; ++axis )
+					{
+						appendDelta( stream, floatBits( vec[ axis ] ), previous[ axis ] );
+					}
+				}
+				RansCoder::encode( stream.data(), stream.size(), out );
+			}
+
+			return;
+		}
+
+		// Quantization header.
+		AlignedBox3f box;
+		float maxLengths[ Traits::N_VECTORS ] = {};
+		for( size_t i = 0; i < n; ++i )
+		{
+			box.extend( Traits::pos( elements[ i ] ) );
+			for( int v = 0; v < Traits::N_VECTORS; ++v )
+			{
+				maxLengths[ v ] = std::max( maxLengths[ v ], Traits::vector( elements[ i ], v ).norm() );
+			}
+		}
+
+		Vec3 origin = ( n > 0 ) ? Vec3( box.min() ) : Vec3( 0.f, 0.f, 0.f );
+		Vec3 extent = ( n > 0 ) ? Vec3( box.sizes() ) : Vec3( 0.f, 0.f, 0.f );
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			appendFloat( out, origin[ axis ] );
+		}
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			appendFloat( out, extent[ axis ] );
+		}
+		for( int v = 0; v < Traits::N_VECTORS; ++v )
+		{
+			appendFloat( out, maxLengths[ v ] );
+		}
+
+		// Positions.
+		const uint64_t maxCoord = ( 1ul << m_positionBits ) - 1ul;
+		Vec3 scale;
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			scale[ axis ] = ( extent[ axis ] > 0.f ) ? float( 1ul << m_positionBits ) / extent[ axis ] : 0.f;
+		}
+
+		int64_t previousMorton = 0;
+		for( size_t i = 0; i < n; ++i )
+		{
+			const Vec3& pos = Traits::pos( elements[ i ] );
+			uint64_t morton = 0ul;
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				float offset = std::max( ( pos[ axis ] - origin[ axis ] ) * scale[ axis ], 0.f );
+				morton |= splitBy3( std::min( uint64_t( offset ), maxCoord ) ) << ( 2 - axis );
+			}
+			appendDelta( stream, int64_t( morton ), previousMorton );
+		}
+		RansCoder::encode( stream.data(), stream.size(), out );
+
+		// Vectors.
+		for( int v = 0; v < Traits::N_VECTORS; ++v )
+		{
+			stream.clear();
+			int64_t previous[ 3 ] = { 0, 0, 0 };
+			for( size_t i = 0; i < n; ++i )
+			{
+				const Vec3& vec = Traits::vector( elements[ i ], v );
+				float length = vec.norm();
+
+				int64_t quantized[ 3 ] = { 0, 0, 0 };
+				if( length > 0.f )
+				{
+					Vector2f encoded = QuantizedSurfels::octEncode( vec / length );
+					quantized[ 0 ] = quantizeUnit( encoded.x() );
+					quantized[ 1 ] = quantizeUnit( encoded.y() );
+					quantized[ 2 ] = quantizeUnit( length / maxLengths[ v ] );
+				}
+
+				for( int c = 0; c < 3; ++c )
+				{
+					appendDelta( stream, quantized[ c ], previous[ c ] );
+				}
+			}
+			RansCoder::encode( stream.data(), stream.size(), out );
+		}
+	}
+
+	template< typename Container >
+	Container PointCodec::decode( const uint8_t*& ptr, const uint8_t* end )
+	{
+		using Element = typename decay< decltype( declval< Container& >()[ 0 ] ) >::type;
+		using Traits = PointCodecTraits< Element >;
+
+		if( end - ptr < 4 )
+		{
+			throw runtime_error( "Truncated point codec block." );
+		}
+
+		uint8_t version = *ptr++;
+		uint8_t mode = *ptr++;
+		uint8_t nVectors = *ptr++;
+		uint8_t positionBits = *ptr++;
+
+		if( version != VERSION || mode > NEAR_LOSSLESS || positionBits == 0u || positionBits > MAX_POSITION_BITS )
+		{
+			throw runtime_error( "Malformed point codec block." );
+		}
+		if( nVectors != Traits::N_VECTORS )
+		{
+			throw runtime_error( "Point codec block has elements of another type." );
+		}
+
+		// Each element has at least one byte in each decoded stream, so n is bounded before allocating.
+		uint64_t n = util::readVarint( ptr, end );
+		if( n > RansCoder::maxDecodedSize( end - ptr ) )
+		{
+			throw runtime_error( "Malformed point codec block size." );
+		}
+
+		Vec3 origin;
+		Vec3 step;
+		float maxLengths[ Traits::N_VECTORS ] = {};
+		if( mode == NEAR_LOSSLESS )
+		{
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				origin[ axis ] = readFloat( ptr, end );
+			}
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				step[ axis ] = readFloat( ptr, end ) / float( 1ul << positionBits );
+			}
+			for( int v = 0; v < Traits::N_VECTORS; ++v )
+			{
+				maxLengths[ v ] = readFloat( ptr, end );
+			}
+		}
+
+		// Attributes are decoded stream by stream into separate arrays, then assembled.
+		ByteVector stream;
+		vector< Vec3 > attributes;
+
+		for( int attrib = 0; attrib < 1 + Traits::N_VECTORS; ++attrib )
+		{
+			stream.clear();
+			RansCoder::decode( ptr, end, stream );
+			// Morton codes have one delta per element, the other attributes have one per component.
+			uint64_t minDeltas = ( mode == NEAR_LOSSLESS && attrib == 0 ) ? n : 3 * n;
+			if( stream.size() < minDeltas )
+			{
+				throw runtime_error( "Truncated point codec stream." );
+			}
+			attributes.resize( n * ( 1 + Traits::N_VECTORS ) );
+			const uint8_t* streamPtr = stream.data();
+			const uint8_t* streamEnd = stream.data() + stream.size();
+			Vec3* values = attributes.data() + attrib * n;
+
+			int64_t previous[ 3 ] = { 0, 0, 0 };
+			if( mode == LOSSLESS )
+			{
+				for( size_t i = 0; i < n; ++i )
+				{
+					for( int axis = 0; axis < 3; ++axis )
+					{
+						values[ i ][ axis ] = bitsFloat( uint32_t( readDelta( streamPtr, streamEnd, previous[ axis ] ) ) );
+					}
+				}
+			}
+			else if( attrib == 0 )
+			{
+				for( size_t i = 0; i < n; ++i )
+				{
+					uint64_t morton = readDelta( streamPtr, streamEnd, previous[ 0 ] );
+					for( int axis = 0; axis < 3; ++axis )
+					{
+						float coord = float( compactBy3( morton >> ( 2 - axis ) ) );
+						values[ i ][ axis ] = origin[ axis ] + ( coord + 0.5f ) * step[ axis ];
+					}
+				}
+			}
+			else
+			{
+				float maxLength = maxLengths[ attrib - 1 ];
+				for( size_t i = 0; i < n; ++i )
+				{
+					float octX = float( readDelta( streamPtr, streamEnd, previous[ 0 ] ) ) / VECTOR_QUANTIZATION_MAX;
+					float octY = float( readDelta( streamPtr, streamEnd, previous[ 1 ] ) ) / VECTOR_QUANTIZATION_MAX;
+					float length = float( readDelta( streamPtr, streamEnd, previous[ 2 ] ) ) / VECTOR_QUANTIZATION_MAX
+								   * maxLength;
+
+					values[ i ] = ( length > 0.f ) ? Vec3( QuantizedSurfels::octDecode( Vector2f( octX, octY ) ) * length )
+												   : Vec3( 0.f, 0.f, 0.f );
+				}
+			}
+
+			if( streamPtr != streamEnd )
+			{
+				throw runtime_error( "Malformed point codec stream." );
+			}
+		}
+
+		Container elements( n );
+		Vec3 vectors[ Traits::N_VECTORS ];
+		for( size_t i = 0; i < n; ++i )
+		{
+			for( int v = 0; v < Traits::N_VECTORS; ++v )
+			{
+				vectors[ v ] = attributes[ ( v + 1 ) * n + i ];
+			}
+			elements[ i ] = Traits::build( attributes[ i ], vectors );
+		}
+
+		return elements;
+	}
+
+	template< typename Element >
+	inline void PointCodec::write( ostream& out, const Element* elements, const size_t n ) const
+	{
+		ByteVector block;
+		encode( elements, n, block );
+
+		uint64_t blockSize = block.size();
+		Binary::write( out, blockSize );
+		out.write( reinterpret_cast< const char* >( block.data() ), block.size() );
+	}
+
+	template< typename Container >
+	inline Container PointCodec::read( istream& input )
+	{
+		uint64_t blockSize;
+		Binary::read( input, blockSize );
+
+		ByteVector block( blockSize );
+		input.read( reinterpret_cast< char* >( block.data() ), blockSize );
+
+		if( !input )
+		{
+			throw runtime_error( "Truncated point codec block." );
+		}
+
+		const uint8_t* ptr = block.data();
+		return decode< Container >( ptr, block.data() + block.size() );
+	}
+
+	inline uint64_t PointCodec::splitBy3( uint64_t x )
+	{
+		x &= 0x1fffff;
+		x = ( x | x << 32 ) & 0x1f00000000ffff;
+		x = ( x | x << 16 ) & 0x1f0000ff0000ff;
+		x = ( x | x << 8 ) & 0x100f00f00f00f00f;
+		x = ( x | x << 4 ) & 0x10c30c30c30c30c3;
+		x = ( x | x << 2 ) & 0x1249249249249249;
+		return x;
+	}
+
+	inline uint64_t PointCodec::compactBy3( uint64_t x )
+	{
+		x &= 0x1249249249249249;
+		x = ( x ^ ( x >> 2 ) ) & 0x10c30c30c30c30c3;
+		x = ( x ^ ( x >> 4 ) ) & 0x100f00f00f00f00f;
+		x = ( x ^ ( x >> 8 ) ) & 0x1f0000ff0000ff;
+		x = ( x ^ ( x >> 16 ) ) & 0x1f00000000ffff;
+		x = ( x ^ ( x >> 32 ) ) & 0x1fffff;
+		return x;
+	}
+
+	inline void PointCodec::appendFloat( ByteVector& out, float value )
+	{
+		uint8_t bytes[ sizeof( float ) ];
+		memcpy( bytes, &value, sizeof( float ) );
+		out.insert( out.end(), bytes, bytes + sizeof( float ) );
+	}
+
+	inline float PointCodec::readFloat( const uint8_t*& ptr, const uint8_t* end )
+	{
+		if( end - ptr < sizeof( float ) )
+		{
+			throw runtime_error( "Truncated point codec block." );
+		}
+
+		float value;
+		memcpy( &value, ptr, sizeof( float ) );
+		ptr += sizeof( float );
+		return value;
+	}
+}
+
+#endif
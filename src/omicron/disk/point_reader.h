@@ -8,33 +8,110 @@ using namespace omicron;
 
 namespace omicron::disk
 {
+	/** Contiguous batch of points. The points are valid only while the batch callback runs. */
+	typedef struct PointBatch
+	{
+		PointBatch( const Point* points, ulong size )
+		: m_points( points ),
+		m_size( size )
+		{}
+
+		const Point* begin() const { return m_points; }
+		const Point* end() const { return m_points + m_size; }
+		ulong size() const { return m_size; }
+		const Point& operator[]( ulong i ) const { return m_points[ i ]; }
+
+		const Point* m_points;
+		ulong m_size;
+	} PointBatch;
+
 	// Interface for reading points.
 	class PointReader
 	{
-	public: 
+	public:
+		/** Default number of points in a batch. */
+		static constexpr ulong DEFAULT_BATCH_SIZE = 4096ul;
+
 		PointReader()
 		: m_inputTime( 0u ),
 		m_initTime( 0u ),
 		m_readTime( 0u )
 		{};
-		
-		/** Read all points using the callback for each point. */
-		virtual void read( const function< void( const Point& ) >& onPointDone ) = 0;
-	
+
+		virtual ~PointReader() {}
+
+		/** Read all points in order, in contiguous batches.
+		 * @param onBatchDone is called for each batch.
+		 * @param batchSize is the maximum number of points in a batch. */
+		virtual void readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+								  ulong batchSize = DEFAULT_BATCH_SIZE ) = 0;
+
+		/** Read all points using the callback for each point. Adapter over readBatches(). */
+		void read( const function< void( const Point& ) >& onPointDone )
+		{
+			readBatches(
+				[ & ]( const PointBatch& batch )
+				{
+					for( const Point& p : batch )
+					{
+						onPointDone( p );
+					}
+				}
+			);
+		}
+
 		/** @returns the time needed to read points from input file (in ms). */
 		uint inputTime() const { return m_inputTime; }
-		
+
 		/** @returns the time needed to init the reader (a partial or full sort for example) (in ms). */
 		uint initTime() const { return m_initTime; }
-		
+
 		/** @returns the time needed to read the points after init (in ms). */
 		uint readTime() const { return m_readTime; }
-	
+
 	protected:
 		uint m_inputTime; // Time needed to read points from input file (in ms).
 		uint m_initTime; // Time needed to init the reader (a partial or full sort for example) (in ms).
 		uint m_readTime; // Time needed to output points to output file (if needed) (in ms).
 	};
+
+	/** Accumulates points in a buffer and sends them in batches. Used by readers that do not have the points
+	 * contiguous in memory. */
+	class PointBatcher
+	{
+	public:
+		PointBatcher( const function< void( const PointBatch& ) >& onBatchDone, ulong batchSize )
+		: m_onBatchDone( onBatchDone ),
+		m_batchSize( batchSize )
+		{
+			m_buffer.reserve( m_batchSize );
+		}
+
+		void push( const Point& p )
+		{
+			m_buffer.push_back( p );
+
+			if( m_buffer.size() == m_batchSize )
+			{
+				flush();
+			}
+		}
+
+		/** Sends the buffered points. Must be called after the last push(). */
+		void flush()
+		{
+			if( !m_buffer.empty() )
+			{
+				m_onBatchDone( PointBatch( m_buffer.data(), m_buffer.size() ) );
+				m_buffer.clear();
+			}
+		}
+
+	private:
+		const function< void( const PointBatch& ) >& m_onBatchDone;
+		ulong m_batchSize;
+		vector< Point, TbbAllocator< Point > > m_buffer;
+	};
 }
 
 #endif
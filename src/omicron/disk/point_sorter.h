@@ -6,6 +6,8 @@
 #include "omicron/basic/morton_code.h"
 #include "omicron/disk/ply_point_reader.h"
 #include "omicron/disk/ply_point_writter.h"
+#include "omicron/disk/binary_point_writter.h"
+#include "omicron/disk/morton_radix_sorter.h"
 #include "omicron/hierarchy/octree_dim_calculator.h"
 #include "omicron/util/profiler.h"
 #include "omicron/memory/global_malloc.h"
@@ -34,6 +36,10 @@ namespace omicron::disk
 		PointSorter( const string& input, const OctreeDim& dim );
 		
 		SorterPointSet sort();
+		
+		/** Sorts and writes the points and the octree file.
+		 * @param outFilename is the sorted point file. A binary point file is written if it has the
+		 * BinaryPointHeader::EXTENSION, a .ply file otherwise. */
 		Json::Value sortToFile( const string& outFilename );
 		OctreeDim& comp() { return m_comp; }
 		
@@ -149,9 +155,9 @@ namespace omicron::disk
 		
 		// Sort points.
 		
-		cout << "Calling std::sort." << endl << endl;
+		cout << "Calling radix sort." << endl << endl;
 		
-		std::sort( m_points->begin(), m_points->end(), m_comp );
+		MortonRadixSorter< M >( m_comp ).sort( m_points->begin(), m_points->end() );
 		
 		m_sortTime = Profiler::elapsedTime( start );
 		
@@ -186,14 +192,24 @@ namespace omicron::disk
 		ofstream octreeFile( octreeFilename, ofstream::out );
 		octreeFile << octreeJson << endl;
 		
-		Writter writter( m_reader, outFilename, m_reader.getNumPoints() );
-		
 		cout << "Writting output file " << outFilename << endl << endl;
 		
 		// Write output point file.
-		for( long i = 0; i < m_points->size(); ++i )
+		if( BinaryPointHeader::isBinaryPointFile( outFilename ) )
+		{
+			BinaryPointWritter< M > writter( outFilename, m_comp, m_reader.hasNormals() );
+			for( long i = 0; i < m_points->size(); ++i )
+			{
+				writter.write( ( *m_points )[ i ] );
+			}
+		}
+		else
 		{
-			writter.write( ( *m_points )[ i ] );
+			Writter writter( m_reader, outFilename, m_reader.getNumPoints() );
+			for( long i = 0; i < m_points->size(); ++i )
+			{
+				writter.write( ( *m_points )[ i ] );
+			}
 		}
 		
 		m_outputTime = Profiler::elapsedTime( start );
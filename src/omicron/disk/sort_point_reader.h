@@ -17,7 +17,8 @@ namespace omicron::disk
 		using Dim = OctreeDimensions< Morton >;
 		
 		SortPointReader( const string& filename, uint leafLvl );
-		void read( const function< void( const Point& ) >& onPointDone ) override;
+		void readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+						  ulong batchSize = DEFAULT_BATCH_SIZE ) override;
 	
 		const Dim& dimensions() const { return m_pointSet.m_dim; }
 		
@@ -41,17 +42,20 @@ namespace omicron::disk
 	}
 	
 	template< typename Morton >
-	inline void SortPointReader< Morton >::read( const function< void( const Point& ) >& onPointDone )
+	inline void SortPointReader< Morton >::readBatches( const function< void( const PointBatch& ) >& onBatchDone,
+														ulong batchSize )
 	{
 		auto now = Profiler::now( "Full sorter point reading" );
 		
 		typename PointSet::PointDeque& points = *m_pointSet.m_points;
+		PointBatcher batcher( onBatchDone, batchSize );
 		
 		while( !points.empty() )
 		{
-			onPointDone( points.front() );
+			batcher.push( points.front() );
 			points.pop_front();
 		}
+		batcher.flush();
 		
 		m_readTime = Profiler::elapsedTime( now, "Full sorter point reading" );
 	}
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <jsoncpp/json/json.h>
+#include "omicron/basic/morton_code.h"
+#include "omicron/hierarchy/auto_tuner.h"
+#include "omicron/hierarchy/fast_parallel_octree.h"
+#include "omicron/hierarchy/reconstruction_config.h"
+#include "omicron/hierarchy/runtime_setup.h"
+#include "omicron/hierarchy/top_down_front_octree.h"
+#include "omicron/renderer/camera_path.h"
+#include "omicron/renderer/headless_renderer.h"
+#include "omicron/util/profiler.h"
+
+using namespace std;
+using namespace omicron;
+using namespace omicron::hierarchy;
+using namespace omicron::renderer;
+using namespace omicron::util;
+
+#ifdef SHALLOW_OCTREE
+	using Morton = ShallowMortonCode;
+#else
+	using Morton = MediumMortonCode;
+#endif
+
+using Octree = FastParallelOctree< Morton >;
+using TopDownOctree = TopDownFrontOctree< Morton >;
+using Loader = Octree::NodeLoader;
+
+/** Statistics of a replayed frame. */
+typedef struct BenchmarkFrame
+{
+	float m_trackingTime; // in ms.
+	float m_frontSize;
+	float m_nPrunes;
+	float m_nBranches;
+	uint m_nRenderedNodes;
+	ulong m_nRenderedPoints;
+} BenchmarkFrame;
+
+/** @returns the percentile p in [ 0, 1 ] of the values, which must be sorted. */
+float percentile( const vector< float >& sorted, const float p )
+{
+	if( sorted.empty() )
+	{
+		return 0.f;
+	}
+
+	size_t idx = size_t( ceil( p * float( sorted.size() ) ) );
+	return sorted[ std::min( std::max( idx, size_t( 1 ) ), sorted.size() ) - 1 ];
+}
+
+template< typename Octree >
+Octree* createOctree( const string& filename, const uint maxLvl, Loader& loader, const ReconstructionConfig& config )
+{
+	RuntimeSetup runtime( config );
+	string extension = filename.substr( filename.find_last_of( '.' ) );
+
+	if( extension == ".oct" )
+	{
+		ifstream file( filename );
+		Json::Value octreeJson;
+		file >> octreeJson;
+
+		return new Octree( octreeJson, loader, runtime );
+	}
+	else if( extension == ".ply" )
+	{
+		return new Octree( filename, maxLvl, loader, runtime );
+	}
+	else
+	{
+		throw runtime_error( "Supported file formats are .oct for already processed octrees or .ply for raw point clouds." );
+	}
+}
+
+/** Sweeps the creation parameters and writes the fastest configuration.
+ * @returns the process exit code. */
+int autotune( const string& datasetFilename, const uint maxLvl, const ReconstructionConfig& config,
+			  const string& outputFilename )
+{
+	Loader loader( nullptr, 1 );
+	AutoTuner tuner( config );
+
+	ReconstructionConfig best = tuner.tune(
+		[ & ]( const ReconstructionConfig& candidate )
+		{
+			auto start = Profiler::now();
+			Octree* octree = createOctree< Octree >( datasetFilename, maxLvl, loader, candidate );
+			octree->waitCreation();
+			int creationTime = Profiler::elapsedTime( start );
+			delete octree;
+
+			cout << "Threads: " << candidate.m_nThreads << ", work list size: " << candidate.m_workListSize
+				 << ", creation time: " << creationTime << "ms" << endl;
+
+			return creationTime;
+		}
+	);
+
+	ofstream out( outputFilename );
+	out << best.toJson();
+
+	cout << endl << "=== AUTOTUNE ===" << endl << tuner.toJson() << endl
+		 << "Best configuration saved into " << outputFilename << endl;
+
+	return 0;
+}
+
+/** Builds the octree and replays the camera path.
+ * @returns the process exit code. */
+template< typename Octree >
+int benchmark( const vector< string >& args, const ReconstructionConfig& config, const string& builder )
+{
+	string datasetFilename = args[ 0 ];
+	CameraPath path( args[ 1 ] );
+	float projThresh = config.m_projThresh;
+	uint framesPerSegment = ( args.size() > 2 ) ? stoul( args[ 2 ] ) : 200u;
+	uint maxLvl = ( args.size() > 3 ) ? stoul( args[ 3 ] ) : 7u;
+
+	// There is no OpenGL context, so there is no loader thread.
+	Loader loader( nullptr, 1 );
+
+	auto creationStart = Profiler::now();
+	Octree* octree = createOctree< Octree >( datasetFilename, maxLvl, loader, config );
+	octree->waitCreation();
+	int creationTime = Profiler::elapsedTime( creationStart );
+
+	pair< uint, uint > nodeStats = octree->nodeStatistics();
+	float creationSecs = std::max( float( creationTime ), 1.f ) * 0.001f;
+
+	cout << "=== CREATION ===" << endl
+		 << "Dataset: " << datasetFilename << endl
+		 << "Builder: " << builder << endl
+		 << "Creation time: " << creationTime << "ms" << endl
+		 << "Nodes: " << nodeStats.first << endl
+		 << "Splats: " << nodeStats.second << endl
+		 << "Throughput: " << float( nodeStats.second ) / creationSecs << " splats/s, "
+		 << float( nodeStats.first ) / creationSecs << " nodes/s" << endl << endl;
+
+	HeadlessRenderer renderer;
+	uint nFrames = path.nFrames( framesPerSegment );
+	vector< BenchmarkFrame > frames;
+	frames.reserve( nFrames );
+
+	for( uint i = 0u; i < nFrames; ++i )
+	{
+		renderer.setViewMatrix( path.viewAtFrame( i, framesPerSegment ) );
+
+		auto start = chrono::high_resolution_clock::now();
+		OctreeStats stats = octree->trackFront( renderer, projThresh );
+		auto end = chrono::high_resolution_clock::now();
+
+		const FrameStats& frame = stats.m_currentStats;
+		frames.push_back( BenchmarkFrame{ chrono::duration< float, milli >( end - start ).count(), frame.m_frontSize,
+										  frame.m_nPrunes, frame.m_nBranches, renderer.nRenderedNodes(),
+										  ulong( frame.m_nRenderedPoints ) } );
+	}
+
+	if( args.size() > 4 )
+	{
+		ofstream out( args[ 4 ] );
+		out << "frame,tracking_ms,front_size,prunes,branches,rendered_nodes,rendered_points" << endl;
+		for( uint i = 0u; i < frames.size(); ++i )
+		{
+			const BenchmarkFrame& frame = frames[ i ];
+			out << i << "," << frame.m_trackingTime << "," << frame.m_frontSize << "," << frame.m_nPrunes << ","
+				<< frame.m_nBranches << "," << frame.m_nRenderedNodes << "," << frame.m_nRenderedPoints << endl;
+		}
+	}
+
+	vector< float > latencies;
+	float totalPrunes = 0.f;
+	float totalBranches = 0.f;
+	float avgFrontSize = 0.f;
+	for( const BenchmarkFrame& frame : frames )
+	{
+		latencies.push_back( frame.m_trackingTime );
+		totalPrunes += frame.m_nPrunes;
+		totalBranches += frame.m_nBranches;
+		avgFrontSize += frame.m_frontSize / float( frames.size() );
+	}
+	sort( latencies.begin(), latencies.end() );
+
+	cout << "=== REPLAY ===" << endl
+		 << "Frames: " << frames.size() << endl
+		 << "Projection threshold: " << projThresh << endl
+		 << "Average front size: " << avgFrontSize << endl
+		 << "Prunes: " << totalPrunes << endl
+		 << "Branches: " << totalBranches << endl
+		 << fixed << setprecision( 3 )
+		 << "Tracking latency p50: " << percentile( latencies, 0.5f ) << "ms" << endl
+		 << "Tracking latency p90: " << percentile( latencies, 0.9f ) << "ms" << endl
+		 << "Tracking latency p99: " << percentile( latencies, 0.99f ) << "ms" << endl
+		 << "Tracking latency max: " << percentile( latencies, 1.f ) << "ms" << endl;
+
+	delete octree;
+
+	return 0;
+}
+
+/** Headless benchmark. Builds a FastParallelOctree and replays a camera path through the front tracking, using a CPU
+ * stand-in renderer, so no GPU is needed. Reports the creation throughput, the front statistics of each frame and the
+ * tracking latency percentiles. With --builder=topdown, the hierarchy is built top-down by a TopDownFrontOctree
+ * instead. With --autotune, it sweeps the creation threads and work list size instead. */
+int main( int argc, char** argv )
+{
+	setlocale( LC_NUMERIC, "C" );
+
+	const string autotuneOption = "--autotune=";
+	const string builderOption = "--builder=";
+	string autotuneFilename;
+	string builder = "bottomup";
+	vector< char* > configArgs;
+	for( int i = 0; i < argc; ++i )
+	{
+		if( string( argv[ i ] ).compare( 0, autotuneOption.size(), autotuneOption ) == 0 )
+		{
+			autotuneFilename = string( argv[ i ] ).substr( autotuneOption.size() );
+		}
+		else if( string( argv[ i ] ).compare( 0, builderOption.size(), builderOption ) == 0 )
+		{
+			builder = string( argv[ i ] ).substr( builderOption.size() );
+		}
+		else
+		{
+			configArgs.push_back( argv[ i ] );
+		}
+	}
+
+	vector< string > args;
+	ReconstructionConfig config;
+	try
+	{
+		config = ReconstructionConfig::fromArgs( int( configArgs.size() ), configArgs.data(), args );
+	}
+	catch( const runtime_error& e )
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	if( !autotuneFilename.empty() && !args.empty() )
+	{
+		return autotune( args[ 0 ], ( args.size() > 1 ) ? stoul( args[ 1 ] ) : 7u, config, autotuneFilename );
+	}
+
+	if( args.size() < 2 )
+	{
+		cerr << "Usage: " << argv[ 0 ] << " [--builder=bottomup|topdown] [--config=<file .json>] [--<key>=<value> ...]"
+			 << " <dataset .ply or .oct>"
+			 << " <camera path> [frames per path segment = 200] [max level = 7] [per-frame output file]" << endl
+			 << "       " << argv[ 0 ] << " --autotune=<output .json> [--config=<file .json>] [--<key>=<value> ...]"
+			 << " <dataset .ply or .oct> [max level = 7]" << endl
+			 << "Keys are the ones in the configuration file, e.g. --projThreshold=" << PROJ_THRESHOLD << endl;
+		return 1;
+	}
+
+	try
+	{
+		if( builder == "bottomup" )
+		{
+			return benchmark< Octree >( args, config, builder );
+		}
+		else if( builder == "topdown" )
+		{
+			return benchmark< TopDownOctree >( args, config, builder );
+		}
+	}
+	catch( const logic_error& e )
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	cerr << "Unknown builder " << builder << ". Options are bottomup and topdown." << endl;
+	return 1;
+}
@@ -0,0 +1,138 @@
+#ifndef AUTO_TUNER_H
+#define AUTO_TUNER_H
+
+#include <functional>
+#include <thread>
+#include <vector>
+#include <jsoncpp/json/json.h>
+#include "omicron/hierarchy/reconstruction_config.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+
+	/** Sweeps the number of hierarchy creation threads and the work list size to find the fastest hierarchy creation
+	 * on the current machine. The creation itself is done by a callback, so the tuner does not depend on the octree
+	 * type. */
+	class AutoTuner
+	{
+	public:
+		/** Result of a creation with a candidate configuration. */
+		typedef struct Trial
+		{
+			int m_nThreads;
+			ulong m_workListSize;
+			/** Best creation time of the repetitions, in ms. */
+			int m_creationTime;
+		} Trial;
+
+		/** Creates the hierarchy with the given configuration and returns the creation time in ms. */
+		using CreationFunction = function< int ( const ReconstructionConfig& ) >;
+
+		/** Ctor.
+		 * @param base is the configuration whose other parameters are kept.
+		 * @param maxThreads is the largest number of threads tried. The candidates are the powers of 2 below it and
+		 * itself. 0 uses the hardware concurrency.
+		 * @param workListSizes are the work list size candidates.
+		 * @param nRepetitions is the number of creations for each candidate. The best time is kept. */
+		AutoTuner( const ReconstructionConfig& base, const uint maxThreads = 0u,
+				   const vector< ulong >& workListSizes = { 4ul, 8ul, 16ul, 32ul, 64ul }, const uint nRepetitions = 1u );
+
+		/** Tries all candidates.
+		 * @returns the base configuration with the fastest thread count and work list size. */
+		ReconstructionConfig tune( const CreationFunction& createHierarchy );
+
+		const vector< int >& threadCandidates() const { return m_threadCandidates; }
+
+		const vector< ulong >& workListSizes() const { return m_workListSizes; }
+
+		/** @returns the trials of the last tune(), in sweep order. */
+		const vector< Trial >& trials() const { return m_trials; }
+
+		/** @returns the trials and the chosen configuration. */
+		Json::Value toJson() const;
+
+	private:
+		ReconstructionConfig m_base;
+		ReconstructionConfig m_best;
+		vector< int > m_threadCandidates;
+		vector< ulong > m_workListSizes;
+		uint m_nRepetitions;
+		vector< Trial > m_trials;
+	};
+
+	inline AutoTuner::AutoTuner( const ReconstructionConfig& base, const uint maxThreads,
+								 const vector< ulong >& workListSizes, const uint nRepetitions )
+	: m_base( base ),
+	m_best( base ),
+	m_workListSizes( workListSizes ),
+	m_nRepetitions( std::max( nRepetitions, 1u ) )
+	{
+		int nThreads = int( ( maxThreads == 0u ) ? std::max( thread::hardware_concurrency(), 1u ) : maxThreads );
+
+		for( int candidate = 1; candidate < nThreads; candidate *= 2 )
+		{
+			m_threadCandidates.push_back( candidate );
+		}
+		m_threadCandidates.push_back( nThreads );
+
+		if( m_workListSizes.empty() )
+		{
+			throw logic_error( "AutoTuner needs at least one work list size candidate." );
+		}
+	}
+
+	inline ReconstructionConfig AutoTuner::tune( const CreationFunction& createHierarchy )
+	{
+		m_trials.clear();
+		m_best = m_base;
+		int bestTime = -1;
+
+		for( int nThreads : m_threadCandidates )
+		{
+			for( ulong workListSize : m_workListSizes )
+			{
+				ReconstructionConfig config = m_base;
+				config.m_nThreads = nThreads;
+				config.m_workListSize = workListSize;
+
+				int creationTime = -1;
+				for( uint i = 0u; i < m_nRepetitions; ++i )
+				{
+					int time = createHierarchy( config );
+					creationTime = ( creationTime < 0 ) ? time : std::min( creationTime, time );
+				}
+
+				m_trials.push_back( Trial{ nThreads, workListSize, creationTime } );
+
+				if( bestTime < 0 || creationTime < bestTime )
+				{
+					bestTime = creationTime;
+					m_best = config;
+				}
+			}
+		}
+
+		return m_best;
+	}
+
+	inline Json::Value AutoTuner::toJson() const
+	{
+		Json::Value json;
+		json[ "repetitions" ] = m_nRepetitions;
+		json[ "trials" ] = Json::Value( Json::arrayValue );
+		for( const Trial& trial : m_trials )
+		{
+			Json::Value trialJson;
+			trialJson[ "hierarchyCreationThreads" ] = trial.m_nThreads;
+			trialJson[ "workListSize" ] = Json::UInt64( trial.m_workListSize );
+			trialJson[ "creationTime" ] = trial.m_creationTime;
+			json[ "trials" ].append( trialJson );
+		}
+		json[ "best" ] = m_best.toJson();
+
+		return json;
+	}
+}
+
+#endif
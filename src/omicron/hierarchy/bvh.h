@@ -1,9 +1,14 @@
 #ifndef BVH_H
 #define BVH_H
 
+#include <omp.h>
+#include <array>
+#include <limits>
+#include <algorithm>
 #include "omicron/basic/basic_types.h"
 #include "omicron/basic/point.h"
 #include "omicron/disk/ply_point_reader.h"
+#include "omicron/memory/tbb_allocator.h"
 
 namespace omicron::hierarchy
 {
@@ -17,119 +22,136 @@ namespace omicron::hierarchy
 			: m_origin( origin ),
 			m_extension( extension )
 			{}
-			
+
 			Vec3 m_origin;
 			Vec3 m_extension;
-			
+
 			friend ostream& operator<<( ostream& out, const Boundaries& boundaries )
 			{
 				out << "Origin: " << endl << boundaries.m_origin << endl << "Extension: " << endl << boundaries.m_extension;
 				return out;
 			}
 		};
-		
-		using AabbPtr = shared_ptr< Aabb >;
-		using ChildrenVector = vector< AabbPtr >;
-		
-		Aabb( const Vec3& p );
-		
-		/** Indicates if the node is leaf. */
-		virtual bool isLeaf() const = 0;
-		
-		/** Recursively and hierarchically inserts a point into this Aabb. Changes origin and extension if needed. */
-		virtual void traverseAndInsert( const Point& point, int level, int maxLevel ) = 0;
-		
-		/** Shrinks used memory to fit inserted points and children. */
-		virtual void shrink() = 0;
-		
-		/** Inserts a point into the Aabb. Changes origin and extension if needed. */
-		virtual void insert( const Point& point );
-		
-		virtual const ChildrenVector& children() const = 0;
-		
-		virtual ChildrenVector& children() = 0;
-		
+
+		/** Ctor for an empty Aabb, which contains nothing. */
+		Aabb()
+		: m_min( Vec3::Constant( numeric_limits< float >::max() ) ),
+		m_max( Vec3::Constant( -numeric_limits< float >::max() ) )
+		{}
+
+		Aabb( const Vec3& p )
+		: m_min( p ),
+		m_max( p )
+		{}
+
+		Aabb( const Vec3& minPoint, const Vec3& maxPoint )
+		: m_min( minPoint ),
+		m_max( maxPoint )
+		{}
+
 		/** Inserts a point into the Aabb. Changes origin and extension if needed. */
-		void insert( const Vec3& point );
-		
+		void insert( const Vec3& point ) { m_min = m_min.cwiseMin( point ); m_max = m_max.cwiseMax( point ); }
+
+		/** Inserts another Aabb into this one. */
+		void insert( const Aabb& other ) { m_min = m_min.cwiseMin( other.m_min ); m_max = m_max.cwiseMax( other.m_max ); }
+
+		bool isEmpty() const { return m_min.x() > m_max.x(); }
+
 		/** Calculates the surface area for SAH. */
 		static float sahSurfaceArea( const Boundaries& boundaries );
-		
+
+		/** Calculates the surface area for SAH. Empty Aabbs have area 0. */
+		float sahSurfaceArea() const { return ( isEmpty() ) ? 0.f : sahSurfaceArea( boundaries() ); }
+
 		/** Calculates the new boundaries of this Aabb when a point is inserted. */
-		Boundaries calcNewBoundaries ( const Vec3& point ) const;
-		
+		Boundaries calcNewBoundaries( const Vec3& point ) const;
+
+		/** Checks if a point is inside this Aabb expanded by epsilon. */
+		bool contains( const Vec3& point, const float epsilon = 0.f ) const;
+
+		/** Checks if another Aabb is inside this Aabb expanded by epsilon. */
+		bool contains( const Aabb& other, const float epsilon = 0.f ) const;
+
 		/** Min point of this Aabb. */
-		Vec3 origin() const { return m_boundaries.m_origin; }
-		
-		Vec3 extension() const { return m_boundaries.m_extension; }
-		
+		Vec3 origin() const { return m_min; }
+
+		Vec3 extension() const { return m_max - m_min; }
+
 		/** Calculates the maximum position this Aabb occupies. */
-		Vec3 maxPoint() const;
-		
+		Vec3 maxPoint() const { return m_max; }
+
 		/** Calculates the center of this Aabb. */
-		Vec3 center() const;
-		
-		const Boundaries& boundaries() const { return m_boundaries; }
-		
+		Vec3 center() const { return ( m_min + m_max ) * 0.5f; }
+
+		Boundaries boundaries() const { return Boundaries( m_min, extension() ); }
+
 		friend ostream& operator<<( ostream& out, const Aabb& aabb );
-	
-	protected:
-		
-		Boundaries m_boundaries;
-	};
-	
-	/** Inner Aabb. Contains left and right children. */
-	class InnerAabb
-	: public Aabb
-	{
-	public:
-		/** Ctor. Receives both children and set the boundaries up. */
-		InnerAabb( AabbPtr leftChild, AabbPtr rightChild );
-		
-		/** Hierarchical point insertion. Traverses the current node, fixing this Aabb's boundaries and recursively inserting the point in the best child, according to the SAH. */
-		void traverseAndInsert( const Point& point, int level, int maxLevel ) override;
-		
-		void shrink() override;
-		
-		bool isLeaf() const override { return false; }
-		
-		const ChildrenVector& children() const override { return m_children; }
-		
-		ChildrenVector& children() override { return m_children; }
-		
+
 	private:
-		ChildrenVector m_children;
+		Vec3 m_min;
+		Vec3 m_max;
 	};
-	
-	/** Leaf Aabb. Contains the actual model geometry. */
-	class LeafAabb
-	: public Aabb
+
+	/** Node of a flat Bvh. The node array is in depth-first order, so the left child of an inner node is the node right
+	 * after it and only the right child index is stored. A leaf has a range of the Bvh point buffer instead. */
+	class BvhNode
 	{
 	public:
-		LeafAabb( const Point& point );
-		
-		void insert( const Point& point ) override;
-		
-		void traverseAndInsert( const Point& point, int level, int maxLevel ) override;
-		
-		void shrink() override { m_points.shrink_to_fit(); }
-		
-		bool isLeaf() const override { return true; }
-		
-		const ChildrenVector& children() const override { throw logic_error( "LeafAabb does not have child." ); }
-		
-		ChildrenVector& children() override { throw logic_error( "LeafAabb does not have child." ); }
-		
-		const vector< Point >& points() const { return m_points; }
-		
+		BvhNode()
+		: m_offset( 0u ),
+		m_nPoints( 0u )
+		{}
+
+		static BvhNode inner( const Aabb& aabb, const uint rightChild ) { return BvhNode( aabb, rightChild, 0u ); }
+
+		static BvhNode leaf( const Aabb& aabb, const uint firstPoint, const uint nPoints )
+		{
+			return BvhNode( aabb, firstPoint, nPoints );
+		}
+
+		bool isLeaf() const { return m_nPoints > 0u; }
+
+		const Aabb& aabb() const { return m_aabb; }
+
+		/** @returns the index of the left child of the node at index idx. Valid only for inner nodes. */
+		static uint leftChild( const uint idx ) { return idx + 1u; }
+
+		/** Index of the right child. Valid only for inner nodes. */
+		uint rightChild() const { return m_offset; }
+
+		/** Index of the first point of the leaf in the point buffer. Valid only for leaves. */
+		uint firstPoint() const { return m_offset; }
+
+		uint nPoints() const { return m_nPoints; }
+
 	private:
-		vector< Point > m_points;
+		friend class Bvh;
+
+		BvhNode( const Aabb& aabb, const uint offset, const uint nPoints )
+		: m_aabb( aabb ),
+		m_offset( offset ),
+		m_nPoints( nPoints )
+		{}
+
+		Aabb m_aabb;
+		/** Right child index for inner nodes, first point index for leaves. */
+		uint m_offset;
+		/** 0 for inner nodes. */
+		uint m_nPoints;
 	};
-	
-	/** Incremental bounding volume hierarchy for points. Insertion is performed using the Surface Area Heuristic (SAH). */
+
+	static_assert( sizeof( BvhNode ) == 32, "BvhNode is expected to have 32 bytes, so 2 nodes fit in a cache line." );
+
+	/** Bounding volume hierarchy for points, bulk built with the binned Surface Area Heuristic (SAH). The nodes are kept
+	 * in a flat array and the leaves reference ranges of a single point buffer, which is reordered by the build. The top
+	 * of the hierarchy is split serially until there are enough subtrees for the threads, then the subtrees are built in
+	 * parallel and appended to the node array. The result does not depend on the number of threads. */
 	class Bvh
 	{
 	public:
+		using PointVector = vector< Point, TbbAllocator< Point > >;
+		using NodeVector = vector< BvhNode, TbbAllocator< BvhNode > >;
+
 		struct Statistics
 		{
 			Statistics( const Aabb::Boundaries& boundaries )
@@ -144,7 +166,7 @@ namespace omicron::hierarchy
 			m_recursionCount( 0ul ),
 			m_maxDepth( 0ul )
 			{}
-			
+
 			ulong m_nNodes;
 			ulong m_nPoints;
 			ulong m_nLeaves;
@@ -154,522 +176,518 @@ namespace omicron::hierarchy
 			ulong m_minPointsPerLeaf;
 			ulong m_recursionCount;
 			ulong m_maxDepth;
-			
+
 			Aabb::Boundaries m_boundaries;
-			
+
 			friend ostream& operator<<( ostream& out, const Statistics& stats );
 		};
-		
-		/** Ctor for an empty Bvh. Points can be inserted using insert(). */
-		Bvh( int maxLevel );
-		
+
+		/** Default maximum number of points in a leaf. */
+		static constexpr uint DEFAULT_MAX_LEAF_POINTS = 16u;
+
+		/** Number of bins per axis used to evaluate the SAH. */
+		static constexpr int N_BINS = 16;
+
+		/** Minimum number of points of a subtree built by a parallel task. */
+		static constexpr ulong MIN_SUBTREE_POINTS = 4096ul;
+
+		/** Builds the Bvh.
+		 * @param points is the input. It is reordered so each leaf has a contiguous range.
+		 * @param maxLevel is the maximum number of levels. The root is at level 1.
+		 * @param maxLeafPoints is the number of points above which a node is split, unless it is at maxLevel.
+		 * @param nThreads is the number of threads used to build the subtrees. */
+		Bvh( PointVector&& points, const int maxLevel = numeric_limits< int >::max(),
+			 const uint maxLeafPoints = DEFAULT_MAX_LEAF_POINTS, const int nThreads = omp_get_max_threads() );
+
 		/** @param plyFilename the path for a .ply file with the input. */
-		Bvh( const string& plyFilename, int maxLevel );
-		
-		const Aabb& root() const { return *m_root; }
-		
-		/** Inserts the point into the Bvh, selecting the insertion path in the hierarchy using SAH. Internal nodes' Aabbs are fixed and geometry is inserted at leaves. New nodes can be created in the process. */
-		void insert( const Point& point );
-		
+		Bvh( const string& plyFilename, const int maxLevel = numeric_limits< int >::max(),
+			 const uint maxLeafPoints = DEFAULT_MAX_LEAF_POINTS, const int nThreads = omp_get_max_threads() );
+
+		/** @throws logic_error if the Bvh is empty. */
+		const BvhNode& root() const;
+
+		const NodeVector& nodes() const { return m_nodes; }
+
+		/** Point buffer referenced by the leaves. */
+		const PointVector& points() const { return m_points; }
+
 		Statistics statistics() const;
-		
-		void shrink();
-		
+
 		/** Sanity test. Throws exceptions when insane.*/
 		void isSane( bool print = false ) const;
-		
+
 	private:
-		void isSane( const Aabb& aabb, int level, bool print ) const;
-		
-		void statistics( const Aabb& aabb, Statistics& stats ) const;
-		
-		typename Aabb::AabbPtr m_root;
+		/** Node of the top of the hierarchy, split serially. Its leaves are the subtrees built in parallel. */
+		typedef struct TopNode
+		{
+			Aabb m_aabb;
+			int m_left;
+			int m_right;
+			/** Index of the subtree if this is a top leaf, -1 otherwise. */
+			int m_subtree;
+		} TopNode;
+
+		/** Subtree built by a parallel task. Its nodes have indices local to the subtree. */
+		typedef struct Subtree
+		{
+			ulong m_begin;
+			ulong m_end;
+			int m_level;
+			NodeVector m_nodes;
+		} Subtree;
+
+		void build( const int nThreads );
+
+		/** Splits the top of the hierarchy recursively until the point ranges are smaller than subtreePoints.
+		 * @returns the index of the created top node. */
+		int buildTop( const ulong begin, const ulong end, const int level, const ulong subtreePoints,
+					  vector< TopNode >& topNodes, vector< Subtree >& subtrees );
+
+		/** Builds the subtree of the point range [ begin, end ) in depth-first order into nodes. */
+		void buildSubtree( const ulong begin, const ulong end, const int level, NodeVector& nodes );
+
+		/** Appends the nodes of a top node and the subtrees under it to the node array, fixing the child indices. */
+		void layout( const vector< TopNode >& topNodes, const int topIdx, vector< Subtree >& subtrees );
+
+		bool isLeafRange( const ulong begin, const ulong end, const int level ) const
+		{
+			return end - begin <= m_maxLeafPoints || level >= m_maxLevel;
+		}
+
+		/** @returns the bounding box of the points in [ begin, end ). */
+		Aabb calcAabb( const ulong begin, const ulong end ) const;
+
+		/** Partitions the points in [ begin, end ) by the best binned SAH split. If all points fall in the same bin, the
+		 * range is split at the median of the largest axis.
+		 * @returns the index of the first point of the right side. */
+		ulong split( const ulong begin, const ulong end, const Aabb& aabb );
+
+		void isSane( const uint nodeIdx, const int level, const bool print, ulong& nextPoint ) const;
+
+		void statistics( const uint nodeIdx, Statistics& stats ) const;
+
+		PointVector m_points;
+		NodeVector m_nodes;
 		int m_maxLevel;
+		uint m_maxLeafPoints;
 	};
-	
+
 	// ==== Aabb implementation ====
-	
-	Aabb::Aabb( const Vec3& p )
-	: m_boundaries( p, Vec3( 0.f, 0.f, 0.f ) )
-	{}
-	
-	void Aabb::insert( const Point& point )
+
+	inline Aabb::Boundaries Aabb::calcNewBoundaries( const Vec3& point ) const
 	{
-		// Debug
-// 		{
-// 			cout << "Before: " << *this << endl << endl;
-// 		}
-		//
-		
-		insert( point.getPos() );
-		
-		// Debug
-// 		{
-// 			cout << "After: " << *this << endl << endl;
-// 		}
-		//
+		Aabb newAabb = *this;
+		newAabb.insert( point );
+
+		return newAabb.boundaries();
 	}
-	
-	void Aabb::insert( const Vec3& point )
+
+	inline float Aabb::sahSurfaceArea( const Boundaries& boundaries )
 	{
-		m_boundaries = calcNewBoundaries( point );
+		const Vec3& extension = boundaries.m_extension;
+
+		return extension.x() * ( extension.y() + extension.z() ) + extension.y() * extension.z();
 	}
-	
-	Aabb::Boundaries Aabb::calcNewBoundaries( const Vec3& point ) const
+
+	inline bool Aabb::contains( const Vec3& point, const float epsilon ) const
 	{
-		Vec3 newOrigin;
-		Vec3 newExtension;
-		
-		Vec3 prevMax = maxPoint();
-		
-		for( int i = 0; i < 3; ++i )
-		{
-			newOrigin[ i ] = min( m_boundaries.m_origin[ i ], point[ i ] );
-			float newMaxCoord = max( prevMax[ i ], point[ i ] );
-			newExtension[ i ] = newMaxCoord - newOrigin[ i ];
-		}
-		
-		return Boundaries( newOrigin, newExtension ); 
+		return ( point.array() >= m_min.array() - epsilon ).all() && ( point.array() <= m_max.array() + epsilon ).all();
 	}
-	
-	float Aabb::sahSurfaceArea( const Boundaries& boundaries )
+
+	inline bool Aabb::contains( const Aabb& other, const float epsilon ) const
 	{
-		const Vec3& extension = boundaries.m_extension;
-		
-		return extension.x() * ( extension.y() + extension.z() ) + extension.y() * extension.z();
+		return contains( other.m_min, epsilon ) && contains( other.m_max, epsilon );
 	}
-	
-	Vec3 Aabb::maxPoint() const
+
+	inline ostream& operator<<( ostream& out, const Aabb& aabb )
 	{
-		return m_boundaries.m_origin + m_boundaries.m_extension;
+		out << aabb.boundaries();
+		return out;
 	}
-	
-	Vec3 Aabb::center() const
+
+	// ==== Bvh implementation ====
+
+	inline Bvh::Bvh( PointVector&& points, const int maxLevel, const uint maxLeafPoints, const int nThreads )
+	: m_points( std::move( points ) ),
+	m_maxLevel( std::max( maxLevel, 1 ) ),
+	m_maxLeafPoints( std::max( maxLeafPoints, 1u ) )
 	{
-		return m_boundaries.m_origin + m_boundaries.m_extension * 0.5f;
+		build( nThreads );
 	}
 
-	ostream& operator<<( ostream& out, const Aabb& aabb )
+	inline Bvh::Bvh( const string& plyFilename, const int maxLevel, const uint maxLeafPoints, const int nThreads )
+	: m_maxLevel( std::max( maxLevel, 1 ) ),
+	m_maxLeafPoints( std::max( maxLeafPoints, 1u ) )
 	{
-		out << "Addr: " << &aabb << endl << "Is leaf: " << ( ( aabb.isLeaf() ) ? "true" : "false" ) << endl << aabb.m_boundaries;
-		return out;
+		auto start = util::Profiler::now( "Bvh creation" );
+
+		PlyPointReader reader( plyFilename );
+		m_points.reserve( reader.getNumPoints() );
+		reader.read( [ & ]( const Point& p ) { m_points.push_back( p ); } );
+
+		build( nThreads );
+
+		util::Profiler::elapsedTime( start, "Bvh creation" );
 	}
-	
-	// ==== InnerAabb implementation ====
-	
-	InnerAabb::InnerAabb( Aabb::AabbPtr leftChild, Aabb::AabbPtr rightChild )
-	: Aabb::Aabb( leftChild->boundaries().m_origin )
+
+	inline const BvhNode& Bvh::root() const
 	{
-		m_children.push_back( leftChild );
-		m_children.push_back( rightChild );
-		
-		// Set boundaries.
-		insert( m_children[ 0 ]->origin() );
-		insert( m_children[ 0 ]->maxPoint() );
-		insert( m_children[ 1 ]->origin() );
-		insert( m_children[ 1 ]->maxPoint() );
+		if( m_nodes.empty() )
+		{
+			throw logic_error( "Empty Bvh has no root." );
+		}
+
+		return m_nodes[ 0 ];
 	}
 
-	void InnerAabb::traverseAndInsert( const Point& point, int level, int maxLevel )
+	inline void Bvh::build( const int nThreads )
 	{
-		// Case 1: The object and a leaf node are paired under a new node.
-		// Case 2: The object is added as a new child to an existing node.
-		// Case 3: The object is added lower in the tree by means of recursing into a child volume.
-		float epsilon = 1.e-10;
-		
-		// Case 1 cost.
-		float cost1 = std::numeric_limits< float >::max();
-		AabbPtr bestCase1NewChild = nullptr;
-		typename ChildrenVector::iterator itToPairedLeaf = m_children.end();
-		
-		AabbPtr bestCase3Inner = nullptr;
-		
-		bool hasInnerChild = false;
-		
-		// Debug
-// 		{
-// 			cout << "Traversing:" << endl << *this << endl << endl;
-// 		}
-		
-		AabbPtr newLeaf( new LeafAabb( point ) );
-		
+		if( m_points.empty() )
 		{
-			float bestCase3InnerCost = std::numeric_limits< float >::max();
-			
-			for( typename ChildrenVector::iterator child = m_children.begin(); child != m_children.end(); child++ )
-			{
-				if( ( *child )->isLeaf() )
-				{
-					// Select the best leaf node to pair with a new leaf node in case 1.
-					AabbPtr newNode( new InnerAabb( *child, newLeaf ) );
-					float cost = 2 * newNode->sahSurfaceArea( newNode->boundaries() );
-					
-					bool currentIsBetterInTie = false;
-					
-					if( abs( cost - cost1 ) < epsilon )
-					{
-						// Cost tie. Choose the Aabb with nearest center.
-						Vec3 distanceToCurrent = point.getPos() - newNode->center();
-						Vec3 distanceToBest = point.getPos() - bestCase1NewChild->center();
-						
-						if( distanceToCurrent.squaredNorm() < distanceToBest.squaredNorm() )
-						{
-							cost1 = cost;
-							bestCase1NewChild = newNode;
-							itToPairedLeaf = child;
-						}
-					}
-					else if( cost < cost1 )
-					{
-						cost1 = cost;
-						bestCase1NewChild = newNode;
-						itToPairedLeaf = child;
-					}
-				}
-				else
-				{
-					// Select the best inner node to recurse in case 3.
-					hasInnerChild = true;
-					
-					float childOldArea = sahSurfaceArea( ( *child )->boundaries() );
-					float childNewArea = sahSurfaceArea( ( *child )->calcNewBoundaries( point.getPos() ) );
-					float cost = ( ( ( *child )->isLeaf() ) ? 0 : ( *child )->children().size() ) * ( childNewArea - childOldArea );
-					
-					if( abs( cost - bestCase3InnerCost ) < epsilon )
-					{
-						// Cost tie. Choose the Aabb with nearest center.
-						Vec3 distanceToCurrent = point.getPos() - ( *child )->center();
-						Vec3 distanceToBest = point.getPos() - bestCase3Inner->center();
-						
-						if( distanceToCurrent.squaredNorm() < distanceToBest.squaredNorm() )
-						{
-							bestCase3InnerCost = cost;
-							bestCase3Inner = *child;
-						}
-					}
-					else if( cost < bestCase3InnerCost )
-					{
-						bestCase3InnerCost = cost;
-						bestCase3Inner = *child;
-					}
-				}
-			}
-			
-			// Debug
-// 			{
-// 				if( itToPairedLeaf != m_children.end() )
-// 				{
-// 					cout << "Best leaf:" << endl << **itToPairedLeaf << endl << endl
-// 						 << "New paired inner:" << endl << *bestCase1NewChild << endl << endl;
-// 				}
-// 				else
-// 				{
-// 					cout << "No leaves." << endl << endl;
-// 				}
-// 				
-// 				if( bestCase3Inner != nullptr )
-// 				{
-// 					cout << "Best inner:" << endl << *bestCase3Inner << endl << endl;
-// 				}
-// 				else
-// 				{
-// 					cout << "No inners." << endl << endl;
-// 				}
-// 			}
-			//
+			return;
 		}
-		
-		// Case 2 cost.
-		float oldArea = sahSurfaceArea( m_boundaries );
-		float newArea = sahSurfaceArea( calcNewBoundaries( point.getPos() ) );
-		
-		float cost2 = m_children.size() * ( newArea - oldArea ) + newArea;
-		
-		// Case 3 cost.
-		float cost3 = ( hasInnerChild ) ? m_children.size() * ( newArea - oldArea ) : std::numeric_limits< float >::max(); 
-		
-		float bestCost = min( min( cost1, cost2 ), cost3 );
-		
-		// Debug
-// 		{
-// 			cout << "cost 1: " << cost1 << endl << "cost 2: " << cost2 << endl << "cost 3: " << cost3 << endl << endl;
-// 		}
-		//
-		
-		// Fix bounding box.
-		insert( point );
-		
-		// Debug
-// 		{
-// 			cout << "Fixed: " << *this << endl << endl;
-// 		}
-		//
-		
-		if( abs( bestCost - cost1 ) < epsilon )
+
+		if( m_points.size() > ulong( numeric_limits< uint >::max() ) )
 		{
-			if( level == maxLevel - 1 )
-			{
-				// Debug 
-// 				{
-// 					cout << "Case: max level. Inserting at best leaf." << endl << endl;
-// 				}
-				
-				// Cannot increase level, so creating a new inner node is not allowed. Inserting directly at leaf instead.
-				( *itToPairedLeaf )->insert( point );
-			}
-			else
-			{
-				// Debug 
-// 				{
-// 					cout << "Case: paired with best child" << endl << endl;
-// 				}
-				
-				// Case 1 is better
-				*itToPairedLeaf = bestCase1NewChild;
-			}
+			throw logic_error( "Bvh supports at most 2^32 - 1 points." );
 		}
-		else if( abs( bestCost - cost2 ) < epsilon )
+
+		// About 8 subtrees per thread, so the work stealing of the dynamic schedule can balance uneven subtrees.
+		int nWorkers = std::max( nThreads, 1 );
+		ulong subtreePoints = ( nWorkers == 1 ) ? m_points.size()
+								: std::max( m_points.size() / ( 8ul * nWorkers ), MIN_SUBTREE_POINTS );
+
+		vector< TopNode > topNodes;
+		vector< Subtree > subtrees;
+		buildTop( 0ul, m_points.size(), 1, subtreePoints, topNodes, subtrees );
+
+		#pragma omp parallel for schedule( dynamic ) num_threads( nWorkers )
+		for( int i = 0; i < int( subtrees.size() ); ++i )
 		{
-			// Debug 
-// 			{
-// 				cout << "Case: added as new child" << endl << endl;
-// 			}
-			
-			// Case 2 is better
-			m_children.push_back( newLeaf );
+			Subtree& subtree = subtrees[ i ];
+			buildSubtree( subtree.m_begin, subtree.m_end, subtree.m_level, subtree.m_nodes );
 		}
-		else
+
+		ulong nNodes = topNodes.size();
+		for( const Subtree& subtree : subtrees )
 		{
-			// Debug 
-// 			{
-// 				cout << "Case: recursion" << endl << endl;
-// 			}
-			
-			// Case 3 is better
-			bestCase3Inner->traverseAndInsert( point, level + 1, maxLevel );
+			nNodes += subtree.m_nodes.size();
 		}
+		m_nodes.reserve( nNodes );
+
+		layout( topNodes, 0, subtrees );
 	}
 
-	void InnerAabb::shrink()
+	inline int Bvh::buildTop( const ulong begin, const ulong end, const int level, const ulong subtreePoints,
+							  vector< TopNode >& topNodes, vector< Subtree >& subtrees )
 	{
-		m_children.shrink_to_fit();
-		
-		for( AabbPtr child : m_children )
+		int topIdx = topNodes.size();
+
+		if( end - begin <= subtreePoints || isLeafRange( begin, end, level ) )
 		{
-			child->shrink();
+			topNodes.push_back( TopNode{ Aabb(), -1, -1, int( subtrees.size() ) } );
+			subtrees.push_back( Subtree{ begin, end, level, NodeVector() } );
+			return topIdx;
 		}
+
+		Aabb aabb = calcAabb( begin, end );
+		topNodes.push_back( TopNode{ aabb, -1, -1, -1 } );
+
+		ulong mid = split( begin, end, aabb );
+		int left = buildTop( begin, mid, level + 1, subtreePoints, topNodes, subtrees );
+		int right = buildTop( mid, end, level + 1, subtreePoints, topNodes, subtrees );
+		topNodes[ topIdx ].m_left = left;
+		topNodes[ topIdx ].m_right = right;
+
+		return topIdx;
 	}
 
-	
-	// ==== LeafAabb implementation ====
-	
-	LeafAabb::LeafAabb( const Point& point )
-	: Aabb::Aabb( point.getPos() )
+	inline void Bvh::buildSubtree( const ulong begin, const ulong end, const int level, NodeVector& nodes )
 	{
-		m_points.push_back( point );
+		Aabb aabb = calcAabb( begin, end );
+
+		if( isLeafRange( begin, end, level ) )
+		{
+			nodes.push_back( BvhNode::leaf( aabb, uint( begin ), uint( end - begin ) ) );
+			return;
+		}
+
+		uint nodeIdx = nodes.size();
+		nodes.push_back( BvhNode() );
+
+		ulong mid = split( begin, end, aabb );
+		buildSubtree( begin, mid, level + 1, nodes );
+		nodes[ nodeIdx ] = BvhNode::inner( aabb, nodes.size() );
+		buildSubtree( mid, end, level + 1, nodes );
 	}
-	
-	void LeafAabb::insert( const Point& point )
+
+	inline void Bvh::layout( const vector< TopNode >& topNodes, const int topIdx, vector< Subtree >& subtrees )
 	{
-		Aabb::insert(point);
-		m_points.push_back( point );
+		const TopNode& topNode = topNodes[ topIdx ];
+
+		if( topNode.m_subtree != -1 )
+		{
+			Subtree& subtree = subtrees[ topNode.m_subtree ];
+			uint base = m_nodes.size();
+			for( const BvhNode& node : subtree.m_nodes )
+			{
+				m_nodes.push_back( node );
+				if( !node.isLeaf() )
+				{
+					m_nodes.back().m_offset += base;
+				}
+			}
+			NodeVector().swap( subtree.m_nodes );
+
+			return;
+		}
+
+		uint nodeIdx = m_nodes.size();
+		m_nodes.push_back( BvhNode() );
+		layout( topNodes, topNode.m_left, subtrees );
+		m_nodes[ nodeIdx ] = BvhNode::inner( topNode.m_aabb, m_nodes.size() );
+		layout( topNodes, topNode.m_right, subtrees );
 	}
 
-	void LeafAabb::traverseAndInsert( const Point& point, int level, int maxLevel )
+	inline Aabb Bvh::calcAabb( const ulong begin, const ulong end ) const
 	{
-		insert( point );
+		Aabb aabb;
+		for( ulong i = begin; i < end; ++i )
+		{
+			aabb.insert( m_points[ i ].getPos() );
+		}
+
+		return aabb;
 	}
 
-	// ==== Bvh implementation ====
-	
-	Bvh::Bvh( int maxLevel = std::numeric_limits< int >::max() )
-	: m_root( nullptr ),
-	m_maxLevel( maxLevel )
-	{}
-	
-	Bvh::Bvh( const string& plyFilename, int maxLevel = std::numeric_limits< int >::max() )
-	: m_root( nullptr ),
-	m_maxLevel( maxLevel )
+	inline ulong Bvh::split( const ulong begin, const ulong end, const Aabb& aabb )
 	{
-		auto start = util::Profiler::now( "Bvh creation" );
-		
-		using namespace util;
-		
-		PlyPointReader reader( plyFilename );
-		reader.read(
-			[ & ]( const Point& p )
+		using Bins = array< Aabb, N_BINS >;
+		using BinCounts = array< ulong, N_BINS >;
+
+		Vec3 origin = aabb.origin();
+		Vec3 extension = aabb.extension();
+
+		auto binIdx =
+			[ & ]( const Vec3& pos, const int axis )
 			{
-				insert( p );
-				
-				// DEBUG
-// 				{
-// 					isSane();
-// 				}
-				//
-			}
-		);
-		
-		shrink();
-		
-		util::Profiler::elapsedTime( start, "Bvh creation" );
-	}
-	
-	void Bvh::insert( const Point& point )
-	{
-		// Debug
-// 		{
-// 			cout << "===== INSERTING =====" << endl << point << endl;
-// 		}
-		//
-		
-		if( m_root == nullptr )
+				int bin = int( float( N_BINS ) * ( pos[ axis ] - origin[ axis ] ) / extension[ axis ] );
+				return std::min( std::max( bin, 0 ), N_BINS - 1 );
+			};
+
+		array< Bins, 3 > bins;
+		array< BinCounts, 3 > counts;
+		for( int axis = 0; axis < 3; ++axis )
 		{
-			m_root = Aabb::AabbPtr( new LeafAabb( point ) );
+			counts[ axis ].fill( 0ul );
 		}
-		else if( m_root->isLeaf() )
+
+		for( ulong i = begin; i < end; ++i )
 		{
-			Aabb::AabbPtr newLeaf( new LeafAabb( point ) );
-			m_root = Aabb::AabbPtr( new InnerAabb( m_root, newLeaf ) );
+			const Vec3& pos = m_points[ i ].getPos();
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				if( extension[ axis ] > 0.f )
+				{
+					int bin = binIdx( pos, axis );
+					bins[ axis ][ bin ].insert( pos );
+					++counts[ axis ][ bin ];
+				}
+			}
 		}
-		else
+
+		// Sweeps the bins from both sides. The cost of splitting after bin b is
+		// area( left ) * nPoints( left ) + area( right ) * nPoints( right ).
+		float bestCost = numeric_limits< float >::max();
+		int bestAxis = -1;
+		int bestBin = -1;
+		for( int axis = 0; axis < 3; ++axis )
 		{
-			m_root->traverseAndInsert( point, 1, m_maxLevel );
+			if( extension[ axis ] <= 0.f )
+			{
+				continue;
+			}
+
+			array< float, N_BINS > rightCosts;
+			Aabb right;
+			ulong nRight = 0ul;
+			for( int b = N_BINS - 1; b > 0; --b )
+			{
+				right.insert( bins[ axis ][ b ] );
+				nRight += counts[ axis ][ b ];
+				rightCosts[ b ] = right.sahSurfaceArea() * float( nRight );
+			}
+
+			Aabb left;
+			ulong nLeft = 0ul;
+			for( int b = 0; b < N_BINS - 1; ++b )
+			{
+				left.insert( bins[ axis ][ b ] );
+				nLeft += counts[ axis ][ b ];
+
+				if( nLeft == 0ul || nLeft == end - begin )
+				{
+					continue;
+				}
+
+				float cost = left.sahSurfaceArea() * float( nLeft ) + rightCosts[ b + 1 ];
+				if( cost < bestCost )
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
 		}
+
+		auto first = m_points.begin() + begin;
+		auto last = m_points.begin() + end;
+
+		if( bestAxis == -1 )
+		{
+			int axis;
+			extension.maxCoeff( &axis );
+			auto mid = first + ( end - begin ) / 2;
+			nth_element( first, mid, last,
+				[ & ]( const Point& p0, const Point& p1 ) { return p0.getPos()[ axis ] < p1.getPos()[ axis ]; }
+			);
+
+			return mid - m_points.begin();
+		}
+
+		auto mid = partition( first, last,
+			[ & ]( const Point& p ) { return binIdx( p.getPos(), bestAxis ) <= bestBin; }
+		);
+
+		return mid - m_points.begin();
 	}
-	
-	void Bvh::shrink()
-	{
-		m_root->shrink();
-	}
-	
-	void Bvh::isSane( bool print ) const
+
+	inline void Bvh::isSane( bool print ) const
 	{
-		isSane( *m_root, 1, print );
+		if( m_nodes.empty() )
+		{
+			return;
+		}
+
+		ulong nextPoint = 0ul;
+		isSane( 0u, 1, print, nextPoint );
+
+		if( nextPoint != m_points.size() )
+		{
+			stringstream ss; ss << "Leaves are expected to cover all points. Covered: " << nextPoint << " Points: "
+				<< m_points.size() << endl << endl;
+			throw runtime_error( ss.str() );
+		}
 	}
-	
-	void Bvh::isSane( const Aabb& aabb, int level, bool print ) const
+
+	inline void Bvh::isSane( const uint nodeIdx, const int level, const bool print, ulong& nextPoint ) const
 	{
+		const BvhNode& node = m_nodes[ nodeIdx ];
+		const Aabb& aabb = node.aabb();
+		float epsilon = 1.e-5;
+
 		if( print )
 		{
-			cout << "Level: " << level << "." << endl << aabb << endl << endl;
+			cout << "Level: " << level << ". Node: " << nodeIdx << endl << aabb << endl << endl;
 		}
-		
-		if( !aabb.isLeaf() )
+
+		if( level > m_maxLevel )
 		{
-			using ChildrenVector = InnerAabb::ChildrenVector;
-			
-			const ChildrenVector& children = aabb.children();
-			
-			float sah = aabb.sahSurfaceArea( aabb.boundaries() );
-			
-			for( ChildrenVector::const_iterator it = children.begin(); it != children.end(); it++ )
+			stringstream ss; ss << "Node " << nodeIdx << " is deeper than the max level " << m_maxLevel << endl << endl;
+			throw runtime_error( ss.str() );
+		}
+
+		if( node.isLeaf() )
+		{
+			// Leaves are in depth-first order, so their point ranges are expected to be consecutive.
+			if( node.firstPoint() != nextPoint || node.firstPoint() + node.nPoints() > m_points.size() )
 			{
-				const Aabb& child = ( **it );
-				float childSah = child.sahSurfaceArea( child.boundaries() );
-				
-				
+				stringstream ss; ss << "Leaf " << nodeIdx << " point range is expected to start at " << nextPoint
+					<< ". Range: [ " << node.firstPoint() << ", " << node.firstPoint() + node.nPoints() << " )" << endl << endl;
+				throw runtime_error( ss.str() );
+			}
+
+			for( uint i = node.firstPoint(); i < node.firstPoint() + node.nPoints(); ++i )
+			{
+				if( !aabb.contains( m_points[ i ].getPos(), epsilon ) )
 				{
-					float epsilon = 1.e-5;
-					// Checking surface area.
-					if( childSah >= sah + epsilon )
-					{
-						stringstream ss; ss << "Child surface area is expected to be less than parent." << "Parents SA: " << sah << " Child SA: " << childSah << endl << endl
-						<< "Parent:" << endl << aabb << endl << endl << "Child:" << endl << child << endl << endl; 
-						throw runtime_error( ss.str() );
-					}
-					
-					// Checking inclusion.
-					for( int i = 0; i < 3; ++i )
-					{
-						if( child.origin()[ i ] < aabb.origin()[ i ] - epsilon || child.maxPoint()[ i ] > aabb.maxPoint()[ i ] + epsilon )
-						{
-							stringstream ss; ss << "Child is expected to be contained in parent." << endl << endl
-							<< "Parent:" << endl << aabb << endl << endl << "Child:" << endl << child << endl << endl;
-							throw runtime_error( ss.str() );
-						}
-					}
+					stringstream ss; ss << "Point is expected to be contained in leaf." << endl << endl
+						<< "Leaf:" << endl << aabb << endl << endl << "Point:" << endl << m_points[ i ] << endl << endl;
+					throw runtime_error( ss.str() );
 				}
-				
-// 				for( ChildrenVector::const_iterator it2 = std::next( it, 1 ); it2 != children.end(); it2++ )
-// 				{
-// 					float collisionPercentage = 0.9f;
-// 					
-// 					const Aabb& sibling = ( **it2 );
-// 					
-// 					// Checking no intersection between children.
-// 					bool intersecting = true;
-// 					
-// 					// Debug
-// // 					{
-// // 						cout << "Intersection test: " << endl << child << endl << " XXX " << endl << sibling << endl << endl;
-// // 					}
-// 					//
-// 					
-// 					for( int i = 0; i < 3; ++i )
-// 					{
-// 						
-// 						if( child.origin()[ i ] > sibling.maxPoint()[ i ] - ( sibling.extension()[ i ] * collisionPercentage )
-// 							|| sibling.origin()[ i ] > child.maxPoint()[ i ] - ( child.extension()[ i ] * collisionPercentage ) )
-// 						{
-// 							// Debug
-// // 							{
-// // 								cout << "Not intersecting at " << i << endl << endl;
-// // 							}
-// 							//
-// 							
-// 							intersecting = false;
-// 							break;
-// 						}
-// 					}
-// 					
-// 					// Test
-// 					if( intersecting )
-// 					{
-// 						stringstream ss; ss << "Intersecting: " << endl << child << endl << "AND " << endl << sibling << endl << endl;
-// 						throw runtime_error( ss.str() );
-// 					}
-// 				}
 			}
-			
-			for( const Aabb::AabbPtr child : children )
+			nextPoint += node.nPoints();
+
+			return;
+		}
+
+		float sah = aabb.sahSurfaceArea();
+
+		for( uint childIdx : { BvhNode::leftChild( nodeIdx ), node.rightChild() } )
+		{
+			if( childIdx <= nodeIdx || childIdx >= m_nodes.size() )
+			{
+				stringstream ss; ss << "Node " << nodeIdx << " has invalid child index " << childIdx << endl << endl;
+				throw runtime_error( ss.str() );
+			}
+
+			const Aabb& child = m_nodes[ childIdx ].aabb();
+			float childSah = child.sahSurfaceArea();
+
+			// Checking surface area.
+			if( childSah >= sah + epsilon )
 			{
-					isSane( *child, level + 1, print );
+				stringstream ss; ss << "Child surface area is expected to be less than parent." << "Parents SA: " << sah << " Child SA: " << childSah << endl << endl
+				<< "Parent:" << endl << aabb << endl << endl << "Child:" << endl << child << endl << endl;
+				throw runtime_error( ss.str() );
+			}
+
+			// Checking inclusion.
+			if( !aabb.contains( child, epsilon ) )
+			{
+				stringstream ss; ss << "Child is expected to be contained in parent." << endl << endl
+				<< "Parent:" << endl << aabb << endl << endl << "Child:" << endl << child << endl << endl;
+				throw runtime_error( ss.str() );
 			}
 		}
+
+		isSane( BvhNode::leftChild( nodeIdx ), level + 1, print, nextPoint );
+		isSane( node.rightChild(), level + 1, print, nextPoint );
 	}
-	
-	Bvh::Statistics Bvh::statistics() const
+
+	inline Bvh::Statistics Bvh::statistics() const
 	{
-		Statistics stats( m_root->boundaries() );
+		Statistics stats( root().aabb().boundaries() );
 		stats.m_maxPointsPerLeaf = numeric_limits< ulong >::min();
 		stats.m_minPointsPerLeaf = numeric_limits< ulong >::max();
-		
-		statistics( *m_root, stats );
-		
+
+		statistics( 0u, stats );
+
 		stats.m_avgPointsPerLeaf = stats.m_nPoints / stats.m_nLeaves;
-		stats.m_avgChildrenPerInner = stats.m_avgChildrenPerInner / ( stats.m_nNodes - stats.m_nLeaves );
-		
-		
+		ulong nInner = stats.m_nNodes - stats.m_nLeaves;
+		stats.m_avgChildrenPerInner = ( nInner == 0ul ) ? 0ul : stats.m_avgChildrenPerInner / nInner;
+
 		return stats;
 	}
 
-	void Bvh::statistics( const Aabb& aabb, Statistics& stats ) const
+	inline void Bvh::statistics( const uint nodeIdx, Statistics& stats ) const
 	{
+		const BvhNode& node = m_nodes[ nodeIdx ];
+
 		++stats.m_nNodes;
 		++stats.m_recursionCount;
-		
+
 		if( stats.m_recursionCount > stats.m_maxDepth )
 		{
 			stats.m_maxDepth = stats.m_recursionCount;
 		}
-		
-		if( aabb.isLeaf() )
+
+		if( node.isLeaf() )
 		{
-			auto leafAabb = dynamic_cast< const LeafAabb* >( &aabb );
-			ulong pointsInLeaf = leafAabb->points().size();
+			ulong pointsInLeaf = node.nPoints();
 			stats.m_nPoints += pointsInLeaf;
 			++stats.m_nLeaves;
-		
+
 			if( pointsInLeaf > stats.m_maxPointsPerLeaf )
 			{
 				stats.m_maxPointsPerLeaf = pointsInLeaf;
@@ -681,18 +699,15 @@ namespace omicron::hierarchy
 		}
 		else
 		{
-			auto innerAabb = dynamic_cast< const InnerAabb* >( &aabb );
-			stats.m_avgChildrenPerInner += innerAabb->children().size();
-			for( const Aabb::AabbPtr child : innerAabb->children() )
-			{
-				statistics( *child, stats );
-			}
+			stats.m_avgChildrenPerInner += 2ul;
+			statistics( BvhNode::leftChild( nodeIdx ), stats );
+			statistics( node.rightChild(), stats );
 		}
-		
+
 		--stats.m_recursionCount;
 	}
-	
-	ostream& operator<<( ostream& out, const Bvh::Statistics& stats )
+
+	inline ostream& operator<<( ostream& out, const Bvh::Statistics& stats )
 	{
 		out << "Boundaries: " << endl << "origin: " << endl << stats.m_boundaries.m_origin << endl << "extension" << endl << stats.m_boundaries.m_extension << endl
 			<< "Max depth: " << stats.m_maxDepth << endl
@@ -704,7 +719,7 @@ namespace omicron::hierarchy
 			<< "Min points in a leaf: " << stats.m_minPointsPerLeaf << endl
 			<< "Max points in a leaf: " << stats.m_maxPointsPerLeaf << endl
 			<< "Recursion count: " << stats.m_recursionCount;
-			
+
 		return out;
 	}
 }
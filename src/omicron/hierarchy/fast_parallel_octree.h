@@ -8,12 +8,22 @@
 #include "omicron/disk/external_sort_reader.h"
 #include "omicron/hierarchy/o1_octree_node.h"
 #include "omicron/hierarchy/hierarchy_creator.h"
+#include "omicron/hierarchy/hierarchy_appender.h"
 #include "omicron/hierarchy/front.h"
 #include "omicron/memory/global_malloc.h"
 #include "omicron/hierarchy/runtime_setup.h"
 
 namespace omicron::hierarchy
 {
+	/** Point reader type for each sorting algorithm. */
+	template< typename Morton, Sorting S > struct SortingReader;
+	template< typename Morton > struct SortingReader< Morton, HEAP_SORT > { using Type = HeapPointReader< Morton >; };
+	template< typename Morton > struct SortingReader< Morton, PARTIAL_SORT >
+	{ using Type = PartialSortPointReader< Morton >; };
+	template< typename Morton > struct SortingReader< Morton, FULL_SORT > { using Type = SortPointReader< Morton >; };
+	template< typename Morton > struct SortingReader< Morton, EXTERNAL_SORT >
+	{ using Type = ExternalSortReader< Morton >; };
+	
 	/** Fast parallel octree. Provides visualization while async constructing the hierarchy bottom-up. */
 	template< typename MortonCode >
 	class FastParallelOctree
@@ -26,14 +36,17 @@ namespace omicron::hierarchy
 		using Dim = typename HierarchyCreator::OctreeDim;
 		using Front = hierarchy::Front< MortonCode >;
 		using NodeLoader = typename Front::NodeLoader;
-		using Renderer = SplatRenderer;
+		using Appender = HierarchyAppender< Morton >;
+		using PointVector = typename Appender::PointVector;
 		
 		/**
 		 * Ctor. Creates the octree from a .ply file, generating a sorted file in the process which can be used with
 		 * the other constructor in order to increase creation performance.
 		 * @param maxLvl is the level from which the octree will be constructed bottom-up. Smaller values incur in
 		 * less created nodes, but also less possibilities for LOD ( level of detail ). In practice, the more points the
-		 * model has, the deeper the hierachy needs to be for good visualization. */
+		 * model has, the deeper the hierachy needs to be for good visualization.
+		 * @param runtime has the reconstruction parameters. The sorting algorithm is chosen at runtime, but each one is a
+		 * separate reader instantiation, so the per-point sorting code has no configuration branches. */
 		FastParallelOctree( const string& plyFilename, const int maxLvl, NodeLoader& nodeLoader,
 							const RuntimeSetup& runtime = RuntimeSetup() );
 		
@@ -44,6 +57,7 @@ namespace omicron::hierarchy
 		~FastParallelOctree();
 		
 		/** Tracks the rendering front of the octree. */
+		template< typename Renderer >
 		OctreeStats trackFront( Renderer& renderer, const Float projThresh );
 		
 		/** Checks if the async creation is finished. */
@@ -52,6 +66,16 @@ namespace omicron::hierarchy
 		/** Returns only after async hierarchy creation has finished. */
 		void waitCreation();
 		
+		/** Merges a batch of new points into the hierarchy, waiting for its creation beforehand. Only the leaves the
+		 * points fall into are re-created and only their ancestors are re-sampled, so the cost is proportional to the
+		 * batch. The front nodes changed by the merge are replaced by placeholders, as are the holes left in the front by
+		 * new nodes, and the placeholders are substituted by the updated nodes in the next frames. Must be called by the
+		 * thread that tracks the front, between frames.
+		 * @param sortedPoints are the new points, in morton order and inside the octree boundaries.
+		 * @returns the number of created nodes. */
+		template< typename Renderer >
+		ulong append( const PointVector& sortedPoints, Renderer& renderer );
+		
 		/** Gets dimensional info of this octree. */
 		const Dim& dim() const { return m_dim; }
 		
@@ -76,6 +100,14 @@ namespace omicron::hierarchy
 		friend ostream& operator<<( ostream& out, const FastParallelOctree< M >& octree );
 		
 	private:
+		/** Creates the reader of the given sorting algorithm and builds from it. */
+		template< Sorting S >
+		void buildFromPly( const string& plyFilename, const int maxLvl, NodeLoader& nodeLoader,
+						   const RuntimeSetup& runtime );
+		
+		/** Applies the process-wide parameters in the configuration. */
+		void applyConfig( const RuntimeSetup& runtime );
+		
 		/** Builds from a point set in memory. */
 		void buildFromPoints( typename HierarchyCreator::ReaderPtr reader, const Dim& dim, NodeLoader& nodeLoader, const RuntimeSetup& runtime );
 		
@@ -99,6 +131,9 @@ namespace omicron::hierarchy
 		/** Dimensional info of this octree. */
 		Dim m_dim;
 		
+		/** Reconstruction parameters. Appended points are sampled with them. */
+		ReconstructionConfig m_config;
+		
 		/** Root node of the hierarchy. */
 		Node* m_root;
 		
@@ -123,22 +158,15 @@ namespace omicron::hierarchy
 	{
 		assert( maxLvl <= Morton::maxLvl() );
 		
-		omp_set_num_threads( 8 );
+		applyConfig( runtime );
 		
-		#if SORTING == HEAP_SORT_D
-			HeapPointReader< Morton >* reader = new HeapPointReader< Morton >( plyFilename, maxLvl );
-		#elif SORTING == PARTIAL_SORT_D
-			PartialSortPointReader< Morton >* reader = new PartialSortPointReader< Morton >( plyFilename, maxLvl );
-		#elif SORTING == FULL_SORT_D
-			SortPointReader< Morton >* reader = new SortPointReader< Morton >( plyFilename, maxLvl );
-        #elif SORTING == EXTERNAL_SORT_D
-			ExternalSortReader< Morton >* reader = new ExternalSortReader< Morton >( plyFilename, maxLvl );
-		#endif
-		
-		m_readerInTime = reader->inputTime();
-		m_readerInitTime = reader->initTime();
-		
-		buildFromPoints( typename HierarchyCreator::ReaderPtr( reader ), reader->dimensions(), loader, runtime );
+		switch( runtime.m_config.m_sorting )
+		{
+			case HEAP_SORT: buildFromPly< HEAP_SORT >( plyFilename, maxLvl, loader, runtime ); break;
+			case PARTIAL_SORT: buildFromPly< PARTIAL_SORT >( plyFilename, maxLvl, loader, runtime ); break;
+			case FULL_SORT: buildFromPly< FULL_SORT >( plyFilename, maxLvl, loader, runtime ); break;
+			case EXTERNAL_SORT: buildFromPly< EXTERNAL_SORT >( plyFilename, maxLvl, loader, runtime ); break;
+		}
 	}
 	
 	template< typename Morton >
@@ -151,6 +179,7 @@ namespace omicron::hierarchy
 	m_readerInitTime( 0u ),
 	m_readerReadTime( 0u )
 	{
+		applyConfig( runtime );
 		buildFromSortedFile( octreeJson, loader, runtime );
 	}
 	
@@ -170,11 +199,31 @@ namespace omicron::hierarchy
 	}
 	
 	template< typename Morton >
+	template< Sorting S >
 	void FastParallelOctree< Morton >
-	::buildFromPoints( typename HierarchyCreator::ReaderPtr reader, const Dim& dim, NodeLoader& loader, const RuntimeSetup& runtime )
+	::buildFromPly( const string& plyFilename, const int maxLvl, NodeLoader& loader, const RuntimeSetup& runtime )
 	{
-		omp_set_num_threads( 8 );
+		using Reader = typename SortingReader< Morton, S >::Type;
+		Reader* reader = new Reader( plyFilename, maxLvl );
 		
+		m_readerInTime = reader->inputTime();
+		m_readerInitTime = reader->initTime();
+		
+		buildFromPoints( typename HierarchyCreator::ReaderPtr( reader ), reader->dimensions(), loader, runtime );
+	}
+	
+	template< typename Morton >
+	void FastParallelOctree< Morton >::applyConfig( const RuntimeSetup& runtime )
+	{
+		m_config = runtime.m_config;
+		omp_set_num_threads( m_config.m_nThreads );
+		GpuAllocStatistics::setTotalGpuMem( runtime.m_config.m_gpuMemory );
+	}
+	
+	template< typename Morton >
+	void FastParallelOctree< Morton >
+	::buildFromPoints( typename HierarchyCreator::ReaderPtr reader, const Dim& dim, NodeLoader& loader, const RuntimeSetup& runtime )
+	{
 		m_dim = dim;
 		
 		// Debug
@@ -182,13 +231,16 @@ namespace omicron::hierarchy
 			cout << "Dim from sorted set: " << m_dim << endl;
 		}
 		
-		m_front = new Front( "", m_dim, runtime.m_nThreads, loader, runtime.m_memoryQuota );
+		const ReconstructionConfig& config = runtime.m_config;
+		
+		m_front = new Front( "", m_dim, config.m_nThreads, loader, config.m_ramQuota, Morton::maxLvl(), config );
 		
 		m_hierarchyCreator = new HierarchyCreator( 	std::move( reader ), m_dim,
 													#ifdef HIERARCHY_CREATION_RENDERING
 														*m_front,
 													#endif
-													runtime.m_loadPerThread, runtime.m_memoryQuota, runtime.m_nThreads );
+													config.m_workListSize, config.m_ramQuota, config.m_nThreads,
+													config );
 		
 		m_creationFuture = m_hierarchyCreator->createAsync();
 	}
@@ -198,8 +250,6 @@ namespace omicron::hierarchy
 	::buildFromSortedFile( const Json::Value& octreeJson, NodeLoader& loader, const RuntimeSetup& runtime )
 	{
 		cout << "Octree json: " << endl << octreeJson << endl;
-			
-		omp_set_num_threads( 8 );
 		
 		Vec3 octreeSize( octreeJson[ "size" ][ "x" ].asFloat(),
 						 octreeJson[ "size" ][ "y" ].asFloat(),
@@ -215,19 +265,23 @@ namespace omicron::hierarchy
 			cout << "Dim from Json: " << m_dim << endl;
 		}
 		
-		m_front = new Front( octreeJson[ "database" ].asString(), m_dim, runtime.m_nThreads, loader,
-							 runtime.m_memoryQuota );
+		const ReconstructionConfig& config = runtime.m_config;
+		
+		m_front = new Front( octreeJson[ "database" ].asString(), m_dim, config.m_nThreads, loader,
+							 config.m_ramQuota, Morton::maxLvl(), config );
 		
 		m_hierarchyCreator = new HierarchyCreator( octreeJson[ "points" ].asString(), m_dim,
 													#ifdef HIERARCHY_CREATION_RENDERING
 														*m_front,
 													#endif
-												   runtime.m_loadPerThread, runtime.m_memoryQuota, runtime.m_nThreads );
+												   config.m_workListSize, config.m_ramQuota, config.m_nThreads,
+												   config );
 		
 		m_creationFuture = m_hierarchyCreator->createAsync();
 	}
 	
 	template< typename Morton >
+	template< typename Renderer >
 	OctreeStats FastParallelOctree< Morton >
 	::trackFront( Renderer& renderer, const Float projThresh )
 	{
@@ -266,6 +320,22 @@ namespace omicron::hierarchy
 		}
 	}
 	
+	template< typename Morton >
+	template< typename Renderer >
+	ulong FastParallelOctree< Morton >::append( const PointVector& sortedPoints, Renderer& renderer )
+	{
+		waitCreation();
+		
+		Appender appender( *m_root, m_dim, m_config, sortedPoints );
+		
+		m_front->beginUpdate( [ & ]( const Morton& morton ) { return appender.isInvalidated( morton ); },
+							  appender.createdMortons(), appender.invalidatedNodes(), renderer );
+		appender.append();
+		m_front->endUpdate( [ & ]( const Morton& morton ) { return appender.find( morton ); } );
+		
+		return appender.nCreatedNodes();
+	}
+	
 	template< typename Morton >
 	pair< uint, uint > FastParallelOctree< Morton >::nodeStatistics() const
 	{
@@ -1,10 +1,17 @@
 #ifndef FRONT_H
 #define FRONT_H
 
+#include <cmath>
 #include <list>
+#include <unordered_set>
 #include "omicron/hierarchy/o1_octree_node.h"
+#include "omicron/hierarchy/front_chunks.h"
+#include "omicron/hierarchy/gpu_residency_manager.h"
 #include "omicron/hierarchy/octree_dimensions.h"
 #include "omicron/hierarchy/octree_stats.h"
+#include "omicron/hierarchy/reconstruction_config.h"
+#include "omicron/renderer/box_batch_tests.h"
+#include "omicron/renderer/camera_predictor.h"
 // #include "renderers/StreamingRenderer.h"
 #include "omicron/renderer/splat_renderer/splat_renderer.hpp"
 #include "omicron/hierarchy/node_loader.h"
@@ -24,9 +31,6 @@
 // #define PRUNING_DEBUG
 // #define BRANCHING_DEBUG
 
-// Turn on asynchronous GPU node loading.
-#define ASYNC_LOAD
-
 // Cut rendering methods.
 #define RENDER_ENTIRE_CUT 0 // Renders the entire cut. The default and correct method to visualize the point cloud.
 #define RENDER_OLD_CUT_ONLY 1 // Debug. Renders only nodes that were in cuts rendered already.
@@ -56,7 +60,19 @@ namespace omicron::hierarchy
 	 *
 	 * Front also provides API for front tracking, operation which prunes or branches front nodes in order to enforce a
 	 * rendering performance budget, specified by a box projection threshold. This operation also manages memory stress
-	 * by persisting and releasing prunned sibling groups. */
+	 * by persisting and releasing prunned sibling groups.
+	 *
+	 * The front is stored in contiguous chunks of about ReconstructionConfig::m_frontChunkSize nodes that never split a
+	 * sibling group. Chunks are tracked in parallel. Renderer and GPU loading operations are not thread safe, so the
+	 * tracking threads record them as actions, which are applied afterwards in front order.
+	 *
+	 * GPU memory is managed by a GpuResidencyManager. Nodes needed by the front are requested with their projected size
+	 * as priority and rendered nodes are touched. The manager decides the loads and evictions of each frame under the GPU
+	 * memory quota. Nodes are charged with the size of their cloud arena slots and the unused arena space is reserved.
+	 *
+	 * When ReconstructionConfig::m_prefetchFrames is not 0, the camera motion is extrapolated that many frames ahead.
+	 * The nodes that will be rendered or branched under the predicted view are requested with lower priority, so fast
+	 * camera moves do not reach unloaded nodes. */
 	template< typename Morton >
 	class Front
 	{
@@ -64,8 +80,16 @@ namespace omicron::hierarchy
 		using Node = O1OctreeNode< Surfel >;
 		using NodeArray = Array< Node >;
 		using OctreeDim = OctreeDimensions< Morton >;
-		using Renderer = SplatRenderer;
 		using NodeLoader = hierarchy::NodeLoader< Point >;
+		using CameraPredictor = renderer::CameraPredictor;
+		using ViewTests = renderer::ViewTests;
+		using BoxBatchTests = renderer::BoxBatchTests;
+		using BoxBatch = renderer::BoxBatch;
+		using BoxTestMasks = renderer::BoxTestMasks;
+		
+		/** Pages in the children of an inner node that has no children in memory. Gets the node and its morton code.
+		 * Returns false if there are no children to page in. */
+		using ChildrenPager = function< bool( Node&, const Morton& ) >;
 		
 		/** The node type that is used in front. */
 		typedef struct FrontNode
@@ -101,11 +125,64 @@ namespace omicron::hierarchy
 		using FrontListIter = typename FrontList::iterator;
 		using InsertionVector = vector< FrontList, ManagedAllocator< FrontList > >;
 		
+		/** Contiguous chunked storage of the front. Placeholders are the pending nodes. */
+		using FrontChunkArray = FrontChunks< FrontNode, ManagedAllocator< FrontNode > >;
+		using FrontChunk = typename FrontChunkArray::Chunk;
+		using FrontVector = typename FrontChunkArray::ItemVector;
+		
+		/** Renderer or GPU loading operation recorded while a chunk is tracked. */
+		typedef struct TrackingAction
+		{
+			enum Type
+			{
+				RENDER, // Renders the node if it is loaded and keeps it resident.
+				ERASE, // Erases the node from the renderer list.
+				LOAD, // Requests the node to be loaded in GPU.
+				RELEASE_CHILDREN, // Releases the children of a prunned node if the memory limit is reached.
+				PREFETCH // Requests the node to be loaded in GPU because the predicted view will need it.
+			};
+			
+			TrackingAction( const Type type, Node& node, const Morton& morton, const Float priority = 0.f )
+			: m_type( type ),
+			m_node( &node ),
+			m_morton( morton ),
+			m_priority( priority )
+			{}
+			
+			Type m_type;
+			Node* m_node;
+			Morton m_morton;
+			/** Residency priority of RENDER, LOAD and PREFETCH actions. */
+			Float m_priority;
+		} TrackingAction;
+		
+		using ActionVector = vector< TrackingAction, ManagedAllocator< TrackingAction > >;
+		
+		/** Number of front operations done in a chunk tracking. */
+		typedef struct TrackingCounts
+		{
+			uint m_nPrunes;
+			uint m_nBranches;
+		} TrackingCounts;
+		
+		/** Boxes of a chunk, tested in batches before the chunk is tracked. */
+		typedef struct ChunkBoxes
+		{
+			/** Boxes of the chunk nodes, in chunk order. Placeholders have empty boxes. */
+			BoxBatch m_nodes;
+			/** Boxes of the parents checked for prunning, in checking order. */
+			BoxBatch m_parents;
+			BoxTestMasks m_nodeMasks;
+			BoxTestMasks m_parentMasks;
+		} ChunkBoxes;
+		
 		/** Ctor.
 		 * @param dbFilename is the path to a database file which will be used to store nodes in an out-of-core approach.
-		 * @param leafLvlDim is the information of octree size at the deepest (leaf) level. */
+		 * @param leafLvlDim is the information of octree size at the deepest (leaf) level.
+		 * @param config has the front chunk size and the number of segments per front. */
 		Front( const string& dbFilename, const OctreeDim& leafLvlDim, const int nHierarchyCreationThreads,
-			   NodeLoader& loader, const ulong memoryLimit, const uint maxDepth = Morton::maxLvl() );
+			   NodeLoader& loader, const ulong memoryLimit, const uint maxDepth = Morton::maxLvl(),
+			   const ReconstructionConfig& config = ReconstructionConfig() );
 		
 		/** Inserts a node into thread's buffer end so it can be push to the front later on. After this, the tracking
 		 * method will ensure that the placeholder related with this node, if any, will be substituted by it.
@@ -140,6 +217,11 @@ namespace omicron::hierarchy
 		 * @param dispatchedThreads is the number of dispatched thread in the creation iteration. */
 		void notifyInsertionEnd( uint dispatchedThreads );
 		
+		/** Ensures that there are at least nSlots insertion buffers, so an insertion iteration can have more continuous
+		 * segments than hierarchy creation threads. Must be called by the creation thread between insertion iterations.
+		 * @param nSlots is the number of segments in the next insertion iteration. */
+		void reserveInsertionSlots( uint nSlots );
+		
 		/** THIS IS A HACK FOR TESTING PURPOSES. Inserts the root of the hierarchy into the front. In other words, makes
 		 * the classic front initialization and ignores the bottom-up insertion capability provided in this class. Obviously,
 		 * the hierarchy should be constructed beforehand and this should be the only insertion needed into the front. */
@@ -152,88 +234,177 @@ namespace omicron::hierarchy
 		void notifyLeafLvlLoaded();
 		
 		/** Tracks the front based on the projection threshold.
-		 * @param renderer is the responsible of rendering the points of the tracked front.
+		 * @param renderer is the responsible of rendering the points of the tracked front and of loading them in GPU. It
+		 * must have the interface of SplatRenderer used here: begin_frame(), eyePosition(), viewMatrix(),
+		 * projectionMatrix(), isLoaded(), loadInGpu(), unloadInGpu(), resetIterator(), render(), eraseFromList(),
+		 * removeFromList(), render_frame() and end_frame(). Culling and projection tests are done in batches with the
+		 * renderer's view and projection, the same tests as SplatRenderer::isCullable() and
+		 * SplatRenderer::isRenderable().
 		 * @param projThresh is the projection threashold */
+		template< typename Renderer >
 		OctreeStats trackFront( Renderer& renderer, const Float projThresh );
 		
 		/** @returns the number of placeholders substituted in front evaluation until now. */
 		uint substitutedPlaceholders() const;
 		
+		/** First step of an update of a finished hierarchy. The front nodes invalidated by the update are replaced by
+		 * leaf level placeholders and the invalidated nodes are released from GPU. Placeholders are also inserted for
+		 * the nodes the update creates in holes of the front, i.e. created nodes whose parent is above the front. Must be
+		 * called by the tracking thread, between frames, before the hierarchy is changed.
+		 * @param isInvalidated tells if the update changes or moves the node with the given morton code.
+		 * @param createdMortons are the roots of the subtrees created under existing nodes, in hierarchy width order.
+		 * @param invalidatedNodes are all nodes changed or moved by the update. */
+		template< typename Renderer >
+		void beginUpdate( const function< bool( const Morton& ) >& isInvalidated, const vector< Morton >& createdMortons,
+						  const vector< Node* >& invalidatedNodes, Renderer& renderer );
+		
+		/** Last step of an update of a finished hierarchy. The updated nodes are inserted so they substitute the
+		 * placeholders of beginUpdate() in the next frames. Must be called by the tracking thread, after the hierarchy
+		 * is changed.
+		 * @param find gets the node with the given morton code in the updated hierarchy. */
+		void endUpdate( const function< Node*( const Morton& ) >& find );
+		
 		void setMaxDepth(const uint maxDepth) { m_maxDepth = maxDepth; }
+		
+		/** Sets a pager for octrees that are not entirely in memory. Children are paged in when their parent is branched.
+		 * Children of prunned nodes are released when the memory limit is reached, since they can be paged in again. The
+		 * pager is called by the tracking threads, so it must be thread safe for distinct nodes. */
+		void setChildrenPager( const ChildrenPager& pager ) { m_childrenPager = pager; }
 
 		uint getMaxDepth(){ return m_maxDepth.load(); }
 
 	private:
-		void trackNode( FrontListIter& frontIt, Node*& lastParent, int substitutionLvl, Renderer& renderer,
-						const Float projThresh );
+		/** Tracks a chunk, replacing its nodes by the tracked ones. THREAD SAFE for distinct chunks. The renderer and GPU
+		 * operations are recorded in m_chunkActions[ chunkIdx ]. The boxes of the chunk nodes and of their parents are
+		 * tested in batches beforehand.
+		 * @param isLastChunk indicates that the chunk is the last one of the front. */
+		template< typename Renderer >
+		void trackChunk( const size_t chunkIdx, const bool isLastChunk, const Renderer& renderer,
+						 const Float projThresh );
+		
+		/** Records PREFETCH actions for the nodes of a tracked chunk that will be needed under the predicted view: the
+		 * unloaded nodes that will be visible and the unloaded children of the nodes that will be branched. Children
+		 * are not paged in for prefetching. The actions are recorded in m_chunkPrefetches[ chunkIdx ]. THREAD SAFE for
+		 * distinct chunks. */
+		template< typename Renderer >
+		void prefetchChunk( const size_t chunkIdx, const Renderer& renderer, const ViewTests& predictedView,
+							const Float projThresh );
+		
+		/** Applies the actions recorded in a chunk tracking. */
+		template< typename Renderer >
+		void applyActions( const ActionVector& actions, Renderer& renderer );
 		
 		/** Substitute a placeholder with the first node of the given substitution level. */
 		bool substitutePlaceholder( FrontNode& node, int substitutionLvl );
 		
-		bool checkPrune( const Morton& parentMorton, Node* parentNode, const OctreeDim& parentLvlDim,
-						 FrontListIter& frontIt, int substituionLvl, Renderer& renderer,
-					const Float projThresh, bool& out_isCullable );
-		
-		void prune( FrontListIter& frontIt, Node* parentNode, const bool parentIsCullable, Renderer& renderer );
+		/** @param parentIsCullable and parentIsRenderable are the parent box test results.
+		 * @param nSiblings is the number of consecutive siblings in the chunk, beginning at the tracked node.
+		 * @param reachesFrontEnd indicates that the sibling group is the last one in the front.
+		 * @param out_priority is the parent residency priority. */
+		template< typename Renderer >
+		bool checkPrune( const Morton& parentMorton, Node* parentNode, const AlignedBox3f& parentBox,
+						 const bool parentIsCullable, const bool parentIsRenderable, const size_t nSiblings,
+						 const bool reachesFrontEnd, const Renderer& renderer, Float& out_priority,
+						 ActionVector& actions );
+		
+		/** Replaces the siblings in [ begin, end ) by their parent. */
+		void prune( const FrontVector& nodes, const size_t begin, const size_t end, Node* parentNode,
+					const Morton& parentMorton, const bool parentIsCullable, const Float parentPriority,
+					FrontVector& out, ActionVector& actions );
+		
+		/** @param isCullable and isRenderable are the node box test results.
+		 * @param out_priority is the node residency priority. */
+		template< typename Renderer >
+		bool checkBranch( const OctreeDim& nodeLvlDim, Node& node, const Morton& morton, const AlignedBox3f& box,
+						  const bool isCullable, const bool isRenderable, const Renderer& renderer,
+						  Float& out_priority, ActionVector& actions );
+		
+		void branch( const FrontNode& frontNode, const OctreeDim& nodeLvlDim, FrontVector& out,
+					 ActionVector& actions );
+		
+		template< typename Renderer >
+		void setupNodeRenderingNoFront( const Morton& moton, Node& node, Renderer& renderer );
 		
-		bool checkBranch( const OctreeDim& nodeLvlDim, Node& node, const Morton& morton, Renderer& renderer,
-						  const Float projThresh, bool& out_isCullable );
+		/** Requests the node to be resident in GPU or touches it if it is already resident. */
+		void requestResidency( Node& node, const Float priority );
 		
-		void branch( FrontListIter& iter, Node& node, const OctreeDim& nodeLvlDim, Renderer& renderer );
+		/** Loads and unloads the nodes scheduled by the residency manager for the current frame. */
+		template< typename Renderer >
+		void applyResidency( Renderer& renderer );
 		
-		void setupNodeRendering( FrontListIter& iter, const FrontNode& frontNode, Renderer& renderer );
+		/** Unloads a subtree that will be released and forgets its residency. */
+		template< typename Renderer >
+		void releaseResidency( Node& node, Renderer& renderer );
 		
-		void setupNodeRenderingNoFront( const Morton& moton, Node& node, Renderer& renderer );
+		/** @returns true if the front nodes are consecutive siblings. Compaction keeps them in the same chunk. */
+		bool areSiblings( const FrontNode& a, const FrontNode& b ) const
+		{
+			Node* parent = a.m_octreeNode->parent();
+			return parent != nullptr && parent == b.m_octreeNode->parent();
+		}
 		
-		void unloadInGpu( Node& node );
+		bool isPlaceholder( const FrontNode& node ) const { return node.m_octreeNode == &m_placeholder; }
 		
 		#ifdef ORDERING_DEBUG
-			void assertFrontIterator( const FrontListIter& iter, const FrontList& front )
+			void assertFrontOrder()
 			{
-				if( iter != front.begin() )
+				const FrontNode* prevNode = nullptr;
+				for( size_t i = 0; i < m_front.nChunks(); ++i )
 				{
-					Morton& currMorton = iter->m_morton;
-					Morton& prevMorton = prev( iter )->m_morton;
-					
-					uint currLvl = currMorton.getLevel();
-					uint prevLvl = prevMorton.getLevel();
-					
-					bool isPlaceholder = ( iter->m_octreeNode == &m_placeholder );
-					stringstream ss;
-					if( currLvl < prevLvl )
+					for( const FrontNode& node : m_front.chunk( i ).m_items )
 					{
-						Morton prevAncestorMorton = prevMorton.getAncestorInLvl( currLvl );
-						if( currMorton <= prevAncestorMorton )
+						if( prevNode != nullptr )
 						{
-							ss  << "Front order compromised. Prev: " << prevAncestorMorton.getPathToRoot( true )
-								<< "Curr: " << currMorton.getPathToRoot( true ) << " is placeholder? "
-								<< isPlaceholder << endl;
-							HierarchyCreationLog::logAndFail( ss.str() );
+							assertFrontOrder( *prevNode, node );
 						}
+						prevNode = &node;
 					}
-					else if( currLvl > prevLvl )
+				}
+			}
+			
+			void assertFrontOrder( const FrontNode& prevNode, const FrontNode& currNode )
+			{
+				const Morton& currMorton = currNode.m_morton;
+				const Morton& prevMorton = prevNode.m_morton;
+				
+				uint currLvl = currMorton.getLevel();
+				uint prevLvl = prevMorton.getLevel();
+				
+				bool isPlaceholder = ( currNode.m_octreeNode == &m_placeholder );
+				stringstream ss;
+				if( currLvl < prevLvl )
+				{
+					Morton prevAncestorMorton = prevMorton.getAncestorInLvl( currLvl );
+					if( currMorton <= prevAncestorMorton )
 					{
-						Morton currAncestorMorton = currMorton.getAncestorInLvl( prevLvl );
-						if( currAncestorMorton <= prevMorton  )
-						{
-							ss  << "Front order compromised. Prev: " << prevMorton.getPathToRoot( true )
-								<< "Curr: " << currAncestorMorton.getPathToRoot( true ) << " is placeholder? "
-								<< isPlaceholder << endl;
-							HierarchyCreationLog::logAndFail( ss.str() );
-						}
+						ss  << "Front order compromised. Prev: " << prevAncestorMorton.getPathToRoot( true )
+							<< "Curr: " << currMorton.getPathToRoot( true ) << " is placeholder? "
+							<< isPlaceholder << endl;
+						HierarchyCreationLog::logAndFail( ss.str() );
 					}
-					else
+				}
+				else if( currLvl > prevLvl )
+				{
+					Morton currAncestorMorton = currMorton.getAncestorInLvl( prevLvl );
+					if( currAncestorMorton <= prevMorton  )
 					{
-						if( currMorton <= prevMorton )
-						{
-							ss  << "Front order compromised. Prev: " << prevMorton.getPathToRoot( true )
-								<< "Curr: " << currMorton.getPathToRoot( true ) << " is placeholder? "
-								<< isPlaceholder << endl;
-							HierarchyCreationLog::logAndFail( ss.str() );
-						}
+						ss  << "Front order compromised. Prev: " << prevMorton.getPathToRoot( true )
+							<< "Curr: " << currAncestorMorton.getPathToRoot( true ) << " is placeholder? "
+							<< isPlaceholder << endl;
+						HierarchyCreationLog::logAndFail( ss.str() );
 					}
 				}
-// 				assertNode( *iter->m_octreeNode, iter->m_morton );
+				else
+				{
+					if( currMorton <= prevMorton )
+					{
+						ss  << "Front order compromised. Prev: " << prevMorton.getPathToRoot( true )
+							<< "Curr: " << currMorton.getPathToRoot( true ) << " is placeholder? "
+							<< isPlaceholder << endl;
+						HierarchyCreationLog::logAndFail( ss.str() );
+					}
+				}
+// 				assertNode( *currNode.m_octreeNode, currNode.m_morton );
 			}
 		
 			void assertNode( const Node& node, const Morton& morton )
@@ -278,7 +449,7 @@ namespace omicron::hierarchy
 							HierarchyCreationLog::logAndFail( ss.str() );
 						}
 						
-						Morton parentMorton = *morton.traverseUp();
+						Morton parentMorton = morton.parent();
 						Morton calcParentMorton = parentDim.calcMorton( *parentNode );
 						if( parentMorton != calcParentMorton )
 						{
@@ -292,10 +463,30 @@ namespace omicron::hierarchy
 		#endif
 		
 		/** The internal front datastructure. Contains all FrontNodes. */
-		FrontList m_front;
+		FrontChunkArray m_front;
+		
+		/** Number of frames needed to track the whole front. */
+		uint m_segmentsPerFront;
 		
-		/** Iterator used to resume front processing from previous frame. */
-		FrontListIter m_frontIter;
+		/** Index of the chunk used to resume front processing from previous frame. */
+		size_t m_chunkIter;
+		
+		/** Actions recorded by the tracking of each chunk in the current frame. */
+		vector< ActionVector > m_chunkActions;
+		
+		/** PREFETCH actions recorded for each chunk in the current frame. They are applied before the tracking actions
+		 * of the chunk, so children released by a prune are forgotten after being prefetched. */
+		vector< ActionVector > m_chunkPrefetches;
+		
+		/** Buffers for the tracked nodes of each chunk. They are swapped with the chunk nodes after tracking, so their
+		 * capacity is reused in the next frames. */
+		vector< FrontVector > m_chunkBuffers;
+		
+		/** Operations done by the tracking of each chunk in the current frame. */
+		vector< TrackingCounts > m_chunkCounts;
+		
+		/** Box batches of each chunk. Kept between frames so their capacity is reused. */
+		vector< ChunkBoxes > m_chunkBoxes;
 		
 		/** Node used as a placeholder in the front. It is used whenever it is known that a node should occupy a given
 		 * position, but the node itself is not defined yet because the hierarchy creation algorithm have not reached
@@ -319,6 +510,12 @@ namespace omicron::hierarchy
 		/** All placeholders pending insertion. The list is sorted in hierarchy width order.  */
 		FrontList m_placeholders;
 		
+		/** Morton codes of the front nodes replaced by placeholders in beginUpdate(), in hierarchy width order. */
+		vector< Morton > m_updatedMortons;
+		
+		/** Pending insertions of nodes invalidated by an update. They are rebound in endUpdate(). */
+		vector< FrontListIter > m_updatedInsertions;
+		
 		NodeLoader& m_nodeLoader;
 		
 		/** Dimensions of the octree nodes at deepest level. */
@@ -330,6 +527,30 @@ namespace omicron::hierarchy
 		/** Indicates that all leaf level nodes are already loaded. */
 		atomic_bool m_leafLvlLoadedFlag;
 		
+		/** Decides which nodes are resident in GPU memory. */
+		GpuResidencyManager< Node* > m_residency;
+		
+		/** Current frame. Used as time reference for residency. */
+		ulong m_frame;
+		
+		/** Eye position in the current frame. */
+		Vec3 m_eye;
+		
+		/** Culling and projection tests of the current frame. */
+		BoxBatchTests m_boxTests;
+		
+		/** Extrapolates the camera motion for prefetching. */
+		CameraPredictor m_cameraPredictor;
+		
+		/** Number of frames ahead of the camera whose nodes are prefetched. 0 disables prefetching. */
+		uint m_prefetchFrames;
+		
+		/** Scale applied to the residency priority of prefetched nodes. */
+		Float m_prefetchPriorityScale;
+		
+		/** Pages in children of nodes in the front. Empty if the whole hierarchy is in memory. */
+		ChildrenPager m_childrenPager;
+		
 		// The maximum depth that the front can be branched.
 		atomic_uint m_maxDepth;
 
@@ -350,8 +571,12 @@ namespace omicron::hierarchy
 	
 	template< typename Morton >
 	inline Front< Morton >::Front( const string& dbFilename, const OctreeDim& leafLvlDim,
-								   const int nHierarchyCreationThreads, NodeLoader& loader, const ulong memoryLimit, const uint maxDepth )
-	: m_leafLvlDim( leafLvlDim ),
+								   const int nHierarchyCreationThreads, NodeLoader& loader, const ulong memoryLimit,
+								   const uint maxDepth, const ReconstructionConfig& config )
+	: m_front( config.m_frontChunkSize ),
+	m_segmentsPerFront( config.m_segmentsPerFront ),
+	m_chunkIter( 0ul ),
+	m_leafLvlDim( leafLvlDim ),
 	m_memoryLimit( memoryLimit ),
 	m_currentIterInsertions( nHierarchyCreationThreads ),
 	m_currentIterPlaceholders( nHierarchyCreationThreads ),
@@ -361,10 +586,13 @@ namespace omicron::hierarchy
 	m_nodeLoader( loader ),
 	m_lastInsertionTime( Profiler::now() ),
 	m_substitutedPlaceholders( 0u ),
+	m_residency( GpuAllocStatistics::gpuMemQuota() ),
+	m_frame( 0ul ),
+	m_eye( Vec3::Zero() ),
+	m_prefetchFrames( config.m_prefetchFrames ),
+	m_prefetchPriorityScale( config.m_prefetchPriorityScale ),
 	m_maxDepth(maxDepth)
 	{
-		m_frontIter = m_front.end();
-		
 		#ifdef NODE_ID_TEXT
 		{
 			m_textEffect.initialize( "shaders/Inconsolata.otf" );
@@ -471,26 +699,48 @@ namespace omicron::hierarchy
 		}
 	}
 	
+	template< typename Morton >
+	inline void Front< Morton >::reserveInsertionSlots( uint nSlots )
+	{
+		if( m_currentIterInsertions.size() < nSlots )
+		{
+			m_currentIterInsertions.resize( nSlots );
+			m_currentIterPlaceholders.resize( nSlots );
+		}
+	}
+	
 	template< typename Morton >
 	inline void Front< Morton >::insertRoot( Node& root )
 	{
 		assert( m_front.empty() && "Front should be empty before inserting root." );
 		
 		Morton rootCode; rootCode.build( 0x1 );
-		m_front.push_back( FrontNode( root, rootCode ) );
-		root.loadInGpu();
+		m_front.pushBack( FrontNode( root, rootCode ), false );
+		requestResidency( root, numeric_limits< Float >::max() );
 	}
 	
 	template< typename Morton >
+	template< typename Renderer >
 	inline OctreeStats Front< Morton >::trackFront( Renderer& renderer, const Float projThresh )
 	{
 		auto start = Profiler::now();
 		
 		renderer.begin_frame();
 		
+		++m_frame;
+		m_eye = renderer.eyePosition();
+		m_boxTests = BoxBatchTests( Matrix4f( renderer.projectionMatrix() * Affine3f( renderer.viewMatrix() ).matrix() ) );
+		
+		if( m_prefetchFrames > 0u )
+		{
+			m_cameraPredictor.push( renderer.viewMatrix() );
+		}
+		
 		// Statistics.
 		float frontInsertionDelay = 0.f;
 		int nNodesPerFrame = 0;
+		uint nPrunes = 0u;
+		uint nBranches = 0u;
 		
 		{
 			lock_guard< mutex > lock( m_perLvlMtx[ m_leafLvlDim.m_nodeLvl ] );
@@ -502,7 +752,11 @@ namespace omicron::hierarchy
 			}
 				
 			// Insert all leaf level placeholders.
-			m_front.splice( m_front.end(), m_placeholders );
+			for( const FrontNode& placeholder : m_placeholders )
+			{
+				m_front.pushBack( placeholder, true );
+			}
+			m_placeholders.clear();
 		}
 		
 		if( !m_front.empty() )
@@ -522,8 +776,6 @@ namespace omicron::hierarchy
 					substitutionLvl = i;
 				}
 			}
-
-			Node* lastParent = nullptr; // Parent of last node. Used to optimize prunning check.
 				
 			#if defined FRONT_TRACKING_DEBUG || defined RENDERING_DEBUG
 			{
@@ -533,31 +785,84 @@ namespace omicron::hierarchy
 			}
 			#endif
 			
-			if( m_frontIter == m_front.end() )
+			if( m_chunkIter >= m_front.nChunks() )
 			{
-				m_frontIter = m_front.begin();
+				m_chunkIter = 0ul;
 				renderer.resetIterator();
 			}
 			
-			nNodesPerFrame = max( float( m_front.size() ) / float( SEGMENTS_PER_FRONT ), 1.f );
+			size_t nChunks = m_front.nChunks();
+			size_t nChunksPerFrame = max( size_t( ceil( float( nChunks ) / float( m_segmentsPerFront ) ) ), size_t( 1 ) );
+			size_t firstChunk = m_chunkIter;
+			size_t endChunk = std::min( firstChunk + nChunksPerFrame, nChunks );
 			
-			for( int i = 0; m_frontIter != m_front.end() && i < nNodesPerFrame; ++i )
+			// Placeholders are substituted in front order, consuming the per-level insertion lists, so substitution
+			// is done before the parallel tracking.
+			for( size_t i = firstChunk; i < endChunk; ++i )
 			{
-				#ifdef FRONT_TRACKING_DEBUG
+				FrontChunk& chunk = m_front.chunk( i );
+				nNodesPerFrame += chunk.m_items.size();
+				
+				for( auto nodeIt = chunk.m_items.begin(); chunk.m_nPending > 0u && nodeIt != chunk.m_items.end();
+					 ++nodeIt )
 				{
-					stringstream ss; ss << "Tracking " << m_frontIter->m_morton.getPathToRoot() << endl
-						<< *m_frontIter->m_octreeNode << endl << endl;
-					HierarchyCreationLog::logDebugMsg( ss.str() );
+					if( isPlaceholder( *nodeIt ) && substitutePlaceholder( *nodeIt, substitutionLvl ) )
+					{
+						--chunk.m_nPending;
+					}
 				}
-				#endif
+			}
+			
+			m_chunkActions.resize( std::max( m_chunkActions.size(), nChunks ) );
+			m_chunkPrefetches.resize( std::max( m_chunkPrefetches.size(), nChunks ) );
+			m_chunkBuffers.resize( std::max( m_chunkBuffers.size(), nChunks ) );
+			m_chunkCounts.resize( std::max( m_chunkCounts.size(), nChunks ) );
+			m_chunkBoxes.resize( std::max( m_chunkBoxes.size(), nChunks ) );
+			
+			// A chunk is tracked again only after the other segments, so the prediction looks at least that far.
+			bool isPrefetching = m_prefetchFrames > 0u && m_cameraPredictor.canPredict();
+			ViewTests predictedView( renderer.projectionMatrix(), ( isPrefetching )
+				? m_cameraPredictor.predictView( float( std::max( m_prefetchFrames, m_segmentsPerFront ) ) )
+				: Affine3f( renderer.viewMatrix() ) );
+			
+			#pragma omp parallel for schedule( dynamic )
+			for( size_t i = firstChunk; i < endChunk; ++i )
+			{
+				trackChunk( i, i == nChunks - 1, renderer, projThresh );
 				
-				#ifdef ORDERING_DEBUG
-					assertFrontIterator( m_frontIter, front );
-				#endif
-					
-				trackNode( m_frontIter, lastParent, substitutionLvl, renderer, projThresh );
+				m_chunkPrefetches[ i ].clear();
+				if( isPrefetching )
+				{
+					prefetchChunk( i, renderer, predictedView, projThresh );
+				}
 			}
 			
+			size_t trackedOffset = 0ul;
+			for( size_t i = 0ul; i < endChunk; ++i )
+			{
+				if( i >= firstChunk )
+				{
+					applyActions( m_chunkPrefetches[ i ], renderer );
+					applyActions( m_chunkActions[ i ], renderer );
+					nPrunes += m_chunkCounts[ i ].m_nPrunes;
+					nBranches += m_chunkCounts[ i ].m_nBranches;
+				}
+				trackedOffset += m_front.chunk( i ).m_items.size();
+			}
+			
+			// Compaction keeps the order, so the next frame resumes after the last tracked node.
+			m_front.compact(
+				[ & ]( const FrontNode& a, const FrontNode& b ) { return areSiblings( a, b ); },
+				[ & ]( const FrontNode& node ) { return isPlaceholder( node ); }
+			);
+			m_chunkIter = m_front.chunkAt( trackedOffset );
+			
+			applyResidency( renderer );
+			
+			#ifdef ORDERING_DEBUG
+				assertFrontOrder();
+			#endif
+			
 			m_nodeLoader.onIterationEnd();
 			renderer.render_frame();
 		}
@@ -603,75 +908,251 @@ namespace omicron::hierarchy
 		}
 		#endif
 		
-		m_octreeStats.addFrame( FrameStats( traversalTime, renderQueueTime, numRenderedPoints, frontInsertionDelay, m_front.size(), nNodesPerFrame ) );
+		m_octreeStats.addFrame( FrameStats( traversalTime, renderQueueTime, numRenderedPoints, frontInsertionDelay, m_front.size(), nNodesPerFrame,
+											nPrunes, nBranches ) );
 		
 		return m_octreeStats;
 	}
 	
 	template< typename Morton >
+	template< typename Renderer >
 	inline void Front< Morton >
-	::trackNode( FrontListIter& frontIt, Node*& lastParent, int substitutionLvl, Renderer& renderer, const Float projThresh )
+	::trackChunk( const size_t chunkIdx, const bool isLastChunk, const Renderer& renderer, const Float projThresh )
 	{
-		FrontNode& frontNode = *frontIt;
-		
-		if( frontNode.m_octreeNode == &m_placeholder )
+		FrontChunk& chunk = m_front.chunk( chunkIdx );
+		FrontVector& nodes = chunk.m_items;
+		FrontVector& out = m_chunkBuffers[ chunkIdx ];
+		ActionVector& actions = m_chunkActions[ chunkIdx ];
+		TrackingCounts& counts = m_chunkCounts[ chunkIdx ];
+		
+		out.clear();
+		out.reserve( nodes.size() );
+		actions.clear();
+		counts = TrackingCounts{ 0u, 0u };
+		
+		// The parents are checked for prunning at the first node of each sibling group, as in the tracking loop below.
+		ChunkBoxes& boxes = m_chunkBoxes[ chunkIdx ];
+		boxes.m_nodes.clear();
+		boxes.m_parents.clear();
+		
+		Node* lastParent = nullptr;
+		for( const FrontNode& frontNode : nodes )
 		{
-			if( !substitutePlaceholder( frontNode, substitutionLvl ) )
+			if( isPlaceholder( frontNode ) )
 			{
-				frontIt++;
-				return;
+				boxes.m_nodes.push_back( AlignedBox3f( Vec3::Zero(), Vec3::Zero() ) );
+				continue;
+			}
+			
+			OctreeDim nodeLvlDim( m_leafLvlDim, frontNode.m_morton.getLevel() );
+			boxes.m_nodes.push_back( nodeLvlDim.getMortonBoundaries( frontNode.m_morton ) );
+			
+			Node* parentNode = frontNode.m_octreeNode->parent();
+			if( parentNode != nullptr && parentNode != lastParent )
+			{
+				OctreeDim parentLvlDim( nodeLvlDim, nodeLvlDim.m_nodeLvl - 1 );
+				boxes.m_parents.push_back( parentLvlDim.getMortonBoundaries( frontNode.m_morton.parent() ) );
+				lastParent = parentNode;
 			}
 		}
 		
-		Node& node = *frontNode.m_octreeNode;
-		Morton& morton = frontNode.m_morton;
-		OctreeDim nodeLvlDim( m_leafLvlDim, morton.getLevel() );
+		m_boxTests.test( boxes.m_nodes, projThresh, boxes.m_nodeMasks );
+		m_boxTests.test( boxes.m_parents, projThresh, boxes.m_parentMasks );
 		
-		Node* parentNode = node.parent();
+		uint nPlaceholders = 0u;
+		size_t parentIdx = 0ul;
+		lastParent = nullptr; // Parent of last node. Used to optimize prunning check.
 		
-		// If parentNode == lastParent, prunning was not sucessful for a sibling of the current node, so the prunning
-		// check can be skipped.
-		if( parentNode != nullptr && parentNode != lastParent )  
+		for( size_t i = 0ul; i < nodes.size(); )
 		{
-			OctreeDim parentLvlDim( nodeLvlDim, nodeLvlDim.m_nodeLvl - 1 );
-			Morton parentMorton = *morton.traverseUp();
-			bool parentIsCullable;
-			if( checkPrune( parentMorton, parentNode, parentLvlDim, frontIt, substitutionLvl, renderer,
-							projThresh, parentIsCullable ) )
+			FrontNode& frontNode = nodes[ i ];
+			
+			#ifdef FRONT_TRACKING_DEBUG
 			{
-				prune( frontIt, parentNode, parentIsCullable, renderer );
-				lastParent = parentNode;
+				stringstream ss; ss << "Tracking " << frontNode.m_morton.getPathToRoot() << endl
+					<< *frontNode.m_octreeNode << endl << endl;
+				HierarchyCreationLog::logDebugMsg( ss.str() );
+			}
+			#endif
+			
+			if( isPlaceholder( frontNode ) )
+			{
+				out.push_back( frontNode );
+				++nPlaceholders;
+				++i;
+				continue;
+			}
+			
+			Node& node = *frontNode.m_octreeNode;
+			Morton& morton = frontNode.m_morton;
+			OctreeDim nodeLvlDim( m_leafLvlDim, morton.getLevel() );
+			
+			Node* parentNode = node.parent();
+			
+			// If parentNode == lastParent, prunning was not sucessful for a sibling of the current node, so the prunning
+			// check can be skipped.
+			if( parentNode != nullptr && parentNode != lastParent )
+			{
+				size_t siblingsEnd = i + 1;
+				while( siblingsEnd < nodes.size() && nodes[ siblingsEnd ].m_octreeNode->parent() == parentNode )
+				{
+					++siblingsEnd;
+				}
 				
-				return;
+				assert( parentIdx < boxes.m_parents.size() && "Parent box not batched." );
+				
+				Morton parentMorton = morton.parent();
+				bool parentIsCullable = boxes.m_parentMasks.isCullable( parentIdx );
+				Float parentPriority;
+				if( checkPrune( parentMorton, parentNode, boxes.m_parents.box( parentIdx ), parentIsCullable,
+								boxes.m_parentMasks.isRenderable( parentIdx ), siblingsEnd - i,
+								isLastChunk && siblingsEnd == nodes.size(), renderer, parentPriority, actions ) )
+				{
+					prune( nodes, i, siblingsEnd, parentNode, parentMorton, parentIsCullable, parentPriority, out,
+						   actions );
+					++counts.m_nPrunes;
+					lastParent = parentNode;
+					++parentIdx;
+					i = siblingsEnd;
+					
+					continue;
+				}
+				lastParent = parentNode;
+				++parentIdx;
 			}
-			lastParent = parentNode;
+			
+			bool isCullable = boxes.m_nodeMasks.isCullable( i );
+			Float priority;
+			
+			if( checkBranch( nodeLvlDim, node, morton, boxes.m_nodes.box( i ), isCullable,
+							 boxes.m_nodeMasks.isRenderable( i ), renderer, priority, actions ) )
+			{
+				branch( frontNode, nodeLvlDim, out, actions );
+				++counts.m_nBranches;
+				++i;
+				continue;
+			}
+			
+			out.push_back( frontNode );
+			actions.push_back( TrackingAction( isCullable ? TrackingAction::ERASE : TrackingAction::RENDER, node,
+											   morton, priority ) );
+			++i;
 		}
 		
-		bool isCullable = false;
-		
-		if( checkBranch( nodeLvlDim, node, morton, renderer, projThresh, isCullable ) )
-		{
-			branch( frontIt, node, nodeLvlDim, renderer );
-			return;
-		}
+		nodes.swap( out );
+		chunk.m_nPending = nPlaceholders;
+	}
+	
+	template< typename Morton >
+	template< typename Renderer >
+	inline void Front< Morton >::prefetchChunk( const size_t chunkIdx, const Renderer& renderer,
+												const ViewTests& predictedView, const Float projThresh )
+	{
+		const FrontVector& nodes = m_front.chunk( chunkIdx ).m_items;
+		ActionVector& actions = m_chunkPrefetches[ chunkIdx ];
+		Vec3 predictedEye = predictedView.eyePosition();
 		
-		if( !isCullable )
+		for( const FrontNode& frontNode : nodes )
 		{
-			setupNodeRenderingNoFront( morton, node, renderer );
+			if( isPlaceholder( frontNode ) )
+			{
+				continue;
+			}
+			
+			Node& node = *frontNode.m_octreeNode;
+			OctreeDim nodeLvlDim( m_leafLvlDim, frontNode.m_morton.getLevel() );
+			AlignedBox3f box = nodeLvlDim.getMortonBoundaries( frontNode.m_morton );
+			
+			if( predictedView.isCullable( box ) )
+			{
+				continue;
+			}
+			
+			if( !renderer.isLoaded( node ) )
+			{
+				actions.push_back( TrackingAction( TrackingAction::PREFETCH, node, frontNode.m_morton,
+												   m_prefetchPriorityScale * m_residency.priority( box, predictedEye ) ) );
+			}
+			
+			if( nodeLvlDim.level() < m_maxDepth && !node.isLeaf() && !node.child().empty()
+				&& !predictedView.isRenderable( box, projThresh ) )
+			{
+				OctreeDim childLvlDim( nodeLvlDim, nodeLvlDim.m_nodeLvl + 1 );
+				
+				for( Node& child : node.child() )
+				{
+					if( !renderer.isLoaded( child ) )
+					{
+						Morton childMorton = childLvlDim.calcMorton( child );
+						AlignedBox3f childBox = childLvlDim.getMortonBoundaries( childMorton );
+						
+						if( !predictedView.isCullable( childBox ) )
+						{
+							actions.push_back( TrackingAction( TrackingAction::PREFETCH, child, childMorton,
+								m_prefetchPriorityScale * m_residency.priority( childBox, predictedEye ) ) );
+						}
+					}
+				}
+			}
 		}
-		else
+	}
+	
+	template< typename Morton >
+	template< typename Renderer >
+	inline void Front< Morton >::applyActions( const ActionVector& actions, Renderer& renderer )
+	{
+		for( const TrackingAction& action : actions )
 		{
-			#ifdef RENDERING_DEBUG
+			Node& node = *action.m_node;
+			
+			switch( action.m_type )
 			{
-				stringstream ss; ss << "Trying to remove from rendering (culled): " << morton.getPathToRoot() << endl << endl;
-				HierarchyCreationLog::logDebugMsg( ss.str() );
+				case TrackingAction::RENDER:
+				{
+					requestResidency( node, action.m_priority );
+					setupNodeRenderingNoFront( action.m_morton, node, renderer );
+					break;
+				}
+				case TrackingAction::ERASE:
+				{
+					#ifdef RENDERING_DEBUG
+					{
+						stringstream ss; ss << "Trying to remove from rendering: " << action.m_morton.getPathToRoot()
+							<< endl << endl;
+						HierarchyCreationLog::logDebugMsg( ss.str() );
+					}
+					#endif
+					
+					renderer.eraseFromList( node );
+					break;
+				}
+				case TrackingAction::LOAD:
+				{
+					requestResidency( node, action.m_priority );
+					break;
+				}
+				case TrackingAction::PREFETCH:
+				{
+					m_residency.prefetch( &node, SurfelCloud::gpuFootprint( node.getContents().size() ),
+										  action.m_priority, m_frame );
+					break;
+				}
+				case TrackingAction::RELEASE_CHILDREN:
+				{
+					// Paged children are out of the front now and can be paged in again if needed. Children that are
+					// not released stay resident untill evicted, so branching them again is cheap.
+					if( m_childrenPager && AllocStatistics::approxTotalAllocated() > m_memoryLimit )
+					{
+						for( Node& child : node.child() )
+						{
+							releaseResidency( child, renderer );
+						}
+						node.releaseChildren();
+					}
+					break;
+				}
 			}
-			#endif
-			
-			renderer.eraseFromList( node );
 		}
-		
-		frontIt++;
 	}
 	
 	template< typename Morton >
@@ -700,11 +1181,9 @@ namespace omicron::hierarchy
 					++m_substitutedPlaceholders;
 					node = substituteCandidate;
 					
-					#ifdef ASYNC_LOAD
-						node.m_octreeNode->loadInGpu();
-					#else
-						node.m_octreeNode->loadGPU();
-					#endif
+					OctreeDim nodeLvlDim( m_leafLvlDim, node.m_morton.getLevel() );
+					requestResidency( *node.m_octreeNode,
+									  m_residency.priority( nodeLvlDim.getMortonBoundaries( node.m_morton ), m_eye ) );
 						
 					substitutionLvlList.erase( substitutionLvlList.begin() );
 					
@@ -721,10 +1200,11 @@ namespace omicron::hierarchy
 	}
 	
 	template< typename Morton >
+	template< typename Renderer >
 	inline bool Front< Morton >
-	::checkPrune( const Morton& parentMorton, Node* parentNode, const OctreeDim& parentLvlDim,
-				  FrontListIter& frontIt, int substitutionLvl, Renderer& renderer, const Float projThresh,
-			   bool& out_isCullable )
+	::checkPrune( const Morton& parentMorton, Node* parentNode, const AlignedBox3f& parentBox,
+				  const bool parentIsCullable, const bool parentIsRenderable, const size_t nSiblings,
+				  const bool reachesFrontEnd, const Renderer& renderer, Float& out_priority, ActionVector& actions )
 	{
 		#ifdef PRUNING_DEBUG
 		{
@@ -734,11 +1214,10 @@ namespace omicron::hierarchy
 		}
 		#endif
 		
-		AlignedBox3f parentBox = parentLvlDim.getMortonBoundaries( parentMorton );
+		out_priority = m_residency.priority( parentBox, m_eye );
 		
 		bool pruneFlag = false;
-		out_isCullable = renderer.isCullable( parentBox );
-		if( out_isCullable )
+		if( parentIsCullable )
 		{
 			pruneFlag = true;
 			
@@ -749,160 +1228,61 @@ namespace omicron::hierarchy
 			}
 			#endif
 		}
-		else
+		else if( parentIsRenderable )
 		{
-			#ifdef PRUNING_DEBUG
-// 			{
-// 				stringstream ss; ss << parentMorton.getPathToRoot() << ": NOT CULLABLE." << endl << endl;
-// 				HierarchyCreationLog::logDebugMsg( ss.str() );
-// 			}
-			#endif
-			
-			if( renderer.isRenderable( parentBox, projThresh ) )
-			{
-				#ifdef PRUNING_DEBUG
-// 				{
-// 					stringstream ss; ss << parentMorton.getPathToRoot() << ": RENDERABLE." << endl
-// 						<< endl;
-// 					HierarchyCreationLog::logDebugMsg( ss.str() );
-// 				}
-				#endif
-				
-				pruneFlag = true;
-			}
-			#ifdef PRUNING_DEBUG
-// 			else
-// 			{
-// 				stringstream ss; ss << parentMorton.getPathToRoot() << ": NOT RENDERABLE." << endl << endl;
-// 				HierarchyCreationLog::logDebugMsg( ss.str() );
-// 			}
-			#endif
+			pruneFlag = true;
 		}
 		
-		if( pruneFlag )
+		// The last sibling group cannot be prunned when the leaf level is not loaded yet. It can be incomplete
+		// at that time and all the sibling nodes should be in front before prunning.
+		if( pruneFlag && ( ( !m_leafLvlLoadedFlag && reachesFrontEnd ) || nSiblings != parentNode->child().size() ) )
 		{
-			int nSiblings = 0;
-			FrontListIter siblingIter = frontIt;
-			while( siblingIter != m_front.end() )
+			#ifdef PRUNING_DEBUG
 			{
-				if( siblingIter->m_octreeNode == &m_placeholder )
-				{
-					substitutePlaceholder( *siblingIter, substitutionLvl );
-				}
-				
-				if( siblingIter++->m_octreeNode->parent() != parentNode )
-				{
-					break;
-				}
-				
-				++nSiblings;
+				stringstream ss; ss << parentMorton.getPathToRoot() << ": last sibling group."
+					<< endl << endl;
+				HierarchyCreationLog::logDebugMsg( ss.str() );
 			}
+			#endif
 			
-			// The last sibling group cannot be prunned when the leaf level is not loaded yet. It can be incomplete
-			// at that time and all the sibling nodes should be in front before prunning.
-			if( ( !m_leafLvlLoadedFlag && siblingIter == m_front.end() ) ||
-				nSiblings != parentNode->child().size() )
-			{
-				#ifdef PRUNING_DEBUG
-				{
-					stringstream ss; ss << parentMorton.getPathToRoot() << ": last sibling group."
-						<< endl << endl;
-					HierarchyCreationLog::logDebugMsg( ss.str() );
-				}
-				#endif
-				
-				pruneFlag = false;
-			}
+			pruneFlag = false;
 		}
 		
-		if( pruneFlag && !parentNode->isLoaded() )
+		if( pruneFlag && !renderer.isLoaded( *parentNode ) )
 		{
-			#ifdef ASYNC_LOAD
-				parentNode->loadInGpu();
-			#else
-				parentNode->loadGPU();
-			#endif
-			
-			#ifdef PRUNING_DEBUG
-// 			{
-// 				stringstream ss; ss << parentMorton.getPathToRoot() << ": not loaded."
-// 					<< endl << endl;
-// 				HierarchyCreationLog::logDebugMsg( ss.str() );
-// 			}
-			#endif
-				
+			actions.push_back( TrackingAction( TrackingAction::LOAD, *parentNode, parentMorton, out_priority ) );
 			pruneFlag = false;
 		}
 		
-		#ifdef PRUNING_DEBUG
-// 		{
-// 			stringstream ss; ss << parentMorton.getPathToRoot() << ": prunning successful? " << pruneFlag
-// 				<< endl << endl;
-// 			HierarchyCreationLog::logDebugMsg( ss.str() );
-// 		}
-		#endif
-		
 		return pruneFlag;
 	}
 	
 	template< typename Morton >
-	inline void Front< Morton >::prune( FrontListIter& frontIt, Node* parentNode, const bool parentIsCullable,
-										Renderer& renderer )
+	inline void Front< Morton >::prune( const FrontVector& nodes, const size_t begin, const size_t end, Node* parentNode,
+										const Morton& parentMorton, const bool parentIsCullable,
+										const Float parentPriority, FrontVector& out, ActionVector& actions )
 	{
-		Morton parentMorton = *frontIt->m_morton.traverseUp();
-		
-		while( frontIt != m_front.end() && frontIt->m_octreeNode->parent() == parentNode )
+		for( size_t i = begin; i < end; ++i )
 		{
-			#ifdef RENDERING_DEBUG
-			{
-				stringstream ss; ss << "Trying to remove from rendering (prunning): " << frontIt->m_morton.getPathToRoot() << endl << endl;
-				HierarchyCreationLog::logDebugMsg( ss.str() );
-			}
-			#endif
-			
-			renderer.eraseFromList( *frontIt->m_octreeNode );
-			frontIt = m_front.erase( frontIt );
+			actions.push_back( TrackingAction( TrackingAction::ERASE, *nodes[ i ].m_octreeNode, nodes[ i ].m_morton ) );
 		}
 		
-// 		if( AllocStatistics::totalAllocated() > m_memoryLimit && parentNode->child()[ 0 ].isLeaf() )
-// 		{
-// 			#ifdef ASYNC_LOAD
-// 				m_nodeLoader.asyncRelease( std::move( parentNode->child() ), omp_get_thread_num() );
-// 			#else
-// 				parentNode->releaseChildren();
-// 			#endif
-// 		}
-// 		else
-// 		{
-			if( GpuAllocStatistics::reachedGpuMemQuota() )
-			{
-				for( Node& node : parentNode->child() )
-				{
-					#ifdef ASYNC_LOAD
-						unloadInGpu( node );
-					#else
-						node.unloadGPU();
-					#endif
-				}
-			}
-// 		}
+		actions.push_back( TrackingAction( TrackingAction::RELEASE_CHILDREN, *parentNode, parentMorton ) );
 		
-		FrontNode frontNode( *parentNode, parentMorton );
+		out.push_back( FrontNode( *parentNode, parentMorton ) );
 		
-		if( parentIsCullable )
+		if( !parentIsCullable )
 		{
-			m_front.insert( frontIt, frontNode );
-		}
-		else
-		{
-			setupNodeRendering( frontIt, frontNode, renderer );
+			actions.push_back( TrackingAction( TrackingAction::RENDER, *parentNode, parentMorton, parentPriority ) );
 		}
 	}
 	
 	template< typename Morton >
+	template< typename Renderer >
 	inline bool Front< Morton >
-	::checkBranch( const OctreeDim& nodeLvlDim, Node& node, const Morton& morton, Renderer& renderer,
-				   const Float projThresh, bool& out_isCullable )
+	::checkBranch( const OctreeDim& nodeLvlDim, Node& node, const Morton& morton, const AlignedBox3f& box,
+				   const bool isCullable, const bool isRenderable, const Renderer& renderer, Float& out_priority,
+				   ActionVector& actions )
 	{
 		#ifdef BRANCHING_DEBUG
 		{
@@ -911,32 +1291,34 @@ namespace omicron::hierarchy
 		}
 		#endif
 		
-		AlignedBox3f box = nodeLvlDim.getMortonBoundaries( morton );
-		out_isCullable = renderer.isCullable( box );
+		out_priority = m_residency.priority( box, m_eye );
+		
+		if( m_childrenPager && nodeLvlDim.level() < m_maxDepth && !node.isLeaf() && node.child().empty() && !isCullable )
+		{
+			m_childrenPager( node, morton );
+		}
 		
 		if( nodeLvlDim.level() < m_maxDepth && !node.isLeaf() && !node.child().empty() )
 		{
 			NodeArray& children = node.child();
+			OctreeDim childLvlDim( nodeLvlDim, nodeLvlDim.m_nodeLvl + 1 );
 			
 			bool areChildrenLoaded = true;
 			
 			for( Node& child : children )
 			{
-				if( !child.isLoaded() )
+				if( !renderer.isLoaded( child ) )
 				{
-					#ifdef ASYNC_LOAD
-						child.loadInGpu();
-					#else
-						child.loadGPU();
-					#endif
-					
+					Morton childMorton = childLvlDim.calcMorton( child );
+					Float childPriority = m_residency.priority( childLvlDim.getMortonBoundaries( childMorton ), m_eye );
+					actions.push_back( TrackingAction( TrackingAction::LOAD, child, childMorton, childPriority ) );
 					areChildrenLoaded = false;
 				}
 			}
 			
 			if( areChildrenLoaded )
 			{
-				return !renderer.isRenderable( box, projThresh ) && !out_isCullable;
+				return !isRenderable && !isCullable;
 			}
 		}
 		
@@ -944,55 +1326,38 @@ namespace omicron::hierarchy
 	}
 	
 	template< typename Morton >
-	inline void Front< Morton >::branch( FrontListIter& frontIt, Node& node,
-										 const OctreeDim& nodeLvlDim, Renderer& renderer )
+	inline void Front< Morton >::branch( const FrontNode& frontNode, const OctreeDim& nodeLvlDim, FrontVector& out,
+										 ActionVector& actions )
 	{
-		#ifdef RENDERING_DEBUG
-		{
-			stringstream ss; ss << "Trying to remove from rendering (branch): " << frontIt->m_morton.getPathToRoot() << endl << endl;
-			HierarchyCreationLog::logDebugMsg( ss.str() );
-		}
-		#endif
-		
-		frontIt = m_front.erase( frontIt );
-		
-		renderer.eraseFromList( node );
+		actions.push_back( TrackingAction( TrackingAction::ERASE, *frontNode.m_octreeNode, frontNode.m_morton ) );
 		
 		OctreeDim childLvlDim( nodeLvlDim, nodeLvlDim.m_nodeLvl + 1 );
-		NodeArray& children = node.child();
+		NodeArray& children = frontNode.m_octreeNode->child();
 		
 		for( int i = 0; i < children.size(); ++i )
 		{
 			Node& child = children[ i ];
 			AlignedBox3f box = childLvlDim.getNodeBoundaries( child );
-			FrontNode frontNode( child, childLvlDim.calcMorton( child ) );
+			FrontNode childFrontNode( child, childLvlDim.calcMorton( child ) );
 			
-			assert( frontNode.m_morton.getBits() != 1 && "Inserting root node into front (branch)." );
+			assert( childFrontNode.m_morton.getBits() != 1 && "Inserting root node into front (branch)." );
 			
-			if( !renderer.isCullable( box ) )
-			{
-				setupNodeRendering( frontIt, frontNode, renderer );
-			}
-			else
+			out.push_back( childFrontNode );
+			
+			if( !m_boxTests.isCullable( box ) )
 			{
-				m_front.insert( frontIt, frontNode );
+				actions.push_back( TrackingAction( TrackingAction::RENDER, child, childFrontNode.m_morton,
+												   m_residency.priority( box, m_eye ) ) );
 			}
 		}
 	}
 	
-	template< typename Morton >
-	inline void Front< Morton >::setupNodeRendering( FrontListIter& frontIt, const FrontNode& frontNode,
-													 Renderer& renderer )
-	{
-		m_front.insert( frontIt, frontNode );
-		
-		setupNodeRenderingNoFront( frontNode.m_morton, *frontNode.m_octreeNode, renderer );
-	}
 	
 	template< typename Morton >
+	template< typename Renderer >
 	inline void Front< Morton >::setupNodeRenderingNoFront( const Morton& morton, Node& node, Renderer& renderer )
 	{
-		if( node.isLoaded() )
+		if( renderer.isLoaded( node ) )
 		{
 			#ifdef NODE_ID_TEXT
 			{
@@ -1046,17 +1411,173 @@ namespace omicron::hierarchy
 	}
 	
 	template< typename Morton >
-	inline void Front< Morton >::unloadInGpu( Node& node )
+	inline void Front< Morton >::requestResidency( Node& node, const Float priority )
+	{
+		m_residency.request( &node, SurfelCloud::gpuFootprint( node.getContents().size() ), priority, m_frame );
+	}
+	
+	template< typename Morton >
+	template< typename Renderer >
+	inline void Front< Morton >::applyResidency( Renderer& renderer )
+	{
+		// Free slots and empty buffers of the cloud arena count against the budget too.
+		m_residency.setReservedBytes( renderer.gpuSlackBytes() );
+		
+		vector< Node* > loads;
+		vector< Node* > evictions;
+		m_residency.schedule( m_frame, loads, evictions );
+		
+		// Evicted nodes can be in the rendering list when their chunks are not tracked in this frame.
+		for( Node* node : evictions )
+		{
+			renderer.removeFromList( *node );
+			renderer.unloadInGpu( *node );
+		}
+		
+		for( Node* node : loads )
+		{
+			// The GPU memory can be exhausted by clouds that are not managed here. The node is requested again later.
+			if( !renderer.loadInGpu( *node ) )
+			{
+				m_residency.forget( node );
+			}
+		}
+	}
+	
+	template< typename Morton >
+	template< typename Renderer >
+	inline void Front< Morton >::releaseResidency( Node& node, Renderer& renderer )
 	{
+		renderer.removeFromList( node );
+		renderer.unloadInGpu( node );
+		m_residency.forget( &node );
+		
 		for( Node& child : node.child() )
 		{
-			if( child.isLoaded() )
+			releaseResidency( child, renderer );
+		}
+	}
+	
+	template< typename Morton >
+	template< typename Renderer >
+	inline void Front< Morton >::beginUpdate( const function< bool( const Morton& ) >& isInvalidated,
+											  const vector< Morton >& createdMortons,
+											  const vector< Node* >& invalidatedNodes, Renderer& renderer )
+	{
+		m_updatedMortons.clear();
+		m_updatedInsertions.clear();
+		
+		// The placeholder of a node is its first leaf level descendant, so the node substitutes it. Comparing first
+		// descendants also gives the width order of nodes that are not ancestors of each other.
+		auto firstLeaf = [ & ]( const Morton& morton )
+		{
+			Morton leaf; leaf.build( morton.getBits() << ( 3 * ( m_leafLvlDim.m_nodeLvl - morton.getLevel() ) ) );
+			return leaf;
+		};
+		
+		// Invalidated nodes can be in the rendering list. They are removed together, in a single pass over the list.
+		unordered_set< const Node* > unlisted( invalidatedNodes.begin(), invalidatedNodes.end() );
+		
+		size_t nextCreated = 0ul;
+		FrontVector items;
+		for( size_t i = 0; i < m_front.nChunks(); ++i )
+		{
+			FrontChunk& chunk = m_front.chunk( i );
+			items.clear();
+			items.reserve( chunk.m_items.size() );
+			
+			for( FrontNode& frontNode : chunk.m_items )
+			{
+				for( ; nextCreated < createdMortons.size(); ++nextCreated )
+				{
+					const Morton& created = createdMortons[ nextCreated ];
+					Morton createdLeaf = firstLeaf( created );
+					
+					if( createdLeaf < firstLeaf( frontNode.m_morton ) )
+					{
+						// Hole in the front.
+						m_updatedMortons.push_back( created );
+						items.push_back( FrontNode( m_placeholder, createdLeaf ) );
+						++chunk.m_nPending;
+					}
+					else if( !created.isDescendantOf( frontNode.m_morton ) )
+					{
+						break;
+					}
+					// Else the created node is reached by branching the front node.
+				}
+				
+				if( !isPlaceholder( frontNode ) && isInvalidated( frontNode.m_morton ) )
+				{
+					unlisted.insert( frontNode.m_octreeNode );
+					m_updatedMortons.push_back( frontNode.m_morton );
+					
+					items.push_back( FrontNode( m_placeholder, firstLeaf( frontNode.m_morton ) ) );
+					++chunk.m_nPending;
+				}
+				else
+				{
+					items.push_back( frontNode );
+				}
+			}
+			
+			chunk.m_items.swap( items );
+		}
+		
+		for( ; nextCreated < createdMortons.size(); ++nextCreated )
+		{
+			m_updatedMortons.push_back( createdMortons[ nextCreated ] );
+			m_front.pushBack( FrontNode( m_placeholder, firstLeaf( createdMortons[ nextCreated ] ) ), true );
+		}
+		
+		m_front.compact(
+			[ & ]( const FrontNode& a, const FrontNode& b ) { return areSiblings( a, b ); },
+			[ & ]( const FrontNode& node ) { return isPlaceholder( node ); }
+		);
+		
+		for( int lvl = 0; lvl < m_perLvlInsertions.size(); ++lvl )
+		{
+			lock_guard< mutex > lock( m_perLvlMtx[ lvl ] );
+			FrontList& lvlInsertions = m_perLvlInsertions[ lvl ];
+			for( FrontListIter it = lvlInsertions.begin(); it != lvlInsertions.end(); ++it )
 			{
-				child.unloadInGpu();
+				if( isInvalidated( it->m_morton ) )
+				{
+					m_updatedInsertions.push_back( it );
+				}
 			}
 		}
 		
-		node.unloadInGpu();
+		// Invalidated nodes that are not in the front can still be in the rendering list until the next full traversal.
+		renderer.removeFromList( unlisted );
+		for( Node* node : invalidatedNodes )
+		{
+			renderer.unloadInGpu( *node );
+			m_residency.forget( node );
+		}
+	}
+	
+	template< typename Morton >
+	inline void Front< Morton >::endUpdate( const function< Node*( const Morton& ) >& find )
+	{
+		for( FrontListIter& it : m_updatedInsertions )
+		{
+			lock_guard< mutex > lock( m_perLvlMtx[ it->m_morton.getLevel() ] );
+			it->m_octreeNode = find( it->m_morton );
+		}
+		
+		for( const Morton& morton : m_updatedMortons )
+		{
+			Node* node = find( morton );
+			assert( node != nullptr && "Updates should not remove nodes." );
+			
+			uint lvl = morton.getLevel();
+			lock_guard< mutex > lock( m_perLvlMtx[ lvl ] );
+			m_perLvlInsertions[ lvl ].push_back( FrontNode( *node, morton ) );
+		}
+		
+		m_updatedMortons.clear();
+		m_updatedInsertions.clear();
 	}
 	
 	template< typename Morton >
@@ -1074,7 +1595,6 @@ namespace omicron::hierarchy
 #undef PRUNING_DEBUG
 #undef BRANCHING_DEBUG
 
-#undef ASYNC_LOAD
 #undef NODE_ID_TEXT
 
 #endif
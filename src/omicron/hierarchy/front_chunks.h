@@ -0,0 +1,218 @@
+#ifndef FRONT_CHUNKS_H
+#define FRONT_CHUNKS_H
+
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include "omicron/basic/basic_types.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+	using namespace basic;
+
+	/** Ordered sequence of items stored in contiguous chunks. Chunks can be modified independently, so each one can be
+	 * processed by a different thread, and compact() restores the target chunk size afterwards without changing the
+	 * item order. Items are grouped by a predicate and compaction never splits a group between chunks, so a thread that
+	 * processes a chunk sees entire groups. Each chunk also counts its pending items, so passes that only care about them
+	 * can skip chunks without pending items.
+	 * @param T is the item type.
+	 * @param A is the item allocator. */
+	template< typename T, typename A = allocator< T > >
+	class FrontChunks
+	{
+	public:
+		using ItemVector = vector< T, A >;
+
+		typedef struct Chunk
+		{
+			Chunk()
+			: m_nPending( 0u )
+			{}
+
+			ItemVector m_items;
+
+			/** Number of pending items in m_items. */
+			uint m_nPending;
+		} Chunk;
+
+		/** @param chunkSize is the target number of items per chunk. */
+		FrontChunks( const size_t chunkSize )
+		: m_chunkSize( std::max( chunkSize, size_t( 1 ) ) ),
+		m_size( 0ul )
+		{}
+
+		/** Appends an item after the last one. A new chunk is started if the last one is full. */
+		void pushBack( const T& item, const bool isPending );
+
+		/** Merges chunks smaller than the target size, moves groups that straddle chunk boundaries to the chunk where
+		 * they begin and splits chunks bigger than twice the target size at group boundaries. Empty chunks are removed.
+		 * Must be called after the chunks are modified, since it also updates size().
+		 * @param sameGroup( const T& a, const T& b ) returns true if a and b are consecutive items of the same group.
+		 * @param isPending( const T& item ) returns true if the item is pending. It is called only for moved items. */
+		template< typename SameGroup, typename IsPending >
+		void compact( const SameGroup& sameGroup, const IsPending& isPending );
+
+		/** @returns the index of the first chunk that begins at or after the given item offset or nChunks() if there is
+		 * no such chunk. */
+		size_t chunkAt( const size_t offset ) const;
+
+		Chunk& chunk( const size_t i ) { return m_chunks[ i ]; }
+
+		const Chunk& chunk( const size_t i ) const { return m_chunks[ i ]; }
+
+		size_t nChunks() const { return m_chunks.size(); }
+
+		/** @returns the total number of items at the last compaction or insertion. */
+		size_t size() const { return m_size; }
+
+		bool empty() const { return m_size == 0ul; }
+
+		size_t chunkSize() const { return m_chunkSize; }
+
+	private:
+		/** Moves items [ begin, end ) of src to the end of dst. */
+		template< typename IsPending >
+		static void moveItems( Chunk& src, const size_t begin, const size_t end, Chunk& dst,
+							   const IsPending& isPending );
+
+		vector< Chunk > m_chunks;
+		size_t m_chunkSize;
+		size_t m_size;
+	};
+
+	template< typename T, typename A >
+	inline void FrontChunks< T, A >::pushBack( const T& item, const bool isPending )
+	{
+		if( m_chunks.empty() || m_chunks.back().m_items.size() >= m_chunkSize )
+		{
+			m_chunks.push_back( Chunk() );
+			m_chunks.back().m_items.reserve( m_chunkSize );
+		}
+
+		Chunk& last = m_chunks.back();
+		last.m_items.push_back( item );
+		last.m_nPending += isPending;
+		++m_size;
+	}
+
+	template< typename T, typename A >
+	template< typename SameGroup, typename IsPending >
+	inline void FrontChunks< T, A >::compact( const SameGroup& sameGroup, const IsPending& isPending )
+	{
+		vector< Chunk > compacted;
+		compacted.reserve( m_chunks.size() );
+		m_size = 0ul;
+
+		for( Chunk& chunk : m_chunks )
+		{
+			ItemVector& items = chunk.m_items;
+			if( items.empty() )
+			{
+				continue;
+			}
+
+			size_t begin = 0ul;
+
+			if( !compacted.empty() )
+			{
+				Chunk& last = compacted.back();
+
+				if( last.m_items.size() + items.size() <= m_chunkSize )
+				{
+					moveItems( chunk, 0ul, items.size(), last, isPending );
+					continue;
+				}
+
+				// The group that straddles the boundary goes to the chunk where it begins.
+				while( begin < items.size() && sameGroup( last.m_items.back(), items[ begin ] ) )
+				{
+					++begin;
+				}
+				moveItems( chunk, 0ul, begin, last, isPending );
+
+				if( begin == items.size() )
+				{
+					continue;
+				}
+			}
+
+			// Oversized chunks are split in pieces with about the target size.
+			while( items.size() - begin > 2 * m_chunkSize )
+			{
+				size_t end = begin + m_chunkSize;
+				while( end < items.size() && sameGroup( items[ end - 1 ], items[ end ] ) )
+				{
+					++end;
+				}
+
+				compacted.push_back( Chunk() );
+				moveItems( chunk, begin, end, compacted.back(), isPending );
+				begin = end;
+			}
+
+			if( begin == 0ul )
+			{
+				compacted.push_back( std::move( chunk ) );
+			}
+			else
+			{
+				compacted.push_back( Chunk() );
+				moveItems( chunk, begin, items.size(), compacted.back(), isPending );
+			}
+		}
+
+		for( const Chunk& chunk : compacted )
+		{
+			m_size += chunk.m_items.size();
+		}
+
+		m_chunks.swap( compacted );
+	}
+
+	template< typename T, typename A >
+	inline size_t FrontChunks< T, A >::chunkAt( const size_t offset ) const
+	{
+		size_t chunkBegin = 0ul;
+		for( size_t i = 0ul; i < m_chunks.size(); ++i )
+		{
+			if( chunkBegin >= offset )
+			{
+				return i;
+			}
+			chunkBegin += m_chunks[ i ].m_items.size();
+		}
+
+		return m_chunks.size();
+	}
+
+	template< typename T, typename A >
+	template< typename IsPending >
+	inline void FrontChunks< T, A >::moveItems( Chunk& src, const size_t begin, const size_t end, Chunk& dst,
+												const IsPending& isPending )
+	{
+		uint nPending = 0u;
+		for( size_t i = begin; i < end; ++i )
+		{
+			nPending += isPending( src.m_items[ i ] );
+		}
+
+		dst.m_items.insert( dst.m_items.end(), make_move_iterator( src.m_items.begin() + begin ),
+							make_move_iterator( src.m_items.begin() + end ) );
+		dst.m_nPending += nPending;
+
+		// Partial moves leave moved-from items in src, which are skipped by compact(). Whole chunks are cleared.
+		if( begin == 0ul && end == src.m_items.size() )
+		{
+			src.m_items.clear();
+			src.m_nPending = 0u;
+		}
+		else
+		{
+			src.m_nPending -= nPending;
+		}
+	}
+}
+
+#endif
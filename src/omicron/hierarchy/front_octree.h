@@ -9,7 +9,8 @@
 
 namespace omicron::hierarchy
 {
-	/** A simple octree with front tracking capability. Used to replace FastParallelOctree in tests. */
+	/** A simple octree with front tracking capability. Used to replace FastParallelOctree in tests. Indexed octree files
+	 * are mapped and their nodes are paged in as the front needs them, so opening them does not depend on their size. */
 	template< typename Morton >
 	class FrontOctree
 	{
@@ -20,7 +21,8 @@ namespace omicron::hierarchy
 		using NodeLoader = typename Front::NodeLoader;
 		using Renderer = SplatRenderer;
 		
-		/** @param octreeJson is a Json with the octree dimensions and a binary octree file entry.
+		/** @param octreeJson is a Json with the octree dimensions and a binary octree file entry. If the binary octree
+		 * file is indexed, the dimensions in its header are used instead.
 		 * @param nodeLoader is the GPU loader used by the front to render the octree. */
 		FrontOctree( const Json::Value& octreeJson, NodeLoader& nodeLoader, const RuntimeSetup& );
 		
@@ -29,7 +31,7 @@ namespace omicron::hierarchy
 		
 		OctreeStats trackFront( Renderer& renderer, const Float projThresh );
 	
-		void waitCreation(){ m_octFile->waitAsyncRead(); }
+		void waitCreation(){ if( m_octFile ) { m_octFile->waitAsyncRead(); } }
 		
 		bool isCreationFinished() { return true; }
 		
@@ -49,12 +51,14 @@ namespace omicron::hierarchy
 		
 		uint readerInTime() { return 0u; }
 		uint readerInitTime() { return 0u; }
-		uint readerReadTime() { return m_octFile->waitAsyncRead(); }
+		uint readerReadTime() { return m_octFile ? m_octFile->waitAsyncRead() : 0u; }
 
 	private:
 		unique_ptr< Front > m_front;
 		typename OctreeFile<Morton>::NodePtr m_root;
 		unique_ptr< OctreeFile<Morton> > m_octFile;
+		// Mapped file used to page in nodes. Null if the binary octree file is not indexed.
+		unique_ptr< IndexedOctreeFile<Morton> > m_indexedFile;
 		Dim m_dim;
 	};
 	
@@ -75,13 +79,32 @@ namespace omicron::hierarchy
 			cout << "Dim from Json: " << m_dim << endl;
 		}
 		
-		m_front = unique_ptr< Front >( new Front( octreeJson[ "database" ].asString(), m_dim, 1, nodeLoader, 8ul * 1024ul * 1024ul * 1024ul ) );
-
-		m_octFile = unique_ptr<OctreeFile<Morton>>(new OctreeFile<Morton>());
-		m_root = m_octFile->asyncRead(
-			octreeJson[ "nodes" ].asString(), m_dim,
-			[&](uint levelDone){ m_front->setMaxDepth(levelDone); }
-		);
+		string nodesFilename = octreeJson[ "nodes" ].asString();
+		
+		if( IndexedOctreeFile<Morton>::isIndexed( nodesFilename ) )
+		{
+			m_indexedFile = unique_ptr< IndexedOctreeFile<Morton> >( new IndexedOctreeFile<Morton>( nodesFilename ) );
+			m_dim = m_indexedFile->dim();
+			
+			m_front = unique_ptr< Front >( new Front( octreeJson[ "database" ].asString(), m_dim, 1, nodeLoader, 8ul * 1024ul * 1024ul * 1024ul ) );
+			m_front->setMaxDepth( m_dim.m_nodeLvl );
+			m_front->notifyLeafLvlLoaded();
+			m_front->setChildrenPager(
+				[ this ]( Node& node, const Morton& morton ){ return m_indexedFile->pageIn( node, morton ); }
+			);
+			
+			m_root = m_indexedFile->loadRoot();
+		}
+		else
+		{
+			m_front = unique_ptr< Front >( new Front( octreeJson[ "database" ].asString(), m_dim, 1, nodeLoader, 8ul * 1024ul * 1024ul * 1024ul ) );
+			
+			m_octFile = unique_ptr<OctreeFile<Morton>>(new OctreeFile<Morton>());
+			m_root = m_octFile->asyncRead(
+				nodesFilename, m_dim,
+				[&](uint levelDone){ m_front->setMaxDepth(levelDone); }
+			);
+		}
 		
 		m_front->insertRoot( *m_root );
 	}
@@ -101,6 +124,18 @@ namespace omicron::hierarchy
 	template< typename Morton >
 	pair< uint, uint > FrontOctree< Morton >::nodeStatistics() const
 	{
+		if( m_indexedFile )
+		{
+			// Only part of the hierarchy is in memory. The node table has the statistics.
+			pair< uint, uint > stats( m_indexedFile->nNodes(), 0u );
+			for( uint64_t i = 0; i < m_indexedFile->nNodes(); ++i )
+			{
+				stats.second += m_indexedFile->entry( i ).m_nContents;
+			}
+			
+			return stats;
+		}
+		
 		return m_root->subtreeStatistics();
 	}
 }
@@ -39,9 +39,27 @@ namespace omicron::hierarchy
 			return totalAllocated() + neededGpuMem < m_totalGpuMem;
 		}
 		
+		/** @returns the GPU memory available for point clouds. */
+		static ulong gpuMemQuota()
+		{
+			return ulong( 0.1f * float( m_totalGpuMem ) );
+		}
+		
 		static bool reachedGpuMemQuota()
 		{
-			return float( totalAllocated() ) > 0.1f * float( m_totalGpuMem );
+			return totalAllocated() > gpuMemQuota();
+		}
+		
+		/** @returns the GPU memory allowed. */
+		static ulong totalGpuMem()
+		{
+			return m_totalGpuMem;
+		}
+		
+		/** Sets the GPU memory allowed. The default is GPU_MEMORY. */
+		static void setTotalGpuMem( const ulong totalGpuMem )
+		{
+			m_totalGpuMem = totalGpuMem;
 		}
 	
 	private:
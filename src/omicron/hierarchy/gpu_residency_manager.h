@@ -0,0 +1,395 @@
+#ifndef GPU_RESIDENCY_MANAGER_H
+#define GPU_RESIDENCY_MANAGER_H
+
+#include <list>
+#include <queue>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <Eigen/Geometry>
+#include "omicron/basic/basic_types.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+	using namespace basic;
+	using namespace Eigen;
+
+	/** Decides which clouds are resident in GPU memory under a byte budget. Load requests wait in a priority queue and
+	 * resident clouds are kept in a LRU list. Each frame, schedule() loads the pending clouds in priority order. When the
+	 * budget is reached, room is made by evicting resident clouds that were not used in the current frame, beginning
+	 * with the least recent ones. A cloud is evicted only if it is stale or has lower priority than the request. Requests
+	 * that are not renewed in a few frames are stale and are dropped instead of loaded. The manager only decides. The
+	 * caller does the loads and unloads. NOT THREAD SAFE.
+	 * @param Key identifies a cloud. */
+	template< typename Key, typename Hash = hash< Key > >
+	class GpuResidencyManager
+	{
+	public:
+		/** @param budget is the maximum number of resident bytes.
+		 * @param staleFrames is the number of frames without renewal after which a request or a resident cloud is stale.
+		 * @param maxLoadsPerFrame is the maximum number of loads scheduled per frame. */
+		GpuResidencyManager( const ulong budget, const uint staleFrames = 8u, const uint maxLoadsPerFrame = 1024u )
+		: m_budget( budget ),
+		m_staleFrames( staleFrames ),
+		m_maxLoadsPerFrame( maxLoadsPerFrame ),
+		m_residentBytes( 0ul ),
+		m_reservedBytes( 0ul ),
+		m_lastSweep( 0ul ),
+		m_nPreempted( 0ul ),
+		m_nEvicted( 0ul )
+		{}
+
+		/** @returns the priority of a cloud, which is its approximate projected size: the box diagonal divided by its
+		 * distance to the eye. */
+		static Float priority( const AlignedBox3f& box, const Vec3& eye );
+
+		/** Requests a load or renews a previous request. If the cloud is resident, it is touched instead. */
+		void request( const Key& key, const ulong bytes, const Float priority, const ulong frame );
+
+		/** Speculative request. Same as request(), but a request done in the same frame with higher priority is kept,
+		 * so speculative loads never delay the needed ones. */
+		void prefetch( const Key& key, const ulong bytes, const Float priority, const ulong frame );
+
+		/** Marks a resident cloud as used in the frame. Does nothing if the cloud is not resident. */
+		void touch( const Key& key, const ulong frame );
+
+		/** Forgets a cloud, pending or resident. Must be called when a cloud is unloaded outside of the manager. */
+		void forget( const Key& key );
+
+		/** Schedules the loads and evictions of a frame. Evictions must be done before loads.
+		 * @param out_loads receives the clouds to load, in priority order.
+		 * @param out_evictions receives the clouds to unload. */
+		void schedule( const ulong frame, vector< Key >& out_loads, vector< Key >& out_evictions );
+
+		bool isResident( const Key& key ) const;
+
+		bool isPending( const Key& key ) const;
+
+		ulong budget() const { return m_budget; }
+
+		void setBudget( const ulong budget ) { m_budget = budget; }
+
+		/** Sets the bytes of the budget that are used outside of the resident clouds, such as the padding of the
+		 * buffers that hold them. They are not available for loads until set again. */
+		void setReservedBytes( const ulong bytes ) { m_reservedBytes = bytes; }
+
+		ulong reservedBytes() const { return m_reservedBytes; }
+
+		ulong residentBytes() const { return m_residentBytes; }
+
+		size_t nResident() const { return m_lru.size(); }
+
+		size_t nPending() const { return m_entries.size() - m_lru.size(); }
+
+		/** @returns the number of stale requests dropped until now. */
+		ulong nPreempted() const { return m_nPreempted; }
+
+		/** @returns the number of evictions until now. */
+		ulong nEvicted() const { return m_nEvicted; }
+
+	private:
+		using LruList = list< Key >;
+		using LruIter = typename LruList::iterator;
+
+		typedef struct Entry
+		{
+			ulong m_bytes;
+			Float m_priority;
+			/** Last frame in which the cloud was requested or used. */
+			ulong m_lastFrame;
+			/** Incremented when the priority changes, so outdated queue items are skipped. */
+			uint m_generation;
+			bool m_isResident;
+			/** Position in the LRU list. Valid only if resident. */
+			LruIter m_lruIt;
+		} Entry;
+
+		typedef struct QueueItem
+		{
+			bool operator<( const QueueItem& other ) const { return m_priority < other.m_priority; }
+
+			Float m_priority;
+			uint m_generation;
+			Key m_key;
+		} QueueItem;
+
+		bool isStale( const Entry& entry, const ulong frame ) const
+		{
+			return frame > entry.m_lastFrame + m_staleFrames;
+		}
+
+		/** Drops stale requests and rebuilds the queue without outdated items. */
+		void sweep( const ulong frame );
+
+		/** Evicts resident clouds so bytes fit in the budget.
+		 * @returns false if there are not enough evictable clouds, in which case nothing is evicted. */
+		bool makeRoom( const ulong bytes, const Float priority, const ulong frame, vector< Key >& out_evictions );
+
+		ulong m_budget;
+		uint m_staleFrames;
+		uint m_maxLoadsPerFrame;
+
+		unordered_map< Key, Entry, Hash > m_entries;
+		priority_queue< QueueItem > m_queue;
+		/** Resident clouds. The most recent is in the front. */
+		LruList m_lru;
+
+		ulong m_residentBytes;
+		ulong m_reservedBytes;
+		/** Frame of the last sweep. */
+		ulong m_lastSweep;
+		ulong m_nPreempted;
+		ulong m_nEvicted;
+	};
+
+	template< typename Key, typename Hash >
+	inline Float GpuResidencyManager< Key, Hash >::priority( const AlignedBox3f& box, const Vec3& eye )
+	{
+		Float diagonal = box.diagonal().norm();
+		Float distance = std::max( ( box.center() - eye ).norm() - 0.5f * diagonal, 1e-6f );
+
+		return diagonal / distance;
+	}
+
+	template< typename Key, typename Hash >
+	inline void GpuResidencyManager< Key, Hash >::request( const Key& key, const ulong bytes, const Float priority,
+														   const ulong frame )
+	{
+		auto entryIt = m_entries.find( key );
+
+		if( entryIt == m_entries.end() )
+		{
+			Entry entry;
+			entry.m_bytes = bytes;
+			entry.m_priority = priority;
+			entry.m_lastFrame = frame;
+			entry.m_generation = 0u;
+			entry.m_isResident = false;
+
+			m_entries.emplace( key, entry );
+			m_queue.push( QueueItem{ priority, 0u, key } );
+			return;
+		}
+
+		Entry& entry = entryIt->second;
+		entry.m_lastFrame = std::max( entry.m_lastFrame, frame );
+
+		if( entry.m_isResident )
+		{
+			entry.m_priority = priority;
+			m_lru.splice( m_lru.begin(), m_lru, entry.m_lruIt );
+		}
+		else if( entry.m_priority != priority )
+		{
+			entry.m_priority = priority;
+			m_queue.push( QueueItem{ priority, ++entry.m_generation, key } );
+		}
+	}
+
+	template< typename Key, typename Hash >
+	inline void GpuResidencyManager< Key, Hash >::prefetch( const Key& key, const ulong bytes, const Float priority,
+															const ulong frame )
+	{
+		auto entryIt = m_entries.find( key );
+
+		if( entryIt != m_entries.end() && entryIt->second.m_lastFrame == frame && entryIt->second.m_priority >= priority )
+		{
+			return;
+		}
+
+		request( key, bytes, priority, frame );
+	}
+
+	template< typename Key, typename Hash >
+	inline void GpuResidencyManager< Key, Hash >::touch( const Key& key, const ulong frame )
+	{
+		auto entryIt = m_entries.find( key );
+
+		if( entryIt != m_entries.end() && entryIt->second.m_isResident )
+		{
+			Entry& entry = entryIt->second;
+			entry.m_lastFrame = std::max( entry.m_lastFrame, frame );
+			m_lru.splice( m_lru.begin(), m_lru, entry.m_lruIt );
+		}
+	}
+
+	template< typename Key, typename Hash >
+	inline void GpuResidencyManager< Key, Hash >::forget( const Key& key )
+	{
+		auto entryIt = m_entries.find( key );
+
+		if( entryIt != m_entries.end() )
+		{
+			Entry& entry = entryIt->second;
+			if( entry.m_isResident )
+			{
+				m_residentBytes -= entry.m_bytes;
+				m_lru.erase( entry.m_lruIt );
+			}
+
+			// Queue items of the forgotten cloud are skipped when popped.
+			m_entries.erase( entryIt );
+		}
+	}
+
+	template< typename Key, typename Hash >
+	inline void GpuResidencyManager< Key, Hash >::schedule( const ulong frame, vector< Key >& out_loads,
+															vector< Key >& out_evictions )
+	{
+		// Low priority requests can stay in the queue for a long time, so stale ones are also swept periodically.
+		if( frame >= m_lastSweep + m_staleFrames )
+		{
+			sweep( frame );
+		}
+
+		uint nLoads = 0u;
+
+		while( !m_queue.empty() && nLoads < m_maxLoadsPerFrame )
+		{
+			const QueueItem& item = m_queue.top();
+
+			auto entryIt = m_entries.find( item.m_key );
+			if( entryIt == m_entries.end() || entryIt->second.m_isResident
+				|| entryIt->second.m_generation != item.m_generation )
+			{
+				// Outdated item.
+				m_queue.pop();
+				continue;
+			}
+
+			Entry& entry = entryIt->second;
+
+			if( isStale( entry, frame ) || entry.m_bytes > m_budget )
+			{
+				// The request was not renewed recently or will never fit, so it is preempted.
+				++m_nPreempted;
+				m_entries.erase( entryIt );
+				m_queue.pop();
+				continue;
+			}
+
+			if( !makeRoom( entry.m_bytes, entry.m_priority, frame, out_evictions ) )
+			{
+				// The remaining requests have lower priorities, so they cannot evict more than this one.
+				break;
+			}
+
+			Key key = item.m_key;
+			m_queue.pop();
+
+			m_lru.push_front( key );
+			entry.m_lruIt = m_lru.begin();
+			entry.m_isResident = true;
+			m_residentBytes += entry.m_bytes;
+
+			out_loads.push_back( key );
+			++nLoads;
+		}
+	}
+
+	template< typename Key, typename Hash >
+	inline void GpuResidencyManager< Key, Hash >::sweep( const ulong frame )
+	{
+		m_lastSweep = frame;
+
+		vector< QueueItem > items;
+		for( auto entryIt = m_entries.begin(); entryIt != m_entries.end(); )
+		{
+			Entry& entry = entryIt->second;
+			if( entry.m_isResident )
+			{
+				++entryIt;
+			}
+			else if( isStale( entry, frame ) )
+			{
+				++m_nPreempted;
+				entryIt = m_entries.erase( entryIt );
+			}
+			else
+			{
+				items.push_back( QueueItem{ entry.m_priority, entry.m_generation, entryIt->first } );
+				++entryIt;
+			}
+		}
+
+		m_queue = priority_queue< QueueItem >( less< QueueItem >(), std::move( items ) );
+	}
+
+	template< typename Key, typename Hash >
+	inline bool GpuResidencyManager< Key, Hash >::makeRoom( const ulong bytes, const Float priority, const ulong frame,
+															vector< Key >& out_evictions )
+	{
+		ulong available = ( m_budget > m_reservedBytes ) ? m_budget - m_reservedBytes : 0ul;
+		if( m_residentBytes + bytes <= available )
+		{
+			return true;
+		}
+
+		// First pass: check if the evictable clouds free enough memory.
+		ulong freed = 0ul;
+		LruIter lastVictim = m_lru.end();
+		for( auto it = m_lru.rbegin(); it != m_lru.rend() && m_residentBytes - freed + bytes > available; ++it )
+		{
+			const Entry& victim = m_entries.at( *it );
+			if( victim.m_lastFrame >= frame )
+			{
+				// This cloud and the more recent ones are used in the current frame.
+				break;
+			}
+
+			if( isStale( victim, frame ) || victim.m_priority < priority )
+			{
+				freed += victim.m_bytes;
+				lastVictim = prev( it.base() );
+			}
+		}
+
+		if( m_residentBytes - freed + bytes > available )
+		{
+			return false;
+		}
+
+		// Second pass: evict.
+		for( auto it = prev( m_lru.end() ); ; )
+		{
+			bool isLast = ( it == lastVictim );
+			Entry& victim = m_entries.at( *it );
+			auto next = ( it == m_lru.begin() ) ? m_lru.end() : prev( it );
+
+			if( isStale( victim, frame ) || victim.m_priority < priority )
+			{
+				m_residentBytes -= victim.m_bytes;
+				out_evictions.push_back( *it );
+				++m_nEvicted;
+
+				m_entries.erase( *it );
+				m_lru.erase( it );
+			}
+
+			if( isLast || next == m_lru.end() )
+			{
+				break;
+			}
+			it = next;
+		}
+
+		return true;
+	}
+
+	template< typename Key, typename Hash >
+	inline bool GpuResidencyManager< Key, Hash >::isResident( const Key& key ) const
+	{
+		auto entryIt = m_entries.find( key );
+		return entryIt != m_entries.end() && entryIt->second.m_isResident;
+	}
+
+	template< typename Key, typename Hash >
+	inline bool GpuResidencyManager< Key, Hash >::isPending( const Key& key ) const
+	{
+		auto entryIt = m_entries.find( key );
+		return entryIt != m_entries.end() && !entryIt->second.m_isResident;
+	}
+}
+
+#endif
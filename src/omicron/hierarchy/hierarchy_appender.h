@@ -0,0 +1,435 @@
+#ifndef HIERARCHY_APPENDER_H
+#define HIERARCHY_APPENDER_H
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_set>
+#include "omicron/hierarchy/o1_octree_node.h"
+#include "omicron/hierarchy/octree_dimensions.h"
+#include "omicron/hierarchy/reconstruction_config.h"
+#include "omicron/hierarchy/sibling_sampler.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+
+	/** Merges a batch of new points into a finished O1OctreeNode hierarchy. Only the leaves the new points fall into are
+	 * re-created and only their ancestors are re-sampled, so the cost is proportional to the batch, not to the
+	 * hierarchy. The append is done in two steps. The ctor finds the nodes that the batch changes or moves in memory
+	 * without touching the hierarchy, so their users (e.g. the Front and the GPU) can release them. append() then
+	 * changes the hierarchy.
+	 *
+	 * A sibling group is an array, so a group that receives a new node is reallocated, moving its nodes. Collapsed
+	 * leaves above the leaf level only have sampled points, which are subdivided again together with the new points.
+	 * @param Morton is the MortonCode type. */
+	template< typename Morton >
+	class HierarchyAppender
+	{
+	public:
+		using Node = O1OctreeNode< Surfel >;
+		using NodeArray = typename Node::NodeArray;
+		using ContentsArray = typename Node::ContentsArray;
+		using OctreeDim = OctreeDimensions< Morton >;
+		using Sampler = SiblingSampler< Node >;
+		using PointVector = vector< Point, TbbAllocator< Point > >;
+		using KeyVector = vector< ulong, TbbAllocator< ulong > >;
+
+		/** Ctor. Prepares the append of a batch. The hierarchy is not changed.
+		 * @param root is the root of a finished hierarchy, with all children in memory.
+		 * @param leafLvlDim is the octree dimensions at the deepest level.
+		 * @param config has the leaf surfel tangent size and the parent sampling parameters of the hierarchy creation.
+		 * @param sortedPoints are the new points, in morton order.
+		 * @throws logic_error if the points are not sorted or if the hierarchy has paged out children.
+		 * @throws runtime_error if a point is outside the octree boundaries. */
+		HierarchyAppender( Node& root, const OctreeDim& leafLvlDim, const ReconstructionConfig& config,
+						   const PointVector& sortedPoints );
+
+		/** @returns true if append() changes or moves the node with the given morton code. */
+		bool isInvalidated( const Morton& morton ) const { return m_invalidated.count( morton.getBits() ) > 0; }
+
+		/** @returns the nodes that append() changes or moves. The pointers are invalid after append(). */
+		const vector< Node* >& invalidatedNodes() const { return m_invalidatedNodes; }
+
+		/** @returns the roots of the subtrees that append() creates under existing nodes, in hierarchy width order. */
+		const vector< Morton >& createdMortons() const { return m_createdMortons; }
+
+		/** Merges the batch into the hierarchy. Must be called once. */
+		void append();
+
+		/** @returns the node with the given morton code or nullptr if there is none. */
+		Node* find( const Morton& morton ) const;
+
+		/** @returns the number of nodes created by append(). */
+		ulong nCreatedNodes() const { return m_nCreatedNodes; }
+
+		/** @returns the number of existing nodes re-sampled by append(). */
+		ulong nResampledNodes() const { return m_nResampledNodes; }
+
+	private:
+		/** Finds the nodes changed or moved by the merge of the batch range [ begin, end ) into a node. */
+		void prepare( Node& node, const Morton& morton, const ulong begin, const ulong end );
+
+		/** Merges the batch range [ begin, end ) into a node and re-samples it. */
+		void merge( Node& node, const Morton& morton, const ulong begin, const ulong end );
+
+		/** Creates in place the subtree of the sorted point range [ begin, end ). Only the created descendants are
+		 * counted in m_nCreatedNodes.
+		 * @param lvl is the subtree root's level. */
+		void createSubtree( Node& node, Node* parent, const ContentsArray& points, const KeyVector& keys,
+							const ulong begin, const ulong end, const uint lvl );
+
+		/** Samples the contents of an inner node from its children, as HierarchyCreator does. */
+		void resample( Node& node, const Morton& morton ) const;
+
+		/** @returns the end of the range beginning at begin whose keys are in the same node at the given level. */
+		ulong groupEnd( const KeyVector& keys, const ulong begin, const ulong end, const uint lvl ) const;
+
+		/** @returns the morton code bits of a leaf level key at the given level. */
+		ulong ancestorBits( const ulong key, const uint lvl ) const
+		{
+			return key >> ( 3 * ( m_leafLvlDim.m_nodeLvl - lvl ) );
+		}
+
+		/** @returns the index of the child with the given morton code bits or -1 if there is none. */
+		int findChild( const Node& node, const ulong childBits, const uint childLvl ) const;
+
+		Node& m_root;
+		OctreeDim m_leafLvlDim;
+		ReconstructionConfig m_config;
+
+		/** New points, as leaf surfels, and their leaf level morton code bits. */
+		ContentsArray m_points;
+		KeyVector m_keys;
+
+		/** Morton code bits of the nodes changed or moved by append(). */
+		unordered_set< ulong > m_invalidated;
+		vector< Node* > m_invalidatedNodes;
+		vector< Morton > m_createdMortons;
+
+		ulong m_nCreatedNodes;
+		ulong m_nResampledNodes;
+	};
+
+	template< typename Morton >
+	HierarchyAppender< Morton >::HierarchyAppender( Node& root, const OctreeDim& leafLvlDim,
+													const ReconstructionConfig& config,
+													const PointVector& sortedPoints )
+	: m_root( root ),
+	m_leafLvlDim( leafLvlDim ),
+	m_config( config ),
+	m_points( sortedPoints.size() ),
+	m_keys( sortedPoints.size() ),
+	m_nCreatedNodes( 0ul ),
+	m_nResampledNodes( 0ul )
+	{
+		const Float lvlNodes = Float( 1ul << m_leafLvlDim.m_nodeLvl );
+
+		for( ulong i = 0; i < sortedPoints.size(); ++i )
+		{
+			const Point& point = sortedPoints[ i ];
+			Vec3 index = ( point.getPos() - m_leafLvlDim.m_origin ).array() / m_leafLvlDim.m_nodeSize.array();
+			if( ( index.array() < 0.f ).any() || ( index.array() >= lvlNodes ).any() )
+			{
+				throw runtime_error( "Appended point is outside the octree boundaries." );
+			}
+
+			m_points[ i ] = Surfel( point, m_config.m_leafSurfelTangentSize );
+			m_keys[ i ] = m_leafLvlDim.calcMorton( point ).getBits();
+
+			if( i > 0 && m_keys[ i ] < m_keys[ i - 1 ] )
+			{
+				throw logic_error( "Appended points must be sorted in morton order." );
+			}
+		}
+
+		if( !m_keys.empty() )
+		{
+			Morton rootMorton; rootMorton.build( 0x1 );
+			prepare( m_root, rootMorton, 0ul, m_keys.size() );
+		}
+	}
+
+	template< typename Morton >
+	void HierarchyAppender< Morton >::prepare( Node& node, const Morton& morton, const ulong begin, const ulong end )
+	{
+		m_invalidated.insert( morton.getBits() );
+		m_invalidatedNodes.push_back( &node );
+
+		if( node.isLeaf() )
+		{
+			return;
+		}
+
+		if( node.child().size() == 0 )
+		{
+			throw logic_error( "Cannot append to a hierarchy with paged out children." );
+		}
+
+		uint childLvl = morton.getLevel() + 1;
+		bool isReallocated = false;
+
+		for( ulong groupBegin = begin; groupBegin < end; )
+		{
+			ulong groupEndIdx = groupEnd( m_keys, groupBegin, end, childLvl );
+			ulong childBits = ancestorBits( m_keys[ groupBegin ], childLvl );
+			int childIdx = findChild( node, childBits, childLvl );
+
+			Morton childMorton; childMorton.build( childBits );
+			if( childIdx == -1 )
+			{
+				m_createdMortons.push_back( childMorton );
+				isReallocated = true;
+			}
+			else
+			{
+				prepare( node.child()[ childIdx ], childMorton, groupBegin, groupEndIdx );
+			}
+
+			groupBegin = groupEndIdx;
+		}
+
+		if( isReallocated )
+		{
+			OctreeDim childDim( m_leafLvlDim, childLvl );
+			for( Node& child : node.child() )
+			{
+				if( m_invalidated.insert( childDim.calcMorton( child ).getBits() ).second )
+				{
+					m_invalidatedNodes.push_back( &child );
+				}
+			}
+		}
+	}
+
+	template< typename Morton >
+	void HierarchyAppender< Morton >::append()
+	{
+		if( !m_keys.empty() )
+		{
+			Morton rootMorton; rootMorton.build( 0x1 );
+			merge( m_root, rootMorton, 0ul, m_keys.size() );
+		}
+
+		m_invalidatedNodes.clear();
+	}
+
+	template< typename Morton >
+	void HierarchyAppender< Morton >::merge( Node& node, const Morton& morton, const ulong begin, const ulong end )
+	{
+		uint lvl = morton.getLevel();
+
+		if( node.isLeaf() )
+		{
+			const ContentsArray& oldPoints = node.getContents();
+			ContentsArray points( oldPoints.size() + end - begin );
+			copy( oldPoints.begin(), oldPoints.end(), points.begin() );
+			copy( m_points.begin() + begin, m_points.begin() + end, points.begin() + oldPoints.size() );
+
+			if( lvl == m_leafLvlDim.m_nodeLvl )
+			{
+				node.setContents( std::move( points ) );
+				return;
+			}
+
+			// Collapsed leaf. It is subdivided down to the leaf level, as if its points were leaf points.
+			vector< ulong > order( points.size() );
+			iota( order.begin(), order.end(), 0ul );
+			KeyVector keys( points.size() );
+			for( ulong i = 0; i < points.size(); ++i )
+			{
+				keys[ i ] = m_leafLvlDim.calcMorton( points[ i ] ).getBits();
+			}
+			stable_sort( order.begin(), order.end(), [ & ]( ulong a, ulong b ) { return keys[ a ] < keys[ b ]; } );
+
+			ContentsArray sortedPoints( points.size() );
+			KeyVector sortedKeys( points.size() );
+			for( ulong i = 0; i < order.size(); ++i )
+			{
+				sortedPoints[ i ] = points[ order[ i ] ];
+				sortedKeys[ i ] = keys[ order[ i ] ];
+			}
+
+			createSubtree( node, node.parent(), sortedPoints, sortedKeys, 0ul, sortedPoints.size(), lvl );
+			++m_nResampledNodes;
+			return;
+		}
+
+		uint childLvl = lvl + 1;
+		OctreeDim childDim( m_leafLvlDim, childLvl );
+
+		// Batch groups of each child. New children are created in a reallocated sibling group, in morton order.
+		struct Group { ulong m_childBits; ulong m_begin; ulong m_end; int m_childIdx; bool m_isNew; };
+		vector< Group > groups;
+		uint nNewChildren = 0u;
+		for( ulong groupBegin = begin; groupBegin < end; )
+		{
+			ulong groupEndIdx = groupEnd( m_keys, groupBegin, end, childLvl );
+			ulong childBits = ancestorBits( m_keys[ groupBegin ], childLvl );
+			int childIdx = findChild( node, childBits, childLvl );
+			nNewChildren += ( childIdx == -1 ) ? 1u : 0u;
+
+			groups.push_back( Group{ childBits, groupBegin, groupEndIdx, childIdx, childIdx == -1 } );
+			groupBegin = groupEndIdx;
+		}
+
+		if( nNewChildren > 0u )
+		{
+			NodeArray& oldChildren = node.child();
+			NodeArray children( oldChildren.size() + nNewChildren );
+
+			uint oldIdx = 0u;
+			uint childIdx = 0u;
+			for( Group& group : groups )
+			{
+				// Old children before the group's child.
+				while( oldIdx < oldChildren.size()
+					&& childDim.calcMorton( oldChildren[ oldIdx ] ).getBits() < group.m_childBits )
+				{
+					children[ childIdx++ ] = std::move( oldChildren[ oldIdx++ ] );
+				}
+
+				if( group.m_isNew )
+				{
+					createSubtree( children[ childIdx ], &node, m_points, m_keys, group.m_begin, group.m_end, childLvl );
+					++m_nCreatedNodes;
+				}
+				else
+				{
+					children[ childIdx ] = std::move( oldChildren[ oldIdx++ ] );
+				}
+				group.m_childIdx = childIdx++;
+			}
+			while( oldIdx < oldChildren.size() )
+			{
+				children[ childIdx++ ] = std::move( oldChildren[ oldIdx++ ] );
+			}
+
+			node.setChildren( std::move( children ) );
+
+			// The move does not fix the parent pointers of the moved nodes' children.
+			for( Node& child : node.child() )
+			{
+				child.setParent( &node );
+				for( Node& grandChild : child.child() )
+				{
+					grandChild.setParent( &child );
+				}
+			}
+		}
+
+		for( const Group& group : groups )
+		{
+			if( !group.m_isNew )
+			{
+				Morton childMorton; childMorton.build( group.m_childBits );
+				merge( node.child()[ group.m_childIdx ], childMorton, group.m_begin, group.m_end );
+			}
+		}
+
+		resample( node, morton );
+		++m_nResampledNodes;
+	}
+
+	template< typename Morton >
+	void HierarchyAppender< Morton >::createSubtree( Node& node, Node* parent, const ContentsArray& points,
+													 const KeyVector& keys, const ulong begin, const ulong end,
+													 const uint lvl )
+	{
+		if( lvl == m_leafLvlDim.m_nodeLvl )
+		{
+			ContentsArray contents( end - begin );
+			copy( points.begin() + begin, points.begin() + end, contents.begin() );
+			node = Node( std::move( contents ), parent );
+			return;
+		}
+
+		uint nChildren = 0u;
+		for( ulong groupBegin = begin; groupBegin < end; groupBegin = groupEnd( keys, groupBegin, end, lvl + 1 ) )
+		{
+			++nChildren;
+		}
+
+		// The node is in its final place, so the children array is not moved after the children get their parent.
+		node = Node( ContentsArray(), parent, NodeArray( nChildren ) );
+
+		uint childIdx = 0u;
+		for( ulong groupBegin = begin; groupBegin < end; )
+		{
+			ulong groupEndIdx = groupEnd( keys, groupBegin, end, lvl + 1 );
+			createSubtree( node.child()[ childIdx++ ], &node, points, keys, groupBegin, groupEndIdx, lvl + 1 );
+			++m_nCreatedNodes;
+			groupBegin = groupEndIdx;
+		}
+
+		Morton morton; morton.build( ancestorBits( keys[ begin ], lvl ) );
+		resample( node, morton );
+	}
+
+	template< typename Morton >
+	inline void HierarchyAppender< Morton >::resample( Node& node, const Morton& morton ) const
+	{
+		Sampler sampler;
+		for( const Node& child : node.child() )
+		{
+			sampler.push( child );
+		}
+
+		int nSamples = std::max( 1.f, sampler.nPoints() * m_config.m_parentPointsRatio );
+		node.setContents( sampler.sample( morton.getBits(), nSamples,
+										  m_config.tangentMultipliers( morton.getLevel() + 1 ) ) );
+	}
+
+	template< typename Morton >
+	inline ulong HierarchyAppender< Morton >::groupEnd( const KeyVector& keys, const ulong begin, const ulong end,
+														const uint lvl ) const
+	{
+		ulong bits = ancestorBits( keys[ begin ], lvl );
+		ulong groupEndIdx = begin + 1;
+		while( groupEndIdx < end && ancestorBits( keys[ groupEndIdx ], lvl ) == bits )
+		{
+			++groupEndIdx;
+		}
+
+		return groupEndIdx;
+	}
+
+	template< typename Morton >
+	inline int HierarchyAppender< Morton >::findChild( const Node& node, const ulong childBits,
+													   const uint childLvl ) const
+	{
+		OctreeDim childDim( m_leafLvlDim, childLvl );
+		const NodeArray& children = node.child();
+		for( int i = 0; i < int( children.size() ); ++i )
+		{
+			if( childDim.calcMorton( children[ i ] ).getBits() == childBits )
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	template< typename Morton >
+	typename HierarchyAppender< Morton >::Node* HierarchyAppender< Morton >::find( const Morton& morton ) const
+	{
+		Node* node = &m_root;
+		uint lvl = morton.getLevel();
+		ulong bits = morton.getBits();
+
+		for( uint childLvl = 1u; childLvl <= lvl; ++childLvl )
+		{
+			int childIdx = findChild( *node, bits >> ( 3 * ( lvl - childLvl ) ), childLvl );
+			if( childIdx == -1 )
+			{
+				return nullptr;
+			}
+			node = &node->child()[ childIdx ];
+		}
+
+		return node;
+	}
+}
+
+#endif
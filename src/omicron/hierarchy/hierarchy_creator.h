@@ -13,10 +13,14 @@
 // #include "SQLiteManager.h"
 #include "omicron/hierarchy/hierarchy_creation_log.h"
 #include "omicron/memory/global_malloc.h"
-#include "omicron/hierarchy/reconstruction_params.h"
+#include "omicron/hierarchy/reconstruction_config.h"
+#include "omicron/hierarchy/sibling_sampler.h"
 #include "omicron/disk/point_set.h"
 #include "omicron/disk/ply_point_reader.h"
+#include "omicron/disk/mmap_point_reader.h"
 #include "omicron/disk/sort_point_reader.h"
+#include "omicron/util/work_stealing_scheduler.h"
+#include "omicron/util/bounded_mpmc_queue.h"
 
 // #define LEAF_CREATION_DEBUG
 // #define INNER_CREATION_DEBUG
@@ -28,7 +32,6 @@ using namespace util;
 
 namespace omicron::hierarchy
 {
-	// TODO: If this algorithm is the best one, change MortonCode API to get rid of shared_ptr.
 	/** Multithreaded massive octree hierarchy creator. */
 	template< typename Morton >
 	class HierarchyCreator
@@ -49,6 +52,8 @@ namespace omicron::hierarchy
 		using NodeList = list< Node, ManagedAllocator< Node > >;
 		// List of NodeLists.
 		using WorkList = list< NodeList, ManagedAllocator< Node > >;
+		// Lock-free queue of NodeLists between the disk access thread and the leaf lvl processing.
+		using LeafWorkQueue = BoundedMpmcQueue< NodeList >;
 		// Array with lists that will be processed in a given creation loop iteration.
 		using IterArray = Array< NodeList >;
 		
@@ -56,24 +61,30 @@ namespace omicron::hierarchy
 		 * @param reader has the role to read the points for which the hierarchy will be created for.
 		 * @param expectedLoadPerThread is the size of the NodeList that will be passed to each thread in the
 		 * hierarchy creation loop iterations.
-		 * @param memoryLimit is the allowed soft limit of memory consumption by the creation algorithm. */
+		 * @param memoryLimit is the allowed soft limit of memory consumption by the creation algorithm.
+		 * @param config has the work splitting, sampling and surfel parameters. */
 		HierarchyCreator( 	ReaderPtr&& reader, const OctreeDim& dim,
 							#ifdef HIERARCHY_CREATION_RENDERING
 								Front& front,
 							#endif
-							ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads = 8 );
+							ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads = 8,
+							const ReconstructionConfig& config = ReconstructionConfig() );
 		
 		/** Ctor.
-		 * @param sortedPlyFilename is a sorted .ply point filename.
+		 * @param sortedPlyFilename is a sorted .ply point filename or a sorted binary point filename, which is read with
+		 * MmapPointReader.
 		 * @param dim is the OctreeDim of the octree to be constructed.
 		 * @param expectedLoadPerThread is the size of the NodeList that will be passed to each thread in the
 		 * hierarchy creation loop iterations.
-		 * @param memoryLimit is the allowed soft limit of memory consumption by the creation algorithm. */
+		 * @param memoryLimit is the allowed soft limit of memory consumption by the creation algorithm.
+		 * @param config has the work splitting, sampling and surfel parameters.
+		 * @throws runtime_error if a binary point file header has other morton lvl, origin or size than dim. */
 		HierarchyCreator( const string& sortedPlyFilename, const OctreeDim& dim,
 							#ifdef HIERARCHY_CREATION_RENDERING
 								Front& front,
 							#endif
-							ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads = 8 );
+							ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads = 8,
+							const ReconstructionConfig& config = ReconstructionConfig() );
 		
 		/** Creates the hierarchy asychronously.
 		 * @return a future that will contain the hierarchy's root node and the duration of the creation in ms when done.
@@ -84,15 +95,14 @@ namespace omicron::hierarchy
 		const Reader& reader() const { return *m_reader; }
 		
 	private:
-		/** Map type used to perform a prefix-sum in nodes of a sibling group. */
-		using SiblingPointsPrefixMap = map< int, Node&, less< int >, ManagedAllocator< pair< const int, Node& > > >;
-		/** Entry type of SiblingPointsPrefixMap. */
-		using SiblingPointsPrefixMapEntry = typename SiblingPointsPrefixMap::value_type;
+		/** Prefix-sum over the contents of the nodes of a sibling group, used to sample parent contents. */
+		using Sampler = SiblingSampler< Node >;
 		
 		/** Creates the hierarchy.
 		 * @return hierarchy's root node. The pointer ownership is caller's. */
 		Node* create();
 		
+		/** Pushes a NodeList to the leaf lvl work queue, waiting while it is full. */
 		void pushWork( NodeList&& workItem );
 		
 		NodeList popWork( const int lvl );
@@ -141,6 +151,25 @@ namespace omicron::hierarchy
 		void mergeOrPushWork( NodeList& previousProcessed, const int previousIdx, NodeList& nextProcessed,
 							  OctreeDim& nextLvlDim );
 		
+		/** Splits a NodeList into chunks with approximately the same load, without splitting sibling groups. The load of
+		 * a node is its number of points, since the cost to create a parent is proportional to the points sampled from
+		 * its children.
+		 * @param list is the NodeList to be split. It is empty after the call.
+		 * @param nSplits is the maximum number of chunks.
+		 * @param out_chunks is the WorkList which the chunks are appended to, in order. */
+		void splitWork( NodeList& list, const int nSplits, WorkList& out_chunks ) const;
+		
+		/** Processes a chunk of the current lvl, creating the parents of its sibling groups.
+		 * @param input is the chunk of the current lvl. It is consumed.
+		 * @param output is the NodeList which the created parents are appended to.
+		 * @param slot is the index of the chunk in the creation iteration, which is also the index of its front segment.
+		 * @param workerIdx is the index of the scheduler worker running the chunk. It selects the parent arena.
+		 * @param spareLastSiblingGroup indicates that the last sibling group should be sent back to the lvl WorkList,
+		 * since it may have remainings to be loaded in a later pass.
+		 * @param nextLvlDim has the dimensions of the octree for the level of the created parents. */
+		void processWork( NodeList& input, NodeList& output, const int slot, const int workerIdx,
+						  const bool spareLastSiblingGroup, const OctreeDim& nextLvlDim );
+		
 		/** Creates a node from its solo child node. */
 		Node createNodeFromSingleChild( Node&& child, bool isLeaf, const int threadIdx,
 										const bool setParentFlag ) /*const*/;
@@ -149,14 +178,22 @@ namespace omicron::hierarchy
 		Node createInnerNode( NodeArray&& inChildren, uint nChildren, const int threadIdx,
 							  const bool setParentFlag ) /*const*/;
 		
-		/** Creates a point sample with 1/8 of the points in the prefix-sum map. */
-		PointArray samplePoints( const SiblingPointsPrefixMap& prefixMap, const int nPoints ) const;
+		/** Creates a point sample with a parent points ratio fraction of the sibling points. The sample depends only on the
+		 * siblings and on the parent's morton code. */
+		PointArray samplePoints( const Sampler& sampler, const ulong parentMorton ) const;
 		
 		/** Calculates the multipliers for splat tangent vectors when constructing a parent node.
 		 * @param octreeDim is the interpolation parameter.
 		 * @returns a Vector2f, each coordinate being the multiplier for that dimension. */
 		Vector2f calcTangentMultipliers( const OctreeDim& octreeDim ) const;
 		
+		/** Creates one parent arena per worker and lvl. */
+		void initParentArenas();
+		
+		/** Checks that a binary point file was sorted with the octree dimensions of the creator.
+		 * @throws runtime_error otherwise. */
+		void checkHeader( const BinaryPointHeader& header, const string& filename ) const;
+		
 		/** Checks if all work is finished in all lvls. */
 		bool checkAllWorkFinished();
 		
@@ -179,9 +216,18 @@ namespace omicron::hierarchy
 		/** Thread[ i ] uses database connection m_dbs[ i ]. */
 		//Array< Sql > m_dbs;
 		
-		/** Worklists for every level in the hierarchy. m_lvlWorkLists[ i ] corresponds to lvl i. */
+		/** Worklists for every level in the hierarchy. m_lvlWorkLists[ i ] corresponds to lvl i. The leaf lvl uses
+		 * m_leafWorkQueue instead. */
 		Array< WorkList > m_lvlWorkLists;
 		
+		/** Work of the leaf lvl. It is shared by the disk access thread and the hierarchy creation threads. Its bound
+		 * gives backpressure to the disk access thread. */
+		LeafWorkQueue m_leafWorkQueue;
+		
+		/** Last leaf sibling group spared in a pass. It is the beginning of the next leaf NodeList popped by popWork().
+		 * Only the worker of the last chunk writes it, while the creation loop waits. */
+		NodeList m_sparedLeaves;
+		
 		/** Current lvl octree dimensions. */
 		OctreeDim m_octreeDim;
 		
@@ -191,8 +237,6 @@ namespace omicron::hierarchy
 		/** The point reader. */
 		ReaderPtr m_reader;
 		
-		mutex m_listMutex;
-		
 		ulong m_memoryLimit;
 		
 		ulong m_expectedLoadPerThread;
@@ -202,6 +246,12 @@ namespace omicron::hierarchy
 		#endif
 		
 		int m_nThreads;
+		
+		ReconstructionConfig m_config;
+		
+		/** Arenas for the parents created by each worker, indexed by workerIdx * number of lvls + lvl. Long-lived
+		 * arenas fill their pages across chunks, so pages are not kept alive by a few nodes of small chunks. */
+		vector< unique_ptr< LevelArena > > m_parentArenas;
 	};
 	
 	template< typename Morton >
@@ -210,21 +260,24 @@ namespace omicron::hierarchy
 						#ifdef HIERARCHY_CREATION_RENDERING
 							Front& front,
 						#endif
-						ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads )
+						ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads,
+						const ReconstructionConfig& config )
 	: m_reader( std::move( reader ) ),
 	m_lvlWorkLists( dim.m_nodeLvl + 1 ),
+	m_leafWorkQueue( config.m_leafWorkQueueSize ),
 	m_leafLvlDim( dim ),
 	m_nThreads( nThreads ),
 	m_expectedLoadPerThread( expectedLoadPerThread ),
 	//m_dbs( nThreads ),
-	m_memoryLimit( memoryLimit )
+	m_memoryLimit( memoryLimit ),
+	m_config( config )
 	
 	#ifdef HIERARCHY_CREATION_RENDERING
 		, m_front( front )
 	#endif
 	{
-		srand( 1 );
 		omp_set_num_threads( m_nThreads );
+		initParentArenas();
 	}
 	
 	template< typename Morton >
@@ -233,21 +286,49 @@ namespace omicron::hierarchy
 						#ifdef HIERARCHY_CREATION_RENDERING
 							Front& front,
 						#endif
-						ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads )
-	: m_reader( new PlyPointReader( sortedPlyFilename ) ), 
+						ulong expectedLoadPerThread, const ulong memoryLimit, int nThreads,
+						const ReconstructionConfig& config )
+	: m_reader( BinaryPointHeader::isBinaryPointFile( sortedPlyFilename )
+				? ReaderPtr( new MmapPointReader( sortedPlyFilename ) )
+				: ReaderPtr( new PlyPointReader( sortedPlyFilename ) ) ),
 	m_lvlWorkLists( dim.m_nodeLvl + 1 ),
+	m_leafWorkQueue( config.m_leafWorkQueueSize ),
 	m_leafLvlDim( dim ),
 	m_nThreads( nThreads ),
 	m_expectedLoadPerThread( expectedLoadPerThread ),
 	//m_dbs( nThreads ),
-	m_memoryLimit( memoryLimit )
+	m_memoryLimit( memoryLimit ),
+	m_config( config )
 	
 	#ifdef HIERARCHY_CREATION_RENDERING
 		, m_front( front )
 	#endif
 	{
-		srand( 1 );
+		if( const MmapPointReader* binaryReader = dynamic_cast< const MmapPointReader* >( m_reader.get() ) )
+		{
+			checkHeader( binaryReader->header(), sortedPlyFilename );
+		}
+		
 		omp_set_num_threads( m_nThreads );
+		initParentArenas();
+	}
+	
+	template< typename Morton >
+	void HierarchyCreator< Morton >::checkHeader( const BinaryPointHeader& header, const string& filename ) const
+	{
+		bool isSameDim = header.m_mortonLvl == m_leafLvlDim.m_nodeLvl;
+		for( int i = 0; i < 3; ++i )
+		{
+			isSameDim = isSameDim && header.m_origin[ i ] == m_leafLvlDim.m_origin[ i ]
+				&& header.m_size[ i ] == m_leafLvlDim.m_size[ i ];
+		}
+		
+		if( !isSameDim )
+		{
+			stringstream ss; ss << filename << ": binary point file sorted at lvl " << header.m_mortonLvl
+				<< ", but the hierarchy is created at lvl " << m_leafLvlDim.m_nodeLvl << " or with other boundaries.";
+			throw runtime_error( ss.str() );
+		}
 	}
 	
 	template< typename Morton >
@@ -298,66 +379,98 @@ namespace omicron::hierarchy
 				PointVector points;
 				
 				Morton currentParent;
-				m_reader->read(
-					[ & ]( const Point& p )
+				vector< Morton > batchParents;
+				
+				// All leaves are allocated from one arena, so its pages are filled across work items.
+				LevelArena leafArena( leafLvlDimCpy.m_nodeLvl, 0ul );
+				
+				// Creates the leaf node with the points accumulated so far.
+				auto createLeaf =
+					[ & ]()
 					{
-// 						Point p( point );
-// 						
-// 						// A shift in z direction in order to avoid points lying in z = 0 plane. Necessary because
-// 						// of later projection operations, performed in homogeneous coordinates. 
-// 						p.getPos() += Vec3( 0.f, 0.f, 1.f );
+						#ifdef LEAF_CREATION_DEBUG
+						{
+							stringstream ss; ss << "Creating node "
+								<< leafLvlDimCpy.calcMorton( points[ 0 ] ).getPathToRoot() << endl << endl;
+							HierarchyCreationLog::logDebugMsg( ss.str() );
+						}
+						#endif
 						
-						Morton code = leafLvlDimCpy.calcMorton( p );
-						Morton parent = *code.traverseUp();
+						// The points are copied to contents allocated in the arena and cleared, so their buffer is reused
+						// by the next leaf.
+						{
+							ArenaScope scope( leafArena );
+							nodeList.push_back( Node( std::move( points ), true ) );
+						}
 						
-						if( parent != currentParent )
+						if( nodeList.size() == m_expectedLoadPerThread )
 						{
-							if( points.size() > 0 )
+							pushWork( std::move( nodeList ) );
+							nodeList = NodeList();
+							
+							bool isReleasingCpy;
+							{
+								lock_guard< mutex > lock( releaseMutex );
+								isReleasingCpy = isReleasing;
+							}
+							
+							if( isReleasingCpy )
 							{
-								#ifdef LEAF_CREATION_DEBUG
 								{
-									stringstream ss; ss << "Creating node "
-										<< leafLvlDimCpy.calcMorton( points[ 0 ] ).getPathToRoot() << endl << endl;
-									HierarchyCreationLog::logDebugMsg( ss.str() );
+									lock_guard< mutex > lock( diskThreadMutex );
+									isDiskThreadStopped = true;
 								}
-								#endif
-								
-								
-								nodeList.push_back( Node( std::move( points ), true ) );
-								
-								points = PointVector();
-								
-								if( nodeList.size() == m_expectedLoadPerThread )
-								{
-									pushWork( std::move( nodeList ) );
-									nodeList = NodeList();
-									
-									bool isReleasingCpy;
-									{
-										lock_guard< mutex > lock( releaseMutex );
-										isReleasingCpy = isReleasing;
-									}
-									
-									if( isReleasingCpy )
-									{
-										{
-											lock_guard< mutex > lock( diskThreadMutex );
-											isDiskThreadStopped = true;
-										}
+					
+								unique_lock< mutex > lock( releaseMutex );
+								releaseFlag.wait( lock, [ & ] { return !isReleasing; } );
+							}
+						}
+					};
+				
+				m_reader->readBatches(
+					[ & ]( const PointBatch& batch )
+					{
+						// Morton codes of the entire batch are computed first, so the leaves can be built from runs of
+						// points with the same parent.
+						batchParents.resize( batch.size() );
+						for( ulong i = 0; i < batch.size(); ++i )
+						{
+							batchParents[ i ] = leafLvlDimCpy.calcMorton( batch[ i ] ).parent();
+						}
+						
+						ulong runBegin = 0;
+						while( runBegin < batch.size() )
+						{
+							const Morton& parent = batchParents[ runBegin ];
+							ulong runEnd = runBegin + 1;
+							while( runEnd < batch.size() && batchParents[ runEnd ] == parent )
+							{
+								++runEnd;
+							}
 							
-										unique_lock< mutex > lock( releaseMutex );
-										releaseFlag.wait( lock, [ & ] { return !isReleasing; } );
-									}
+							if( parent != currentParent )
+							{
+								if( points.size() > 0 )
+								{
+									createLeaf();
 								}
+								currentParent = parent;
 							}
-							currentParent = parent;
+							
+							for( ulong i = runBegin; i < runEnd; ++i )
+							{
+								points.push_back( Surfel( batch[ i ], m_config.m_leafSurfelTangentSize ) );
+							}
+							
+							runBegin = runEnd;
 						}
-						
-						points.push_back( Surfel( p ) );
 					}
 				);
 				
-				nodeList.push_back( Node( std::move( points ), true ) );
+				{
+					ArenaScope scope( leafArena );
+					nodeList.push_back( Node( std::move( points ), true ) );
+				}
 				pushWork( std::move( nodeList ) );
 				
 				leafLvlLoaded = true;
@@ -411,7 +524,8 @@ namespace omicron::hierarchy
 					// Multipass restriction: the level's last sibling group cannot be processed until the last pass,
 					// since nodes loaded after or in the middle of current pass can have remainings of that sibling group.
 					// In the leaf lvl, the entire last NodeList is spared to avoid order issues generated by concurrent
-					// work loading by the disk access thread.
+					// work loading by the disk access thread. A full leaf queue is handled as a stopped disk access thread,
+					// since the thread waits for queue space, which only this loop can free.
 					int dispatchedThreads;
 					if( workListSize > m_nThreads )
 					{
@@ -424,7 +538,9 @@ namespace omicron::hierarchy
 							lock_guard< mutex > lock( diskThreadMutex );
 							isDiskThreadStoppedCpy = isDiskThreadStopped;
 						}
-						if( lvl != m_leafLvlDim.m_nodeLvl || isLastPass || isDiskThreadStoppedCpy )
+						bool isLeafQueueFull = lvl == m_leafLvlDim.m_nodeLvl
+							&& m_leafWorkQueue.size() >= m_leafWorkQueue.capacity();
+						if( lvl != m_leafLvlDim.m_nodeLvl || isLastPass || isDiskThreadStoppedCpy || isLeafQueueFull )
 						{
 							dispatchedThreads = workListSize;
 							increaseLvlFlag = true;
@@ -436,203 +552,157 @@ namespace omicron::hierarchy
 						}
 					}
 					
-					int lastThreadIdx = dispatchedThreads - 1;
-					IterArray iterInput( dispatchedThreads );
-					
+					// Each dispatched list is split into chunks with whole sibling groups. Every chunk is a task with its own
+					// output and front segment, so the per-level ordering is kept, and idle workers can steal chunks from
+					// overloaded ones.
+					WorkList chunkList;
+					vector< int > chunkOwners;
 					for( int i = 0; i < dispatchedThreads; ++i )
 					{
-						iterInput[ i ] = popWork( lvl );
+						NodeList input = popWork( lvl );
+						splitWork( input, m_config.m_workListSplits, chunkList );
+						chunkOwners.resize( chunkList.size(), i );
+					}
+					
+					int nChunks = chunkList.size();
+					int lastChunkIdx = nChunks - 1;
+					IterArray iterInput( nChunks );
+					for( int i = 0; i < nChunks; ++i )
+					{
+						iterInput[ i ] = std::move( chunkList.front() );
+						chunkList.pop_front();
 					}
 					
-					IterArray iterOutput( dispatchedThreads );
+					IterArray iterOutput( nChunks );
 					
-					// BEGIN PARALLEL WORKLIST PROCESSING.
-					#pragma omp parallel for
-					for( int i = 0; i < dispatchedThreads; ++i )
+					#ifdef HIERARCHY_CREATION_RENDERING
+						m_front.reserveInsertionSlots( nChunks );
+					#endif
+					
+					bool spareLastSiblingGroup = workListSize - dispatchedThreads == 0 && !isLastPass;
+					WorkList& nextLvlWorkList = m_lvlWorkLists[ lvl - 1 ];
+					
+					// Merge frontier. Outputs are merged in order as soon as all chunks before them are done, by the worker
+					// that finishes the chunk which advances the frontier. Only the frontier is serialized.
+					mutex mergeMutex;
+					vector< bool > isChunkDone( nChunks, false );
+					int mergeCursor = 0;
+					
+					auto mergeStep = [ & ]( const int chunkIdx )
 					{
-						int threadIdx = omp_get_thread_num();
-						NodeList& input = iterInput[ threadIdx ];
-						NodeList& output = iterOutput[ threadIdx ];
-						bool isBoundarySiblingGroup = true;
-						
-						while( !input.empty() )
+						if( chunkIdx == 0 )
 						{
-							Node& node = input.front();
-							Morton parentCode = *m_octreeDim.calcMorton( node ).traverseUp();
-							
-							NodeArray siblings( 8 );
-							siblings[ 0 ] = std::move( node );
-							input.pop_front();
-							int nSiblings = 1;
-							
-							while( !input.empty() && *m_octreeDim.calcMorton( input.front() ).traverseUp() == parentCode )
-							{
-								siblings[ nSiblings ] = std::move( input.front() );
-								++nSiblings;
-								input.pop_front();
-							}
-							
-							#ifdef NODE_PROCESSING_DEBUG
+							if( !iterOutput[ 0 ].empty() )
 							{
-								stringstream ss;
-								for( int i = 0; i < nSiblings; ++i )
+								if( !nextLvlWorkList.empty() )
 								{
-									ss << "[ t" << omp_get_thread_num() << " ] processing: "
-										<< m_octreeDim.calcMorton( siblings[ i ] ).getPathToRoot() << endl << endl;
-								}
-								
-								HierarchyCreationLog::logDebugMsg( ss.str() );
-							}
-							#endif
-							
-							bool isLastSiblingGroup = input.empty();
-							
-							if( workListSize - dispatchedThreads == 0 && !isLastPass && threadIdx == lastThreadIdx
-								&& isLastSiblingGroup )
-							{
-								// Send this last sibling group to the lvl WorkList again.
-								NodeList lastSiblingsList;
-								for( int j = 0; j < nSiblings; ++j )
-								{
-									lastSiblingsList.push_back( std::move( siblings[ j ] ) );
-								}
-								m_lvlWorkLists[ lvl ].push_back( std::move( lastSiblingsList ) );
-							}
-							else
-							{
-								if( isLastSiblingGroup )
-								{
-									isBoundarySiblingGroup = true;
-								}
-								
-								if( nSiblings == 1 && siblings[ 0 ].isLeaf() && !isBoundarySiblingGroup )
-								{
-									#ifdef INNER_CREATION_DEBUG
+									#ifdef NODE_LIST_MERGE_DEBUG
 									{
-										stringstream ss; ss << "[ t" << omp_get_thread_num()
-											<< " ] creating collapsed inner " << ( ( isBoundarySiblingGroup ) ? "boundary:"
-											: "not boundary:" )
-											<< nextLvlDim.calcMorton( siblings[ 0 ] ).getPathToRoot() << endl << endl;
-										HierarchyCreationLog::logDebugMsg( ss.str() );
+										HierarchyCreationLog::logDebugMsg( "Merging previous work list with chunk 0 ouput\n\n" );
 									}
 									#endif
 									
-									#ifdef NODE_COLAPSE
-										bool newNodeIsLeafFlag = ( lvl == m_leafLvlDim.level() ) ? true : false;
-									#else
-										bool newNodeIsLeafFlag = false;
-									#endif
+									NodeList nextLvlBack = std::move( nextLvlWorkList.back() );
+									nextLvlWorkList.pop_back();
 									
-									output.push_back(
-										createNodeFromSingleChild( std::move( siblings[ 0 ] ), newNodeIsLeafFlag,
-																   threadIdx, !isBoundarySiblingGroup )
-									);
+									mergeOrPushWork( nextLvlBack, -1, iterOutput[ 0 ], nextLvlDim );
 								}
-								else
+								else if( iterOutput[ 0 ].size() > 1 )
 								{
-									#ifdef INNER_CREATION_DEBUG
+									#ifdef NODE_LIST_MERGE_DEBUG
 									{
-										stringstream ss; ss << "[ t" << omp_get_thread_num()
-											<< " ] creating LoD inner " << ( ( isBoundarySiblingGroup ) ? "boundary:"
-											: "not boundary:" )
-											<< nextLvlDim.calcMorton( siblings[ 0 ] ).getPathToRoot() << endl << endl;
-										HierarchyCreationLog::logDebugMsg( ss.str() );
+										HierarchyCreationLog::logDebugMsg( "Setting parent of first node in chunk 0 ouput\n\n" );
 									}
 									#endif
 									
-									// LOD
-									Node inner = createInnerNode( std::move( siblings ), nSiblings,
-																  threadIdx, !isBoundarySiblingGroup );
+									// Setup the parent for the first node in chunk[ 0 ] output. This is
+									// necessary because it won't be merged with a previous workList.
+									Node& firstNode = iterOutput[ 0 ].front();
 									
-									output.push_back( std::move( inner ) );
-									isBoundarySiblingGroup = false;
+									#ifdef HIERARCHY_CREATION_RENDERING
+										auto iter = m_front.getIteratorToBufferBegin( 0 );
+									#endif
+									for( Node& child : firstNode.child() )
+									{
+										setParent( child, 0
+											#ifdef HIERARCHY_CREATION_RENDERING
+												, iter
+											#endif
+										);
+									}
 								}
 							}
 						}
-					}
-					// END PARALLEL WORKLIST PROCESSING.
-					
-					WorkList& nextLvlWorkList = m_lvlWorkLists[ lvl - 1 ];
-					
-					if( !iterOutput.empty() && !iterOutput[ 0 ].empty() )
-					{
-						if( !nextLvlWorkList.empty() )
+						else
 						{
 							#ifdef NODE_LIST_MERGE_DEBUG
 							{
-								HierarchyCreationLog::logDebugMsg( "Merging previous work list with t 0 ouput\n\n" );
+								stringstream ss; ss << "Merging chunk " << chunkIdx - 1 << " with chunk " << chunkIdx
+									<< endl << endl;
+								HierarchyCreationLog::logDebugMsg( ss.str() );
 							}
 							#endif
 							
-							NodeList nextLvlBack = std::move( nextLvlWorkList.back() );
-							nextLvlWorkList.pop_back();
-							
-							mergeOrPushWork( nextLvlBack, -1, iterOutput[ 0 ], nextLvlDim );
+							mergeOrPushWork( iterOutput[ chunkIdx - 1 ], chunkIdx - 1, iterOutput[ chunkIdx ], nextLvlDim );
 						}
-						else if( iterOutput[ 0 ].size() > 1 )
-						{
-							#ifdef NODE_LIST_MERGE_DEBUG
-							{
-								HierarchyCreationLog::logDebugMsg( "Setting parent of first node in t 0 ouput\n\n" );
-							}
-							#endif
-							
-							// Setup the parent for the first node in thread[ 0 ] output. This is
-							// necessary because it won't be merged with a previous workList.
-							Node& firstNode = iterOutput[ 0 ].front();
-							
-							#ifdef HIERARCHY_CREATION_RENDERING
-								auto iter = m_front.getIteratorToBufferBegin( 0 );
-							#endif
-							for( Node& child : firstNode.child() )
+					};
+					
+					// BEGIN PARALLEL WORKLIST PROCESSING.
+					WorkStealingScheduler scheduler( m_nThreads );
+					
+					// Chunks are pushed in reverse order, so owners process their chunks in order, advancing the merge
+					// frontier, and thieves steal the chunks that would be processed last.
+					for( int i = lastChunkIdx; i > -1; --i )
+					{
+						scheduler.push( chunkOwners[ i ],
+							[ &, i ]( int workerIdx )
 							{
-								setParent( child, 0
-									#ifdef HIERARCHY_CREATION_RENDERING
-										, iter
-									#endif
-								);
+								processWork( iterInput[ i ], iterOutput[ i ], i, workerIdx,
+											 spareLastSiblingGroup && i == lastChunkIdx, nextLvlDim );
+								
+								lock_guard< mutex > lock( mergeMutex );
+								isChunkDone[ i ] = true;
+								
+								while( mergeCursor < nChunks && isChunkDone[ mergeCursor ] )
+								{
+									mergeStep( mergeCursor++ );
+								}
 							}
-						}
+						);
 					}
 					
-					for( int i = 0; i < lastThreadIdx; ++i )
-					{
-						#ifdef NODE_LIST_MERGE_DEBUG
-						{
-							stringstream ss; ss << "Merging t " << i << " with t " << i + 1 << endl << endl;
-							HierarchyCreationLog::logDebugMsg( ss.str() );
-						}
-						#endif
-						
-						mergeOrPushWork( iterOutput[ i ], i, iterOutput[ i + 1 ], nextLvlDim );
-					}
+					// run() is still a barrier per iteration. Parent sibling groups are not tasks depending on their children,
+					// since the next iteration's first chunk is merged with this iteration's last output, which fixes the
+					// order of the next level's work list.
+					scheduler.run();
+					// END PARALLEL WORKLIST PROCESSING.
 					
-					// The last thread's NodeList is not collapsed, since the last node can be in a sibling group not
+					// The last chunk's NodeList is not collapsed, since the last node can be in a sibling group not
 					// entirely processed in this iteration.
-					if( !iterOutput.empty() && !iterOutput[ lastThreadIdx ].empty() )
+					if( !iterOutput.empty() && !iterOutput[ lastChunkIdx ].empty() )
 					{
 						if( !nextLvlWorkList.empty() )
 						{
-							removeBoundaryDuplicate( nextLvlWorkList.back(), lastThreadIdx, iterOutput[ lastThreadIdx ],
+							removeBoundaryDuplicate( nextLvlWorkList.back(), lastChunkIdx, iterOutput[ lastChunkIdx ],
 													 nextLvlDim );
 						}
-						nextLvlWorkList.push_back( std::move( iterOutput[ lastThreadIdx ] ) );
+						nextLvlWorkList.push_back( std::move( iterOutput[ lastChunkIdx ] ) );
 					}
 					
 					#ifdef HIERARCHY_CREATION_RENDERING
-						m_front.notifyInsertionEnd( dispatchedThreads );
+						m_front.notifyInsertionEnd( nChunks );
 					#endif
 					// END LOAD BALANCE.
 					
 					// BEGIN NODE RELEASE MANAGEMENT.
 					if( isReleasing )
 					{
-						if( AllocStatistics::totalAllocated() < m_memoryLimit )
+						if( AllocStatistics::approxTotalAllocated() < m_memoryLimit )
 						{
 							turnReleaseOff( releaseMutex, isReleasing, releaseFlag, diskThreadMutex, isDiskThreadStopped );
 						}
 					}
-					else if( AllocStatistics::totalAllocated() > m_memoryLimit )
+					else if( AllocStatistics::approxTotalAllocated() > m_memoryLimit )
 					{
 						turnReleaseOn( releaseMutex, isReleasing );
 					}
@@ -720,9 +790,7 @@ namespace omicron::hierarchy
 	template< typename Morton >
 	inline void HierarchyCreator< Morton >::pushWork( NodeList&& workItem )
 	{
-		lock_guard< mutex > lock( m_listMutex );
-		
-		m_lvlWorkLists[ m_leafLvlDim.m_nodeLvl ].push_back( std::move( workItem ) );
+		m_leafWorkQueue.push( std::move( workItem ) );
 	}
 	
 	template< typename Morton >
@@ -731,9 +799,14 @@ namespace omicron::hierarchy
 	{
 		if( lvl == m_leafLvlDim.m_nodeLvl )
 		{
-			lock_guard< mutex > lock( m_listMutex );
-			NodeList nodeList = std::move( m_lvlWorkLists[ lvl ].front() );
-			m_lvlWorkLists[ lvl ].pop_front();
+			// The spared leaf sibling group precedes all leaves in the queue.
+			NodeList nodeList;
+			if( m_sparedLeaves.empty() || !m_leafWorkQueue.empty() )
+			{
+				nodeList = m_leafWorkQueue.pop();
+			}
+			nodeList.splice( nodeList.begin(), m_sparedLeaves );
+			
 			return nodeList;
 		}
 		else
@@ -749,9 +822,8 @@ namespace omicron::hierarchy
 	{
 		if( lvl == m_leafLvlDim.m_nodeLvl )
 		{
-			// This lock is need so m_workList.size() access is not optimized, returning outdated results.
-			lock_guard< mutex > lock( m_listMutex );
-			return m_lvlWorkLists[ lvl ].size();
+			size_t queueSize = m_leafWorkQueue.size();
+			return ( m_sparedLeaves.empty() ) ? queueSize : std::max( queueSize, size_t( 1 ) );
 		}
 		else
 		{
@@ -878,8 +950,7 @@ namespace omicron::hierarchy
 			{
 				// Nodes from same sibling groups were in different threads
 				
-				int nPoints = 0;
-				SiblingPointsPrefixMap prefixMap;
+				Sampler sampler;
 				NodeArray mergedChild( prevLastNodeChild.size() + nextFirstNodeChild.size() );
 				
 				for( int i = 0; i < prevLastNodeChild.size(); ++i )
@@ -887,8 +958,7 @@ namespace omicron::hierarchy
 					mergedChild[ i ] = std::move( prevLastNodeChild[ i ] );
 					Node& child = mergedChild[ i ];
 					
-					prefixMap.insert( prefixMap.end(), SiblingPointsPrefixMapEntry( nPoints, child ) );
-					nPoints += child.getContents().size();
+					sampler.push( child );
 					
 					if( previousIdx == -1 )
 					{
@@ -911,8 +981,7 @@ namespace omicron::hierarchy
 					
 					Node& child = mergedChild[ idx ];
 					
-					prefixMap.insert( prefixMap.end(), SiblingPointsPrefixMapEntry( nPoints, child ) );
-					nPoints += child.getContents().size();
+					sampler.push( child );
 					
 					if( previousIdx == -1 )
 					{
@@ -928,7 +997,7 @@ namespace omicron::hierarchy
 					}
 				}
 				
-				PointArray selectedPoints = samplePoints( prefixMap, nPoints );
+				PointArray selectedPoints = samplePoints( sampler, nextLvlDim.calcMorton( nextFirstNode ).getBits() );
 				nextFirstNode.setContents( std::move( selectedPoints ) );
 				nextFirstNode.setChildren( std::move( mergedChild ) );
 				
@@ -1009,10 +1078,179 @@ namespace omicron::hierarchy
 		}
 	}
 	
+	template< typename Morton >
+	inline void HierarchyCreator< Morton >::splitWork( NodeList& list, const int nSplits, WorkList& out_chunks ) const
+	{
+		size_t totalLoad = 0;
+		for( const Node& node : list )
+		{
+			totalLoad += node.getContents().size();
+		}
+		size_t chunkLoad = ( totalLoad + nSplits - 1 ) / nSplits;
+		
+		while( !list.empty() )
+		{
+			auto it = list.begin();
+			size_t load = 0;
+			do
+			{
+				load += it->getContents().size();
+				++it;
+			}
+			while( it != list.end() && load < chunkLoad );
+			
+			// Advance the cut to the next sibling group boundary.
+			if( it != list.end() )
+			{
+				Morton parentCode = m_octreeDim.calcMorton( *std::prev( it ) ).parent();
+				while( it != list.end() && m_octreeDim.calcMorton( *it ).parent() == parentCode )
+				{
+					++it;
+				}
+			}
+			
+			NodeList chunk;
+			chunk.splice( chunk.end(), list, list.begin(), it );
+			out_chunks.push_back( std::move( chunk ) );
+		}
+	}
+	
+	template< typename Morton >
+	void HierarchyCreator< Morton >::processWork( NodeList& input, NodeList& output, const int slot,
+												  const int workerIdx, const bool spareLastSiblingGroup,
+												  const OctreeDim& nextLvlDim )
+	{
+		int lvl = m_octreeDim.m_nodeLvl;
+		bool isBoundarySiblingGroup = true;
+		
+		// Parents are allocated from the worker's arena of their lvl, which is kept across chunks and iterations.
+		LevelArena& arena = *m_parentArenas[ workerIdx * m_lvlWorkLists.size() + lvl - 1 ];
+		
+		while( !input.empty() )
+		{
+			Node& node = input.front();
+			Morton parentCode = m_octreeDim.calcMorton( node ).parent();
+			
+			NodeArray siblings( 8 );
+			siblings[ 0 ] = std::move( node );
+			input.pop_front();
+			int nSiblings = 1;
+			
+			while( !input.empty() && m_octreeDim.calcMorton( input.front() ).parent() == parentCode )
+			{
+				siblings[ nSiblings ] = std::move( input.front() );
+				++nSiblings;
+				input.pop_front();
+			}
+			
+			#ifdef NODE_PROCESSING_DEBUG
+			{
+				stringstream ss;
+				for( int i = 0; i < nSiblings; ++i )
+				{
+					ss << "[ t" << omp_get_thread_num() << " ] processing: "
+						<< m_octreeDim.calcMorton( siblings[ i ] ).getPathToRoot() << endl << endl;
+				}
+				
+				HierarchyCreationLog::logDebugMsg( ss.str() );
+			}
+			#endif
+			
+			bool isLastSiblingGroup = input.empty();
+			
+			if( spareLastSiblingGroup && isLastSiblingGroup )
+			{
+				// Send this last sibling group to the lvl WorkList again.
+				NodeList lastSiblingsList;
+				for( int j = 0; j < nSiblings; ++j )
+				{
+					lastSiblingsList.push_back( std::move( siblings[ j ] ) );
+				}
+				if( lvl == m_leafLvlDim.m_nodeLvl )
+				{
+					// Kept apart instead of pushed to the leaf queue, so the worker never waits for queue space and the
+					// group stays before the leaves loaded meanwhile.
+					m_sparedLeaves = std::move( lastSiblingsList );
+				}
+				else
+				{
+					m_lvlWorkLists[ lvl ].push_back( std::move( lastSiblingsList ) );
+				}
+			}
+			else
+			{
+				ArenaScope scope( arena );
+				
+				if( isLastSiblingGroup )
+				{
+					isBoundarySiblingGroup = true;
+				}
+				
+				if( nSiblings == 1 && siblings[ 0 ].isLeaf() && !isBoundarySiblingGroup )
+				{
+					#ifdef INNER_CREATION_DEBUG
+					{
+						stringstream ss; ss << "[ t" << omp_get_thread_num()
+							<< " ] creating collapsed inner " << ( ( isBoundarySiblingGroup ) ? "boundary:"
+							: "not boundary:" )
+							<< nextLvlDim.calcMorton( siblings[ 0 ] ).getPathToRoot() << endl << endl;
+						HierarchyCreationLog::logDebugMsg( ss.str() );
+					}
+					#endif
+					
+					#ifdef NODE_COLAPSE
+						bool newNodeIsLeafFlag = ( lvl == m_leafLvlDim.level() ) ? true : false;
+					#else
+						bool newNodeIsLeafFlag = false;
+					#endif
+					
+					output.push_back(
+						createNodeFromSingleChild( std::move( siblings[ 0 ] ), newNodeIsLeafFlag,
+												   slot, !isBoundarySiblingGroup )
+					);
+				}
+				else
+				{
+					#ifdef INNER_CREATION_DEBUG
+					{
+						stringstream ss; ss << "[ t" << omp_get_thread_num()
+							<< " ] creating LoD inner " << ( ( isBoundarySiblingGroup ) ? "boundary:"
+							: "not boundary:" )
+							<< nextLvlDim.calcMorton( siblings[ 0 ] ).getPathToRoot() << endl << endl;
+						HierarchyCreationLog::logDebugMsg( ss.str() );
+					}
+					#endif
+					
+					// LOD
+					Node inner = createInnerNode( std::move( siblings ), nSiblings,
+												  slot, !isBoundarySiblingGroup );
+					
+					output.push_back( std::move( inner ) );
+					isBoundarySiblingGroup = false;
+				}
+			}
+		}
+	}
+	
+	template< typename Morton >
+	inline void HierarchyCreator< Morton >::initParentArenas()
+	{
+		for( int workerIdx = 0; workerIdx < m_nThreads; ++workerIdx )
+		{
+			for( uint lvl = 0u; lvl < m_lvlWorkLists.size(); ++lvl )
+			{
+				m_parentArenas.push_back( unique_ptr< LevelArena >( new LevelArena( lvl, workerIdx ) ) );
+			}
+		}
+	}
+	
 	template< typename Morton >
 	inline bool HierarchyCreator< Morton >::checkAllWorkFinished()
 	{
-		lock_guard< mutex > lock( m_listMutex );
+		if( !m_leafWorkQueue.empty() || !m_sparedLeaves.empty() )
+		{
+			return false;
+		}
 		
 		for( int i = 1; i < m_lvlWorkLists.size(); ++i )
 		{
@@ -1065,22 +1303,9 @@ namespace omicron::hierarchy
 			#endif
 		}
 		
-		const PointArray& childPoints = child.getContents();
-		
-		int numSamplePoints = std::max( 1.f, childPoints.size() * PARENT_POINTS_RATIO_VALUE );
-		PointArray selectedPoints( numSamplePoints );
-		
-		Vector2f tangentMultipliers = calcTangentMultipliers( m_octreeDim );
-		
-		for( int i = 0; i < numSamplePoints; ++i )
-		{
-			int choosenIdx = rand() % childPoints.size();
-			Surfel s = childPoints[ choosenIdx ];
-			
-			s.u *= tangentMultipliers.x();
-			s.v *= tangentMultipliers.y();
-			selectedPoints[ i ] = s;
-		}
+		Sampler sampler;
+		sampler.push( child );
+		PointArray selectedPoints = samplePoints( sampler, childMorton.parent().getBits() );
 		
 		Node node( std::move( selectedPoints ), isLeaf );
 		if( !isLeaf )
@@ -1114,8 +1339,7 @@ namespace omicron::hierarchy
 			// Verify if placeholders are necessary.
 			bool frontPlaceholdersOn = ( m_octreeDim.calcMorton( inChildren[ 0 ] ).getLevel() == m_leafLvlDim.m_nodeLvl );
 			
-			int nPoints = 0;
-			SiblingPointsPrefixMap prefixMap;
+			Sampler sampler;
 			for( int i = 0; i < children.size(); ++i )
 			{
 				children[ i ] = std::move( inChildren[ i ] );
@@ -1129,8 +1353,7 @@ namespace omicron::hierarchy
 				
 				Node& child = children[ i ];
 				
-				prefixMap.insert( prefixMap.end(), SiblingPointsPrefixMapEntry( nPoints, child ) );
-				nPoints += child.getContents().size();
+				sampler.push( child );
 				
 				// Set parental relationship of children.
 				if( setParentFlag && !child.isLeaf() )
@@ -1139,7 +1362,7 @@ namespace omicron::hierarchy
 				}
 			}
 			
-			PointArray selectedPoints = samplePoints( prefixMap, nPoints );
+			PointArray selectedPoints = samplePoints( sampler, m_octreeDim.calcMorton( children[ 0 ] ).parent().getBits() );
 			
 			Node node( std::move( selectedPoints ), false );
 			node.setChildren( std::move( children ) );
@@ -1150,30 +1373,16 @@ namespace omicron::hierarchy
 	
 	template< typename Morton >
 	inline typename HierarchyCreator< Morton >::PointArray HierarchyCreator< Morton >
-	::samplePoints( const SiblingPointsPrefixMap& prefixMap, const int nPoints ) const
+	::samplePoints( const Sampler& sampler, const ulong parentMorton ) const
 	{
-		int numSamplePoints = std::max( 1.f, nPoints * PARENT_POINTS_RATIO_VALUE );
-		PointArray selectedPoints( numSamplePoints );
-		
-		Vector2f tangentMultipliers = calcTangentMultipliers( m_octreeDim );
-		
-		for( int i = 0; i < numSamplePoints; ++i )
-		{
-			int choosenIdx = rand() % nPoints;
-			SiblingPointsPrefixMapEntry choosenEntry = *( --prefixMap.upper_bound( choosenIdx ) );
-			
-			Surfel s = choosenEntry.second.getContents()[ choosenIdx - choosenEntry.first ];
-			s.multiplyTangents( tangentMultipliers );
-			selectedPoints[ i ] = s;
-		}
-		
-		return selectedPoints;
+		int numSamplePoints = std::max( 1.f, sampler.nPoints() * m_config.m_parentPointsRatio );
+		return sampler.sample( parentMorton, numSamplePoints, calcTangentMultipliers( m_octreeDim ) );
 	}
 	
 	template< typename Morton >
 	inline Vector2f HierarchyCreator< Morton >::calcTangentMultipliers( const OctreeDim& octreeDim ) const
 	{
-		return ReconstructionParams::calcMultipliers( octreeDim.level() );
+		return m_config.tangentMultipliers( octreeDim.level() );
 	}
 	
 	template< typename Morton >
@@ -15,7 +15,8 @@ namespace omicron::hierarchy
 	/** Asynchronous-threading-aware loader and unloader for point meshes in the GPU. Requests are handled in iterations
 	 * in order to minimize locking overhead. In each iteration, user threads can concurrently request load and unload
 	 * operations. After all requests are issued, onIterationEnd() must be called in order to flush them to internal
-	 * datastructures. */
+	 * datastructures. If there is no loader thread, as in headless usage, requests are dropped and GPU memory queries fall
+	 * back to GpuAllocStatistics. */
 	template< typename Point, typename Alloc = TbbAllocator< Point > >
 	class NodeLoader
 	{
@@ -29,6 +30,7 @@ namespace omicron::hierarchy
 		using SiblingsList = typename NodeLoaderThread::SiblingsList;
 		using SiblingsListArray = typename NodeLoaderThread::SiblingsListArray;
 		
+		/** @param loaderThread is the thread that owns the loading OpenGL context. Can be nullptr. */
 		NodeLoader( NodeLoaderThread* loaderThread, const uint nUserThreads );
 		
 		~NodeLoader();
@@ -74,13 +76,16 @@ namespace omicron::hierarchy
 	template< typename Point, typename Alloc >
 	NodeLoader< Point, Alloc >::~NodeLoader()
 	{
-		m_loaderThread->wait();
+		if( m_loaderThread )
+		{
+			m_loaderThread->wait();
+		}
 	}
 	
 	template< typename Point, typename Alloc >
 	inline void NodeLoader< Point, Alloc >::asyncLoad( Node& node, const uint threadIdx )
 	{
-		if( m_loaderThread->hasMemoryFor( node.getContents() ) && !node.isLoaded() )
+		if( m_loaderThread && m_loaderThread->hasMemoryFor( node.getContents() ) && !node.isLoaded() )
 		{
 			node.loadInGpu();
 			m_iterLoad[ threadIdx ].push_back( &node );
@@ -125,31 +130,34 @@ namespace omicron::hierarchy
 			release.splice( release.end(), list );
 		}
 		
-		m_loaderThread->pushRequests( load, unload, release );
+		if( m_loaderThread )
+		{
+			m_loaderThread->pushRequests( load, unload, release );
+		}
 	}
 	
 	template< typename Point, typename Alloc >
 	inline bool NodeLoader< Point, Alloc >::reachedGpuMemQuota()
 	{
-		return m_loaderThread->reachedGpuMemQuota();
+		return ( m_loaderThread ) ? m_loaderThread->reachedGpuMemQuota() : GpuAllocStatistics::reachedGpuMemQuota();
 	}
 	
 	template< typename Point, typename Alloc >
 	inline ulong NodeLoader< Point, Alloc >::memoryUsage()
 	{
-		return m_loaderThread->memoryUsage();
+		return ( m_loaderThread ) ? m_loaderThread->memoryUsage() : GpuAllocStatistics::totalAllocated();
 	}
 	
 	template< typename Point, typename Alloc >
 	inline bool NodeLoader< Point, Alloc >::isReleasing()
 	{
-		return m_loaderThread->isReleasing();
+		return m_loaderThread && m_loaderThread->isReleasing();
 	}
 	
 	template< typename Point, typename Alloc >
 	inline const QGLWidget* NodeLoader< Point, Alloc >::widget()
 	{
-		return m_loaderThread->widget();
+		return ( m_loaderThread ) ? m_loaderThread->widget() : nullptr;
 	}
 }
 
@@ -8,10 +8,24 @@
 #include "omicron/hierarchy/hierarchy_creation_log.h"
 #include "omicron/util/stack_trace.h"
 #include "omicron/memory/global_malloc.h"
+#include "omicron/memory/level_arena.h"
 
 // #define CTOR_DEBUG
 // #define LOADING_DEBUG
 
+namespace omicron::hierarchy
+{
+	template< typename Contents, typename ContentsAlloc >
+	class O1OctreeNode;
+}
+
+namespace omicron::memory
+{
+	/** Sibling groups are allocated from the level arenas of hierarchy creation. */
+	template< typename Contents, typename ContentsAlloc >
+	struct IsArenaAllocated< hierarchy::O1OctreeNode< Contents, ContentsAlloc > > : true_type {};
+}
+
 namespace omicron::hierarchy
 {
     using namespace std;
@@ -27,6 +41,7 @@ namespace omicron::hierarchy
 	class O1OctreeNode
 	{
 	public:
+		/** Decoded contents. Quantized surfels from disk are decoded to this array when the node is paged in. */
 		using ContentsArray = Array< Contents, ContentsAlloc >;
 		using NodeAlloc = typename ContentsAlloc:: template rebind< O1OctreeNode >::other;
 		using NodeArray = Array< O1OctreeNode, NodeAlloc >;
@@ -251,6 +266,9 @@ namespace omicron::hierarchy
 			}
 		}
 		
+		/** @returns true if a cloud was created for the contents, even if it is not loaded yet. */
+		bool hasCloud() const { return m_cloud != nullptr; }
+		
 		bool isLoaded() const
 		{
 			if( m_cloud != nullptr )
@@ -72,7 +72,7 @@ namespace omicron::hierarchy
 			
 			assert( level == m_nodeLvl && "Morton code level should be equal than OctreeDimension's." );
 			
-			auto nodeCoordsVec = code.decode( level );
+			auto nodeCoordsVec = code.decodeArray( level );
 			Vec3 nodeCoords( nodeCoordsVec[ 0 ], nodeCoordsVec[ 1 ], nodeCoordsVec[ 2 ] );
 			Float nodeSizeFactor = Float( 1 ) / Float( 1 << level );
 			Vec3 levelNodeSize = m_size * nodeSizeFactor;
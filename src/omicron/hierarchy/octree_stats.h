@@ -4,8 +4,9 @@
 #include <ostream>
 #include <Eigen/Dense>
 #include "omicron/basic/stream.h"
-#include "omicron/hierarchy/reconstruction_params.h"
+#include "omicron/hierarchy/reconstruction_config.h"
 #include "omicron/util/profiler.h"
+#include "omicron/util/ring_buffer.h"
 
 namespace omicron::hierarchy
 {
@@ -18,14 +19,17 @@ namespace omicron::hierarchy
 	{
 	public:
 		FrameStats( const float traversalTime = 0.f, const float renderQueueTime = 0.f, const float nRenderedPoints = 0.f,
-					const float frontInsertionDelay = 0.f, const float frontSize = 0.f, const float frontSegmentSize = 0.f )
+					const float frontInsertionDelay = 0.f, const float frontSize = 0.f, const float frontSegmentSize = 0.f,
+					const float nPrunes = 0.f, const float nBranches = 0.f )
 		: m_traversalTime( traversalTime ),
 		m_renderQueueTime( renderQueueTime ),
 		m_cpuOverhead( traversalTime + renderQueueTime ),
 		m_nRenderedPoints( nRenderedPoints ),
 		m_frontInsertionDelay( frontInsertionDelay ),
 		m_frontSize( frontSize ),
-		m_frontSegmentSize( frontSegmentSize )
+		m_frontSegmentSize( frontSegmentSize ),
+		m_nPrunes( nPrunes ),
+		m_nBranches( nBranches )
 		{}
 		
 		friend ostream& operator<<( ostream& out, const FrameStats& frame )
@@ -36,8 +40,9 @@ namespace omicron::hierarchy
 				<< "Rendered points: " << frame.m_nRenderedPoints << endl
 				<< "Front insertion delay: " << frame.m_frontInsertionDelay << "ms" << endl
 				<< "Front size: " << frame.m_frontSize << endl
-				<< "Front segments: " << SEGMENTS_PER_FRONT << endl
-				<< "Front segment size: " << frame.m_frontSegmentSize;
+				<< "Front segment size: " << frame.m_frontSegmentSize << endl
+				<< "Prunes: " << frame.m_nPrunes << endl
+				<< "Branches: " << frame.m_nBranches;
 			return out;
 		}
 		
@@ -48,6 +53,8 @@ namespace omicron::hierarchy
 		float m_frontInsertionDelay;
 		float m_frontSize;
 		float m_frontSegmentSize;
+		float m_nPrunes;
+		float m_nBranches;
 	};
 	
 	/** Statistics of an Octree. */
@@ -82,9 +89,11 @@ namespace omicron::hierarchy
 			}
 			float avgFrontSize = calcIncrementalAvg( m_currentStats.m_frontSize, m_avgStats.m_frontSize, m_nFrames );
 			float avgFrontSegmentSize = calcIncrementalAvg( m_currentStats.m_frontSegmentSize, m_avgStats.m_frontSegmentSize, m_nFrames );
+			float avgPrunes = calcIncrementalAvg( m_currentStats.m_nPrunes, m_avgStats.m_nPrunes, m_nFrames );
+			float avgBranches = calcIncrementalAvg( m_currentStats.m_nBranches, m_avgStats.m_nBranches, m_nFrames );
 			
 			m_avgStats = FrameStats( avgTraversalTime, avgRenderQueueTime, avgRenderedPoints, avgFrontInsertionDelay, avgFrontSize,
-									 avgFrontSegmentSize );
+									 avgFrontSegmentSize, avgPrunes, avgBranches );
 		}
 		
 		float calcIncrementalAvg( const float newValue, const float currentAvg, const float nFrames ) const
@@ -107,15 +116,27 @@ namespace omicron::hierarchy
 		float m_nFrontInsertions;
 	};
 	
-	/** Cumulus' statistics. */
+	/** Cumulus' statistics. The most recent frames are kept in a ring buffer for the time series export. */
 	class CumulusStats
 	{
 	public:
-		CumulusStats( const float projThresh )
-		: m_projThresh( projThresh ),
+		/** Statistics of a frame in the time series. */
+		typedef struct FrameRecord
+		{
+			FrameStats m_frame;
+			float m_gpuOverhead;
+		} FrameRecord;
+		
+		/** @param frameCapacity is the number of most recent frames kept in the time series.
+		 * @param config is the reconstruction configuration reported with the statistics. */
+		CumulusStats( const float projThresh, const size_t frameCapacity = 1ul << 16,
+					  const ReconstructionConfig& config = ReconstructionConfig() )
+		: m_config( config ),
+		m_projThresh( projThresh ),
 		m_hierarchyDepth( 0 ),
 		m_gpuOverhead( 0.f ),
-		m_avgGpuOverhead( 0.f )
+		m_avgGpuOverhead( 0.f ),
+		m_frames( frameCapacity )
 		{
 			addCompletionPercent( 0.f );
 		}
@@ -125,6 +146,7 @@ namespace omicron::hierarchy
 			m_octreeStats = octreeStats;
 			m_gpuOverhead = gpuOverhead;
 			m_avgGpuOverhead = octreeStats.calcIncrementalAvg( m_gpuOverhead, m_avgGpuOverhead, octreeStats.m_nFrames );
+			m_frames.push( FrameRecord{ octreeStats.m_currentStats, gpuOverhead } );
 		}
 		
 		/** Reports the time stamp when the given percentage of the hierarchy is complete. */
@@ -140,13 +162,17 @@ namespace omicron::hierarchy
 		
 		friend ostream& operator<<( ostream& out, const CumulusStats& cumulusStats )
 		{
+			const ReconstructionConfig& config = cumulusStats.m_config;
+			
 			out << "Dataset: " << cumulusStats.m_datasetName << endl << endl
-				<< "Hierarchy creation threads: " << HIERARCHY_CREATION_THREADS << endl << endl
-				<< "Work list size: " << WORK_LIST_SIZE << endl << endl
-				<< "GPU memory allowed: " << GPU_MEMORY << endl << endl
+				<< "Hierarchy creation threads: " << config.m_nThreads << endl << endl
+				<< "Work list size: " << config.m_workListSize << endl << endl
+				<< "GPU memory allowed: " << config.m_gpuMemory << endl << endl
 				<< "Projection threshold: " << cumulusStats.m_projThresh << endl << endl
+				<< "Front segments: " << config.m_segmentsPerFront << endl << endl
+				<< "Front chunk size: " << config.m_frontChunkSize << endl << endl
 				<< "Hierarchy depth: " << cumulusStats.m_hierarchyDepth << endl << endl
-				<< "Parent point ratio: " << PARENT_POINTS_RATIO_VALUE << endl << endl
+				<< "Parent point ratio: " << config.m_parentPointsRatio << endl << endl
 				<< "Leaf collapse: " <<
 				#ifdef NODE_COLAPSE
 					"true"
@@ -154,16 +180,16 @@ namespace omicron::hierarchy
 					"false"
 				#endif
 				<< endl << endl
-				<< "Leaf tangent sizes: " << endl << "{ " << LEAF_SURFEL_TANGENT_SIZE_X
-				<< ", " << LEAF_SURFEL_TANGENT_SIZE_Y << " }" << endl << endl
-				<< "=== Tangent multipliers === " << endl << "Level 1 : " << endl << ReconstructionParams::calcMultipliers( 1 ) << endl
-				<< "Level 2 : " << endl << ReconstructionParams::calcMultipliers( 2 ) << endl
-				<< "Level 3 : " << endl << ReconstructionParams::calcMultipliers( 3 ) << endl
-				<< "Level 4 : " << endl << ReconstructionParams::calcMultipliers( 4 ) << endl
-				<< "Level 5 : " << endl << ReconstructionParams::calcMultipliers( 5 ) << endl
-				<< "Level 6 : " << endl << ReconstructionParams::calcMultipliers( 6 ) << endl
-				<< "Level 7 : " << endl << ReconstructionParams::calcMultipliers( 7 ) << endl
-				<< "Level 8 : " << endl << ReconstructionParams::calcMultipliers( 8 ) << endl << endl
+				<< "Leaf tangent sizes: " << endl << "{ " << config.m_leafSurfelTangentSize.x()
+				<< ", " << config.m_leafSurfelTangentSize.y() << " }" << endl << endl
+				<< "=== Tangent multipliers === " << endl << "Level 1 : " << endl << config.tangentMultipliers( 1 ) << endl
+				<< "Level 2 : " << endl << config.tangentMultipliers( 2 ) << endl
+				<< "Level 3 : " << endl << config.tangentMultipliers( 3 ) << endl
+				<< "Level 4 : " << endl << config.tangentMultipliers( 4 ) << endl
+				<< "Level 5 : " << endl << config.tangentMultipliers( 5 ) << endl
+				<< "Level 6 : " << endl << config.tangentMultipliers( 6 ) << endl
+				<< "Level 7 : " << endl << config.tangentMultipliers( 7 ) << endl
+				<< "Level 8 : " << endl << config.tangentMultipliers( 8 ) << endl << endl
 				<< "Reconstruction algorithm: " << RECONSTRUCTION_ALG << endl << endl
 				<< cumulusStats.m_octreeStats << endl;
 			
@@ -178,6 +204,8 @@ namespace omicron::hierarchy
 			return out;
 		}
 		
+		ReconstructionConfig m_config;
+		
 		string m_datasetName;
 		int m_workListSize;
 		float m_projThresh;
@@ -190,6 +218,9 @@ namespace omicron::hierarchy
 		
 		float m_gpuOverhead;
 		float m_avgGpuOverhead;
+		
+		/** Time series of the most recent frames. */
+		RingBuffer< FrameRecord > m_frames;
 	};
 }
 
@@ -0,0 +1,522 @@
+#ifndef RECONSTRUCTION_CONFIG_H
+#define RECONSTRUCTION_CONFIG_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <jsoncpp/json/json.h>
+#include "omicron/hierarchy/reconstruction_params.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+
+	/** Runtime reconstruction configuration. The defaults are the reconstruction_params.h macros. It can be loaded from
+	 * a JSON file and overridden from the command line, so parameter sweeps do not need a rebuild. The JSON keys are
+	 * the same ones written by toJson(). */
+	class ReconstructionConfig
+	{
+	public:
+		/** Levels with tangent multipliers. Deeper levels use ( 1, 1 ). */
+		static constexpr uint N_MULTIPLIER_LVLS = 32u;
+
+		/** Ctor. Inits with the compile-time parameters. */
+		ReconstructionConfig();
+
+		/** Sets the model and the parameters that depend on it: leaf tangent sizes, camera path speed and tangent
+		 * multipliers. */
+		void setModel( const uint model );
+
+		/** Sets the parent points ratio and the tangent multiplier table tuned for it. */
+		void setParentPointsRatio( const float ratio );
+
+		/** @returns the tangent multipliers used when creating a parent node at the given level. */
+		const Vector2f& tangentMultipliers( const uint level ) const
+		{
+			return ( level < m_tangentMultipliers.size() ) ? m_tangentMultipliers[ level ] : m_unitMultipliers;
+		}
+
+		void setTangentMultipliers( const uint level, const Vector2f& multipliers );
+
+		/** Overrides the parameters present in a JSON object. The model and the parent points ratio are applied first,
+		 * since they reset dependent parameters, and explicit tangent multipliers are applied last. The configuration
+		 * is not changed if the object is invalid.
+		 * @throws runtime_error if the object has an unknown key, a value of wrong type or an invalid value. */
+		void apply( const Json::Value& json );
+
+		/** Overrides a parameter given as text. The value is parsed as JSON, or taken as a string if it is not valid
+		 * JSON. */
+		void apply( const string& key, const string& value );
+
+		Json::Value toJson() const;
+
+		/** Loads a configuration file over the defaults. */
+		static ReconstructionConfig fromFile( const string& filename );
+
+		/** Creates a configuration from the command line. "--config=<file>" loads a configuration file and
+		 * "--<key>=<value>" overrides a parameter, in this order, whatever their positions.
+		 * @param out_positional receives the arguments that are not options, except argv[ 0 ].
+		 * @throws runtime_error for unknown options. */
+		static ReconstructionConfig fromArgs( int argc, char** argv, vector< string >& out_positional );
+
+		static string modelName( const uint model );
+
+		static uint parseModel( const Json::Value& value );
+
+		static string sortingName( const Sorting sorting );
+
+		static Sorting parseSorting( const Json::Value& value );
+
+		static string compressionName( const PointCompression compression );
+
+		static PointCompression parseCompression( const Json::Value& value );
+
+		uint m_model;
+
+		/** Number of threads used in the HierarchyCreator. */
+		int m_nThreads;
+		/** Work list size for hierarchy creation. */
+		ulong m_workListSize;
+		/** Number of work-stealing tasks each work list is split into in hierarchy creation. */
+		int m_workListSplits;
+		/** Maximum number of work lists in the leaf lvl queue. */
+		size_t m_leafWorkQueueSize;
+		ulong m_ramQuota;
+		/** Sorting algorithm for unsorted input. */
+		Sorting m_sorting;
+		/** Number of threads used in the OocPointSorter. */
+		int m_oocSortThreads;
+		float m_parentPointsRatio;
+		float m_projThresh;
+		/** Number of frames needed to track the whole front. */
+		uint m_segmentsPerFront;
+		/** Target number of nodes in each front chunk. */
+		size_t m_frontChunkSize;
+		/** Number of frames the camera motion is extrapolated to prefetch nodes. 0 disables prefetching. */
+		uint m_prefetchFrames;
+		/** Residency priority scale of prefetched nodes, in ( 0, 1 ]. */
+		float m_prefetchPriorityScale;
+		ulong m_gpuMemory;
+		/** Compression of the out-of-core sorter chunks and of saved octree files. */
+		PointCompression m_pointCompression;
+		/** Position quantization per axis of NEAR_LOSSLESS_COMPRESSION, in [ 1, 21 ]. */
+		uint m_compressionPositionBits;
+		Vector2f m_leafSurfelTangentSize;
+		float m_cameraPathSpeed;
+		/** Dataset to be opened at startup. Empty for the default one. */
+		string m_dataset;
+
+	private:
+		/** Overrides the parameters present in a JSON object, without validating the resulting configuration. */
+		void assign( const Json::Value& json );
+
+		/** @throws runtime_error if a parameter has an invalid value. */
+		void validate() const;
+
+		/** Tangent multipliers indexed by level. */
+		vector< Vector2f > m_tangentMultipliers;
+		Vector2f m_unitMultipliers;
+	};
+
+	inline ReconstructionConfig::ReconstructionConfig()
+	: m_model( MODEL ),
+	m_nThreads( HIERARCHY_CREATION_THREADS ),
+	m_workListSize( WORK_LIST_SIZE ),
+	m_workListSplits( WORK_LIST_SPLITS ),
+	m_leafWorkQueueSize( LEAF_WORK_QUEUE_SIZE ),
+	m_ramQuota( RAM_QUOTA ),
+	m_sorting( Sorting( SORTING ) ),
+	m_oocSortThreads( OOC_SORT_THREADS ),
+	m_parentPointsRatio( PARENT_POINTS_RATIO_VALUE ),
+	m_projThresh( PROJ_THRESHOLD ),
+	m_segmentsPerFront( SEGMENTS_PER_FRONT ),
+	m_frontChunkSize( FRONT_CHUNK_SIZE ),
+	m_prefetchFrames( PREFETCH_FRAMES ),
+	m_prefetchPriorityScale( PREFETCH_PRIORITY_SCALE ),
+	m_gpuMemory( GPU_MEMORY ),
+	m_pointCompression( POINT_COMPRESSION ),
+	m_compressionPositionBits( COMPRESSION_POSITION_BITS ),
+	m_leafSurfelTangentSize( LEAF_SURFEL_TANGENT_SIZE_X, LEAF_SURFEL_TANGENT_SIZE_Y ),
+	m_cameraPathSpeed( CAMERA_PATH_SPEED ),
+	m_tangentMultipliers( N_MULTIPLIER_LVLS ),
+	m_unitMultipliers( 1.f, 1.f )
+	{
+		for( uint level = 0u; level < N_MULTIPLIER_LVLS; ++level )
+		{
+			m_tangentMultipliers[ level ] = ReconstructionParams::calcMultipliers( level );
+		}
+	}
+
+	inline void ReconstructionConfig::setModel( const uint model )
+	{
+		m_model = model;
+		m_leafSurfelTangentSize = ReconstructionParams::leafSurfelTangentSize( model );
+		m_cameraPathSpeed = ReconstructionParams::cameraPathSpeed( model );
+		setParentPointsRatio( m_parentPointsRatio );
+	}
+
+	inline void ReconstructionConfig::setParentPointsRatio( const float ratio )
+	{
+		if( ratio <= 0.f || ratio > 1.f )
+		{
+			throw runtime_error( "Parent points ratio must be in ( 0, 1 ]." );
+		}
+
+		m_parentPointsRatio = ratio;
+		for( uint level = 0u; level < N_MULTIPLIER_LVLS; ++level )
+		{
+			m_tangentMultipliers[ level ] = ReconstructionParams::calcMultipliers( m_model, ratio, level );
+		}
+	}
+
+	inline void ReconstructionConfig::setTangentMultipliers( const uint level, const Vector2f& multipliers )
+	{
+		if( level >= N_MULTIPLIER_LVLS )
+		{
+			throw runtime_error( "Tangent multipliers are supported up to level " + to_string( N_MULTIPLIER_LVLS - 1 )
+								 + "." );
+		}
+		m_tangentMultipliers[ level ] = multipliers;
+	}
+
+	inline void ReconstructionConfig::apply( const Json::Value& json )
+	{
+		ReconstructionConfig config( *this );
+		config.assign( json );
+		config.validate();
+
+		*this = std::move( config );
+	}
+
+	inline void ReconstructionConfig::assign( const Json::Value& json )
+	{
+		static const vector< string > keys = {
+			"model", "hierarchyCreationThreads", "workListSize", "workListSplits", "leafWorkQueueSize", "ramQuota",
+			"sorting", "oocSortThreads", "parentPointsRatio", "projThreshold", "segmentsPerFront", "frontChunkSize",
+			"prefetchFrames", "prefetchPriorityScale", "gpuMemory", "pointCompression", "compressionPositionBits",
+			"leafSurfelTangentSize", "cameraPathSpeed", "tangentMultipliers", "dataset" };
+
+		if( !json.isObject() )
+		{
+			throw runtime_error( "Reconstruction configuration must be a JSON object." );
+		}
+
+		for( const string& key : json.getMemberNames() )
+		{
+			if( find( keys.begin(), keys.end(), key ) == keys.end() )
+			{
+				throw runtime_error( "Unknown reconstruction configuration key: " + key );
+			}
+		}
+
+		auto toVector2f = []( const Json::Value& value, const string& key )
+		{
+			if( !value.isArray() || value.size() != 2u )
+			{
+				throw runtime_error( "Configuration key " + key + " expects an array with 2 numbers." );
+			}
+			return Vector2f( value[ 0 ].asFloat(), value[ 1 ].asFloat() );
+		};
+
+		try
+		{
+			if( json.isMember( "model" ) ) { setModel( parseModel( json[ "model" ] ) ); }
+			if( json.isMember( "parentPointsRatio" ) ) { setParentPointsRatio( json[ "parentPointsRatio" ].asFloat() ); }
+
+			if( json.isMember( "hierarchyCreationThreads" ) ) { m_nThreads = json[ "hierarchyCreationThreads" ].asInt(); }
+			if( json.isMember( "workListSize" ) ) { m_workListSize = json[ "workListSize" ].asUInt64(); }
+			if( json.isMember( "workListSplits" ) ) { m_workListSplits = json[ "workListSplits" ].asInt(); }
+			if( json.isMember( "leafWorkQueueSize" ) ) { m_leafWorkQueueSize = json[ "leafWorkQueueSize" ].asUInt64(); }
+			if( json.isMember( "ramQuota" ) ) { m_ramQuota = json[ "ramQuota" ].asUInt64(); }
+			if( json.isMember( "sorting" ) ) { m_sorting = parseSorting( json[ "sorting" ] ); }
+			if( json.isMember( "oocSortThreads" ) ) { m_oocSortThreads = json[ "oocSortThreads" ].asInt(); }
+			if( json.isMember( "projThreshold" ) ) { m_projThresh = json[ "projThreshold" ].asFloat(); }
+			if( json.isMember( "segmentsPerFront" ) ) { m_segmentsPerFront = json[ "segmentsPerFront" ].asUInt(); }
+			if( json.isMember( "frontChunkSize" ) ) { m_frontChunkSize = json[ "frontChunkSize" ].asUInt64(); }
+			if( json.isMember( "prefetchFrames" ) ) { m_prefetchFrames = json[ "prefetchFrames" ].asUInt(); }
+			if( json.isMember( "prefetchPriorityScale" ) )
+			{
+				m_prefetchPriorityScale = json[ "prefetchPriorityScale" ].asFloat();
+			}
+			if( json.isMember( "gpuMemory" ) ) { m_gpuMemory = json[ "gpuMemory" ].asUInt64(); }
+			if( json.isMember( "pointCompression" ) )
+			{
+				m_pointCompression = parseCompression( json[ "pointCompression" ] );
+			}
+			if( json.isMember( "compressionPositionBits" ) )
+			{
+				m_compressionPositionBits = json[ "compressionPositionBits" ].asUInt();
+			}
+			if( json.isMember( "leafSurfelTangentSize" ) )
+			{
+				m_leafSurfelTangentSize = toVector2f( json[ "leafSurfelTangentSize" ], "leafSurfelTangentSize" );
+			}
+			if( json.isMember( "cameraPathSpeed" ) ) { m_cameraPathSpeed = json[ "cameraPathSpeed" ].asFloat(); }
+			if( json.isMember( "dataset" ) ) { m_dataset = json[ "dataset" ].asString(); }
+
+			if( json.isMember( "tangentMultipliers" ) )
+			{
+				const Json::Value& multipliers = json[ "tangentMultipliers" ];
+				if( !multipliers.isObject() )
+				{
+					throw runtime_error( "Configuration key tangentMultipliers expects an object indexed by level." );
+				}
+				for( const string& level : multipliers.getMemberNames() )
+				{
+					setTangentMultipliers( stoul( level ), toVector2f( multipliers[ level ], "tangentMultipliers" ) );
+				}
+			}
+		}
+		catch( const Json::Exception& e )
+		{
+			throw runtime_error( string( "Invalid reconstruction configuration value: " ) + e.what() );
+		}
+		catch( const invalid_argument& e )
+		{
+			throw runtime_error( "Tangent multiplier levels must be integers." );
+		}
+	}
+
+	inline void ReconstructionConfig::validate() const
+	{
+		if( m_nThreads < 1 || m_oocSortThreads < 1 || m_workListSize == 0ul || m_workListSplits < 1
+			|| m_segmentsPerFront == 0u || m_frontChunkSize == 0ul )
+		{
+			throw runtime_error( "Thread, work list, segment and chunk parameters must be positive." );
+		}
+
+		if( m_leafWorkQueueSize < 2ul )
+		{
+			throw runtime_error( "Leaf work queue size must be at least 2." );
+		}
+
+		if( m_prefetchPriorityScale <= 0.f || m_prefetchPriorityScale > 1.f )
+		{
+			throw runtime_error( "Prefetch priority scale must be in ( 0, 1 ]." );
+		}
+
+		if( m_compressionPositionBits == 0u || m_compressionPositionBits > 21u )
+		{
+			throw runtime_error( "Compression position bits must be in [ 1, 21 ]." );
+		}
+	}
+
+	inline void ReconstructionConfig::apply( const string& key, const string& value )
+	{
+		Json::Value parsed;
+		Json::CharReaderBuilder builder;
+		string errors;
+		istringstream in( value );
+
+		if( !Json::parseFromStream( builder, in, &parsed, &errors ) )
+		{
+			parsed = value;
+		}
+
+		Json::Value json;
+		json[ key ] = parsed;
+		apply( json );
+	}
+
+	inline Json::Value ReconstructionConfig::toJson() const
+	{
+		Json::Value json;
+		json[ "model" ] = modelName( m_model );
+		json[ "hierarchyCreationThreads" ] = m_nThreads;
+		json[ "workListSize" ] = Json::UInt64( m_workListSize );
+		json[ "workListSplits" ] = m_workListSplits;
+		json[ "leafWorkQueueSize" ] = Json::UInt64( m_leafWorkQueueSize );
+		json[ "ramQuota" ] = Json::UInt64( m_ramQuota );
+		json[ "sorting" ] = sortingName( m_sorting );
+		json[ "oocSortThreads" ] = m_oocSortThreads;
+		json[ "parentPointsRatio" ] = m_parentPointsRatio;
+		json[ "projThreshold" ] = m_projThresh;
+		json[ "segmentsPerFront" ] = m_segmentsPerFront;
+		json[ "frontChunkSize" ] = Json::UInt64( m_frontChunkSize );
+		json[ "prefetchFrames" ] = m_prefetchFrames;
+		json[ "prefetchPriorityScale" ] = m_prefetchPriorityScale;
+		json[ "gpuMemory" ] = Json::UInt64( m_gpuMemory );
+		json[ "pointCompression" ] = compressionName( m_pointCompression );
+		json[ "compressionPositionBits" ] = m_compressionPositionBits;
+		json[ "leafSurfelTangentSize" ].append( m_leafSurfelTangentSize.x() );
+		json[ "leafSurfelTangentSize" ].append( m_leafSurfelTangentSize.y() );
+		json[ "cameraPathSpeed" ] = m_cameraPathSpeed;
+		if( !m_dataset.empty() )
+		{
+			json[ "dataset" ] = m_dataset;
+		}
+
+		for( uint level = 0u; level < N_MULTIPLIER_LVLS; ++level )
+		{
+			Json::Value levelMultipliers;
+			levelMultipliers.append( m_tangentMultipliers[ level ].x() );
+			levelMultipliers.append( m_tangentMultipliers[ level ].y() );
+			json[ "tangentMultipliers" ][ to_string( level ) ] = levelMultipliers;
+		}
+
+		return json;
+	}
+
+	inline ReconstructionConfig ReconstructionConfig::fromFile( const string& filename )
+	{
+		ifstream file( filename );
+		if( !file.good() )
+		{
+			throw runtime_error( "Cannot open reconstruction configuration file " + filename );
+		}
+
+		Json::Value json;
+		Json::CharReaderBuilder builder;
+		string errors;
+		if( !Json::parseFromStream( builder, file, &json, &errors ) )
+		{
+			throw runtime_error( "Cannot parse reconstruction configuration file " + filename + ": " + errors );
+		}
+
+		ReconstructionConfig config;
+		config.apply( json );
+		return config;
+	}
+
+	inline ReconstructionConfig ReconstructionConfig::fromArgs( int argc, char** argv, vector< string >& out_positional )
+	{
+		const string configOption = "--config=";
+
+		ReconstructionConfig config;
+		vector< pair< string, string > > overrides;
+
+		for( int i = 1; i < argc; ++i )
+		{
+			string arg = argv[ i ];
+
+			if( arg.compare( 0, 2, "--" ) != 0 )
+			{
+				out_positional.push_back( arg );
+			}
+			else if( arg.compare( 0, configOption.size(), configOption ) == 0 )
+			{
+				config = fromFile( arg.substr( configOption.size() ) );
+			}
+			else
+			{
+				size_t equals = arg.find( '=' );
+				if( equals == string::npos )
+				{
+					throw runtime_error( "Options are expected as --<key>=<value>: " + arg );
+				}
+				overrides.push_back( pair< string, string >( arg.substr( 2, equals - 2 ), arg.substr( equals + 1 ) ) );
+			}
+		}
+
+		for( const pair< string, string >& override : overrides )
+		{
+			config.apply( override.first, override.second );
+		}
+
+		return config;
+	}
+
+	inline string ReconstructionConfig::modelName( const uint model )
+	{
+		switch( model )
+		{
+			case DAVID: return "david";
+			case ST_MATHEW: return "st_mathew";
+			case ATLAS: return "atlas";
+			case DUOMO: return "duomo";
+			case BUNNY: return "bunny";
+		}
+
+		return to_string( model );
+	}
+
+	inline uint ReconstructionConfig::parseModel( const Json::Value& value )
+	{
+		if( value.isString() )
+		{
+			for( uint model : { DAVID, ST_MATHEW, ATLAS, DUOMO, BUNNY } )
+			{
+				if( modelName( model ) == value.asString() )
+				{
+					return model;
+				}
+			}
+		}
+		else if( value.isUInt() && value.asUInt() <= BUNNY )
+		{
+			return value.asUInt();
+		}
+
+		throw runtime_error( "Unknown model: " + value.toStyledString() );
+	}
+
+	inline string ReconstructionConfig::sortingName( const Sorting sorting )
+	{
+		switch( sorting )
+		{
+			case HEAP_SORT: return "heap";
+			case PARTIAL_SORT: return "partial";
+			case FULL_SORT: return "full";
+			case EXTERNAL_SORT: return "external";
+		}
+
+		return to_string( int( sorting ) );
+	}
+
+	inline Sorting ReconstructionConfig::parseSorting( const Json::Value& value )
+	{
+		if( value.isString() )
+		{
+			for( Sorting sorting : { HEAP_SORT, PARTIAL_SORT, FULL_SORT, EXTERNAL_SORT } )
+			{
+				if( sortingName( sorting ) == value.asString() )
+				{
+					return sorting;
+				}
+			}
+		}
+		else if( value.isUInt() && value.asUInt() <= EXTERNAL_SORT )
+		{
+			return Sorting( value.asUInt() );
+		}
+
+		throw runtime_error( "Unknown sorting: " + value.toStyledString() );
+	}
+
+	inline string ReconstructionConfig::compressionName( const PointCompression compression )
+	{
+		switch( compression )
+		{
+			case NO_COMPRESSION: return "none";
+			case LOSSLESS_COMPRESSION: return "lossless";
+			case NEAR_LOSSLESS_COMPRESSION: return "nearLossless";
+		}
+
+		return to_string( int( compression ) );
+	}
+
+	inline PointCompression ReconstructionConfig::parseCompression( const Json::Value& value )
+	{
+		if( value.isString() )
+		{
+			for( PointCompression compression : { NO_COMPRESSION, LOSSLESS_COMPRESSION, NEAR_LOSSLESS_COMPRESSION } )
+			{
+				if( compressionName( compression ) == value.asString() )
+				{
+					return compression;
+				}
+			}
+		}
+		else if( value.isUInt() && value.asUInt() <= NEAR_LOSSLESS_COMPRESSION )
+		{
+			return PointCompression( value.asUInt() );
+		}
+
+		throw runtime_error( "Unknown point compression: " + value.toStyledString() );
+	}
+}
+
+#endif
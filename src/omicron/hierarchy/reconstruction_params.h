@@ -35,6 +35,13 @@ enum Sorting
 	EXTERNAL_SORT = 3
 };
 
+enum PointCompression
+{
+	NO_COMPRESSION = 0, // Raw points.
+	LOSSLESS_COMPRESSION = 1, // PointCodec::LOSSLESS.
+	NEAR_LOSSLESS_COMPRESSION = 2 // PointCodec::NEAR_LOSSLESS.
+};
+
 enum ReconstructionAlgorithm
 {
 	ZPBG01 = 0,
@@ -60,6 +67,15 @@ enum ReconstructionAlgorithm
 #define WORK_LIST_SIZE 8
 // #define WORK_LIST_SIZE 32
 
+// Number of work-stealing tasks each work list is split into in hierarchy creation. Each task has whole sibling groups.
+#define WORK_LIST_SPLITS 4
+
+// Maximum number of work lists in the leaf lvl queue. The disk access thread waits while the queue is full.
+#define LEAF_WORK_QUEUE_SIZE 1024
+
+// Number of threads used in the out-of-core point sorter. Each thread merges an independent range of morton codes.
+#define OOC_SORT_THREADS 8
+
 #define RAM_QUOTA 6ul * 1024ul * 1024ul * 1024ul
 
 // Activates rendering in parallel with hierarchy creation.
@@ -95,6 +111,21 @@ enum ReconstructionAlgorithm
 // #define SEGMENTS_PER_FRONT 10
 #define SEGMENTS_PER_FRONT 1
 
+// Target number of nodes in each front chunk. Chunks are the unit of parallel front tracking.
+#define FRONT_CHUNK_SIZE 4096
+
+// Number of frames ahead of the camera whose nodes are prefetched. 0 disables prefetching.
+#define PREFETCH_FRAMES 0
+
+// Residency priority of prefetched nodes relative to the priority they would have if needed now.
+#define PREFETCH_PRIORITY_SCALE 0.5f
+
+// Compression of the out-of-core sorter chunks and of saved octree files.
+#define POINT_COMPRESSION NO_COMPRESSION
+
+// Position quantization per axis of near-lossless compression.
+#define COMPRESSION_POSITION_BITS 16u
+
 // Enables node colapse when leaves do not have siblings.
 #define NODE_COLAPSE
 
@@ -164,96 +195,210 @@ enum ReconstructionAlgorithm
 
 namespace omicron::hierarchy
 {
+	/** Per-model reconstruction tables. The macro parameters above are the compile-time defaults. The same tables are
+	 * available at runtime for any model and parent points ratio, so ReconstructionConfig can switch them without a
+	 * rebuild. */
 	class ReconstructionParams
 	{
 	public:
+		/** @returns the tangent multipliers of the given level for the compile-time MODEL and PARENT_POINTS_RATIO. */
 		static Vector2f calcMultipliers( const uint level )
 		{
-			switch( level )
+			return calcMultipliers( MODEL, PARENT_POINTS_RATIO_VALUE, level );
+		}
+		
+		/** @returns the tangent multipliers of the given level.
+		 * @param model is one of the model identifiers.
+		 * @param parentPointsRatio selects the nearest of the tuned tables, which are for 1/4, 1/5 and 1/10. */
+		static Vector2f calcMultipliers( const uint model, const float parentPointsRatio, const uint level )
+		{
+			bool oneFourth = parentPointsRatio > 0.225f;
+			bool oneTenth = parentPointsRatio < 0.15f;
+			
+			switch( model )
 			{
-				#if MODEL == DAVID
-					#ifdef PARENT_POINTS_RATIO_ONE_FOURTH
-						case 7: return Vector2f( 4.2f, 4.2f );
-						case 6: return Vector2f( 2.5f, 2.0f );
-						case 5: return Vector2f( 2.0f, 2.0f );
-						case 4: return Vector2f( 2.0f, 2.0f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#elif defined PARENT_POINTS_RATIO_ONE_FIFTH
-						case 7: return Vector2f( 4.7f, 4.7f );
-						case 6: return Vector2f( 3.0f, 2.5f );
-						case 5: return Vector2f( 2.0f, 2.0f );
-						case 4: return Vector2f( 2.5f, 2.5f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#elif defined PARENT_POINTS_RATIO_ONE_TENTH
-						case 7: return Vector2f( 6.f, 6.0f );
-						case 6: return Vector2f( 3.0f, 2.5f );
-						case 5: return Vector2f( 2.0f, 2.0f );
-						case 4: return Vector2f( 2.5f, 2.5f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#endif
-				#elif MODEL == ATLAS
-					#ifdef PARENT_POINTS_RATIO_ONE_FOURTH
-						case 7: return Vector2f( 3.8f, 3.5f );
-						case 6: return Vector2f( 2.5f, 2.0f );
-						case 5: return Vector2f( 2.0f, 2.0f );
-						case 4: return Vector2f( 2.0f, 2.0f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#elif defined PARENT_POINTS_RATIO_ONE_FIFTH || defined PARENT_POINTS_RATIO_ONE_TENTH
-// 						case 7: return Vector2f( 4.2f, 4.2f );
-						case 7: return Vector2f( 2.0f, 2.0f );
-						case 6: return Vector2f( 2.5f, 2.0f );
-						case 5: return Vector2f( 2.3f, 2.3f );
-						case 4: return Vector2f( 2.3f, 2.3f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#endif
-				#elif MODEL == ST_MATHEW
-					#ifdef PARENT_POINTS_RATIO_ONE_FOURTH
-						case 7: return Vector2f( 4.2f, 4.0f );
-						case 6: return Vector2f( 2.3f, 2.0f );
-						case 5: return Vector2f( 2.0f, 2.0f );
-						case 4: return Vector2f( 2.0f, 2.0f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#elif defined PARENT_POINTS_RATIO_ONE_FIFTH || defined PARENT_POINTS_RATIO_ONE_TENTH
-// 						case 7: return Vector2f( 4.7, 4.5f );
-						case 7: return Vector2f( 2.0f, 2.0f );
-						case 6: return Vector2f( 2.6f, 2.3f );
-						case 5: return Vector2f( 2.2f, 2.2f );
-						case 4: return Vector2f( 2.5f, 2.5f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#endif
-				#elif MODEL == DUOMO
-					#ifdef PARENT_POINTS_RATIO_ONE_FOURTH
-						case 7: return Vector2f( 4.2f, 4.2f );
-						case 6: return Vector2f( 2.7f, 1.9f );
-						case 5: return Vector2f( 2.6f, 1.5f );
-						case 4: return Vector2f( 2.0f, 1.7f );
-						case 3: return Vector2f( 2.0f, 2.0f );
-					#elif defined PARENT_POINTS_RATIO_ONE_FIFTH || defined PARENT_POINTS_RATIO_ONE_TENTH
-						case 7: return Vector2f( 4.4f, 4.4f );
-						case 6: return Vector2f( 3.0f, 2.1f );
-						case 5: return Vector2f( 2.8f, 1.8f );
-						case 4: return Vector2f( 2.0f, 2.0f );
-						case 3: return Vector2f( 2.0f, 1.0f );
-					#endif
-				#endif
+				case DAVID:
+				{
+					if( oneFourth )
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 4.2f, 4.2f );
+							case 6: return Vector2f( 2.5f, 2.0f );
+							case 5: return Vector2f( 2.0f, 2.0f );
+							case 4: return Vector2f( 2.0f, 2.0f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					else if( oneTenth )
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 6.f, 6.0f );
+							case 6: return Vector2f( 3.0f, 2.5f );
+							case 5: return Vector2f( 2.0f, 2.0f );
+							case 4: return Vector2f( 2.5f, 2.5f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					else
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 4.7f, 4.7f );
+							case 6: return Vector2f( 3.0f, 2.5f );
+							case 5: return Vector2f( 2.0f, 2.0f );
+							case 4: return Vector2f( 2.5f, 2.5f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					break;
+				}
+				case ATLAS:
+				{
+					if( oneFourth )
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 3.8f, 3.5f );
+							case 6: return Vector2f( 2.5f, 2.0f );
+							case 5: return Vector2f( 2.0f, 2.0f );
+							case 4: return Vector2f( 2.0f, 2.0f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					else
+					{
+						switch( level )
+						{
+// 							case 7: return Vector2f( 4.2f, 4.2f );
+							case 7: return Vector2f( 2.0f, 2.0f );
+							case 6: return Vector2f( 2.5f, 2.0f );
+							case 5: return Vector2f( 2.3f, 2.3f );
+							case 4: return Vector2f( 2.3f, 2.3f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					break;
+				}
+				case ST_MATHEW:
+				{
+					if( oneFourth )
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 4.2f, 4.0f );
+							case 6: return Vector2f( 2.3f, 2.0f );
+							case 5: return Vector2f( 2.0f, 2.0f );
+							case 4: return Vector2f( 2.0f, 2.0f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					else
+					{
+						switch( level )
+						{
+// 							case 7: return Vector2f( 4.7, 4.5f );
+							case 7: return Vector2f( 2.0f, 2.0f );
+							case 6: return Vector2f( 2.6f, 2.3f );
+							case 5: return Vector2f( 2.2f, 2.2f );
+							case 4: return Vector2f( 2.5f, 2.5f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					break;
+				}
+				case DUOMO:
+				{
+					if( oneFourth )
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 4.2f, 4.2f );
+							case 6: return Vector2f( 2.7f, 1.9f );
+							case 5: return Vector2f( 2.6f, 1.5f );
+							case 4: return Vector2f( 2.0f, 1.7f );
+							case 3: return Vector2f( 2.0f, 2.0f );
+						}
+					}
+					else
+					{
+						switch( level )
+						{
+							case 7: return Vector2f( 4.4f, 4.4f );
+							case 6: return Vector2f( 3.0f, 2.1f );
+							case 5: return Vector2f( 2.8f, 1.8f );
+							case 4: return Vector2f( 2.0f, 2.0f );
+							case 3: return Vector2f( 2.0f, 1.0f );
+						}
+					}
+					break;
+				}
 			}
 		
 			return Vector2f( 1.f, 1.f );
 		}
 		
 		static Vector2f calcAcummulatedMultipliers( int startingLevel, int endingLevel )
-	{
-		Vector2f multipliers( 1.f, 1.f );
+		{
+			Vector2f multipliers( 1.f, 1.f );
+			
+			for( int level = startingLevel; level < endingLevel + 1; ++level )
+			{
+				Vector2f levelMult = calcMultipliers( level );
+				multipliers.x() *= levelMult.x();
+				multipliers.y() *= levelMult.y();
+			}
+			
+			return multipliers;
+		}
 		
-		for( int level = startingLevel; level < endingLevel + 1; ++level )
+		/** @returns the tangent size of the leaf surfels of the given model. */
+		static Vector2f leafSurfelTangentSize( const uint model )
 		{
-			Vector2f levelMult = calcMultipliers( level );
-			multipliers.x() *= levelMult.x();
-			multipliers.y() *= levelMult.y();
+			switch( model )
+			{
+				case DAVID: return Vector2f( 0.000037f, 0.00003f );
+				case ATLAS: return Vector2f( 0.0003f, 0.0002f );
+				case ST_MATHEW: return Vector2f( 0.0003f, 0.0002f );
+				case DUOMO: return Vector2f( 0.00008f, 0.00002f );
+				case BUNNY: return Vector2f( 0.015f, 0.015f );
+			}
+			
+			return Vector2f( LEAF_SURFEL_TANGENT_SIZE_X, LEAF_SURFEL_TANGENT_SIZE_Y );
 		}
 		
-		return multipliers;
-	}
+		/** @returns the number of placeholders expected to be substituted in the hierarchy creation of the given
+		 * model. */
+		static uint expectedSubstitutedPlaceholders( const uint model )
+		{
+			switch( model )
+			{
+				#ifdef NODE_COLAPSE
+					case DAVID: return 19895u;
+				#else
+					case DAVID: return 19777u;
+				#endif
+				case ATLAS: return 21187u;
+				case ST_MATHEW: case BUNNY: case DUOMO: return 23711u;
+			}
+			
+			return EXPECTED_SUBSTITUTED_PLACEHOLDERS;
+		}
+		
+		/** @returns the camera path animation speed of the given model. */
+		static float cameraPathSpeed( const uint model )
+		{
+			switch( model )
+			{
+				case DAVID: return 0.005f;
+				case ATLAS: return 0.004f;
+				case ST_MATHEW: return 0.002f;
+				case DUOMO: case BUNNY: return 0.001f;
+			}
+			
+			return CAMERA_PATH_SPEED;
+		}
 	};
 }
 
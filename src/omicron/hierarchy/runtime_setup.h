@@ -1,19 +1,27 @@
 #ifndef RUNTIME_SETUP_H
 #define RUNTIME_SETUP_H
 
+#include "omicron/hierarchy/reconstruction_config.h"
+
 namespace omicron::hierarchy
 {
 	typedef struct RuntimeSetup
 	{
+		/** Ctor. Overrides the thread count, work list size and memory quota of the default configuration. */
 		RuntimeSetup( int nThreads = 8, ulong loadPerThread = 1024, ulong memoryQuota = 1024 * 1024 * 8 )
-		: m_nThreads( nThreads ),
-		m_loadPerThread( loadPerThread ),
-		m_memoryQuota( memoryQuota )
+		{
+			m_config.m_nThreads = nThreads;
+			m_config.m_workListSize = loadPerThread;
+			m_config.m_ramQuota = memoryQuota;
+		}
+		
+		RuntimeSetup( const ReconstructionConfig& config )
+		: m_config( config )
 		{}
 		
-		int m_nThreads;
-		ulong m_loadPerThread;
-		ulong m_memoryQuota;
+		/** Reconstruction parameters. The thread count, load per thread and memory quota are m_nThreads,
+		 * m_workListSize and m_ramQuota. */
+		ReconstructionConfig m_config;
 	} RuntimeSetup;
 }
 
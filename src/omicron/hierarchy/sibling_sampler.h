@@ -0,0 +1,101 @@
+#ifndef SIBLING_SAMPLER_H
+#define SIBLING_SAMPLER_H
+
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+#include "omicron/basic/basic_types.h"
+#include "omicron/util/counter_rng.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+	using namespace basic;
+	using namespace util;
+
+	/** Samples the contents of a parent node from the contents of its children. The sibling contents are addressed by
+	 * an exclusive prefix sum kept in a fixed-size array, so no allocation is done besides the sampled contents. The
+	 * random choices are drawn from a CounterRng keyed by the parent's morton code, so the sampled contents are the same
+	 * regardless of the thread that creates the parent or of how its sibling group was split among threads.
+	 * @param Node is the node type. Its contents must support multiplyTangents(). */
+	template< typename Node >
+	class SiblingSampler
+	{
+	public:
+		using ContentsArray = typename Node::ContentsArray;
+
+		/** Maximum number of siblings in a group. */
+		static constexpr uint MAX_SIBLINGS = 8u;
+
+		SiblingSampler()
+		: m_nSiblings( 0u ),
+		m_nPoints( 0u )
+		{}
+
+		/** Appends a sibling. The sibling must outlive the sampling. Siblings should be pushed in morton order for the
+		 * sampling to be reproducible. */
+		void push( const Node& sibling );
+
+		uint nSiblings() const { return m_nSiblings; }
+
+		/** @returns the total number of points in the siblings. */
+		uint nPoints() const { return m_nPoints; }
+
+		/** Samples with replacement.
+		 * @param key is the parent's morton code bits.
+		 * @param nSamples is the number of sampled points.
+		 * @param tangentMultipliers are applied to the tangents of the sampled points.
+		 * @returns the sampled points or an empty array if the siblings have no points. */
+		ContentsArray sample( const uint64_t key, const uint nSamples, const Vector2f& tangentMultipliers ) const;
+
+	private:
+		array< uint, MAX_SIBLINGS > m_prefix;
+		array< const Node*, MAX_SIBLINGS > m_siblings;
+		uint m_nSiblings;
+		uint m_nPoints;
+	};
+
+	template< typename Node >
+	inline void SiblingSampler< Node >::push( const Node& sibling )
+	{
+		if( m_nSiblings == MAX_SIBLINGS )
+		{
+			throw logic_error( "A sibling group cannot have more than 8 nodes." );
+		}
+
+		m_prefix[ m_nSiblings ] = m_nPoints;
+		m_siblings[ m_nSiblings ] = &sibling;
+		m_nPoints += sibling.getContents().size();
+		++m_nSiblings;
+	}
+
+	template< typename Node >
+	inline typename SiblingSampler< Node >::ContentsArray SiblingSampler< Node >
+	::sample( const uint64_t key, const uint nSamples, const Vector2f& tangentMultipliers ) const
+	{
+		if( m_nPoints == 0u )
+		{
+			return ContentsArray();
+		}
+
+		ContentsArray selectedPoints( nSamples );
+		CounterRng rng( key );
+		auto prefixEnd = m_prefix.begin() + m_nSiblings;
+
+		for( uint i = 0; i < nSamples; ++i )
+		{
+			uint choosenIdx = rng.uniform( m_nPoints );
+
+			// Last sibling whose first point is at or before choosenIdx. Empty siblings are skipped by upper_bound.
+			uint sibling = std::upper_bound( m_prefix.begin(), prefixEnd, choosenIdx ) - m_prefix.begin() - 1;
+
+			auto s = m_siblings[ sibling ]->getContents()[ choosenIdx - m_prefix[ sibling ] ];
+			s.multiplyTangents( tangentMultipliers );
+			selectedPoints[ i ] = s;
+		}
+
+		return selectedPoints;
+	}
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef STATS_EXPORT_H
+#define STATS_EXPORT_H
+
+#include <ostream>
+#include <sstream>
+#include <jsoncpp/json/json.h>
+#include "omicron/hierarchy/octree_stats.h"
+#include "omicron/hierarchy/reconstruction_config.h"
+#include "omicron/memory/tbb_allocator.h"
+
+// Machine-readable export of the statistics in octree_stats.h. JSON has every counter and the configuration in effect.
+// CSV has the per-frame time series.
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+
+	inline Json::Value toJson( const FrameStats& frame )
+	{
+		Json::Value json;
+		json[ "traversalTime" ] = frame.m_traversalTime;
+		json[ "renderQueueTime" ] = frame.m_renderQueueTime;
+		json[ "cpuOverhead" ] = frame.m_cpuOverhead;
+		json[ "renderedPoints" ] = frame.m_nRenderedPoints;
+		json[ "frontInsertionDelay" ] = frame.m_frontInsertionDelay;
+		json[ "frontSize" ] = frame.m_frontSize;
+		json[ "frontSegmentSize" ] = frame.m_frontSegmentSize;
+		json[ "prunes" ] = frame.m_nPrunes;
+		json[ "branches" ] = frame.m_nBranches;
+
+		return json;
+	}
+
+	inline Json::Value toJson( const OctreeStats& octreeStats )
+	{
+		Json::Value json;
+		json[ "frames" ] = octreeStats.m_nFrames;
+		json[ "frontInsertions" ] = octreeStats.m_nFrontInsertions;
+		json[ "current" ] = toJson( octreeStats.m_currentStats );
+		json[ "average" ] = toJson( octreeStats.m_avgStats );
+
+		return json;
+	}
+
+	/** @returns the reconstruction configuration and the compile-time flags in reconstruction_params.h. */
+	inline Json::Value reconstructionParamsJson( const ReconstructionConfig& config = ReconstructionConfig() )
+	{
+		auto toString = []( const auto& value ) { stringstream ss; ss << value; return ss.str(); };
+
+		Json::Value json = config.toJson();
+		#ifdef LAB
+			json[ "lab" ] = true;
+		#else
+			json[ "lab" ] = false;
+		#endif
+		#ifdef HIERARCHY_CREATION_RENDERING
+			json[ "hierarchyCreationRendering" ] = true;
+		#else
+			json[ "hierarchyCreationRendering" ] = false;
+		#endif
+		json[ "noSort" ] = NO_SORT;
+		json[ "sortingSegments" ] = SORTING_SEGMENTS;
+		#ifdef SHALLOW_OCTREE
+			json[ "shallowOctree" ] = true;
+		#else
+			json[ "shallowOctree" ] = false;
+		#endif
+		json[ "octreeConstruction" ] = OCTREE_CONSTRUCTION;
+		#ifdef NODE_COLAPSE
+			json[ "nodeCollapse" ] = true;
+		#else
+			json[ "nodeCollapse" ] = false;
+		#endif
+		json[ "expectedSubstitutedPlaceholders" ] =
+			ReconstructionParams::expectedSubstitutedPlaceholders( config.m_model );
+		json[ "reconstructionAlgorithm" ] = toString( ReconstructionAlgorithm( RECONSTRUCTION_ALG ) );
+		json[ "topDownOctreeK" ] = TOP_DOWN_OCTREE_K;
+
+		return json;
+	}
+
+	inline Json::Value toJson( const CumulusStats& cumulusStats )
+	{
+		Json::Value json;
+		json[ "dataset" ] = cumulusStats.m_datasetName;
+		json[ "projThreshold" ] = cumulusStats.m_projThresh;
+		json[ "hierarchyDepth" ] = cumulusStats.m_hierarchyDepth;
+		json[ "gpuOverhead" ] = cumulusStats.m_gpuOverhead;
+		json[ "avgGpuOverhead" ] = cumulusStats.m_avgGpuOverhead;
+		json[ "octree" ] = toJson( cumulusStats.m_octreeStats );
+
+		for( const pair< float, chrono::system_clock::time_point >& completion : cumulusStats.m_completionPercent )
+		{
+			Json::Value completionJson;
+			completionJson[ "percent" ] = completion.first * 100.f;
+			completionJson[ "time" ] = Json::Int64( chrono::duration_cast< chrono::milliseconds >(
+				completion.second.time_since_epoch() ).count() );
+			json[ "completion" ].append( completionJson );
+		}
+
+		const RingBuffer< CumulusStats::FrameRecord >& frames = cumulusStats.m_frames;
+		json[ "droppedFrames" ] = Json::UInt64( frames.nDropped() );
+		json[ "timeSeries" ] = Json::Value( Json::arrayValue );
+		for( size_t i = 0; i < frames.size(); ++i )
+		{
+			Json::Value frameJson = toJson( frames[ i ].m_frame );
+			frameJson[ "frame" ] = Json::UInt64( frames.nDropped() + i );
+			frameJson[ "gpuOverhead" ] = frames[ i ].m_gpuOverhead;
+			json[ "timeSeries" ].append( frameJson );
+		}
+
+		return json;
+	}
+
+	/** @returns the creation timings of an octree. The hierarchy creation must be finished. */
+	template< typename Octree >
+	Json::Value creationJson( Octree& octree )
+	{
+		pair< uint, uint > nodeStats = octree.nodeStatistics();
+
+		Json::Value json;
+		json[ "readerInTime" ] = octree.readerInTime();
+		json[ "readerInitTime" ] = octree.readerInitTime();
+		json[ "readerReadTime" ] = octree.readerReadTime();
+		json[ "hierarchyCreationTime" ] = octree.hierarchyCreationDuration();
+		json[ "nodes" ] = nodeStats.first;
+		json[ "splats" ] = nodeStats.second;
+		json[ "substitutedPlaceholders" ] = octree.substitutedPlaceholders();
+		json[ "allocated" ] = Json::UInt64( memory::AllocStatistics::totalAllocated() );
+
+		return json;
+	}
+
+	/** Writes the time series of frames as CSV, from the oldest to the most recent kept frame. */
+	inline void writeFramesCsv( ostream& out, const CumulusStats& cumulusStats )
+	{
+		out << "frame,traversal_time,render_queue_time,cpu_overhead,gpu_overhead,rendered_points,front_insertion_delay,"
+			<< "front_size,front_segment_size,prunes,branches" << endl;
+
+		const RingBuffer< CumulusStats::FrameRecord >& frames = cumulusStats.m_frames;
+		for( size_t i = 0; i < frames.size(); ++i )
+		{
+			const FrameStats& frame = frames[ i ].m_frame;
+			out << frames.nDropped() + i << "," << frame.m_traversalTime << "," << frame.m_renderQueueTime << ","
+				<< frame.m_cpuOverhead << "," << frames[ i ].m_gpuOverhead << "," << frame.m_nRenderedPoints << ","
+				<< frame.m_frontInsertionDelay << "," << frame.m_frontSize << "," << frame.m_frontSegmentSize << ","
+				<< frame.m_nPrunes << "," << frame.m_nBranches << endl;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef TOP_DOWN_CREATOR_H
+#define TOP_DOWN_CREATOR_H
+
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include "omicron/hierarchy/o1_octree_node.h"
+#include "omicron/hierarchy/octree_dimensions.h"
+#include "omicron/hierarchy/reconstruction_config.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "omicron/util/counter_rng.h"
+#include "omicron/util/work_stealing_scheduler.h"
+
+namespace omicron::hierarchy
+{
+	using namespace std;
+	using namespace util;
+
+	/** Task-parallel top-down octree hierarchy creator. A node with more than a given number of points is subdivided.
+	 * The points are never copied while subdividing: the leaf level morton code of each point is computed once and the
+	 * (code, point index) keys of a node are partitioned in place into its 8 children ranges by the next morton digit.
+	 * Children whose range is above a cutoff are spawned as tasks of a WorkStealingScheduler, the others are created
+	 * inline by the same task. The result is the same O1OctreeNode hierarchy built bottom-up by HierarchyCreator, so both
+	 * can be compared on the same datasets.
+	 * @param Morton is the MortonCode type. */
+	template< typename Morton >
+	class TopDownCreator
+	{
+	public:
+		using Node = O1OctreeNode< Surfel >;
+		using NodeArray = typename Node::NodeArray;
+		using ContentsArray = typename Node::ContentsArray;
+		using OctreeDim = OctreeDimensions< Morton >;
+		using Sorter = disk::MortonRadixSorter< Morton >;
+
+		/** Default minimum number of points of a node for its creation to be spawned as a task. */
+		static constexpr ulong DEFAULT_TASK_CUTOFF = 16384ul;
+
+		/** Ctor.
+		 * @param leafLvlDim is the octree dimensions at the deepest level. Nodes at this level are always leaves.
+		 * @param nThreads is the number of creation threads.
+		 * @param config has the tangent multipliers applied to the points sampled for inner nodes.
+		 * @param maxNodePoints is the number of points above which a node is subdivided. It is also the number of
+		 * points sampled for inner nodes.
+		 * @param taskCutoff is the minimum number of points of a node for its creation to be spawned as a task. */
+		TopDownCreator( const OctreeDim& leafLvlDim, const int nThreads,
+						const ReconstructionConfig& config = ReconstructionConfig(),
+						const uint maxNodePoints = TOP_DOWN_OCTREE_K, const ulong taskCutoff = DEFAULT_TASK_CUTOFF );
+
+		/** Creates the hierarchy. The creation is deterministic: it does not depend on the number of threads.
+		 * @param points are the leaf points, inside the leaf level dimensions boundaries.
+		 * @returns the root of the hierarchy. The caller takes ownership. */
+		Node* create( const ContentsArray& points );
+
+		/** @returns the number of node creations spawned as tasks in the last create(). */
+		ulong spawnedTasks() const { return m_spawnedTasks.load(); }
+
+	private:
+		/** Child ranges of a node. The range of child digit d is [ bounds[ d ], bounds[ d + 1 ] ). */
+		using ChildBounds = array< ulong, 9 >;
+
+		/** Creates the node of the key range [ begin, end ) and its subtree.
+		 * @param lvl is the node's level.
+		 * @param workerIdx is the scheduler worker running the caller task. */
+		void createNode( Node& node, Node* parent, const ulong begin, const ulong end, const uint lvl,
+						 const int workerIdx );
+
+		/** Partitions the key range [ begin, end ) in place by the morton digit of the child level. */
+		ChildBounds partition( const ulong begin, const ulong end, const uint childLvl );
+
+		/** Samples the contents of an inner node with replacement from the points of its subtree.
+		 * @param nodeKey is the node's morton code bits, the key of the random sequence. */
+		ContentsArray samplePoints( const ulong begin, const ulong end, const ulong nodeKey, const uint lvl ) const;
+
+		/** @returns the points of the key range [ begin, end ). */
+		ContentsArray gatherPoints( const ulong begin, const ulong end ) const;
+
+		/** @returns the morton digit of a key at the given level. */
+		uint digit( const ulong key, const uint lvl ) const
+		{
+			return ( key >> ( 3 * ( m_leafLvlDim.m_nodeLvl - lvl ) ) ) & 0x7;
+		}
+
+		OctreeDim m_leafLvlDim;
+		int m_nThreads;
+		uint m_maxNodePoints;
+		ulong m_taskCutoff;
+
+		/** Per level product of the tangent multipliers from the level below it down to the leaf level, so a point
+		 * sampled directly from the leaves has the size it would have after being sampled level by level. */
+		vector< Vector2f > m_accumulatedMultipliers;
+
+		/** Keys of the points being created, partitioned along the creation. */
+		typename Sorter::KeyVector m_keys;
+
+		const ContentsArray* m_points;
+		WorkStealingScheduler* m_scheduler;
+		atomic_ulong m_spawnedTasks;
+	};
+
+	template< typename Morton >
+	inline TopDownCreator< Morton >::TopDownCreator( const OctreeDim& leafLvlDim, const int nThreads,
+													 const ReconstructionConfig& config, const uint maxNodePoints,
+													 const ulong taskCutoff )
+	: m_leafLvlDim( leafLvlDim ),
+	m_nThreads( nThreads ),
+	m_maxNodePoints( std::max( maxNodePoints, 1u ) ),
+	m_taskCutoff( taskCutoff ),
+	m_accumulatedMultipliers( leafLvlDim.m_nodeLvl + 1, Vector2f( 1.f, 1.f ) ),
+	m_points( nullptr ),
+	m_scheduler( nullptr ),
+	m_spawnedTasks( 0ul )
+	{
+		for( int lvl = int( leafLvlDim.m_nodeLvl ) - 1; lvl >= 0; --lvl )
+		{
+			m_accumulatedMultipliers[ lvl ] = m_accumulatedMultipliers[ lvl + 1 ].cwiseProduct(
+				config.tangentMultipliers( lvl + 1 ) );
+		}
+	}
+
+	template< typename Morton >
+	typename TopDownCreator< Morton >::Node* TopDownCreator< Morton >::create( const ContentsArray& points )
+	{
+		if( points.size() == 0 )
+		{
+			throw logic_error( "TopDownCreator needs at least one point." );
+		}
+
+		m_points = &points;
+		m_keys = Sorter( m_leafLvlDim ).computeKeys( points.begin(), points.end() );
+		m_spawnedTasks = 0ul;
+
+		Node* root = new Node();
+		WorkStealingScheduler scheduler( m_nThreads );
+		m_scheduler = &scheduler;
+
+		scheduler.push( 0, [ & ]( int workerIdx ) { createNode( *root, nullptr, 0ul, m_keys.size(), 0u, workerIdx ); } );
+		scheduler.run();
+
+		m_scheduler = nullptr;
+		m_points = nullptr;
+		typename Sorter::KeyVector().swap( m_keys );
+
+		return root;
+	}
+
+	template< typename Morton >
+	void TopDownCreator< Morton >::createNode( Node& node, Node* parent, const ulong begin, const ulong end,
+											   const uint lvl, const int workerIdx )
+	{
+		if( end - begin <= m_maxNodePoints || lvl == m_leafLvlDim.m_nodeLvl )
+		{
+			node = Node( gatherPoints( begin, end ), parent );
+			return;
+		}
+
+		// Sampled before partitioning, so the sample depends only on the order given by the ancestors' partitions. The
+		// key is the node's full morton code, leading bit included, as in SiblingSampler, so nodes of different levels
+		// with the same digits have different sequences.
+		Morton leafMorton; leafMorton.build( m_keys[ begin ].m_key );
+		ContentsArray contents = samplePoints( begin, end, leafMorton.getAncestorInLvl( lvl ).getBits(), lvl );
+
+		ChildBounds bounds = partition( begin, end, lvl + 1 );
+		uint nChildren = 0u;
+		for( int d = 0; d < 8; ++d )
+		{
+			nChildren += ( bounds[ d + 1 ] > bounds[ d ] ) ? 1u : 0u;
+		}
+
+		// The node is in its final place, so the children array is not moved after the children get their parent.
+		node = Node( std::move( contents ), parent, NodeArray( nChildren ) );
+
+		uint childIdx = 0u;
+		for( int d = 0; d < 8; ++d )
+		{
+			ulong childBegin = bounds[ d ];
+			ulong childEnd = bounds[ d + 1 ];
+			if( childBegin == childEnd )
+			{
+				continue;
+			}
+
+			Node& child = node.child()[ childIdx++ ];
+			if( childEnd - childBegin >= m_taskCutoff )
+			{
+				++m_spawnedTasks;
+				m_scheduler->push( workerIdx,
+					[ this, &child, &node, childBegin, childEnd, lvl ]( int idx )
+					{
+						createNode( child, &node, childBegin, childEnd, lvl + 1, idx );
+					}
+				);
+			}
+			else
+			{
+				createNode( child, &node, childBegin, childEnd, lvl + 1, workerIdx );
+			}
+		}
+	}
+
+	template< typename Morton >
+	typename TopDownCreator< Morton >::ChildBounds TopDownCreator< Morton >
+	::partition( const ulong begin, const ulong end, const uint childLvl )
+	{
+		ChildBounds bounds;
+		bounds.fill( 0ul );
+		for( ulong i = begin; i < end; ++i )
+		{
+			++bounds[ digit( m_keys[ i ].m_key, childLvl ) + 1 ];
+		}
+
+		bounds[ 0 ] = begin;
+		for( int d = 0; d < 8; ++d )
+		{
+			bounds[ d + 1 ] += bounds[ d ];
+		}
+
+		// American flag sort pass: each misplaced key is swapped into the next free slot of its bucket.
+		array< ulong, 8 > next;
+		copy( bounds.begin(), bounds.begin() + 8, next.begin() );
+		for( int d = 0; d < 8; ++d )
+		{
+			while( next[ d ] < bounds[ d + 1 ] )
+			{
+				uint keyDigit = digit( m_keys[ next[ d ] ].m_key, childLvl );
+				if( keyDigit == uint( d ) )
+				{
+					++next[ d ];
+				}
+				else
+				{
+					swap( m_keys[ next[ d ] ], m_keys[ next[ keyDigit ]++ ] );
+				}
+			}
+		}
+
+		return bounds;
+	}
+
+	template< typename Morton >
+	inline typename TopDownCreator< Morton >::ContentsArray TopDownCreator< Morton >
+	::samplePoints( const ulong begin, const ulong end, const ulong nodeKey, const uint lvl ) const
+	{
+		ContentsArray selectedPoints( m_maxNodePoints );
+		CounterRng rng( nodeKey );
+		const Vector2f& multipliers = m_accumulatedMultipliers[ lvl ];
+
+		for( uint i = 0u; i < m_maxNodePoints; ++i )
+		{
+			ulong choosenIdx = begin + rng.uniform( uint32_t( end - begin ) );
+			Surfel s = ( *m_points )[ m_keys[ choosenIdx ].m_index ];
+			s.multiplyTangents( multipliers );
+			selectedPoints[ i ] = s;
+		}
+
+		return selectedPoints;
+	}
+
+	template< typename Morton >
+	inline typename TopDownCreator< Morton >::ContentsArray TopDownCreator< Morton >
+	::gatherPoints( const ulong begin, const ulong end ) const
+	{
+		ContentsArray points( end - begin );
+		for( ulong i = begin; i < end; ++i )
+		{
+			points[ i - begin ] = ( *m_points )[ m_keys[ i ].m_index ];
+		}
+
+		return points;
+	}
+}
+
+#endif
@@ -26,7 +26,26 @@ int main(int argc, char **argv)
 
 	QDir::setCurrent( QApplication::applicationDirPath() );
 	
-	MainWindow window;
+	// Reconstruction configuration: --config=<file .json> and --<key>=<value> overrides. A positional argument is the
+	// dataset to open.
+	vector< string > args;
+	omicron::hierarchy::ReconstructionConfig config;
+	try
+	{
+		config = omicron::hierarchy::ReconstructionConfig::fromArgs( argc, argv, args );
+	}
+	catch( const runtime_error& e )
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+	
+	if( !args.empty() )
+	{
+		config.m_dataset = args[ 0 ];
+	}
+	
+	MainWindow window( config );
 
     window.show();
 	window.resize( 1280, 1280 );
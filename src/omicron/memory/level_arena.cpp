@@ -0,0 +1,160 @@
+#include <mutex>
+#include "omicron/memory/level_arena.h"
+#include "omicron/memory/tbb_allocator.h"
+
+namespace omicron::memory
+{
+	thread_local LevelArena* LevelArena::m_current( nullptr );
+	atomic< LevelArena::PageMapLeaf* > LevelArena::m_pageMap[ size_t( 1 ) << LevelArena::ROOT_BITS ];
+	atomic_ulong LevelArena::m_totalPages( 0ul );
+	atomic_ulong LevelArena::m_levelPages[ LevelArena::MAX_LEVELS ];
+
+	LevelArena::LevelArena( const uint level, const ulong batch )
+	: m_level( level ),
+	m_batch( batch ),
+	m_page( nullptr ),
+	m_offset( 0 )
+	{}
+
+	LevelArena::~LevelArena()
+	{
+		if( m_current == this )
+		{
+			m_current = nullptr;
+		}
+
+		if( m_page != nullptr )
+		{
+			releasePage( m_page );
+		}
+	}
+
+	void LevelArena::startBatch( const ulong batch )
+	{
+		if( m_page != nullptr )
+		{
+			releasePage( m_page );
+			m_page = nullptr;
+		}
+
+		m_batch = batch;
+	}
+
+	void* LevelArena::allocate( const size_t bytes )
+	{
+		if( bytes > MAX_BLOCK_SIZE )
+		{
+			return nullptr;
+		}
+
+		size_t size = blockSize( bytes );
+
+		if( m_page == nullptr || m_offset + size > PAGE_SIZE )
+		{
+			if( m_page != nullptr )
+			{
+				releasePage( m_page );
+			}
+
+			m_page = acquirePage();
+			m_offset = firstBlockOffset();
+
+			if( m_page == nullptr )
+			{
+				return nullptr;
+			}
+		}
+
+		char* block = reinterpret_cast< char* >( m_page ) + m_offset;
+		*reinterpret_cast< size_t* >( block ) = size;
+		m_offset += size;
+		m_page->m_live.fetch_add( 1ul, memory_order_relaxed );
+		AllocStatistics::notifyAlloc( size );
+
+		return block + BLOCK_HEADER_SIZE;
+	}
+
+	void LevelArena::deallocate( void* p )
+	{
+		AllocStatistics::notifyDealloc( *reinterpret_cast< size_t* >( static_cast< char* >( p ) - BLOCK_HEADER_SIZE ) );
+		releasePage( pageOf( p ) );
+	}
+
+	LevelArena::PageHeader* LevelArena::acquirePage()
+	{
+		void* memory = scalable_aligned_malloc( PAGE_SIZE, PAGE_SIZE );
+		if( memory == nullptr )
+		{
+			throw bad_alloc();
+		}
+
+		uintptr_t pageIdx = uintptr_t( memory ) >> PAGE_SHIFT;
+		if( pageIdx >> PAGE_INDEX_BITS )
+		{
+			scalable_aligned_free( memory );
+			return nullptr;
+		}
+
+		PageHeader* page = new( memory ) PageHeader;
+		page->m_live.store( 1ul, memory_order_relaxed );
+		page->m_level = m_level % MAX_LEVELS;
+
+		setPageBit( pageIdx, true );
+
+		++m_totalPages;
+		++m_levelPages[ page->m_level ];
+
+		return page;
+	}
+
+	void LevelArena::releasePage( PageHeader* page )
+	{
+		if( page->m_live.fetch_sub( 1ul, memory_order_acq_rel ) == 1ul )
+		{
+			setPageBit( uintptr_t( page ) >> PAGE_SHIFT, false );
+
+			--m_levelPages[ page->m_level ];
+			--m_totalPages;
+
+			page->~PageHeader();
+			scalable_aligned_free( page );
+		}
+	}
+
+	void LevelArena::setPageBit( uintptr_t pageIdx, bool value )
+	{
+		atomic< PageMapLeaf* >& root = m_pageMap[ pageIdx >> LEAF_BITS ];
+		PageMapLeaf* leaf = root.load( memory_order_acquire );
+
+		if( leaf == nullptr )
+		{
+			// Leaves are never freed, so a racing allocation is simply discarded.
+			PageMapLeaf* newLeaf = new PageMapLeaf[ LEAF_WORDS ];
+			for( int i = 0; i < LEAF_WORDS; ++i )
+			{
+				newLeaf[ i ].store( 0ul, memory_order_relaxed );
+			}
+
+			if( root.compare_exchange_strong( leaf, newLeaf, memory_order_acq_rel ) )
+			{
+				leaf = newLeaf;
+			}
+			else
+			{
+				delete[] newLeaf;
+			}
+		}
+
+		uintptr_t bit = pageIdx & ( ( 1 << LEAF_BITS ) - 1 );
+		uint64_t mask = uint64_t( 1 ) << ( bit % 64 );
+
+		if( value )
+		{
+			leaf[ bit / 64 ].fetch_or( mask, memory_order_release );
+		}
+		else
+		{
+			leaf[ bit / 64 ].fetch_and( ~mask, memory_order_release );
+		}
+	}
+}
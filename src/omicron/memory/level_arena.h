@@ -0,0 +1,173 @@
+#ifndef LEVEL_ARENA_H
+#define LEVEL_ARENA_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "omicron/basic/basic_types.h"
+
+namespace omicron::memory
+{
+	using namespace std;
+	using namespace basic;
+
+	/** Opts a type in arena allocation. Only TbbAllocator< T > with IsArenaAllocated< T > true takes blocks from the
+	 * active arena and looks them up in the page map on deallocation. Other allocations made in an ArenaScope, such as
+	 * list nodes and temporaries, do not pin arena pages and do not pay the lookup. */
+	template< typename T >
+	struct IsArenaAllocated : false_type {};
+
+	/** Bump allocator for nodes and contents created in the same octree level and creation batch. Memory is taken from
+	 * large pages aligned to their size. Each page counts its live blocks, so deallocating a block is a single atomic
+	 * decrement and the page is dropped as a whole when its last block dies. Nodes created together are usually released
+	 * together, so releasing a subtree gives back entire pages instead of many small blocks.
+	 *
+	 * An arena is activated in the calling thread by an ArenaScope. TbbAllocator allocates types opted in by
+	 * IsArenaAllocated from the active arena when there is one and falls back to the scalable allocator otherwise. Each
+	 * block has a small header with its size, so live blocks are reported to AllocStatistics as they are allocated and
+	 * deallocated, as the scalable allocator does. The unused space of partially filled pages is not reported, so
+	 * arenas are meant to be long-lived, one per level and thread, and filled across creation batches.
+	 *
+	 * An arena is meant to be used by one thread. Blocks can be deallocated by any thread and can outlive the arena. */
+	class LevelArena
+	{
+	public:
+		static constexpr int PAGE_SHIFT = 21;
+		static constexpr size_t PAGE_SIZE = size_t( 1 ) << PAGE_SHIFT;
+		/** Bigger blocks are not allocated from arenas, to bound the space lost at the end of pages. */
+		static constexpr size_t MAX_BLOCK_SIZE = PAGE_SIZE / 8;
+		/** Alignment of all blocks. */
+		static constexpr size_t ALIGNMENT = 16;
+		/** Size of the header before each block. */
+		static constexpr size_t BLOCK_HEADER_SIZE = ALIGNMENT;
+		static constexpr int MAX_LEVELS = 32;
+
+		/** @param level is the octree level of the nodes that will be allocated. It is used for statistics only.
+		 * @param batch identifies the creation batch. */
+		LevelArena( const uint level, const ulong batch );
+
+		LevelArena( const LevelArena& ) = delete;
+		LevelArena& operator=( const LevelArena& ) = delete;
+
+		/** The current page is dropped only after its remaining blocks die. */
+		~LevelArena();
+
+		/** Starts a new creation batch. Blocks of the next batch do not share pages with the previous one. */
+		void startBatch( const ulong batch );
+
+		/** @returns a block with at least the given size or nullptr if the size is bigger than MAX_BLOCK_SIZE. */
+		void* allocate( const size_t bytes );
+
+		/** @returns the arena memory taken by a block with the given size, which is what AllocStatistics is notified
+		 * of. */
+		static size_t blockSize( const size_t bytes )
+		{
+			return ( ( bytes + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 ) ) + BLOCK_HEADER_SIZE;
+		}
+
+		uint level() const { return m_level; }
+
+		ulong batch() const { return m_batch; }
+
+		/** @returns the arena activated in the calling thread or nullptr if none. */
+		static LevelArena* current() { return m_current; }
+
+		/** @returns true if p was allocated by a LevelArena. THREAD SAFE. */
+		static bool owns( const void* p );
+
+		/** Deallocates a block allocated by a LevelArena. THREAD SAFE. */
+		static void deallocate( void* p );
+
+		/** @returns the number of pages in use. */
+		static ulong pagesInUse() { return m_totalPages.load(); }
+
+		/** @returns the number of pages in use for a given level. */
+		static ulong pagesInUse( const uint level ) { return m_levelPages[ level % MAX_LEVELS ].load(); }
+
+	private:
+		friend class ArenaScope;
+
+		/** Header in the beginning of each page. */
+		typedef struct PageHeader
+		{
+			/** Live blocks plus one while the page is the current page of an arena. */
+			atomic_ulong m_live;
+			uint m_level;
+		} PageHeader;
+
+		// The page map is a two-level radix tree with one bit per possible page in a 48-bit address space.
+		static constexpr int ADDRESS_BITS = 48;
+		static constexpr int PAGE_INDEX_BITS = ADDRESS_BITS - PAGE_SHIFT;
+		static constexpr int LEAF_BITS = 13;
+		static constexpr int ROOT_BITS = PAGE_INDEX_BITS - LEAF_BITS;
+		static constexpr int LEAF_WORDS = ( 1 << LEAF_BITS ) / 64;
+
+		using PageMapLeaf = atomic< uint64_t >;
+
+		static PageHeader* pageOf( const void* p )
+		{
+			return reinterpret_cast< PageHeader* >( uintptr_t( p ) & ~( PAGE_SIZE - 1 ) );
+		}
+
+		static size_t firstBlockOffset() { return ( sizeof( PageHeader ) + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 ); }
+
+		/** @returns a new page with one reference for its arena or nullptr if the system allocator returns memory that
+		 * cannot be addressed by the page map. */
+		PageHeader* acquirePage();
+
+		/** Releases one reference of the page, dropping it if it is the last one. */
+		static void releasePage( PageHeader* page );
+
+		static void setPageBit( uintptr_t pageIdx, bool value );
+
+		uint m_level;
+		ulong m_batch;
+		PageHeader* m_page;
+		size_t m_offset;
+
+		static thread_local LevelArena* m_current;
+		static atomic< PageMapLeaf* > m_pageMap[ size_t( 1 ) << ROOT_BITS ];
+		static atomic_ulong m_totalPages;
+		static atomic_ulong m_levelPages[ MAX_LEVELS ];
+	};
+
+	/** Activates an arena in the calling thread while in scope. Scopes can be nested. */
+	class ArenaScope
+	{
+	public:
+		ArenaScope( LevelArena& arena )
+		: m_previous( LevelArena::m_current )
+		{
+			LevelArena::m_current = &arena;
+		}
+
+		ArenaScope( const ArenaScope& ) = delete;
+		ArenaScope& operator=( const ArenaScope& ) = delete;
+
+		~ArenaScope() { LevelArena::m_current = m_previous; }
+
+	private:
+		LevelArena* m_previous;
+	};
+
+	inline bool LevelArena::owns( const void* p )
+	{
+		uintptr_t pageIdx = uintptr_t( p ) >> PAGE_SHIFT;
+		if( pageIdx >> PAGE_INDEX_BITS )
+		{
+			return false;
+		}
+
+		PageMapLeaf* leaf = m_pageMap[ pageIdx >> LEAF_BITS ].load( memory_order_acquire );
+		if( leaf == nullptr )
+		{
+			return false;
+		}
+
+		uintptr_t bit = pageIdx & ( ( 1 << LEAF_BITS ) - 1 );
+		return ( leaf[ bit / 64 ].load( memory_order_acquire ) >> ( bit % 64 ) ) & 1u;
+	}
+}
+
+#endif
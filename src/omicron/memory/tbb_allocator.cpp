@@ -2,5 +2,8 @@
 
 namespace omicron::memory
 {
-	atomic_ulong AllocStatistics::m_allocated( 0 );
+	atomic_long AllocStatistics::m_allocated( 0 );
+	AllocStatistics::Shard AllocStatistics::m_shards[ AllocStatistics::N_SHARDS ];
+	atomic_int AllocStatistics::m_nextShard( 0 );
+	thread_local int AllocStatistics::m_threadShard( -1 );
 }
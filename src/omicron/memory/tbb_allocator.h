@@ -6,6 +6,7 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <algorithm>
 
 #define SCALABLE
 
@@ -18,6 +19,7 @@
 
 #include <sstream>
 #include "omicron/hierarchy/hierarchy_creation_log.h"
+#include "omicron/memory/level_arena.h"
 
 #define DEBUG
 
@@ -26,45 +28,88 @@ using namespace tbb;
 
 namespace omicron::memory
 {
-	/** Statistics for allocations in the multithreaded environment. A counter of allocated bytes is maintened per
-	 * thread. The counters can be negative in case bytes are allocated in a thread and deallocated in another.
-	 * The total allocated report will be correct, though. IMPORTANT: the scalable allocator memory overhead is not
-	 * taken into consideration in the report. */
+	/** Statistics for allocations in the multithreaded environment. Each thread accumulates its allocated bytes in a
+	 * cache-line-padded shard, which is flushed to a global counter when it goes over FLUSH_THRESHOLD bytes in
+	 * absolute value. Threads are assigned to shards round-robin, so threads only contend on the global counter once
+	 * per flush. The shards can be negative in case bytes are allocated in a thread and deallocated in another. The
+	 * approximate total is the global counter alone and differs from the exact total by at most
+	 * N_SHARDS * FLUSH_THRESHOLD bytes. IMPORTANT: the scalable allocator memory overhead is not taken into
+	 * consideration in the report. */
 	class AllocStatistics
 	{
 	public:
-		//using map = unordered_map< thread::id, ulong >;
+		static constexpr int N_SHARDS = 64;
+		static constexpr long FLUSH_THRESHOLD = 1l << 16;
 		
 		static void notifyAlloc( size_t bytes )
 		{
-			//m_stats[ this_thread::get_id() ] += bytes;
-			m_allocated += bytes;
+			add( long( bytes ) );
 		}
 		
 		static void notifyDealloc( size_t bytes )
 		{
-			//m_stats[ this_thread::get_id() ] -= bytes;
-			m_allocated -= bytes;
+			add( -long( bytes ) );
 		}
 		
+		/** @returns the exact allocated bytes if no allocation is being made concurrently. Reads all shards. */
 		static ulong totalAllocated()
 		{
-// 			ulong allocated = 0;
-// 			for( map::value_type entry : m_stats ) 
-// 			{
-// 				allocated += entry.second;
-// 			}
-// 			
-// 			return allocated;
-			return m_allocated.load();
+			long allocated = m_allocated.load( memory_order_acquire );
+			for( const Shard& shard : m_shards )
+			{
+				allocated += shard.m_delta.load( memory_order_acquire );
+			}
+			
+			return ulong( std::max( allocated, 0l ) );
 		}
+		
+		/** @returns the allocated bytes with an error of at most maxApproximationError(). Reads only the global
+		 * counter, so it is cheap enough for frequent checks, such as memory quotas. */
+		static ulong approxTotalAllocated()
+		{
+			return ulong( std::max( m_allocated.load( memory_order_relaxed ), 0l ) );
+		}
+		
+		static constexpr ulong maxApproximationError() { return N_SHARDS * FLUSH_THRESHOLD; }
+		
 	private:
-		static atomic_ulong m_allocated;
-		//static map m_stats;
+		/** Per-thread counter in its own cache line. */
+		typedef struct alignas( 64 ) Shard
+		{
+			atomic_long m_delta;
+		} Shard;
+		
+		static void add( long bytes )
+		{
+			Shard& shard = m_shards[ shardIdx() ];
+			long delta = shard.m_delta.fetch_add( bytes, memory_order_relaxed ) + bytes;
+			
+			if( delta > FLUSH_THRESHOLD || delta < -FLUSH_THRESHOLD )
+			{
+				m_allocated.fetch_add( shard.m_delta.exchange( 0l, memory_order_acq_rel ), memory_order_acq_rel );
+			}
+		}
+		
+		static int shardIdx()
+		{
+			// Plain thread_local without dynamic initialization, since it is used by the global operator new.
+			if( m_threadShard == -1 )
+			{
+				m_threadShard = m_nextShard.fetch_add( 1, memory_order_relaxed ) % N_SHARDS;
+			}
+			
+			return m_threadShard;
+		}
+		
+		static atomic_long m_allocated;
+		static Shard m_shards[ N_SHARDS ];
+		static atomic_int m_nextShard;
+		static thread_local int m_threadShard;
 	};
 	
 	/** Threading Building Blocks scalable_allocator wrapper. Reports allocations and deallocations in order to maintain
-	 * statists of use. */
+	 * statists of use. Allocations of types opted in by IsArenaAllocated are taken from the calling thread's LevelArena
+	 * when an ArenaScope is active. */
 	template< typename T >
 	class TbbAllocator
 	{
@@ -94,6 +139,17 @@ namespace omicron::memory
 		
 		pointer allocate( size_type n )
 		{
+			if constexpr( IsArenaAllocated< T >::value && alignof( T ) <= LevelArena::ALIGNMENT )
+			{
+				if( LevelArena::current() != nullptr )
+				{
+					if( void* p = LevelArena::current()->allocate( sizeof( T ) * n ) )
+					{
+						return static_cast< pointer >( p );
+					}
+				}
+			}
+			
 			#ifdef SCALABLE
 				pointer p = InternalAlloc().allocate( n );
 				AllocStatistics::notifyAlloc( scalable_msize( p ) );
@@ -106,6 +162,15 @@ namespace omicron::memory
 		}
 		void deallocate( pointer p, size_type = 0 )
 		{
+			if constexpr( IsArenaAllocated< T >::value && alignof( T ) <= LevelArena::ALIGNMENT )
+			{
+				if( LevelArena::owns( p ) )
+				{
+					LevelArena::deallocate( p );
+					return;
+				}
+			}
+			
 			#ifdef SCALABLE
 				AllocStatistics::notifyDealloc( scalable_msize( p ) );
 				InternalAlloc().deallocate( p, 0 );
@@ -0,0 +1,464 @@
+#ifndef BOX_BATCH_TESTS_H
+#define BOX_BATCH_TESTS_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Geometry>
+
+#if defined( __x86_64__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+	#include <immintrin.h>
+	#define BOX_TESTS_SIMD
+#endif
+
+namespace omicron::renderer
+{
+	using namespace std;
+	using namespace Eigen;
+
+	/** Axis aligned boxes in structure of arrays layout, so consecutive boxes are loaded together in SIMD registers. */
+	class BoxBatch
+	{
+	public:
+		void clear()
+		{
+			for( vector< float >& coords : m_coords )
+			{
+				coords.clear();
+			}
+		}
+
+		void reserve( const size_t nBoxes )
+		{
+			for( vector< float >& coords : m_coords )
+			{
+				coords.reserve( nBoxes );
+			}
+		}
+
+		void push_back( const AlignedBox3f& box )
+		{
+			for( int i = 0; i < 3; ++i )
+			{
+				m_coords[ i ].push_back( box.min()[ i ] );
+				m_coords[ i + 3 ].push_back( box.max()[ i ] );
+			}
+		}
+
+		size_t size() const { return m_coords[ 0 ].size(); }
+
+		bool empty() const { return m_coords[ 0 ].empty(); }
+
+		AlignedBox3f box( const size_t i ) const
+		{
+			return AlignedBox3f( Vector3f( m_coords[ 0 ][ i ], m_coords[ 1 ][ i ], m_coords[ 2 ][ i ] ),
+								 Vector3f( m_coords[ 3 ][ i ], m_coords[ 4 ][ i ], m_coords[ 5 ][ i ] ) );
+		}
+
+		/** @param coord is the axis of the min corners ( 0 to 2 ) or the axis plus 3 of the max corners ( 3 to 5 ).
+		 * @returns the coordinates of all boxes. */
+		const float* coords( const int coord ) const { return m_coords[ coord ].data(); }
+
+	private:
+		array< vector< float >, 6 > m_coords;
+	};
+
+	/** Results of BoxBatchTests::test(). Bit i % 64 of word i / 64 is the result of box i. */
+	class BoxTestMasks
+	{
+	public:
+		size_t size() const { return m_size; }
+
+		bool isCullable( const size_t i ) const { return ( m_cullable[ i / 64 ] >> ( i % 64 ) ) & 1ul; }
+
+		bool isRenderable( const size_t i ) const { return ( m_renderable[ i / 64 ] >> ( i % 64 ) ) & 1ul; }
+
+		const vector< uint64_t >& cullable() const { return m_cullable; }
+
+		const vector< uint64_t >& renderable() const { return m_renderable; }
+
+	private:
+		friend class BoxBatchTests;
+
+		void reset( const size_t nBoxes )
+		{
+			m_size = nBoxes;
+			m_cullable.assign( ( nBoxes + 63 ) / 64, 0ul );
+			m_renderable.assign( ( nBoxes + 63 ) / 64, 0ul );
+		}
+
+		/** Sets the results of the boxes beginning at i, which must be in the same word. */
+		void set( const size_t i, const uint64_t cullableBits, const uint64_t renderableBits )
+		{
+			m_cullable[ i / 64 ] |= cullableBits << ( i % 64 );
+			m_renderable[ i / 64 ] |= renderableBits << ( i % 64 );
+		}
+
+		size_t m_size = 0ul;
+		vector< uint64_t > m_cullable;
+		vector< uint64_t > m_renderable;
+	};
+
+	/** Frustum culling and projection size tests of boxes, the same ones as SplatRenderer::isCullable() and
+	 * SplatRenderer::isRenderable(). Batches of boxes are tested with SSE or AVX, chosen at runtime, and the results
+	 * of all instruction sets are the same as the ones of the single box tests. It holds as long as the compiler does
+	 * not contract floating point operations, which is the case for the x86-64 baseline without FMA. */
+	class BoxBatchTests
+	{
+	public:
+		enum Isa
+		{
+			SCALAR,
+			SSE,
+			AVX
+		};
+
+		/** @param viewProj is the projection matrix times the view matrix. */
+		BoxBatchTests( const Matrix4f& viewProj = Matrix4f::Identity() );
+
+		const Matrix4f& viewProj() const { return m_viewProj; }
+
+		/** @returns the best instruction set supported by the CPU. */
+		static Isa bestIsa();
+
+		static bool isSupported( const Isa isa ) { return isa <= bestIsa(); }
+
+		/** @returns true if the box is outside of a frustum plane. */
+		bool isCullable( const AlignedBox3f& box ) const
+		{
+			return isCullable( box.min().x(), box.min().y(), box.min().z(), box.max().x(), box.max().y(),
+							   box.max().z() );
+		}
+
+		/** @returns true if the largest of two projected box diagonals has squared length less than projThresh in
+		 * normalized device coordinates. */
+		bool isRenderable( const AlignedBox3f& box, const float projThresh ) const
+		{
+			return isRenderable( box.min().x(), box.min().y(), box.min().z(), box.max().x(), box.max().y(),
+								 box.max().z(), projThresh );
+		}
+
+		/** Tests all boxes of a batch with the best instruction set. */
+		void test( const BoxBatch& boxes, const float projThresh, BoxTestMasks& out_masks ) const
+		{
+			test( boxes, projThresh, out_masks, bestIsa() );
+		}
+
+		/** Tests all boxes of a batch with the given instruction set.
+		 * @throws logic_error if the instruction set is not supported. */
+		void test( const BoxBatch& boxes, const float projThresh, BoxTestMasks& out_masks, const Isa isa ) const;
+
+	private:
+		bool isCullable( const float minX, const float minY, const float minZ, const float maxX, const float maxY,
+						 const float maxZ ) const;
+
+		bool isRenderable( const float minX, const float minY, const float minZ, const float maxX, const float maxY,
+						   const float maxZ, const float projThresh ) const;
+
+		/** @returns the dot product of a row with ( x, y, z, 1 ). */
+		static float dot( const float* row, const float x, const float y, const float z )
+		{
+			return row[ 0 ] * x + row[ 1 ] * y + row[ 2 ] * z + row[ 3 ];
+		}
+
+		/** Tests boxes [ begin, end ) one at a time. */
+		void testScalar( const BoxBatch& boxes, const size_t begin, const size_t end, const float projThresh,
+						 BoxTestMasks& out_masks ) const;
+
+		#ifdef BOX_TESTS_SIMD
+			/** Tests boxes [ 0, size rounded down to 4 ). @returns the number of tested boxes. */
+			size_t testSse( const BoxBatch& boxes, const float projThresh, BoxTestMasks& out_masks ) const;
+
+			/** Tests boxes [ 0, size rounded down to 8 ). @returns the number of tested boxes. */
+			__attribute__(( target( "avx" ) ))
+			size_t testAvx( const BoxBatch& boxes, const float projThresh, BoxTestMasks& out_masks ) const;
+
+			static __m128 dotSse( const float* row, const __m128 x, const __m128 y, const __m128 z )
+			{
+				return _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( row[ 0 ] ), x ),
+														   _mm_mul_ps( _mm_set1_ps( row[ 1 ] ), y ) ),
+											   _mm_mul_ps( _mm_set1_ps( row[ 2 ] ), z ) ),
+								   _mm_set1_ps( row[ 3 ] ) );
+			}
+
+			static __m128 selectSse( const __m128 mask, const __m128 a, const __m128 b )
+			{
+				return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+			}
+
+			__attribute__(( target( "avx" ) ))
+			static __m256 dotAvx( const float* row, const __m256 x, const __m256 y, const __m256 z )
+			{
+				return _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( _mm256_set1_ps( row[ 0 ] ), x ),
+																	_mm256_mul_ps( _mm256_set1_ps( row[ 1 ] ), y ) ),
+													 _mm256_mul_ps( _mm256_set1_ps( row[ 2 ] ), z ) ),
+									  _mm256_set1_ps( row[ 3 ] ) );
+			}
+
+			__attribute__(( target( "avx" ) ))
+			static __m256 selectAvx( const __m256 mask, const __m256 a, const __m256 b )
+			{
+				return _mm256_or_ps( _mm256_and_ps( mask, a ), _mm256_andnot_ps( mask, b ) );
+			}
+		#endif
+
+		/** Boxes with a z coordinate nearer to 0 than this use the other z, since their projection is undefined. */
+		static constexpr float Z_DELTA = 1e-6f;
+
+		Matrix4f m_viewProj;
+
+		/** Frustum planes. A point is inside if the dot products of ( x, y, z, 1 ) with all planes are not negative. */
+		array< array< float, 4 >, 6 > m_planes;
+
+		/** Rows 0, 1 and 3 of viewProj, used to project x, y and w. */
+		array< array< float, 4 >, 3 > m_rows;
+	};
+
+	inline BoxBatchTests::BoxBatchTests( const Matrix4f& viewProj )
+	: m_viewProj( viewProj )
+	{
+		for( int i = 0; i < 4; ++i )
+		{
+			for( int plane = 0; plane < 6; ++plane )
+			{
+				float sign = ( plane % 2 == 0 ) ? 1.f : -1.f;
+				m_planes[ plane ][ i ] = viewProj( 3, i ) + sign * viewProj( plane / 2, i );
+			}
+
+			m_rows[ 0 ][ i ] = viewProj( 0, i );
+			m_rows[ 1 ][ i ] = viewProj( 1, i );
+			m_rows[ 2 ][ i ] = viewProj( 3, i );
+		}
+	}
+
+	inline BoxBatchTests::Isa BoxBatchTests::bestIsa()
+	{
+		#ifdef BOX_TESTS_SIMD
+			static const Isa isa = ( __builtin_cpu_supports( "avx" ) ) ? AVX : SSE;
+			return isa;
+		#else
+			return SCALAR;
+		#endif
+	}
+
+	inline bool BoxBatchTests::isCullable( const float minX, const float minY, const float minZ, const float maxX,
+										   const float maxY, const float maxZ ) const
+	{
+		// The corner farthest along the plane normal is the last one to leave the plane's positive side.
+		for( const array< float, 4 >& plane : m_planes )
+		{
+			float x = ( plane[ 0 ] >= 0.f ) ? maxX : minX;
+			float y = ( plane[ 1 ] >= 0.f ) ? maxY : minY;
+			float z = ( plane[ 2 ] >= 0.f ) ? maxZ : minZ;
+
+			if( dot( plane.data(), x, y, z ) < 0.f )
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	inline bool BoxBatchTests::isRenderable( const float minX, const float minY, const float minZ, const float maxX,
+											 const float maxY, const float maxZ, const float projThresh ) const
+	{
+		float z0 = ( fabs( minZ ) < Z_DELTA ) ? maxZ : minZ;
+		float z1 = ( fabs( maxZ ) < Z_DELTA ) ? minZ : maxZ;
+
+		const float* rowX = m_rows[ 0 ].data();
+		const float* rowY = m_rows[ 1 ].data();
+		const float* rowW = m_rows[ 2 ].data();
+
+		// Diagonal from min to max.
+		float w = dot( rowW, minX, minY, z0 );
+		float x0 = dot( rowX, minX, minY, z0 ) / w;
+		float y0 = dot( rowY, minX, minY, z0 ) / w;
+
+		w = dot( rowW, maxX, maxY, z1 );
+		float dx = dot( rowX, maxX, maxY, z1 ) / w - x0;
+		float dy = dot( rowY, maxX, maxY, z1 ) / w - y0;
+		float diagonal0 = dx * dx + dy * dy;
+
+		// Diagonal from ( min.x, max.y, max.z ) to ( max.x, min.y, min.z ).
+		w = dot( rowW, minX, maxY, z1 );
+		x0 = dot( rowX, minX, maxY, z1 ) / w;
+		y0 = dot( rowY, minX, maxY, z1 ) / w;
+
+		w = dot( rowW, maxX, minY, z0 );
+		dx = dot( rowX, maxX, minY, z0 ) / w - x0;
+		dy = dot( rowY, maxX, minY, z0 ) / w - y0;
+		float diagonal1 = dx * dx + dy * dy;
+
+		return std::max( diagonal0, diagonal1 ) < projThresh;
+	}
+
+	inline void BoxBatchTests::test( const BoxBatch& boxes, const float projThresh, BoxTestMasks& out_masks,
+									 const Isa isa ) const
+	{
+		if( !isSupported( isa ) )
+		{
+			throw logic_error( "Instruction set not supported by the CPU." );
+		}
+
+		out_masks.reset( boxes.size() );
+
+		size_t nTested = 0ul;
+		#ifdef BOX_TESTS_SIMD
+			if( isa == AVX )
+			{
+				nTested = testAvx( boxes, projThresh, out_masks );
+			}
+			else if( isa == SSE )
+			{
+				nTested = testSse( boxes, projThresh, out_masks );
+			}
+		#endif
+
+		testScalar( boxes, nTested, boxes.size(), projThresh, out_masks );
+	}
+
+	inline void BoxBatchTests::testScalar( const BoxBatch& boxes, const size_t begin, const size_t end,
+										   const float projThresh, BoxTestMasks& out_masks ) const
+	{
+		for( size_t i = begin; i < end; ++i )
+		{
+			float minX = boxes.coords( 0 )[ i ];
+			float minY = boxes.coords( 1 )[ i ];
+			float minZ = boxes.coords( 2 )[ i ];
+			float maxX = boxes.coords( 3 )[ i ];
+			float maxY = boxes.coords( 4 )[ i ];
+			float maxZ = boxes.coords( 5 )[ i ];
+
+			out_masks.set( i, isCullable( minX, minY, minZ, maxX, maxY, maxZ ),
+						   isRenderable( minX, minY, minZ, maxX, maxY, maxZ, projThresh ) );
+		}
+	}
+
+	#ifdef BOX_TESTS_SIMD
+		inline size_t BoxBatchTests::testSse( const BoxBatch& boxes, const float projThresh,
+											  BoxTestMasks& out_masks ) const
+		{
+			const size_t end = boxes.size() & ~size_t( 3 );
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7fffffff ) );
+			const __m128 delta = _mm_set1_ps( Z_DELTA );
+			const __m128 thresh = _mm_set1_ps( projThresh );
+
+			for( size_t i = 0ul; i < end; i += 4 )
+			{
+				__m128 minX = _mm_loadu_ps( boxes.coords( 0 ) + i );
+				__m128 minY = _mm_loadu_ps( boxes.coords( 1 ) + i );
+				__m128 minZ = _mm_loadu_ps( boxes.coords( 2 ) + i );
+				__m128 maxX = _mm_loadu_ps( boxes.coords( 3 ) + i );
+				__m128 maxY = _mm_loadu_ps( boxes.coords( 4 ) + i );
+				__m128 maxZ = _mm_loadu_ps( boxes.coords( 5 ) + i );
+
+				__m128 cullable = zero;
+				for( const array< float, 4 >& plane : m_planes )
+				{
+					__m128 dist = dotSse( plane.data(), ( plane[ 0 ] >= 0.f ) ? maxX : minX,
+										  ( plane[ 1 ] >= 0.f ) ? maxY : minY, ( plane[ 2 ] >= 0.f ) ? maxZ : minZ );
+					cullable = _mm_or_ps( cullable, _mm_cmplt_ps( dist, zero ) );
+				}
+
+				__m128 z0 = selectSse( _mm_cmplt_ps( _mm_and_ps( minZ, absMask ), delta ), maxZ, minZ );
+				__m128 z1 = selectSse( _mm_cmplt_ps( _mm_and_ps( maxZ, absMask ), delta ), minZ, maxZ );
+
+				const float* rowX = m_rows[ 0 ].data();
+				const float* rowY = m_rows[ 1 ].data();
+				const float* rowW = m_rows[ 2 ].data();
+
+				__m128 w = dotSse( rowW, minX, minY, z0 );
+				__m128 x0 = _mm_div_ps( dotSse( rowX, minX, minY, z0 ), w );
+				__m128 y0 = _mm_div_ps( dotSse( rowY, minX, minY, z0 ), w );
+
+				w = dotSse( rowW, maxX, maxY, z1 );
+				__m128 dx = _mm_sub_ps( _mm_div_ps( dotSse( rowX, maxX, maxY, z1 ), w ), x0 );
+				__m128 dy = _mm_sub_ps( _mm_div_ps( dotSse( rowY, maxX, maxY, z1 ), w ), y0 );
+				__m128 diagonal0 = _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+
+				w = dotSse( rowW, minX, maxY, z1 );
+				x0 = _mm_div_ps( dotSse( rowX, minX, maxY, z1 ), w );
+				y0 = _mm_div_ps( dotSse( rowY, minX, maxY, z1 ), w );
+
+				w = dotSse( rowW, maxX, minY, z0 );
+				dx = _mm_sub_ps( _mm_div_ps( dotSse( rowX, maxX, minY, z0 ), w ), x0 );
+				dy = _mm_sub_ps( _mm_div_ps( dotSse( rowY, maxX, minY, z0 ), w ), y0 );
+				__m128 diagonal1 = _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+
+				// Operand order gives the same NaN propagation as std::max( diagonal0, diagonal1 ).
+				__m128 renderable = _mm_cmplt_ps( _mm_max_ps( diagonal1, diagonal0 ), thresh );
+
+				out_masks.set( i, uint64_t( _mm_movemask_ps( cullable ) ), uint64_t( _mm_movemask_ps( renderable ) ) );
+			}
+
+			return end;
+		}
+
+		__attribute__(( target( "avx" ) ))
+		inline size_t BoxBatchTests::testAvx( const BoxBatch& boxes, const float projThresh,
+											  BoxTestMasks& out_masks ) const
+		{
+			const size_t end = boxes.size() & ~size_t( 7 );
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 absMask = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7fffffff ) );
+			const __m256 delta = _mm256_set1_ps( Z_DELTA );
+			const __m256 thresh = _mm256_set1_ps( projThresh );
+
+			for( size_t i = 0ul; i < end; i += 8 )
+			{
+				__m256 minX = _mm256_loadu_ps( boxes.coords( 0 ) + i );
+				__m256 minY = _mm256_loadu_ps( boxes.coords( 1 ) + i );
+				__m256 minZ = _mm256_loadu_ps( boxes.coords( 2 ) + i );
+				__m256 maxX = _mm256_loadu_ps( boxes.coords( 3 ) + i );
+				__m256 maxY = _mm256_loadu_ps( boxes.coords( 4 ) + i );
+				__m256 maxZ = _mm256_loadu_ps( boxes.coords( 5 ) + i );
+
+				__m256 cullable = zero;
+				for( const array< float, 4 >& plane : m_planes )
+				{
+					__m256 dist = dotAvx( plane.data(), ( plane[ 0 ] >= 0.f ) ? maxX : minX,
+										  ( plane[ 1 ] >= 0.f ) ? maxY : minY, ( plane[ 2 ] >= 0.f ) ? maxZ : minZ );
+					cullable = _mm256_or_ps( cullable, _mm256_cmp_ps( dist, zero, _CMP_LT_OQ ) );
+				}
+
+				__m256 z0 = selectAvx( _mm256_cmp_ps( _mm256_and_ps( minZ, absMask ), delta, _CMP_LT_OQ ), maxZ, minZ );
+				__m256 z1 = selectAvx( _mm256_cmp_ps( _mm256_and_ps( maxZ, absMask ), delta, _CMP_LT_OQ ), minZ, maxZ );
+
+				const float* rowX = m_rows[ 0 ].data();
+				const float* rowY = m_rows[ 1 ].data();
+				const float* rowW = m_rows[ 2 ].data();
+
+				__m256 w = dotAvx( rowW, minX, minY, z0 );
+				__m256 x0 = _mm256_div_ps( dotAvx( rowX, minX, minY, z0 ), w );
+				__m256 y0 = _mm256_div_ps( dotAvx( rowY, minX, minY, z0 ), w );
+
+				w = dotAvx( rowW, maxX, maxY, z1 );
+				__m256 dx = _mm256_sub_ps( _mm256_div_ps( dotAvx( rowX, maxX, maxY, z1 ), w ), x0 );
+				__m256 dy = _mm256_sub_ps( _mm256_div_ps( dotAvx( rowY, maxX, maxY, z1 ), w ), y0 );
+				__m256 diagonal0 = _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) );
+
+				w = dotAvx( rowW, minX, maxY, z1 );
+				x0 = _mm256_div_ps( dotAvx( rowX, minX, maxY, z1 ), w );
+				y0 = _mm256_div_ps( dotAvx( rowY, minX, maxY, z1 ), w );
+
+				w = dotAvx( rowW, maxX, minY, z0 );
+				dx = _mm256_sub_ps( _mm256_div_ps( dotAvx( rowX, maxX, minY, z0 ), w ), x0 );
+				dy = _mm256_sub_ps( _mm256_div_ps( dotAvx( rowY, maxX, minY, z0 ), w ), y0 );
+				__m256 diagonal1 = _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) );
+
+				__m256 renderable = _mm256_cmp_ps( _mm256_max_ps( diagonal1, diagonal0 ), thresh, _CMP_LT_OQ );
+
+				out_masks.set( i, uint64_t( _mm256_movemask_ps( cullable ) ),
+							   uint64_t( _mm256_movemask_ps( renderable ) ) );
+			}
+
+			return end;
+		}
+	#endif
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Geometry>
+
+namespace omicron::renderer
+{
+	using namespace std;
+	using namespace Eigen;
+
+	/** Camera path in the format of the files in camera_paths/, which are written by Tucano::Path. The file begins with
+	 * the number of key positions. Each key has a homogeneous position, the orientation quaternion ( x y z w ), a
+	 * second quaternion that is ignored and an integer flag that is also ignored. The path is sampled by linear
+	 * interpolation of positions and spherical interpolation of orientations between consecutive keys. */
+	class CameraPath
+	{
+	public:
+		/** Key camera transform. The camera to world transform is the translation by m_position after the rotation by
+		 * m_orientation. */
+		typedef struct Key
+		{
+			Vector3f m_position;
+			Quaternionf m_orientation;
+		} Key;
+
+		CameraPath() = default;
+
+		/** Loads the path from a file.
+		 * @throws runtime_error if the file cannot be read. */
+		explicit CameraPath( const string& filename );
+
+		void addKey( const Vector3f& position, const Quaternionf& orientation );
+
+		const vector< Key >& keys() const { return m_keys; }
+
+		/** @returns the number of frames needed to replay the path with framesPerSegment frames between keys. */
+		uint nFrames( const uint framesPerSegment ) const;
+
+		/** @returns the camera to world transform at a given frame of the replay. */
+		Affine3f cameraAtFrame( const uint frame, const uint framesPerSegment ) const;
+
+		/** @returns the view matrix at a given frame of the replay. */
+		Affine3f viewAtFrame( const uint frame, const uint framesPerSegment ) const
+		{
+			return cameraAtFrame( frame, framesPerSegment ).inverse();
+		}
+
+	private:
+		vector< Key > m_keys;
+	};
+
+	inline CameraPath::CameraPath( const string& filename )
+	{
+		ifstream in( filename );
+		if( !in.is_open() )
+		{
+			throw runtime_error( "Cannot open camera path " + filename );
+		}
+
+		int nKeys;
+		in >> nKeys;
+
+		for( int i = 0; i < nKeys; ++i )
+		{
+			Vector4f position;
+			Quaternionf orientation;
+			Quaternionf ignoredOrientation;
+			int ignoredFlag;
+
+			in >> position.x() >> position.y() >> position.z() >> position.w()
+			   >> orientation.x() >> orientation.y() >> orientation.z() >> orientation.w()
+			   >> ignoredOrientation.x() >> ignoredOrientation.y() >> ignoredOrientation.z() >> ignoredOrientation.w()
+			   >> ignoredFlag;
+
+			if( !in )
+			{
+				throw runtime_error( "Malformed camera path " + filename );
+			}
+
+			addKey( position.head< 3 >() / position.w(), orientation );
+		}
+	}
+
+	inline void CameraPath::addKey( const Vector3f& position, const Quaternionf& orientation )
+	{
+		m_keys.push_back( Key{ position, orientation.normalized() } );
+	}
+
+	inline uint CameraPath::nFrames( const uint framesPerSegment ) const
+	{
+		return ( m_keys.empty() ) ? 0u : uint( m_keys.size() - 1 ) * framesPerSegment + 1u;
+	}
+
+	inline Affine3f CameraPath::cameraAtFrame( const uint frame, const uint framesPerSegment ) const
+	{
+		if( m_keys.empty() )
+		{
+			throw logic_error( "Sampling an empty camera path." );
+		}
+
+		size_t segment = std::min( size_t( frame / framesPerSegment ), m_keys.size() - 1 );
+		const Key& begin = m_keys[ segment ];
+
+		Affine3f camera;
+		if( segment == m_keys.size() - 1 )
+		{
+			camera = Translation3f( begin.m_position ) * begin.m_orientation;
+		}
+		else
+		{
+			const Key& end = m_keys[ segment + 1 ];
+			float t = float( frame % framesPerSegment ) / float( framesPerSegment );
+
+			camera = Translation3f( ( 1.f - t ) * begin.m_position + t * end.m_position )
+				* begin.m_orientation.slerp( t, end.m_orientation );
+		}
+
+		return camera;
+	}
+}
+
+#endif
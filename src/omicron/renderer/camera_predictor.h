@@ -0,0 +1,137 @@
+#ifndef CAMERA_PREDICTOR_H
+#define CAMERA_PREDICTOR_H
+
+#include <cmath>
+#include <Eigen/Geometry>
+#include "omicron/renderer/box_batch_tests.h"
+#include "omicron/util/ring_buffer.h"
+
+namespace omicron::renderer
+{
+	using namespace std;
+	using namespace Eigen;
+	using util::RingBuffer;
+
+	/** Predicts the camera some frames ahead by extrapolating its motion in the recent frames. The linear and angular
+	 * velocities are the mean ones over the kept history, so the jitter of single frames is smoothed out. NOT THREAD
+	 * SAFE. */
+	class CameraPredictor
+	{
+	public:
+		/** @param historySize is the number of recent frames used to estimate the velocities. Must be at least 2. */
+		CameraPredictor( const uint historySize = 4u );
+
+		/** Records the view matrix of a frame. */
+		void push( const Affine3f& view );
+
+		void clear() { m_poses.clear(); }
+
+		/** @returns true if there are enough frames to estimate the velocities. */
+		bool canPredict() const { return m_poses.size() > 1ul; }
+
+		/** @returns the mean translation of the eye per frame, in world coordinates. */
+		Vector3f linearVelocity() const;
+
+		/** @returns the mean rotation of the camera per frame, in world coordinates. */
+		AngleAxisf angularVelocity() const;
+
+		/** @returns the camera to world transform predicted framesAhead frames after the last recorded one. It is the
+		 * last recorded camera if the velocities cannot be estimated yet. */
+		Affine3f predictCamera( const float framesAhead ) const;
+
+		/** @returns the view matrix predicted framesAhead frames after the last recorded one. */
+		Affine3f predictView( const float framesAhead ) const { return predictCamera( framesAhead ).inverse(); }
+
+	private:
+		/** Camera to world transform. The translation is the eye position. */
+		typedef struct Pose
+		{
+			Vector3f m_position;
+			Quaternionf m_orientation;
+		} Pose;
+
+		RingBuffer< Pose > m_poses;
+	};
+
+	/** Culling and projection tests of a view that is not the rendered one, such as a predicted view. Same tests as
+	 * SplatRenderer. */
+	class ViewTests
+	{
+	public:
+		ViewTests( const Matrix4f& projection, const Affine3f& view )
+		: m_tests( Matrix4f( projection * view.matrix() ) ),
+		m_eye( view.inverse().translation() )
+		{}
+
+		const Vector3f& eyePosition() const { return m_eye; }
+
+		bool isCullable( const AlignedBox3f& box ) const { return m_tests.isCullable( box ); }
+
+		bool isRenderable( const AlignedBox3f& box, const float projThresh ) const
+		{
+			return m_tests.isRenderable( box, projThresh );
+		}
+
+		const BoxBatchTests& boxTests() const { return m_tests; }
+
+	private:
+		BoxBatchTests m_tests;
+		Vector3f m_eye;
+	};
+
+	inline CameraPredictor::CameraPredictor( const uint historySize )
+	: m_poses( historySize )
+	{
+		if( historySize < 2u )
+		{
+			throw logic_error( "CameraPredictor needs at least 2 frames of history." );
+		}
+	}
+
+	inline void CameraPredictor::push( const Affine3f& view )
+	{
+		Affine3f camera = view.inverse();
+		m_poses.push( Pose{ camera.translation(), Quaternionf( camera.rotation() ).normalized() } );
+	}
+
+	inline Vector3f CameraPredictor::linearVelocity() const
+	{
+		if( !canPredict() )
+		{
+			return Vector3f::Zero();
+		}
+
+		return ( m_poses.back().m_position - m_poses[ 0 ].m_position ) / float( m_poses.size() - 1 );
+	}
+
+	inline AngleAxisf CameraPredictor::angularVelocity() const
+	{
+		if( !canPredict() )
+		{
+			return AngleAxisf( 0.f, Vector3f::UnitZ() );
+		}
+
+		// The shortest rotation from the oldest to the newest orientation. Its angle is in [ 0, pi ].
+		AngleAxisf rotation( m_poses.back().m_orientation * m_poses[ 0 ].m_orientation.conjugate() );
+		return AngleAxisf( rotation.angle() / float( m_poses.size() - 1 ), rotation.axis() );
+	}
+
+	inline Affine3f CameraPredictor::predictCamera( const float framesAhead ) const
+	{
+		if( m_poses.empty() )
+		{
+			throw logic_error( "Predicting a camera without history." );
+		}
+
+		const Pose& last = m_poses.back();
+		AngleAxisf angularVel = angularVelocity();
+
+		// Rotations beyond half a turn would be undone by the quaternion double cover, so the extrapolation stops there.
+		float angle = std::min( angularVel.angle() * framesAhead, float( M_PI ) );
+		Quaternionf orientation = ( AngleAxisf( angle, angularVel.axis() ) * last.m_orientation ).normalized();
+
+		return Translation3f( last.m_position + linearVelocity() * framesAhead ) * orientation;
+	}
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <stdexcept>
+#include "omicron/renderer/gpu_buffer_arena.h"
+#include "omicron/hierarchy/gpu_alloc_statistics.h"
+
+namespace omicron::renderer
+{
+	using hierarchy::GpuAllocStatistics;
+
+	GpuBufferArena::GpuBufferArena( GpuBufferBackend& backend, const uint elementSize, const uint minSlotElements,
+									const uint nSizeClasses, const size_t bufferBytes )
+	: m_backend( backend ),
+	m_elementSize( elementSize ),
+	m_minSlotElements( minSlotElements ),
+	m_sizeClasses( nSizeClasses ),
+	m_nUsedSlots( 0ul ),
+	m_allocatedBytes( 0ul ),
+	m_usedBytes( 0ul )
+	{
+		if( elementSize == 0u || minSlotElements == 0u || nSizeClasses == 0u )
+		{
+			throw logic_error( "GpuBufferArena needs non-empty elements, slots and size classes." );
+		}
+
+		for( uint i = 0u; i < nSizeClasses; ++i )
+		{
+			size_t slotBytes = size_t( slotElements( i ) ) * m_elementSize;
+
+			SizeClass& sizeClass = m_sizeClasses[ i ];
+			sizeClass.m_slotsPerBuffer = std::max( bufferBytes / slotBytes, size_t( 1 ) );
+			sizeClass.m_nEmptyBuffers = 0u;
+		}
+	}
+
+	GpuBufferArena::~GpuBufferArena()
+	{
+		for( const pair< const BufferId, Buffer >& entry : m_buffers )
+		{
+			GpuAllocStatistics::notifyDealloc( bufferBytes( entry.second.m_sizeClass ) );
+			m_backend.destroyBuffer( entry.first );
+		}
+	}
+
+	bool GpuBufferArena::allocate( const uint nElements, Slot& out_slot )
+	{
+		if( nElements > maxSlotElements() )
+		{
+			return false;
+		}
+
+		uint sizeClassIdx = sizeClassOf( nElements );
+
+		lock_guard< mutex > lock( m_mutex );
+
+		SizeClass& sizeClass = m_sizeClasses[ sizeClassIdx ];
+		if( sizeClass.m_free.empty() )
+		{
+			createBuffer( sizeClassIdx );
+		}
+
+		out_slot = sizeClass.m_free.back();
+		sizeClass.m_free.pop_back();
+		out_slot.m_nElements = nElements;
+
+		Buffer& buffer = m_buffers[ out_slot.m_buffer ];
+		if( buffer.m_nUsed++ == 0u )
+		{
+			--sizeClass.m_nEmptyBuffers;
+		}
+		++m_nUsedSlots;
+		m_usedBytes += size_t( slotElements( sizeClassIdx ) ) * m_elementSize;
+
+		return true;
+	}
+
+	void GpuBufferArena::release( const Slot& slot )
+	{
+		lock_guard< mutex > lock( m_mutex );
+
+		auto bufferIt = m_buffers.find( slot.m_buffer );
+		if( bufferIt == m_buffers.end() )
+		{
+			throw logic_error( "Releasing a slot of a buffer that is not in the GpuBufferArena." );
+		}
+
+		SizeClass& sizeClass = m_sizeClasses[ slot.m_sizeClass ];
+		sizeClass.m_free.push_back( slot );
+		--m_nUsedSlots;
+		m_usedBytes -= size_t( slotElements( slot.m_sizeClass ) ) * m_elementSize;
+
+		Buffer& buffer = bufferIt->second;
+		if( --buffer.m_nUsed == 0u )
+		{
+			// One empty buffer is kept per size class, so alternating loads and unloads do not recreate buffers.
+			if( sizeClass.m_nEmptyBuffers > 0u )
+			{
+				destroyBuffer( slot.m_buffer, slot.m_sizeClass );
+			}
+			else
+			{
+				++sizeClass.m_nEmptyBuffers;
+			}
+		}
+	}
+
+	void GpuBufferArena::upload( const Slot& slot, const void* data )
+	{
+		m_backend.upload( slot.m_buffer, size_t( slot.m_first ) * m_elementSize, size_t( slot.m_nElements ) * m_elementSize,
+						  data );
+	}
+
+	void GpuBufferArena::draw( const Slot& slot )
+	{
+		m_backend.draw( slot.m_buffer, slot.m_first, slot.m_nElements );
+	}
+
+	size_t GpuBufferArena::nBuffers() const
+	{
+		lock_guard< mutex > lock( m_mutex );
+		return m_buffers.size();
+	}
+
+	size_t GpuBufferArena::nUsedSlots() const
+	{
+		lock_guard< mutex > lock( m_mutex );
+		return m_nUsedSlots;
+	}
+
+	size_t GpuBufferArena::allocatedBytes() const
+	{
+		lock_guard< mutex > lock( m_mutex );
+		return m_allocatedBytes;
+	}
+
+	size_t GpuBufferArena::slackBytes() const
+	{
+		lock_guard< mutex > lock( m_mutex );
+		return m_allocatedBytes - m_usedBytes;
+	}
+
+	size_t GpuBufferArena::footprint( const uint nElements, const uint elementSize, const uint minSlotElements,
+									  const uint nSizeClasses )
+	{
+		size_t slotElements = minSlotElements;
+		for( uint i = 1u; i < nSizeClasses && slotElements < nElements; ++i )
+		{
+			slotElements <<= 1;
+		}
+
+		return std::max( size_t( nElements ), slotElements ) * elementSize;
+	}
+
+	uint GpuBufferArena::sizeClassOf( const uint nElements ) const
+	{
+		uint sizeClass = 0u;
+		while( slotElements( sizeClass ) < nElements )
+		{
+			++sizeClass;
+		}
+
+		return sizeClass;
+	}
+
+	void GpuBufferArena::createBuffer( const uint sizeClassIdx )
+	{
+		SizeClass& sizeClass = m_sizeClasses[ sizeClassIdx ];
+		size_t bytes = bufferBytes( sizeClassIdx );
+
+		BufferId id = m_backend.createBuffer( bytes );
+		m_buffers[ id ] = Buffer{ sizeClassIdx, 0u };
+		++sizeClass.m_nEmptyBuffers;
+
+		m_allocatedBytes += bytes;
+		GpuAllocStatistics::notifyAlloc( bytes );
+
+		// Slots are pushed backwards, so the first slots of the buffer are allocated first.
+		Slot slot;
+		slot.m_buffer = id;
+		slot.m_sizeClass = sizeClassIdx;
+		for( uint i = sizeClass.m_slotsPerBuffer; i > 0u; --i )
+		{
+			slot.m_first = ( i - 1 ) * slotElements( sizeClassIdx );
+			sizeClass.m_free.push_back( slot );
+		}
+	}
+
+	void GpuBufferArena::destroyBuffer( const BufferId id, const uint sizeClassIdx )
+	{
+		vector< Slot >& freeSlots = m_sizeClasses[ sizeClassIdx ].m_free;
+		freeSlots.erase( remove_if( freeSlots.begin(), freeSlots.end(),
+									[ & ]( const Slot& slot ) { return slot.m_buffer == id; } ),
+						 freeSlots.end() );
+		m_buffers.erase( id );
+
+		size_t bytes = bufferBytes( sizeClassIdx );
+		m_allocatedBytes -= bytes;
+		GpuAllocStatistics::notifyDealloc( bytes );
+
+		m_backend.destroyBuffer( id );
+	}
+}
@@ -0,0 +1,158 @@
+#ifndef GPU_BUFFER_ARENA_H
+#define GPU_BUFFER_ARENA_H
+
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include "omicron/basic/basic_types.h"
+
+namespace omicron::renderer
+{
+	using namespace std;
+	using namespace basic;
+
+	/** Creates, fills and draws the GPU buffers of a GpuBufferArena. It is separated from the arena so the arena
+	 * bookkeeping can be used with other graphics APIs and tested without a graphics context. Implementations are used
+	 * only by the thread that owns the graphics context. */
+	class GpuBufferBackend
+	{
+	public:
+		using BufferId = uint;
+
+		virtual ~GpuBufferBackend() {}
+
+		/** @returns a new buffer with the given size in bytes. */
+		virtual BufferId createBuffer( const size_t bytes ) = 0;
+
+		virtual void destroyBuffer( const BufferId buffer ) = 0;
+
+		/** Writes data in the buffer, beginning at the given byte offset. */
+		virtual void upload( const BufferId buffer, const size_t offset, const size_t bytes, const void* data ) = 0;
+
+		/** Draws count elements of the buffer, beginning at the first element. */
+		virtual void draw( const BufferId buffer, const uint first, const uint count ) = 0;
+	};
+
+	/** Suballocator of GPU buffers. Large buffers are carved into fixed-size slots, each buffer having slots of a single
+	 * size class. Size classes have power-of-two element counts. Released slots go to a free list of their size class and
+	 * a buffer is destroyed when all its slots are free and its size class already has another empty buffer. Slots are
+	 * drawn with their first element as offset, so many small clouds share a few buffer objects. Buffer creation and
+	 * destruction are reported to GpuAllocStatistics. THREAD SAFE, but the backend operations are done in the calling
+	 * thread. */
+	class GpuBufferArena
+	{
+	public:
+		using BufferId = GpuBufferBackend::BufferId;
+
+		/** Elements allocated in a buffer. */
+		typedef struct Slot
+		{
+			Slot()
+			: m_buffer( 0u ),
+			m_sizeClass( 0u ),
+			m_first( 0u ),
+			m_nElements( 0u )
+			{}
+
+			BufferId m_buffer;
+			uint m_sizeClass;
+			/** Index of the first element of the slot in the buffer. */
+			uint m_first;
+			/** Number of used elements. */
+			uint m_nElements;
+		} Slot;
+
+		/** @param elementSize is the size of an element in bytes.
+		 * @param minSlotElements is the number of elements in the slots of the smallest size class.
+		 * @param nSizeClasses is the number of size classes. The slots of a class have twice the elements of the previous
+		 * one.
+		 * @param bufferBytes is the size of the buffers. A buffer has at least one slot. */
+		GpuBufferArena( GpuBufferBackend& backend, const uint elementSize, const uint minSlotElements,
+						const uint nSizeClasses, const size_t bufferBytes );
+
+		GpuBufferArena( const GpuBufferArena& ) = delete;
+		GpuBufferArena& operator=( const GpuBufferArena& ) = delete;
+
+		/** Destroys all buffers. */
+		~GpuBufferArena();
+
+		/** Allocates a slot for nElements.
+		 * @returns false if nElements is bigger than maxSlotElements() and nothing is allocated. */
+		bool allocate( const uint nElements, Slot& out_slot );
+
+		/** Releases a slot. Its buffer is destroyed if all its slots are free and there is another empty buffer in
+		 * its size class. */
+		void release( const Slot& slot );
+
+		/** Writes the slot elements. data must have slot.m_nElements elements. */
+		void upload( const Slot& slot, const void* data );
+
+		void draw( const Slot& slot );
+
+		uint slotElements( const uint sizeClass ) const { return m_minSlotElements << sizeClass; }
+
+		uint maxSlotElements() const { return slotElements( m_sizeClasses.size() - 1 ); }
+
+		size_t nBuffers() const;
+
+		size_t nUsedSlots() const;
+
+		/** @returns the total size of the buffers in bytes. */
+		size_t allocatedBytes() const;
+
+		/** @returns the bytes of the buffers that are not in used slots. They are the free slots of partially used
+		 * buffers and the empty buffers kept for reuse. */
+		size_t slackBytes() const;
+
+		/** @returns the bytes of the slot that would be allocated for nElements. Elements that do not fit in a slot are
+		 * accounted with their own size. */
+		size_t footprint( const uint nElements ) const
+		{
+			return footprint( nElements, m_elementSize, m_minSlotElements, m_sizeClasses.size() );
+		}
+
+		/** Same as the member footprint(), for an arena with the given ctor parameters. It can be used without the
+		 * arena, which may only exist in the thread that owns the graphics context. */
+		static size_t footprint( const uint nElements, const uint elementSize, const uint minSlotElements,
+								 const uint nSizeClasses );
+
+	private:
+		typedef struct Buffer
+		{
+			uint m_sizeClass;
+			uint m_nUsed;
+		} Buffer;
+
+		typedef struct SizeClass
+		{
+			uint m_slotsPerBuffer;
+			uint m_nEmptyBuffers;
+			vector< Slot > m_free;
+		} SizeClass;
+
+		/** @returns the smallest size class with slots that fit nElements. */
+		uint sizeClassOf( const uint nElements ) const;
+
+		size_t bufferBytes( const uint sizeClass ) const
+		{
+			return size_t( m_sizeClasses[ sizeClass ].m_slotsPerBuffer ) * slotElements( sizeClass ) * m_elementSize;
+		}
+
+		void createBuffer( const uint sizeClass );
+
+		void destroyBuffer( const BufferId buffer, const uint sizeClass );
+
+		GpuBufferBackend& m_backend;
+		uint m_elementSize;
+		uint m_minSlotElements;
+		vector< SizeClass > m_sizeClasses;
+		unordered_map< BufferId, Buffer > m_buffers;
+		size_t m_nUsedSlots;
+		size_t m_allocatedBytes;
+		/** Bytes of the used slots. */
+		size_t m_usedBytes;
+		mutable mutex m_mutex;
+	};
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef HEADLESS_RENDERER_H
+#define HEADLESS_RENDERER_H
+
+#include <cmath>
+#include <unordered_set>
+#include <Eigen/Geometry>
+#include "omicron/hierarchy/o1_octree_node.h"
+#include "omicron/hierarchy/gpu_alloc_statistics.h"
+#include "omicron/renderer/box_batch_tests.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+
+namespace omicron::renderer
+{
+	using namespace std;
+	using namespace Eigen;
+	using hierarchy::GpuAllocStatistics;
+
+	/** CPU stand-in for SplatRenderer, used to track fronts without an OpenGL context. It has the same culling and
+	 * projection tests, but rendering only counts the nodes and points and GPU loading only accounts the memory in
+	 * GpuAllocStatistics. The camera is set directly with a view matrix. */
+	class HeadlessRenderer
+	{
+	public:
+		using Node = hierarchy::O1OctreeNode< Surfel >;
+
+		/** @param fovy is the vertical field of view in degrees. */
+		HeadlessRenderer( const float fovy = 60.f, const float aspectRatio = 1.f, const float near = 0.001f,
+						  const float far = 10.f );
+
+		~HeadlessRenderer();
+
+		void setViewMatrix( const Affine3f& view ) { m_view = view; }
+
+		const Affine3f& viewMatrix() const { return m_view; }
+
+		const Matrix4f& projectionMatrix() const { return m_projection; }
+
+		void begin_frame();
+
+		Vector3f eyePosition() const { return m_view.inverse().translation(); }
+
+		bool isCullable( const AlignedBox3f& box ) const { return m_boxTests.isCullable( box ); }
+
+		bool isRenderable( const AlignedBox3f& box, const float projThresh ) const
+		{
+			return m_boxTests.isRenderable( box, projThresh );
+		}
+
+		/** @returns the culling and projection tests of the current frame. */
+		const BoxBatchTests& boxTests() const { return m_boxTests; }
+
+		bool isLoaded( const Node& node ) const { return m_loaded.count( &node ) > 0; }
+
+		/** Accounts the node's points as GPU memory.
+		 * @returns false if the GPU memory is not enough. */
+		bool loadInGpu( Node& node );
+
+		void unloadInGpu( Node& node );
+
+		void resetIterator() {}
+
+		void render( Node& node );
+
+		void eraseFromList( const Node& node ) { ++m_nErased; }
+
+		/** There is no rendering list, so there is nothing to remove. */
+		void removeFromList( const Node& node ) {}
+
+		void removeFromList( const unordered_set< const Node* >& nodes ) {}
+
+		/** Clouds are accounted with their exact size, so there is no slack. */
+		ulong gpuSlackBytes() const { return 0ul; }
+
+		void render_frame() {}
+
+		/** @returns the number of points rendered in the frame. */
+		ulong end_frame() { return m_nRenderedPoints; }
+
+		uint nRenderedNodes() const { return m_nRenderedNodes; }
+
+		uint nErased() const { return m_nErased; }
+
+		size_t nLoaded() const { return m_loaded.size(); }
+
+	private:
+		Matrix4f m_projection;
+		Affine3f m_view;
+		BoxBatchTests m_boxTests;
+
+		/** Nodes accounted as loaded in GPU. */
+		unordered_set< const Node* > m_loaded;
+
+		ulong m_nRenderedPoints;
+		uint m_nRenderedNodes;
+		uint m_nErased;
+	};
+
+	inline HeadlessRenderer::HeadlessRenderer( const float fovy, const float aspectRatio, const float near,
+											   const float far )
+	: m_projection( Matrix4f::Zero() ),
+	m_view( Affine3f::Identity() ),
+	m_nRenderedPoints( 0ul ),
+	m_nRenderedNodes( 0u ),
+	m_nErased( 0u )
+	{
+		// Same projection as Tucano::Camera::setPerspectiveMatrix().
+		float yScale = 1.f / tan( 0.5f * fovy * float( M_PI ) / 180.f );
+		float xScale = yScale / aspectRatio;
+		float depth = near - far;
+
+		m_projection( 0, 0 ) = xScale;
+		m_projection( 1, 1 ) = yScale;
+		m_projection( 2, 2 ) = ( far + near ) / depth;
+		m_projection( 2, 3 ) = 2.f * far * near / depth;
+		m_projection( 3, 2 ) = -1.f;
+	}
+
+	inline HeadlessRenderer::~HeadlessRenderer()
+	{
+		for( const Node* node : m_loaded )
+		{
+			GpuAllocStatistics::notifyDealloc( node->getContents().size() * GpuAllocStatistics::pointSize() );
+		}
+	}
+
+	inline void HeadlessRenderer::begin_frame()
+	{
+		m_boxTests = BoxBatchTests( Matrix4f( m_projection * m_view.matrix() ) );
+
+		m_nRenderedPoints = 0ul;
+		m_nRenderedNodes = 0u;
+		m_nErased = 0u;
+	}
+
+	inline bool HeadlessRenderer::loadInGpu( Node& node )
+	{
+		if( isLoaded( node ) )
+		{
+			return true;
+		}
+
+		if( !GpuAllocStatistics::hasMemoryFor( node.getContents() ) )
+		{
+			return false;
+		}
+
+		m_loaded.insert( &node );
+		GpuAllocStatistics::notifyAlloc( node.getContents().size() * GpuAllocStatistics::pointSize() );
+
+		return true;
+	}
+
+	inline void HeadlessRenderer::unloadInGpu( Node& node )
+	{
+		if( m_loaded.erase( &node ) )
+		{
+			GpuAllocStatistics::notifyDealloc( node.getContents().size() * GpuAllocStatistics::pointSize() );
+		}
+	}
+
+	inline void HeadlessRenderer::render( Node& node )
+	{
+		++m_nRenderedNodes;
+		m_nRenderedPoints += node.getContents().size();
+	}
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef PPM_IMAGE_H
+#define PPM_IMAGE_H
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace omicron::renderer
+{
+	using namespace std;
+
+	/** Writes an RGB image as binary PPM.
+	 * @param pixels has 3 bytes per pixel. Rows are in OpenGL order, the bottom one first, as read by glReadPixels().
+	 * @throws runtime_error if the file cannot be written. */
+	inline void writePpm( const string& filename, const uint8_t* pixels, const uint width, const uint height )
+	{
+		ofstream out( filename, ios::binary );
+		if( !out.is_open() )
+		{
+			throw runtime_error( "Cannot write image " + filename );
+		}
+
+		out << "P6\n" << width << " " << height << "\n" << "255\n";
+
+		for( int i = int( height ) - 1; i >= 0; --i )
+		{
+			out.write( reinterpret_cast< const char* >( pixels ) + size_t( i ) * width * 3, size_t( width ) * 3 );
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,667 @@
+#ifndef SOFTWARE_SPLAT_RENDERER_H
+#define SOFTWARE_SPLAT_RENDERER_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <omp.h>
+#include <Eigen/Dense>
+#include "omicron/hierarchy/reconstruction_params.h"
+#include "omicron/renderer/headless_renderer.h"
+#include "omicron/renderer/ppm_image.h"
+
+namespace omicron::renderer
+{
+	using namespace std;
+	using namespace Eigen;
+
+	/** CPU implementation of the SplatRenderer passes, used to render without an OpenGL context. The surfels are
+	 * rasterized as the shaders in splat_renderer/shader do: the visibility pass fills the depth buffer with the
+	 * surfels pushed back by epsilon, the attribute pass blends the EWA-filtered surfels in front of it (soft z-buffer)
+	 * and the finalization pass normalizes the accumulated colors. Shading is the non-smooth one and multisampling is
+	 * not supported.
+	 *
+	 * The screen is split in tiles. Surfels are set up and binned to the tiles they overlap in parallel, and tiles are
+	 * rasterized in parallel. Each pixel gets its surfels in the order they were rendered, so images do not depend on
+	 * the number of threads.
+	 *
+	 * It has the culling, projection and GPU accounting of HeadlessRenderer, so it can be used in front tracking. The
+	 * rendered nodes are rasterized in render_frame(). */
+	class SoftwareSplatRenderer
+	: public HeadlessRenderer
+	{
+	public:
+		/** Rendering parameters. The defaults are the SplatRenderer ones. */
+		typedef struct Parameters
+		{
+			/** Enables the visibility pass and blending of the surfels near the front surface. */
+			bool m_softZBuffer = true;
+			/** Enables the EWA screen space filter. Needs the soft z-buffer. */
+			bool m_ewaFilter = true;
+			bool m_backfaceCulling = true;
+			/** Method used to find the screen bounds of surfels. */
+			ReconstructionAlgorithm m_pointSizeMethod = ReconstructionAlgorithm( RECONSTRUCTION_ALG );
+			Vector3f m_color = Vector3f( 0.5f, 0.5f, 0.5f );
+			/** Depth tolerance of the soft z-buffer in eye space. */
+			float m_epsilon = 5.f * 1e-3f;
+			float m_shininess = 8.f;
+			float m_radiusScale = 1.f;
+			float m_ewaRadius = 1.f;
+		} Parameters;
+
+		/** @param fovy is the vertical field of view in degrees.
+		 * @param nThreads is the number of rasterization threads. */
+		SoftwareSplatRenderer( const uint width, const uint height, const float fovy = 60.f, const float near = 0.001f,
+							   const float far = 10.f, const int nThreads = omp_get_max_threads() );
+
+		Parameters& parameters() { return m_params; }
+
+		const Parameters& parameters() const { return m_params; }
+
+		/** Begins a frame. The framebuffer is cleared when the frame is rasterized. */
+		void begin_frame();
+
+		/** Queues the contents of a node for rasterization in render_frame(). The node must stay unchanged until
+		 * then. */
+		void render( Node& node );
+
+		/** Queues surfels for rasterization in render_frame(). The array must stay unchanged until then. */
+		void render( const Surfel* surfels, const size_t nSurfels );
+
+		/** Rasterizes the queued surfels into the framebuffer. */
+		void render_frame();
+
+		uint width() const { return m_width; }
+
+		uint height() const { return m_height; }
+
+		/** @returns the final RGB color of a pixel. ( 0, 0 ) is the bottom left pixel, as in OpenGL. */
+		const uint8_t* pixel( const uint x, const uint y ) const { return m_rgb.data() + ( size_t( y ) * m_width + x ) * 3; }
+
+		/** @returns the RGB image, with 3 bytes per pixel and the bottom row first. */
+		const vector< uint8_t >& image() const { return m_rgb; }
+
+		/** @returns the window depth of a pixel in [ 0, 1 ]. It is 1 if no surfel covers the pixel. */
+		float depth( const uint x, const uint y ) const { return m_depth[ size_t( y ) * m_width + x ]; }
+
+		/** @returns the accumulated alpha of a pixel, which is the sum of the filter weights blended in it. */
+		float alpha( const uint x, const uint y ) const { return m_color[ size_t( y ) * m_width + x ].w(); }
+
+		/** Saves the image as binary PPM, as SplatRenderer::saveFbo() does. */
+		void savePpm( const string& filename ) const { writePpm( filename, m_rgb.data(), m_width, m_height ); }
+
+	private:
+		/** Tile side in pixels. */
+		static constexpr int TILE_SIZE = 16;
+
+		/** Surfel data computed once per frame, as the vertex shader outputs. */
+		typedef struct Splat
+		{
+			Vector3f m_cEye;
+			Vector3f m_uEye;
+			Vector3f m_vEye;
+			Vector3f m_nEye;
+			Vector3f m_color;
+			/** Window position of the center. */
+			Vector2f m_cScr;
+			/** Sprite sizes of the visibility and attribute passes, in pixels. */
+			float m_visibilitySize;
+			float m_attributeSize;
+		} Splat;
+
+		/** Sets up the splat of a surfel. @returns false if the surfel is culled or clipped. */
+		bool setup( const Surfel& surfel, const Matrix4f& view, Splat& out_splat ) const;
+
+		/** Finds the normalized device position and half extent of a splat, as pointsprite() in attribute_vs.glsl.
+		 * @returns false if the splat is clipped. */
+		bool pointSprite( const Vector3f& c, const Vector3f& u, const Vector3f& v, Vector2f& out_center,
+						  Vector2f& out_halfExtent ) const;
+
+		/** Phong shading in lighting.glsl. */
+		static Vector3f lighting( const Vector3f& normal, const Vector3f& position, const Vector3f& color,
+								  const float shininess );
+
+		/** @returns the pixel range [ begin, end ) covered by a sprite along an axis. */
+		static void spriteRange( const float center, const float size, const int nPixels, int& out_begin,
+								 int& out_end );
+
+		/** Runs the visibility and attribute passes of a tile. */
+		void rasterizeTile( const int tileX, const int tileY, const vector< uint >& splatIdxs );
+
+		/** Computes the fragment of a splat at a pixel, as attribute_fs.glsl.
+		 * @returns false if the fragment is discarded. */
+		bool fragment( const Splat& splat, const int x, const int y, const bool isVisibilityPass, float& out_depth,
+					   float& out_alpha ) const;
+
+		uint m_width;
+		uint m_height;
+		int m_nThreads;
+		Parameters m_params;
+
+		Matrix4f m_projectionInv;
+		/** Normalized frustum planes in eye space, as setup_uniforms() computes them. */
+		array< Vector4f, 6 > m_frustumPlanes;
+		/** EWA filter kernel samples, as the SplatRenderer 1D texture. */
+		array< float, 256 > m_filterKernel;
+
+		/** Surfel arrays queued in the current frame. */
+		vector< pair< const Surfel*, size_t > > m_queue;
+
+		vector< Splat > m_splats;
+		/** Splat indices of each tile, in rendering order. */
+		vector< vector< uint > > m_tileBins;
+		/** Splat indices binned by each thread. */
+		vector< vector< vector< uint > > > m_threadBins;
+		int m_nTilesX;
+		int m_nTilesY;
+
+		/** Accumulated RGB and alpha of the attribute pass. */
+		vector< Vector4f, aligned_allocator< Vector4f > > m_color;
+		vector< float > m_depth;
+		vector< uint8_t > m_rgb;
+	};
+
+	inline SoftwareSplatRenderer::SoftwareSplatRenderer( const uint width, const uint height, const float fovy,
+														 const float near, const float far, const int nThreads )
+	: HeadlessRenderer( fovy, float( width ) / float( height ), near, far ),
+	m_width( width ),
+	m_height( height ),
+	m_nThreads( std::max( nThreads, 1 ) ),
+	m_nTilesX( ( int( width ) + TILE_SIZE - 1 ) / TILE_SIZE ),
+	m_nTilesY( ( int( height ) + TILE_SIZE - 1 ) / TILE_SIZE ),
+	m_color( size_t( width ) * height ),
+	m_depth( size_t( width ) * height ),
+	m_rgb( size_t( width ) * height * 3 )
+	{
+		if( width == 0u || height == 0u )
+		{
+			throw logic_error( "SoftwareSplatRenderer needs a non-empty framebuffer." );
+		}
+
+		const Matrix4f& projection = projectionMatrix();
+		m_projectionInv = projection.inverse();
+
+		for( int i = 0; i < 6; ++i )
+		{
+			Vector4f plane = projection.row( 3 ) + ( -1.f + 2.f * float( i % 2 ) ) * projection.row( i / 2 );
+			m_frustumPlanes[ i ] = plane / plane.head< 3 >().norm();
+		}
+
+		// Same kernel as SplatRenderer::setup_filter_kernel().
+		const float sigma2 = 0.316228f;
+		for( int i = 0; i < 256; ++i )
+		{
+			float x = float( i ) / 255.f;
+			m_filterKernel[ i ] = exp( -x * x / ( 2.f * sigma2 ) );
+		}
+
+		m_tileBins.resize( size_t( m_nTilesX ) * m_nTilesY );
+		m_threadBins.resize( m_nThreads, vector< vector< uint > >( m_tileBins.size() ) );
+	}
+
+	inline void SoftwareSplatRenderer::begin_frame()
+	{
+		HeadlessRenderer::begin_frame();
+		m_queue.clear();
+	}
+
+	inline void SoftwareSplatRenderer::render( Node& node )
+	{
+		HeadlessRenderer::render( node );
+		render( node.getContents().data(), node.getContents().size() );
+	}
+
+	inline void SoftwareSplatRenderer::render( const Surfel* surfels, const size_t nSurfels )
+	{
+		if( nSurfels > 0ul )
+		{
+			m_queue.push_back( pair< const Surfel*, size_t >( surfels, nSurfels ) );
+		}
+	}
+
+	inline void SoftwareSplatRenderer::render_frame()
+	{
+		if( m_params.m_ewaFilter && !m_params.m_softZBuffer )
+		{
+			throw logic_error( "The EWA filter needs the soft z-buffer." );
+		}
+
+		size_t nSurfels = 0ul;
+		for( const pair< const Surfel*, size_t >& surfels : m_queue )
+		{
+			nSurfels += surfels.second;
+		}
+
+		// Setup. Culled splats are marked with size 0.
+		m_splats.resize( nSurfels );
+		Matrix4f view = viewMatrix().matrix();
+
+		size_t offset = 0ul;
+		for( const pair< const Surfel*, size_t >& surfels : m_queue )
+		{
+			#pragma omp parallel for schedule( static ) num_threads( m_nThreads )
+			for( size_t i = 0ul; i < surfels.second; ++i )
+			{
+				Splat& splat = m_splats[ offset + i ];
+				if( !setup( surfels.first[ i ], view, splat ) )
+				{
+					splat.m_attributeSize = 0.f;
+				}
+			}
+			offset += surfels.second;
+		}
+
+		// The bins of all threads are cleared, since the OpenMP runtime can give less threads than requested and the
+		// bins of the missing threads are still merged.
+		for( vector< vector< uint > >& bins : m_threadBins )
+		{
+			for( vector< uint >& bin : bins )
+			{
+				bin.clear();
+			}
+		}
+
+		// Binning. Each thread bins a contiguous range, so concatenating the thread bins keeps the rendering order.
+		#pragma omp parallel num_threads( m_nThreads )
+		{
+			vector< vector< uint > >& bins = m_threadBins[ omp_get_thread_num() ];
+
+			#pragma omp for schedule( static )
+			for( size_t i = 0ul; i < nSurfels; ++i )
+			{
+				const Splat& splat = m_splats[ i ];
+				if( splat.m_attributeSize == 0.f )
+				{
+					continue;
+				}
+
+				// The attribute sprite is never smaller than the visibility one.
+				int xBegin, xEnd, yBegin, yEnd;
+				spriteRange( splat.m_cScr.x(), splat.m_attributeSize, m_width, xBegin, xEnd );
+				spriteRange( splat.m_cScr.y(), splat.m_attributeSize, m_height, yBegin, yEnd );
+
+				for( int tileY = yBegin / TILE_SIZE; tileY * TILE_SIZE < yEnd; ++tileY )
+				{
+					for( int tileX = xBegin / TILE_SIZE; tileX * TILE_SIZE < xEnd; ++tileX )
+					{
+						bins[ tileY * m_nTilesX + tileX ].push_back( uint( i ) );
+					}
+				}
+			}
+		}
+
+		#pragma omp parallel for schedule( dynamic ) num_threads( m_nThreads )
+		for( size_t tile = 0ul; tile < m_tileBins.size(); ++tile )
+		{
+			vector< uint >& bin = m_tileBins[ tile ];
+			bin.clear();
+			for( int t = 0; t < m_nThreads; ++t )
+			{
+				const vector< uint >& threadBin = m_threadBins[ t ][ tile ];
+				bin.insert( bin.end(), threadBin.begin(), threadBin.end() );
+			}
+
+			rasterizeTile( int( tile % m_nTilesX ), int( tile / m_nTilesX ), bin );
+		}
+	}
+
+	inline bool SoftwareSplatRenderer::setup( const Surfel& surfel, const Matrix4f& view, Splat& out_splat ) const
+	{
+		Vector3f cEye = ( view * Vector4f( surfel.c.x(), surfel.c.y(), surfel.c.z(), 1.f ) ).head< 3 >();
+		Vector3f uEye = m_params.m_radiusScale * ( view.topLeftCorner< 3, 3 >() * surfel.u );
+		Vector3f vEye = m_params.m_radiusScale * ( view.topLeftCorner< 3, 3 >() * surfel.v );
+		Vector3f nEye = uEye.cross( vEye ).normalized();
+
+		if( m_params.m_backfaceCulling && !( nEye.dot( -cEye ) > 0.f ) )
+		{
+			return false;
+		}
+
+		Vector2f center;
+		Vector2f halfExtent;
+		if( !pointSprite( cEye, uEye, vEye, center, halfExtent ) )
+		{
+			return false;
+		}
+
+		// One additional pixel avoids artifacts.
+		float size = std::max( halfExtent.x() * m_width, halfExtent.y() * m_height ) + 1.f;
+
+		out_splat.m_cEye = cEye;
+		out_splat.m_uEye = uEye;
+		out_splat.m_vEye = vEye;
+		out_splat.m_nEye = nEye;
+		out_splat.m_color = lighting( nEye, cEye, m_params.m_color, m_params.m_shininess );
+		out_splat.m_cScr = Vector2f( ( center.x() + 1.f ) * m_width * 0.5f, ( center.y() + 1.f ) * m_height * 0.5f );
+		out_splat.m_visibilitySize = size;
+		out_splat.m_attributeSize = ( m_params.m_ewaFilter ) ? std::max( 2.f, size ) : size;
+
+		return true;
+	}
+
+	inline bool SoftwareSplatRenderer::pointSprite( const Vector3f& c, const Vector3f& u, const Vector3f& v,
+													Vector2f& out_center, Vector2f& out_halfExtent ) const
+	{
+		const Matrix4f& projection = projectionMatrix();
+
+		switch( m_params.m_pointSizeMethod )
+		{
+			case ZPBG01:
+			{
+				// Clips and projects a bounding polygon.
+				Matrix4f basis = Matrix4f::Zero();
+				basis.block< 3, 1 >( 0, 0 ) = u;
+				basis.block< 3, 1 >( 0, 1 ) = v;
+				basis.block< 3, 1 >( 0, 2 ) = c;
+				basis( 3, 3 ) = 1.f;
+				Matrix4f m = projection * basis;
+
+				array< Vector4f, 8 > polygon;
+				polygon[ 0 ] = m * Vector4f( 1.f, 1.f, 1.f, 1.f );
+				polygon[ 1 ] = m * Vector4f( 1.f, -1.f, 1.f, 1.f );
+				polygon[ 2 ] = m * Vector4f( -1.f, -1.f, 1.f, 1.f );
+				polygon[ 3 ] = m * Vector4f( -1.f, 1.f, 1.f, 1.f );
+				int n = 4;
+
+				for( int plane = 0; plane < 6 && n > 0; ++plane )
+				{
+					int axis = plane / 2;
+					float sign = float( -1 + 2 * ( plane % 2 ) );
+					array< Vector4f, 8 > clipped;
+					int k = 0;
+
+					for( int j = 0; j < n; ++j )
+					{
+						const Vector4f& v1 = polygon[ j ];
+						const Vector4f& v2 = polygon[ ( j + 1 ) % n ];
+						float b1 = v1.w() + sign * v1[ axis ];
+						float b2 = v2.w() + sign * v2[ axis ];
+
+						if( b1 > 0.f && b2 > 0.f )
+						{
+							clipped[ k++ ] = v2;
+						}
+						else if( b1 > 0.f || b2 > 0.f )
+						{
+							float a = b1 / ( b1 - b2 );
+							clipped[ k++ ] = ( 1.f - a ) * v1 + a * v2;
+							if( b2 > 0.f )
+							{
+								clipped[ k++ ] = v2;
+							}
+						}
+					}
+
+					polygon = clipped;
+					n = k;
+				}
+
+				if( n == 0 )
+				{
+					return false;
+				}
+
+				Vector2f pMin( 1.f, 1.f );
+				Vector2f pMax( -1.f, -1.f );
+				for( int i = 0; i < n; ++i )
+				{
+					Vector2f p = polygon[ i ].head< 2 >() / polygon[ i ].w();
+					pMin = pMin.cwiseMin( p );
+					pMax = pMax.cwiseMax( p );
+				}
+
+				out_halfExtent = 0.5f * ( pMax - pMin );
+				out_center = pMin + out_halfExtent;
+				break;
+			}
+			case BHZK05:
+			{
+				Vector4f p = projection * Vector4f( c.x(), c.y(), c.z(), 1.f );
+				if( !( p.w() > 0.f ) || fabs( p.z() ) > p.w() )
+				{
+					return false;
+				}
+
+				float r = std::max( u.norm(), v.norm() );
+				out_center = p.head< 2 >() / p.w();
+				out_halfExtent = Vector2f( 0.f, r * projection( 1, 1 ) / fabs( c.z() ) );
+				break;
+			}
+			case WHA07:
+			{
+				float r = std::max( u.norm(), v.norm() );
+				Vector4f c4( c.x(), c.y(), c.z(), 1.f );
+				for( int i = 0; i < 6; ++i )
+				{
+					if( !( m_frustumPlanes[ i ].dot( c4 ) + r > 0.f ) )
+					{
+						return false;
+					}
+				}
+
+				Matrix< float, 4, 3 > basis = Matrix< float, 4, 3 >::Zero();
+				basis.block< 3, 1 >( 0, 0 ) = u;
+				basis.block< 3, 1 >( 0, 1 ) = v;
+				basis.block< 3, 1 >( 0, 2 ) = c;
+				basis( 3, 2 ) = 1.f;
+				Matrix< float, 4, 3 > t = projection * basis;
+
+				Vector3f signs( 1.f, 1.f, -1.f );
+				Vector3f t3 = t.row( 3 ).transpose();
+				float d = signs.dot( t3.cwiseProduct( t3 ) );
+				Vector3f f = signs / d;
+
+				Vector3f p;
+				Vector3f h;
+				for( int i = 0; i < 3; ++i )
+				{
+					Vector3f ti = t.row( i ).transpose();
+					p[ i ] = f.dot( ti.cwiseProduct( t3 ) );
+					h[ i ] = sqrt( std::max( 0.f, p[ i ] * p[ i ] - f.dot( ti.cwiseProduct( ti ) ) ) );
+				}
+
+				out_center = p.head< 2 >();
+				out_halfExtent = h.head< 2 >();
+				break;
+			}
+			case ZRB04:
+			{
+				// Centralized conics.
+				Matrix3f sInv;
+				sInv.row( 0 ) = v.cross( c );
+				sInv.row( 1 ) = -u.cross( c );
+				sInv.row( 2 ) = u.cross( v );
+
+				Matrix3f pInv = m_projectionInv.topLeftCorner< 3, 3 >();
+				pInv( 2, 2 ) = -1.f;
+
+				Matrix3f mInv = sInv * pInv;
+				Matrix3f q = mInv.transpose() * Vector3f( 1.f, 1.f, -1.f ).asDiagonal() * mInv;
+
+				float qa = q( 0, 0 ); float qb = q( 0, 1 );
+				float qc = q( 1, 1 ); float qd = q( 0, 2 );
+				float qe = q( 1, 2 ); float qf = -q( 2, 2 );
+
+				float delta = qa * qc - qb * qb;
+				if( !( delta > 0.f ) )
+				{
+					return false;
+				}
+
+				Vector2f p = ( qb * Vector2f( qe, qd ) - Vector2f( qc * qd, qa * qe ) ) / delta;
+				float bb = qf - Vector2f( qd, qe ).dot( p );
+
+				float delta2 = ( qa / bb ) * ( qc / bb ) - ( qb / bb ) * ( qb / bb );
+				Vector2f h( sqrt( ( qc / bb ) / delta2 ), sqrt( ( qa / bb ) / delta2 ) );
+
+				// The centralized conics method is numerically unstable, so the size is bounded.
+				out_halfExtent = h.cwiseMax( 0.f ).cwiseMin( 0.1f );
+				out_center = p;
+				break;
+			}
+			default:
+			{
+				throw logic_error( "Unknown point size method." );
+			}
+		}
+
+		// Points are clipped by their center.
+		return fabs( out_center.x() ) <= 1.f && fabs( out_center.y() ) <= 1.f;
+	}
+
+	inline Vector3f SoftwareSplatRenderer::lighting( const Vector3f& normal, const Vector3f& position,
+													 const Vector3f& color, const float shininess )
+	{
+		const Vector3f light( 0.f, 0.f, 1.f );
+
+		float dif = std::max( light.dot( normal ), 0.f );
+		Vector3f refl = light - 2.f * normal.dot( light ) * normal;
+
+		Vector3f view = position.normalized();
+		float spe = pow( std::min( std::max( refl.dot( view ), 0.f ), 1.f ), shininess );
+		float rim = pow( 1.f + normal.dot( view ), 3.f );
+
+		return 0.15f * color + 0.6f * dif * color + Vector3f::Constant( 0.1f * spe + 0.1f * rim );
+	}
+
+	inline void SoftwareSplatRenderer::spriteRange( const float center, const float size, const int nPixels,
+													int& out_begin, int& out_end )
+	{
+		// Pixels whose centers are inside the sprite.
+		out_begin = std::max( int( ceil( center - 0.5f * size - 0.5f ) ), 0 );
+		out_end = std::min( int( floor( center + 0.5f * size - 0.5f ) ) + 1, nPixels );
+		out_end = std::max( out_end, out_begin );
+	}
+
+	inline void SoftwareSplatRenderer::rasterizeTile( const int tileX, const int tileY, const vector< uint >& splatIdxs )
+	{
+		int x0 = tileX * TILE_SIZE;
+		int y0 = tileY * TILE_SIZE;
+		int x1 = std::min( x0 + TILE_SIZE, int( m_width ) );
+		int y1 = std::min( y0 + TILE_SIZE, int( m_height ) );
+
+		for( int y = y0; y < y1; ++y )
+		{
+			for( int x = x0; x < x1; ++x )
+			{
+				m_depth[ size_t( y ) * m_width + x ] = 1.f;
+				m_color[ size_t( y ) * m_width + x ] = Vector4f::Zero();
+			}
+		}
+
+		for( int pass = ( m_params.m_softZBuffer ) ? 0 : 1; pass < 2; ++pass )
+		{
+			bool isVisibilityPass = ( pass == 0 );
+
+			for( uint splatIdx : splatIdxs )
+			{
+				const Splat& splat = m_splats[ splatIdx ];
+				float size = ( isVisibilityPass ) ? splat.m_visibilitySize : splat.m_attributeSize;
+
+				int xBegin, xEnd, yBegin, yEnd;
+				spriteRange( splat.m_cScr.x(), size, m_width, xBegin, xEnd );
+				spriteRange( splat.m_cScr.y(), size, m_height, yBegin, yEnd );
+
+				for( int y = std::max( yBegin, y0 ); y < std::min( yEnd, y1 ); ++y )
+				{
+					for( int x = std::max( xBegin, x0 ); x < std::min( xEnd, x1 ); ++x )
+					{
+						float fragDepth;
+						float alpha;
+						size_t idx = size_t( y ) * m_width + x;
+
+						if( !fragment( splat, x, y, isVisibilityPass, fragDepth, alpha ) || !( fragDepth < m_depth[ idx ] ) )
+						{
+							continue;
+						}
+
+						if( isVisibilityPass )
+						{
+							m_depth[ idx ] = fragDepth;
+						}
+						else if( m_params.m_softZBuffer )
+						{
+							// Additive blending, without depth writes.
+							m_color[ idx ] += Vector4f( splat.m_color.x() * alpha, splat.m_color.y() * alpha,
+														splat.m_color.z() * alpha, alpha );
+						}
+						else
+						{
+							m_depth[ idx ] = fragDepth;
+							m_color[ idx ] = Vector4f( splat.m_color.x(), splat.m_color.y(), splat.m_color.z(), alpha );
+						}
+					}
+				}
+			}
+		}
+
+		// Finalization. Empty pixels are white.
+		for( int y = y0; y < y1; ++y )
+		{
+			for( int x = x0; x < x1; ++x )
+			{
+				size_t idx = size_t( y ) * m_width + x;
+				const Vector4f& pixel = m_color[ idx ];
+				Vector3f color = ( pixel.w() > 0.f ) ? Vector3f( pixel.head< 3 >() / pixel.w() ) : Vector3f::Ones();
+
+				for( int i = 0; i < 3; ++i )
+				{
+					float value = std::min( std::max( sqrt( color[ i ] ), 0.f ), 1.f );
+					m_rgb[ idx * 3 + i ] = uint8_t( lround( value * 255.f ) );
+				}
+			}
+		}
+	}
+
+	inline bool SoftwareSplatRenderer::fragment( const Splat& splat, const int x, const int y,
+												 const bool isVisibilityPass, float& out_depth, float& out_alpha ) const
+	{
+		Vector2f fragCoord( float( x ) + 0.5f, float( y ) + 0.5f );
+		Vector4f pNdc( 2.f * fragCoord.x() / m_width - 1.f, 2.f * fragCoord.y() / m_height - 1.f, -1.f, 1.f );
+		Vector4f pEye = m_projectionInv * pNdc;
+		Vector3f qn = pEye.head< 3 >() / pEye.w();
+
+		// Ray and splat plane intersection.
+		Vector3f q = qn * ( splat.m_cEye.dot( splat.m_nEye ) / qn.dot( splat.m_nEye ) );
+		Vector3f d = q - splat.m_cEye;
+
+		Vector2f uv( splat.m_uEye.dot( d ) / splat.m_uEye.squaredNorm(), splat.m_vEye.dot( d ) / splat.m_vEye.squaredNorm() );
+		float w3d = uv.norm();
+		float zval = q.z();
+		float dist = w3d;
+
+		bool isEwa = !isVisibilityPass && m_params.m_ewaFilter;
+		if( isEwa )
+		{
+			float w2d = ( fragCoord - splat.m_cScr ).norm() / m_params.m_ewaRadius;
+			dist = std::min( w2d, w3d );
+
+			// Fragments of the low-pass filter that are outside of the reconstruction filter get the center depth.
+			if( w3d > 1.f )
+			{
+				zval = splat.m_cEye.z();
+			}
+		}
+
+		if( !( dist <= 1.f ) )
+		{
+			return false;
+		}
+
+		out_alpha = ( isEwa ) ? m_filterKernel[ std::min( int( dist * 256.f ), 255 ) ] : 1.f;
+
+		if( isVisibilityPass )
+		{
+			zval -= m_params.m_epsilon;
+		}
+
+		const Matrix4f& projection = projectionMatrix();
+		float ndcDepth = -projection( 2, 3 ) * ( 1.f / zval ) - projection( 2, 2 );
+		out_depth = std::min( std::max( ( ndcDepth + 1.f ) * 0.5f, 0.f ), 1.f );
+
+		return true;
+	}
+}
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef QUANTIZED_SURFELS_H
+#define QUANTIZED_SURFELS_H
+
+#include <cstdint>
+#include <cstring>
+#include "omicron/basic/array.h"
+#include "omicron/memory/tbb_allocator.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+
+namespace omicron
+{
+	using namespace std;
+	using namespace basic;
+
+	/** Compact structure-of-arrays storage for the surfels of a node. Positions are quantized to 16-bit offsets relative
+	 * to a box, usually the node's morton box. Tangent directions are octahedral-encoded with 16 bits per coordinate and
+	 * tangent lengths are quantized to 16 bits relative to the longest tangent in the node. Each surfel needs 18 bytes,
+	 * half of a Surfel.
+	 *
+	 * This is an on-disk format only. OctreeFile writes it and IndexedOctreeFile decodes it when paging sibling groups
+	 * in, so resident nodes still hold Array< Surfel >, the layout SurfelCloud uploads to the GPU. The memory of
+	 * resident nodes is not reduced, so neither is the hierarchy size that fits in RAM_QUOTA.
+	 *
+	 * Serialized layout: | size | box origin | box extent | max u length | max v length | components |. The components
+	 * are 9 arrays of size uint16: position x, y, z, u octahedral x, y, u length, v octahedral x, y, v length. */
+	class QuantizedSurfels
+	{
+	public:
+		using SurfelArray = Array< Surfel >;
+
+		/** Initializes an empty array. */
+		QuantizedSurfels()
+		: m_size( 0u ),
+		m_origin( 0.f, 0.f, 0.f ),
+		m_extent( 0.f, 0.f, 0.f ),
+		m_maxULength( 0.f ),
+		m_maxVLength( 0.f )
+		{}
+
+		/** Quantizes surfels.
+		 * @param box is the quantization box. Centers outside it are clamped to it. */
+		QuantizedSurfels( const SurfelArray& surfels, const AlignedBox3f& box );
+
+		/** Ctor to init from stream.
+		 * @param input is expected to be binary and writen with persist(). */
+		QuantizedSurfels( istream& input );
+
+		/** Ctor to init from a byte sequence writen with persist(), such as a file mapping. */
+		QuantizedSurfels( const char* bytes );
+
+		uint size() const { return m_size; }
+
+		bool empty() const { return m_size == 0u; }
+
+		/** Decodes the i-th surfel. */
+		Surfel operator[]( uint i ) const;
+
+		/** Decodes all surfels. */
+		SurfelArray decode() const;
+
+		/** @returns the size in bytes of the serialization writen by persist(). */
+		size_t serializedSize() const { return serializedSize( m_size ); }
+
+		/** @returns the size in bytes of the serialization of nSurfels surfels. */
+		static size_t serializedSize( uint nSurfels ) { return HEADER_SIZE + N_COMPONENTS * nSurfels * sizeof( uint16_t ); }
+
+		/** Binary persistence. See class documentation for the layout. */
+		void persist( ostream& out ) const;
+
+		/** @returns the maximum position error per axis. */
+		Vec3 maxPositionError() const { return m_extent / float( QUANTIZATION_MAX ); }
+
+		/** Octahedral encoding of a unit direction into [ 0, 1 ]^2. */
+		static Vector2f octEncode( const Vec3& dir );
+
+		/** @returns the unit direction of an octahedral encoding in [ 0, 1 ]^2. */
+		static Vec3 octDecode( const Vector2f& encoded );
+
+	private:
+		enum Component
+		{
+			POS_X, POS_Y, POS_Z,
+			U_OCT_X, U_OCT_Y, U_LENGTH,
+			V_OCT_X, V_OCT_Y, V_LENGTH,
+			N_COMPONENTS
+		};
+
+		static constexpr uint32_t QUANTIZATION_MAX = 0xFFFFu;
+		static constexpr size_t HEADER_SIZE = sizeof( uint32_t ) + 8 * sizeof( float );
+
+		static uint16_t quantize( float value ) // value in [ 0, 1 ].
+		{
+			value = std::min( std::max( value, 0.f ), 1.f );
+			return uint16_t( value * QUANTIZATION_MAX + 0.5f );
+		}
+
+		static float dequantize( uint16_t value ) { return float( value ) / QUANTIZATION_MAX; }
+
+		uint16_t& component( Component c, uint i ) { return m_components[ c * m_size + i ]; }
+
+		uint16_t component( Component c, uint i ) const { return m_components[ c * m_size + i ]; }
+
+		void encodeTangent( const Vec3& tangent, float maxLength, Component octX, uint i );
+
+		Vec3 decodeTangent( float maxLength, Component octX, uint i ) const;
+
+		void initFromBytes( const char* header );
+
+		uint32_t m_size;
+		Vec3 m_origin;
+		Vec3 m_extent;
+		float m_maxULength;
+		float m_maxVLength;
+		vector< uint16_t, TbbAllocator< uint16_t > > m_components;
+	};
+
+	inline QuantizedSurfels::QuantizedSurfels( const SurfelArray& surfels, const AlignedBox3f& box )
+	: m_size( surfels.size() ),
+	m_origin( box.min() ),
+	m_extent( box.sizes() ),
+	m_maxULength( 0.f ),
+	m_maxVLength( 0.f ),
+	m_components( N_COMPONENTS * surfels.size() )
+	{
+		for( const Surfel& surfel : surfels )
+		{
+			m_maxULength = std::max( m_maxULength, surfel.u.norm() );
+			m_maxVLength = std::max( m_maxVLength, surfel.v.norm() );
+		}
+
+		for( uint i = 0; i < m_size; ++i )
+		{
+			const Surfel& surfel = surfels[ i ];
+
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				float normalized = ( m_extent[ axis ] > 0.f )
+					? ( surfel.c[ axis ] - m_origin[ axis ] ) / m_extent[ axis ] : 0.f;
+				component( Component( POS_X + axis ), i ) = quantize( normalized );
+			}
+
+			encodeTangent( surfel.u, m_maxULength, U_OCT_X, i );
+			encodeTangent( surfel.v, m_maxVLength, V_OCT_X, i );
+		}
+	}
+
+	inline QuantizedSurfels::QuantizedSurfels( istream& input )
+	{
+		char header[ HEADER_SIZE ];
+		input.read( header, HEADER_SIZE );
+		initFromBytes( header );
+
+		input.read( reinterpret_cast< char* >( m_components.data() ), m_components.size() * sizeof( uint16_t ) );
+	}
+
+	inline QuantizedSurfels::QuantizedSurfels( const char* bytes )
+	{
+		initFromBytes( bytes );
+		memcpy( m_components.data(), bytes + HEADER_SIZE, m_components.size() * sizeof( uint16_t ) );
+	}
+
+	inline void QuantizedSurfels::initFromBytes( const char* header )
+	{
+		float floats[ 8 ];
+		memcpy( &m_size, header, sizeof( uint32_t ) );
+		memcpy( floats, header + sizeof( uint32_t ), sizeof( floats ) );
+
+		m_origin = Vec3( floats[ 0 ], floats[ 1 ], floats[ 2 ] );
+		m_extent = Vec3( floats[ 3 ], floats[ 4 ], floats[ 5 ] );
+		m_maxULength = floats[ 6 ];
+		m_maxVLength = floats[ 7 ];
+		m_components.resize( N_COMPONENTS * m_size );
+	}
+
+	inline Surfel QuantizedSurfels::operator[]( uint i ) const
+	{
+		Vec3 center;
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			center[ axis ] = m_origin[ axis ] + dequantize( component( Component( POS_X + axis ), i ) ) * m_extent[ axis ];
+		}
+
+		return Surfel( center, decodeTangent( m_maxULength, U_OCT_X, i ), decodeTangent( m_maxVLength, V_OCT_X, i ) );
+	}
+
+	inline QuantizedSurfels::SurfelArray QuantizedSurfels::decode() const
+	{
+		SurfelArray surfels( m_size );
+		for( uint i = 0; i < m_size; ++i )
+		{
+			surfels[ i ] = ( *this )[ i ];
+		}
+
+		return surfels;
+	}
+
+	inline void QuantizedSurfels::persist( ostream& out ) const
+	{
+		Binary::write( out, m_size );
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			Binary::write( out, m_origin[ axis ] );
+		}
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			Binary::write( out, m_extent[ axis ] );
+		}
+		Binary::write( out, m_maxULength );
+		Binary::write( out, m_maxVLength );
+
+		out.write( reinterpret_cast< const char* >( m_components.data() ), m_components.size() * sizeof( uint16_t ) );
+	}
+
+	inline Vector2f QuantizedSurfels::octEncode( const Vec3& dir )
+	{
+		Vec3 n = dir / ( fabs( dir.x() ) + fabs( dir.y() ) + fabs( dir.z() ) );
+		Vector2f encoded( n.x(), n.y() );
+
+		if( n.z() < 0.f )
+		{
+			// Folds the lower hemisphere over the diagonals.
+			encoded = Vector2f( ( 1.f - fabs( n.y() ) ) * ( n.x() >= 0.f ? 1.f : -1.f ),
+								( 1.f - fabs( n.x() ) ) * ( n.y() >= 0.f ? 1.f : -1.f ) );
+		}
+
+		return ( encoded + Vector2f( 1.f, 1.f ) ) * 0.5f;
+	}
+
+	inline Vec3 QuantizedSurfels::octDecode( const Vector2f& encoded )
+	{
+		Vector2f e = encoded * 2.f - Vector2f( 1.f, 1.f );
+		Vec3 n( e.x(), e.y(), 1.f - fabs( e.x() ) - fabs( e.y() ) );
+
+		if( n.z() < 0.f )
+		{
+			n.x() = ( 1.f - fabs( e.y() ) ) * ( e.x() >= 0.f ? 1.f : -1.f );
+			n.y() = ( 1.f - fabs( e.x() ) ) * ( e.y() >= 0.f ? 1.f : -1.f );
+		}
+
+		return n.normalized();
+	}
+
+	inline void QuantizedSurfels::encodeTangent( const Vec3& tangent, float maxLength, Component octX, uint i )
+	{
+		float length = tangent.norm();
+
+		if( length > 0.f )
+		{
+			Vector2f encoded = octEncode( tangent / length );
+			component( octX, i ) = quantize( encoded.x() );
+			component( Component( octX + 1 ), i ) = quantize( encoded.y() );
+			component( Component( octX + 2 ), i ) = quantize( length / maxLength );
+		}
+		else
+		{
+			component( octX, i ) = 0u;
+			component( Component( octX + 1 ), i ) = 0u;
+			component( Component( octX + 2 ), i ) = 0u;
+		}
+	}
+
+	inline Vec3 QuantizedSurfels::decodeTangent( float maxLength, Component octX, uint i ) const
+	{
+		float length = dequantize( component( Component( octX + 2 ), i ) ) * maxLength;
+
+		if( length == 0.f )
+		{
+			return Vec3( 0.f, 0.f, 0.f );
+		}
+
+		Vector2f encoded( dequantize( component( octX, i ) ), dequantize( component( Component( octX + 1 ), i ) ) );
+		return octDecode( encoded ) * length;
+	}
+}
+
+#endif
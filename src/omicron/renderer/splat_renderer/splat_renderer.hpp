@@ -26,12 +26,16 @@
 #include <Eigen/Core>
 #include <string>
 #include <list>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 #include "omicron/renderer/splat_renderer/surfel.hpp"
 #include "omicron/renderer/splat_renderer/surfel_cloud.h"
 #include "omicron/basic/array.h"
 #include "omicron/hierarchy/o1_octree_node.h"
 #include "tucano/utils/frustum.hpp"
 #include "omicron/renderer/ogl_utils.h"
+#include "omicron/renderer/ppm_image.h"
 #include "omicron/memory/global_malloc.h"
 
 // Substitutes the splat rendering shaders by a Tucano phong shader. Bad perfomance, but good for debugging.
@@ -90,6 +94,16 @@ public:
 	/** Removes the node from the rendering list if it is currently being referenced by the current rendering list iterator. */
 	void eraseFromList( const Node& node );
 	
+	/** Removes the node from the rendering list wherever it is, in constant time. The list keeps pointers to the
+	 * nodes, so it must be called before a listed node is unloaded or freed outside front tracking. */
+	void removeFromList( const Node& node );
+	
+	/** Removes a set of nodes from the rendering list in a single pass over it. */
+	void removeFromList( const unordered_set< const Node* >& nodes );
+	
+	/** @returns the bytes of the GPU cloud buffers that are not used by clouds. */
+	ulong gpuSlackBytes() const { return SurfelCloud::arena().slackBytes(); }
+	
 	/** Resets the inserting iterator to the beginning of the rendering list. */
 	void resetIterator();
 	
@@ -106,6 +120,23 @@ public:
 	bool isCullable( const AlignedBox3f& box ) const;
 	bool isRenderable( const AlignedBox3f& box, const float projThresh ) const;
 	
+	/** @returns the camera position in world space. */
+	Vector3f eyePosition() const;
+	
+	Affine3f viewMatrix() const { return m_camera->getViewMatrix(); }
+	
+	Matrix4f projectionMatrix() const { return m_camera->getProjectionMatrix(); }
+	
+	/** @returns true if the node's cloud is loaded in GPU and can be rendered. */
+	bool isLoaded( const Node& node ) const { return node.isLoaded(); }
+	
+	/** Issues the async loading of the node's cloud in GPU.
+	 * @returns false if there is no GPU memory for the cloud. */
+	bool loadInGpu( Node& node ) const;
+	
+	/** Unloads the node's cloud from GPU. */
+	void unloadInGpu( Node& node ) const { node.unloadInGpu(); }
+	
     bool smooth() const;
     void set_smooth(bool enable = true);
 
@@ -177,6 +208,8 @@ private:
 	
 	RenderingList m_toRender;
 	RenderingListIter m_toRenderIter;
+	/** Position of each node in the rendering list. */
+	unordered_map< const Node*, RenderingListIter > m_listed;
 	
     GLuint m_rect_vertices_vbo, m_rect_texture_uv_vbo,
         m_rect_vao, m_filter_kernel;
@@ -233,6 +266,7 @@ inline void SplatRenderer::eraseFromList( const Node& node )
 		}
 		#endif
 		
+		m_listed.erase( *m_toRenderIter );
 		m_toRenderIter = m_toRender.erase( m_toRenderIter );
 		
 		#ifdef RENDERING_DEBUG
@@ -252,6 +286,45 @@ inline void SplatRenderer::eraseFromList( const Node& node )
 	}
 }
 
+inline void SplatRenderer::removeFromList( const Node& node )
+{
+	auto listedIt = m_listed.find( &node );
+	if( listedIt != m_listed.end() )
+	{
+		if( listedIt->second == m_toRenderIter )
+		{
+			++m_toRenderIter;
+		}
+		m_toRender.erase( listedIt->second );
+		m_listed.erase( listedIt );
+	}
+}
+
+inline void SplatRenderer::removeFromList( const unordered_set< const Node* >& nodes )
+{
+	if( nodes.empty() )
+	{
+		return;
+	}
+	
+	for( RenderingListIter it = m_toRender.begin(); it != m_toRender.end(); )
+	{
+		if( nodes.count( *it ) )
+		{
+			if( it == m_toRenderIter )
+			{
+				++m_toRenderIter;
+			}
+			m_listed.erase( *it );
+			it = m_toRender.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
 inline void SplatRenderer::resetIterator()
 {
 	#ifdef RENDERING_DEBUG
@@ -278,7 +351,7 @@ inline void SplatRenderer::render( Node& node )
 			}
 			#endif
 			
-			m_toRender.insert( m_toRenderIter, &node );
+			m_listed[ &node ] = m_toRender.insert( m_toRenderIter, &node );
 		}
 		else
 		{
@@ -294,7 +367,7 @@ inline void SplatRenderer::render( Node& node )
 		}
 		#endif
 		
-		m_toRender.insert( m_toRenderIter, &node );
+		m_listed[ &node ] = m_toRender.insert( m_toRenderIter, &node );
 	}
 }
 
@@ -329,6 +402,17 @@ inline bool SplatRenderer::isCullable( const AlignedBox3f& box ) const
 	return m_frustum.isCullable( box );
 }
 
+inline Vector3f SplatRenderer::eyePosition() const
+{
+	return m_camera->getViewMatrix().inverse().translation();
+}
+
+inline bool SplatRenderer::loadInGpu( Node& node ) const
+{
+	node.loadInGpu();
+	return node.hasCloud();
+}
+
 inline bool SplatRenderer::isRenderable( const AlignedBox3f& box, const float projThresh ) const
 {
 	const Vector3f& rawMin = box.min();
@@ -639,17 +723,14 @@ inline void SplatRenderer::saveFbo( int attach )
 			
 			stringstream filename; filename << "/media/vinicius/data/Videos/OMiCroN/fbo" << m_diskFileSuffix << ".ppm";
 			
-			ofstream out_stream;
-			out_stream.open( filename.str() );
-			out_stream << "P6\n";
-			out_stream << threadWidth << " " << threadHeight << "\n";
-			out_stream << "255\n";
-
-			for( int i = threadHeight - 1; i >= 0; --i )
+			try
+			{
+				omicron::renderer::writePpm( filename.str(), threadPixels, threadWidth, threadHeight );
+			}
+			catch( const runtime_error& e )
 			{
-				out_stream.write( ( char* ) threadPixels + i * threadWidth * 3, threadWidth * 3 );
+				cerr << e.what() << endl;
 			}
-			out_stream.close();
 			
 			delete[] threadPixels;
 		}
@@ -7,6 +7,7 @@
 #include "omicron/basic/point.h"
 #include "omicron/basic/stream.h"
 #include "omicron/hierarchy/reconstruction_params.h"
+#include "omicron/memory/level_arena.h"
 
 using namespace std;
 using namespace omicron::basic;
@@ -19,8 +20,13 @@ struct Surfel
 		: c(c_), u(u_), v(v_) { }
 	
 	
+	/** Ctor from a leaf point, using the compile-time leaf tangent sizes. */
 	Surfel( const Point& p );
 	
+	/** Ctor from a leaf point.
+	 * @param tangentSize has the lengths of the tangent vectors. */
+	Surfel( const Point& p, const Vector2f& tangentSize );
+	
 	void multiplyTangents( const Vector2f& multipliers );
 	
 	/** Ctor to init from stream.
@@ -40,7 +46,18 @@ struct Surfel
 					u, v;   // Ellipse major and minor axis.
 };
 
+namespace omicron::memory
+{
+	/** Node contents are allocated from the level arenas of hierarchy creation. */
+	template<>
+	struct IsArenaAllocated< Surfel > : true_type {};
+}
+
 inline Surfel::Surfel( const Point& p )
+: Surfel( p, Vector2f( LEAF_SURFEL_TANGENT_SIZE_X, LEAF_SURFEL_TANGENT_SIZE_Y ) )
+{}
+
+inline Surfel::Surfel( const Point& p, const Vector2f& tangentSize )
 {
 	const Vec3& pos = p.getPos();
 	const Vec3& normal = p.getNormal();
@@ -73,8 +90,8 @@ inline Surfel::Surfel( const Point& p )
 	v = normal.cross( u );
 
 	c = pos;
-	u *= LEAF_SURFEL_TANGENT_SIZE_X;
-	v *= LEAF_SURFEL_TANGENT_SIZE_Y;
+	u *= tangentSize.x();
+	v *= tangentSize.y();
 }
 
 inline Surfel::Surfel( ifstream& input )
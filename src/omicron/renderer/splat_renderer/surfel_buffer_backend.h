@@ -0,0 +1,105 @@
+#ifndef SURFEL_BUFFER_BACKEND_H
+#define SURFEL_BUFFER_BACKEND_H
+
+#include <unordered_map>
+#include <GL/glew.h>
+#include "omicron/renderer/gpu_buffer_arena.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+#include "omicron/renderer/ogl_utils.h"
+
+// #define GL_ERROR_DEBUG
+
+namespace omicron::renderer
+{
+	/** OpenGL backend of a GpuBufferArena of surfels. Each buffer is a VBO with a VAO that has the surfel attribute
+	 * layout, so drawing a slot is a single glDrawArrays() with the slot's first surfel. */
+	class SurfelBufferBackend
+	: public GpuBufferBackend
+	{
+	public:
+		~SurfelBufferBackend()
+		{
+			for( const pair< const BufferId, GLuint >& entry : m_vaos )
+			{
+				GLuint vbo = entry.first;
+				glDeleteBuffers( 1, &vbo );
+				glDeleteVertexArrays( 1, &entry.second );
+			}
+		}
+
+		BufferId createBuffer( const size_t bytes ) override
+		{
+			GLuint vao, vbo;
+			glGenVertexArrays( 1, &vao );
+			glBindVertexArray( vao );
+
+			glGenBuffers( 1, &vbo );
+			glBindBuffer( GL_ARRAY_BUFFER, vbo );
+			glBufferData( GL_ARRAY_BUFFER, bytes, NULL, GL_STATIC_DRAW );
+
+			// Center c.
+			glEnableVertexAttribArray( 0 );
+			glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE,
+				sizeof( Surfel ), reinterpret_cast< const GLfloat* >( 0 ) );
+
+			// Tagent vector u.
+			glEnableVertexAttribArray( 1 );
+			glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE,
+				sizeof( Surfel ), reinterpret_cast< const GLfloat* >( 12 ) );
+
+			// Tangent vector v.
+			glEnableVertexAttribArray( 2 );
+			glVertexAttribPointer( 2, 3, GL_FLOAT, GL_FALSE,
+				sizeof( Surfel ), reinterpret_cast< const GLfloat* >( 24 ) );
+
+			glBindVertexArray( 0 );
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+			#if defined GL_ERROR_DEBUG || !defined NDEBUG
+				OglUtils::checkOglErrors();
+			#endif
+
+			m_vaos[ vbo ] = vao;
+
+			return vbo;
+		}
+
+		void destroyBuffer( const BufferId buffer ) override
+		{
+			GLuint vbo = buffer;
+			glDeleteBuffers( 1, &vbo );
+			glDeleteVertexArrays( 1, &m_vaos[ buffer ] );
+			m_vaos.erase( buffer );
+		}
+
+		void upload( const BufferId buffer, const size_t offset, const size_t bytes, const void* data ) override
+		{
+			glBindBuffer( GL_ARRAY_BUFFER, buffer );
+			glBufferSubData( GL_ARRAY_BUFFER, offset, bytes, data );
+			glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+			#if defined GL_ERROR_DEBUG || !defined NDEBUG
+				OglUtils::checkOglErrors();
+			#endif
+		}
+
+		void draw( const BufferId buffer, const uint first, const uint count ) override
+		{
+			glBindVertexArray( m_vaos[ buffer ] );
+			glDrawArrays( GL_POINTS, first, count );
+			glBindVertexArray( 0 );
+
+			#if defined GL_ERROR_DEBUG || !defined NDEBUG
+				OglUtils::checkOglErrors();
+			#endif
+		}
+
+	private:
+		/** VAO of each buffer. */
+		unordered_map< BufferId, GLuint > m_vaos;
+	};
+}
+
+#undef GL_ERROR_DEBUG
+
+#endif
@@ -1,4 +1,5 @@
 #include "omicron/renderer/splat_renderer/surfel_cloud.h"
+#include "omicron/renderer/splat_renderer/surfel_buffer_backend.h"
 
 // #define BUFFER_MTX 
 
@@ -6,4 +7,13 @@
 	mutex SurfelCloud::m_bufferBindMtx;
 #endif
 
+GpuBufferArena& SurfelCloud::arena()
+{
+	// Never destroyed, since the OpenGL context may be gone at exit. The context releases the buffers itself.
+	static omicron::renderer::SurfelBufferBackend* backend = new omicron::renderer::SurfelBufferBackend();
+	static GpuBufferArena* arena = new GpuBufferArena( *backend, sizeof( Surfel ), MIN_SLOT_SURFELS, N_SLOT_SIZE_CLASSES,
+													   ARENA_BUFFER_BYTES );
+	return *arena;
+}
+
 #undef BUFFER_MTX
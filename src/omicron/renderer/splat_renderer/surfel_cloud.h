@@ -6,6 +6,7 @@
 #include "omicron/basic/array.h"
 #include "omicron/hierarchy/gpu_alloc_statistics.h"
 #include "omicron/renderer/ogl_utils.h"
+#include "omicron/renderer/gpu_buffer_arena.h"
 #include "omicron/util/stack_trace.h"
 #include "omicron/hierarchy/hierarchy_creation_log.h"
 #include "omicron/memory/global_malloc.h"
@@ -18,12 +19,22 @@
 // #define COMPARISON_DEBUG
 
 using namespace omicron::hierarchy;
+using omicron::renderer::GpuBufferArena;
 
-/** Surfel cloud that supports async loading. */
+/** Surfel cloud that supports async loading. Clouds are allocated in slots of a GpuBufferArena shared by all clouds and
+ * uploaded synchronously. Clouds bigger than the arena's biggest slot have their own VBO, filled asynchronously. */
 class SurfelCloud
 {
     
 public:
+	/** Surfels in the slots of the smallest arena size class. */
+	static constexpr uint MIN_SLOT_SURFELS = 64u;
+	/** Number of arena size classes. The biggest slots have MIN_SLOT_SURFELS << ( N_SLOT_SIZE_CLASSES - 1 ) surfels. */
+	static constexpr uint N_SLOT_SIZE_CLASSES = 10u;
+	/** Size of the arena buffers. */
+	static constexpr size_t ARENA_BUFFER_BYTES = size_t( 16 ) * 1024 * 1024;
+	
+
 	enum LoadStatus
 	{
 		UNLOADED,
@@ -34,8 +45,8 @@ public:
 	void* operator new( size_t size );
 	void operator delete( void* p );
 	
-	/** Ctor which maps a VBO GPU memory for the cloud and issue a async loading operation. The loading operation status
-	 * can be evaluated with loadStatus(). */
+	/** Ctor which allocates GPU memory for the cloud and uploads it. Clouds that do not fit in the arena map their own
+	 * VBO and issue an async loading operation. The loading operation status can be evaluated with loadStatus(). */
 	SurfelCloud( const omicron::basic::Array< Surfel >& surfels );
 	
 	SurfelCloud( const SurfelCloud& other ) = delete;
@@ -61,15 +72,30 @@ public:
 	
 	friend ostream& operator<<( ostream& out, const SurfelCloud& cloud );
 	
+	/** @returns the arena shared by all clouds. Must be called by the thread that owns the OpenGL context. */
+	static GpuBufferArena& arena();
+	
+	/** @returns the GPU bytes used by a cloud with nPoints, which is its arena slot size if it fits in one. Can be
+	 * called by any thread. */
+	static size_t gpuFootprint( const uint nPoints )
+	{
+		return GpuBufferArena::footprint( nPoints, sizeof( Surfel ), MIN_SLOT_SURFELS, N_SLOT_SIZE_CLASSES );
+	}
+	
 private:
 	void unmap();
 	
 	void clean();
 	
+	bool isPooled() const { return m_slot.m_nElements > 0u; }
+	
 	Surfel* m_bufferMap;
 	
 	future< void >* m_loadFuture;
 	
+	/** Slot in the arena. Empty if the cloud has its own VBO. */
+	GpuBufferArena::Slot m_slot;
+	
 	GLuint m_vbo, m_vao;
     uint m_numPts;
 };
@@ -85,10 +111,28 @@ inline void SurfelCloud::operator delete( void* p )
 }
 
 inline SurfelCloud::SurfelCloud(  const omicron::basic::Array< Surfel >& surfels )
-: m_numPts( surfels.size() )
+: m_bufferMap( nullptr ),
+m_loadFuture( nullptr ),
+m_vbo( 0 ),
+m_vao( 0 ),
+m_numPts( surfels.size() )
 {
 	assert( surfels.size() > 0 && "SurfelCloud size is expected to be greater than 0." );
 	
+	if( arena().allocate( m_numPts, m_slot ) )
+	{
+		arena().upload( m_slot, surfels.data() );
+		
+		#ifdef CTOR_DEBUG
+		{
+			stringstream ss; ss << "Ctor: " << *this << endl << endl;
+			HierarchyCreationLog::logDebugMsg( ss.str() );
+		}
+		#endif
+		
+		return;
+	}
+	
 	GpuAllocStatistics::notifyAlloc( m_numPts * GpuAllocStatistics::pointSize() );
 	
 	glGenVertexArrays( 1, &m_vao );
@@ -158,7 +202,7 @@ inline bool SurfelCloud::operator==( const SurfelCloud& other ) const
 	}
 	#endif
 	
-	return m_vbo == other.m_vbo;
+	return m_vbo == other.m_vbo && m_slot.m_buffer == other.m_slot.m_buffer && m_slot.m_first == other.m_slot.m_first;
 }
 
 inline bool SurfelCloud::operator!=( const SurfelCloud& other ) const
@@ -176,6 +220,12 @@ inline void SurfelCloud::render()
 	}
 	#endif
 	
+	if( isPooled() )
+	{
+		arena().draw( m_slot );
+		return;
+	}
+	
 	glBindVertexArray( m_vao );
 	glDrawArrays( GL_POINTS, 0, m_numPts );
 	glBindVertexArray( 0 );
@@ -187,6 +237,12 @@ inline void SurfelCloud::render()
 
 inline SurfelCloud::LoadStatus SurfelCloud::loadStatus()
 {
+	if( isPooled() )
+	{
+		// Pooled clouds are uploaded in the ctor.
+		return LOADED;
+	}
+	
 	if( m_loadFuture->valid() )
 	{
 		// get() was not called yet.
@@ -227,6 +283,20 @@ inline void SurfelCloud::unmap()
 
 inline void SurfelCloud::clean()
 {
+	if( isPooled() )
+	{
+		#ifdef CLEANING_DEBUG
+		{
+			stringstream ss; ss << "Cleaning: " << endl << *this << endl << endl;
+			HierarchyCreationLog::logDebugMsg( ss.str() );
+		}
+		#endif
+		
+		arena().release( m_slot );
+		m_slot = GpuBufferArena::Slot();
+		return;
+	}
+	
 	if( m_loadFuture->valid() )
 	{
 		m_loadFuture->get();
@@ -253,8 +323,8 @@ inline void SurfelCloud::clean()
 
 inline ostream& operator<<( ostream& out, const SurfelCloud& cloud )
 {
-	out << "Address: " << &cloud << ". vao: " << cloud.m_vao << " vbo: " << cloud.m_vbo << " nPoints: "
-		<< cloud.m_numPts;
+	out << "Address: " << &cloud << ". vao: " << cloud.m_vao << " vbo: " << cloud.m_vbo << " arena buffer: "
+		<< cloud.m_slot.m_buffer << " first: " << cloud.m_slot.m_first << " nPoints: " << cloud.m_numPts;
 	return out;
 }
 
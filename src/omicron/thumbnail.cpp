@@ -0,0 +1,78 @@
+#include <iostream>
+#include "omicron/disk/ply_point_reader.h"
+#include "omicron/renderer/software_splat_renderer.h"
+
+using namespace std;
+using namespace omicron;
+using namespace omicron::disk;
+using namespace omicron::renderer;
+
+int main( int argc, char** argv )
+{
+	setlocale( LC_NUMERIC, "C" );
+
+	if( argc < 3 )
+	{
+		cerr << "Usage: " << argv[ 0 ] << " <dataset .ply> <output .ppm> [width = 256] [height = 256]" << endl
+			 << "Renders the whole dataset seen from +z with the software splat renderer." << endl;
+		return 1;
+	}
+
+	const string filename = argv[ 1 ];
+	const string outputFilename = argv[ 2 ];
+	const uint width = ( argc > 3 ) ? stoul( argv[ 3 ] ) : 256u;
+	const uint height = ( argc > 4 ) ? stoul( argv[ 4 ] ) : 256u;
+	const float fovy = 60.f;
+
+	try
+	{
+		vector< Point > points;
+		AlignedBox3f box;
+		PlyPointReader( filename ).read(
+			[ & ]( const Point& p )
+			{
+				points.push_back( p );
+				box.extend( p.getPos() );
+			}
+		);
+
+		if( points.empty() )
+		{
+			throw runtime_error( filename + " has no points." );
+		}
+
+		// Tangents sized to cover the bounding box surface on average.
+		float diagonal = box.diagonal().norm();
+		float tangentSize = 1.5f * diagonal / sqrt( float( points.size() ) );
+
+		vector< Surfel > surfels;
+		surfels.reserve( points.size() );
+		for( const Point& p : points )
+		{
+			surfels.push_back( Surfel( p, Vector2f( tangentSize, tangentSize ) ) );
+		}
+
+		// Camera on +z, far enough to see the whole bounding sphere.
+		float halfFov = atan( tan( 0.5f * fovy * float( M_PI ) / 180.f ) * std::min( 1.f, float( width ) / height ) );
+		float distance = 0.5f * diagonal / sin( halfFov );
+		Vector3f eye = box.center() + Vector3f( 0.f, 0.f, distance );
+
+		SoftwareSplatRenderer renderer( width, height, fovy, distance * 0.01f, distance + diagonal );
+		renderer.parameters().m_backfaceCulling = false;
+		renderer.setViewMatrix( Affine3f( Translation3f( -eye ) ) );
+
+		renderer.begin_frame();
+		renderer.render( surfels.data(), surfels.size() );
+		renderer.render_frame();
+		renderer.end_frame();
+
+		renderer.savePpm( outputFilename );
+	}
+	catch( const exception& e )
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -3,7 +3,7 @@
 #include "omicron/ui/gl_hidden_widget.h"
 #include "ui_main_window.h"
 
-MainWindow::MainWindow(QWidget *parent) :
+MainWindow::MainWindow( const omicron::hierarchy::ReconstructionConfig& config, QWidget *parent ) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
@@ -14,7 +14,7 @@ MainWindow::MainWindow(QWidget *parent) :
 	auto loaderThread = new NodeLoaderThread( hiddenWidget, 900ul * 1024ul * 1024ul );
 	m_loader = new NodeLoader( loaderThread, 1 );
 	
-	m_pointRenderWidget = new PointRendererWidget( *m_loader, ui->centralWidget );
+	m_pointRenderWidget = new PointRendererWidget( *m_loader, config, ui->centralWidget );
 	m_pointRenderWidget->setObjectName(QStringLiteral("pointRendererWidget"));
 	QSizePolicy sizePolicy( QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding );
 	sizePolicy.setHorizontalStretch( 0 );
@@ -13,7 +13,7 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow( QWidget *parent = 0 );
+    explicit MainWindow( const omicron::hierarchy::ReconstructionConfig& config, QWidget *parent = 0 );
     ~MainWindow();
 
     void initialize( );
@@ -1,27 +1,29 @@
 #include "omicron/ui/point_renderer_widget.h"
 #include "omicron/renderer/tucano_debug_renderer.h"
 #include "omicron/disk/octree_file.h"
+#include "omicron/hierarchy/stats_export.h"
 #include <QDebug>
 #include <QTimer>
 
 // #define ADAPTIVE_PROJ
 
-PointRendererWidget::PointRendererWidget( NodeLoader& loader, QWidget *parent )
+PointRendererWidget::PointRendererWidget( NodeLoader& loader, const ReconstructionConfig& config, QWidget *parent )
 : Tucano::QtFreecameraWidget( parent, loader.widget() ),
-m_projThresh( PROJ_THRESHOLD ),
+m_config( config ),
+m_projThresh( config.m_projThresh ),
 m_desiredRenderTime( 0.f ),
 draw_trackball( true ),
 m_drawAuxViewports( false ),
 m_octree( nullptr ),
 m_renderer( nullptr ),
 m_loader( loader ),
-m_statistics( m_projThresh )
+m_statistics( config.m_projThresh, 1ul << 16, config )
 {
 	setlocale( LC_NUMERIC, "C" );
     
 	camera->setSpeed( 0.005f );
 	m_cameraPath.initialize( "shaders/tucano/" );
-	m_cameraPath.setAnimSpeed( CAMERA_PATH_SPEED );
+	m_cameraPath.setAnimSpeed( m_config.m_cameraPathSpeed );
 	m_cameraPath.toggleDrawControlPoints();
 // 	m_cameraPath.toggleDrawQuaternions();
 	loadCameraPath();
@@ -59,61 +61,80 @@ void PointRendererWidget::initialize( const unsigned int& frameRate, const int&
 // 	openMesh( QDir::currentPath().append( "/data/example/staypuff.ply" ).toStdString() );
 // 	openMesh( QDir::currentPath().append( "/data/example/sorted_staypuff.oct" ).toStdString() );
 	
-	#if MODEL == DAVID
-		#ifdef LAB
-			#if NO_SORT == true
-                openMesh( "/home/dsilva.vinicius/projects/datasets/David/DavidWithFaces_sorted7.oct" );
+	if( !m_config.m_dataset.empty() )
+	{
+		openMesh( m_config.m_dataset );
+	}
+	else
+	{
+		openDefaultDataset();
+	}
+	
+	m_timer = new QTimer( this );
+	connect( m_timer, SIGNAL( timeout() ), this, SLOT( updateGL() ) );
+	m_timer->start( 0 ); // Update 60 fps.
+}
+
+void PointRendererWidget::openDefaultDataset()
+{
+	switch( m_config.m_model )
+	{
+		case DAVID:
+			#ifdef LAB
+				#if NO_SORT == true
+	                openMesh( "/home/dsilva.vinicius/projects/datasets/David/DavidWithFaces_sorted7.oct" );
+				#else
+					openMesh( "/home/dsilva.vinicius/projects/datasets/David/DavidWithFaces.ply" );
+				#endif
 			#else
-				openMesh( "/home/dsilva.vinicius/projects/datasets/David/DavidWithFaces.ply" );
+				#if NO_SORT == true
+					openMesh( "/media/vinicius/data/Datasets/David/DavidWithFaces_sorted7.oct" );
+				#else
+					openMesh( "/media/vinicius/data/Datasets/David/DavidWithFaces.ply" );
+				#endif
 			#endif
-		#else
-			#if NO_SORT == true
-				openMesh( "/media/vinicius/data/Datasets/David/DavidWithFaces_sorted7.oct" );
+			break;
+		case ST_MATHEW:
+			#ifdef LAB
+				openMesh( "/home/dsilva.vinicius/projects/datasets/StMatthew/StMathewWithFaces_sorted7.oct" );
 			#else
-				openMesh( "/media/vinicius/data/Datasets/David/DavidWithFaces.ply" );
+				#if NO_SORT == true
+					openMesh( "/media/vinicius/data/Datasets/StMathew/StMathewWithFaces_sorted7.oct" );
+				#else
+					openMesh( "/media/vinicius/data/Datasets/StMathew/StMathewWithFaces.ply" );
+				#endif
 			#endif
-		#endif
-	#elif MODEL == ST_MATHEW
-		#ifdef LAB
-			openMesh( "/home/dsilva.vinicius/projects/datasets/StMatthew/StMathewWithFaces_sorted7.oct" );
-		#else
-			#if NO_SORT == true
-				openMesh( "/media/vinicius/data/Datasets/StMathew/StMathewWithFaces_sorted7.oct" );
+			break;
+		case ATLAS:
+			#ifdef LAB
+				openMesh( "/media/viniciusdasilva/Expansion Drive/Datasets/Atlas/Shallow/Atlas_lab.oct" );
 			#else
-				openMesh( "/media/vinicius/data/Datasets/StMathew/StMathewWithFaces.ply" );
-			#endif
-		#endif
-	#elif MODEL == ATLAS
-		#ifdef LAB
-			openMesh( "/media/viniciusdasilva/Expansion Drive/Datasets/Atlas/Shallow/Atlas_lab.oct" );
-		#else
-			#if NO_SORT == true
-				openMesh( "/media/vinicius/data/Datasets/Atlas/AtlasWithFaces_sorted7.oct" );
+				#if NO_SORT == true
+					openMesh( "/media/vinicius/data/Datasets/Atlas/AtlasWithFaces_sorted7.oct" );
+				#else
+					openMesh( "/media/vinicius/data/Datasets/Atlas/AtlasWithFaces.ply" );
+				#endif
+			#endif		
+			break;
+		case DUOMO:
+			#ifdef LAB
+				openMesh( "/media/viniciusdasilva/Expansion Drive/Duomo/Shallow/Duomo_lab.oct" );
 			#else
-				openMesh( "/media/vinicius/data/Datasets/Atlas/AtlasWithFaces.ply" );
+				#if NO_SORT == true
+					openMesh( "/media/vinicius/data/Datasets/Duomo/Duomo_sorted7.oct" );
+				#else
+					openMesh( "/media/vinicius/data/Datasets/Duomo/Duomo.ply" );
+				#endif
 			#endif
-		#endif		
-	#elif MODEL == DUOMO
-		#ifdef LAB
-			openMesh( "/media/viniciusdasilva/Expansion Drive/Duomo/Shallow/Duomo_lab.oct" );
-		#else
+			break;
+		case BUNNY:
 			#if NO_SORT == true
-				openMesh( "/media/vinicius/data/Datasets/Duomo/Duomo_sorted7.oct" );
+				openMesh( "/media/vinicius/data/Datasets/Bunny/bunny_sorted7.oct" );
 			#else
-				openMesh( "/media/vinicius/data/Datasets/Duomo/Duomo.ply" );
+				openMesh( "/home/dsilva.vinicius/projects/datasets/Bunny/bunny.ply" );
 			#endif
-		#endif
-	#elif MODEL == BUNNY
-		#if NO_SORT == true
-			openMesh( "/media/vinicius/data/Datasets/Bunny/bunny_sorted7.oct" );
-		#else
-			openMesh( "/home/dsilva.vinicius/projects/datasets/Bunny/bunny.ply" );
-		#endif
-	#endif
-	
-	m_timer = new QTimer( this );
-	connect( m_timer, SIGNAL( timeout() ), this, SLOT( updateGL() ) );
-	m_timer->start( 0 ); // Update 60 fps.
+			break;
+	}
 }
 
 void PointRendererWidget::resizeGL( int width, int height )
@@ -184,8 +205,9 @@ void PointRendererWidget::paintGL (void)
 	
 	{
 		float currentCompletion = m_statistics.currentCompletion();
-		if( m_octree->substitutedPlaceholders() >= EXPECTED_SUBSTITUTED_PLACEHOLDERS * ( currentCompletion + 0.1f )
-			|| ( m_octree->substitutedPlaceholders() == EXPECTED_SUBSTITUTED_PLACEHOLDERS && m_statistics.currentCompletion() < 1.f ) )
+		uint expectedPlaceholders = ReconstructionParams::expectedSubstitutedPlaceholders( m_config.m_model );
+		if( m_octree->substitutedPlaceholders() >= expectedPlaceholders * ( currentCompletion + 0.1f )
+			|| ( m_octree->substitutedPlaceholders() == expectedPlaceholders && currentCompletion < 1.f ) )
 		{
 			m_statistics.addCompletionPercent( m_statistics.currentCompletion() + 0.1f );
 		}
@@ -360,7 +382,7 @@ void PointRendererWidget::closeEvent( QCloseEvent * event )
 	
 	ostringstream statsString; statsString << m_statistics << endl
 		<< "No sort? " << ( ( NO_SORT ) ? "true" : "false" ) << endl
-		<< "Sorting flag: " << Sorting( SORTING ) << endl
+		<< "Sorting flag: " << m_config.m_sorting << endl
 		<< "Sorting chunks: " << SORTING_SEGMENTS << endl
 		<< "Hierarchy construction method: " << OCTREE_CONSTRUCTION << endl
 		<< "Time for reader input: " << m_octree->readerInTime() << "ms" << endl
@@ -377,6 +399,24 @@ void PointRendererWidget::closeEvent( QCloseEvent * event )
 	
 	cout << "Statistics saved into " << statsFilename.str() << endl << endl;
 	
+	// Machine-readable statistics.
+	ostringstream statsBasename; statsBasename << "../statistics/" << m_statistics.m_datasetName << "-" << the_date;
+	{
+		Json::Value statsJson;
+		statsJson[ "config" ] = reconstructionParamsJson( m_config );
+		statsJson[ "creation" ] = creationJson( *m_octree );
+		statsJson[ "statistics" ] = toJson( m_statistics );
+		
+		ofstream jsonFile( statsBasename.str() + ".json" );
+		jsonFile << statsJson;
+	}
+	{
+		ofstream csvFile( statsBasename.str() + ".csv" );
+		writeFramesCsv( csvFile, m_statistics );
+	}
+	
+	cout << "Machine-readable statistics saved into " << statsBasename.str() << ".json and .csv" << endl << endl;
+	
 	event->accept();
 }
 
@@ -489,7 +529,7 @@ void PointRendererWidget::openMesh( const string& filename )
 		delete m_octree;
 	}
 	
-	RuntimeSetup runtime( HIERARCHY_CREATION_THREADS, WORK_LIST_SIZE, RAM_QUOTA );
+	RuntimeSetup runtime( m_config );
 	
 	if( !filename.substr( filename.find_last_of( '.' ) ).compare( ".oct" ) )
 	{
@@ -554,43 +594,44 @@ void PointRendererWidget::openMesh( const string& filename )
 	updateGL();
 }
 
+string PointRendererWidget::cameraFileName() const
+{
+	switch( m_config.m_model )
+	{
+		case DAVID: return "David";
+		case ST_MATHEW: return "StMathew";
+		case ATLAS: return "Atlas";
+		case DUOMO: return "Duomo";
+	}
+	
+	return "";
+}
+
 void PointRendererWidget::loadCameraPath()
 {
-	#if MODEL == DAVID
-		m_cameraPath.loadFromFile("../../camera_paths/David");
-	#elif MODEL == ST_MATHEW
-		m_cameraPath.loadFromFile("../../camera_paths/StMathew");
-	#elif MODEL == ATLAS
-		m_cameraPath.loadFromFile("../../camera_paths/Atlas");
-	#elif MODEL == DUOMO
-		m_cameraPath.loadFromFile("../../camera_paths/Duomo");
-	#endif
+	string name = cameraFileName();
+	if( !name.empty() )
+	{
+		m_cameraPath.loadFromFile( "../../camera_paths/" + name );
+	}
 }
 	
 void PointRendererWidget::saveCameraPath()
 {
-	#if MODEL == DAVID
-		m_cameraPath.writeToFile("../../camera_paths/David");
-	#elif MODEL == ST_MATHEW
-		m_cameraPath.writeToFile("../../camera_paths/StMathew");
-	#elif MODEL == ATLAS
-		m_cameraPath.writeToFile("../../camera_paths/Atlas");
-	#elif MODEL == DUOMO
-		m_cameraPath.writeToFile("../../camera_paths/Duomo");
-	#endif
+	string name = cameraFileName();
+	if( !name.empty() )
+	{
+		m_cameraPath.writeToFile( "../../camera_paths/" + name );
+	}
 }
 
 void PointRendererWidget::loadScreenshotCamera()
 {
-	#if MODEL == DAVID
-		m_cameraPath.loadFromFile("../../screenshot_cameras/David");
-	#elif MODEL == ST_MATHEW
-		m_cameraPath.loadFromFile("../../screenshot_cameras/StMathew");
-	#elif MODEL == ATLAS
-		m_cameraPath.loadFromFile("../../screenshot_cameras/Atlas");
-	#elif MODEL == DUOMO
-		m_cameraPath.loadFromFile("../../screenshot_cameras/Duomo");
-	#endif
+	string name = cameraFileName();
+	if( !name.empty() )
+	{
+		m_cameraPath.loadFromFile( "../../screenshot_cameras/" + name );
+	}
 }
 	
 void PointRendererWidget::saveScreenshotCamera()
@@ -598,15 +639,46 @@ void PointRendererWidget::saveScreenshotCamera()
 	m_cameraPath.addKeyPosition( *camera );
 	m_cameraPath.addKeyPosition( *camera ); // Spaguetti needed.
 	
-	#if MODEL == DAVID
-		m_cameraPath.writeToFile("../../screenshot_cameras/David");
-	#elif MODEL == ST_MATHEW
-		m_cameraPath.writeToFile("../../screenshot_cameras/StMathew");
-	#elif MODEL == ATLAS
-		m_cameraPath.writeToFile("../../screenshot_cameras/Atlas");
-	#elif MODEL == DUOMO
-		m_cameraPath.writeToFile("../../screenshot_cameras/Duomo");
-	#endif
+	string name = cameraFileName();
+	if( !name.empty() )
+	{
+		m_cameraPath.writeToFile( "../../screenshot_cameras/" + name );
+	}
+}
+
+string PointRendererWidget::octreeFilename() const
+{
+	switch( m_config.m_model )
+	{
+		case DAVID:
+			#ifdef LAB
+				return "/media/viniciusdasilva/Expansion Drive/Datasets/David/David.boc";
+			#else
+				return "/media/vinicius/data/Datasets/David/David.boc";
+			#endif
+		case ST_MATHEW:
+			#ifdef LAB
+				return "/media/viniciusdasilva/Expansion Drive/Datasets/StMathew/StMathew.boc";
+			#else
+				return "/media/vinicius/data/Datasets/StMathew/StMathew.boc";
+			#endif
+		case ATLAS:
+			#ifdef LAB
+				return "/media/viniciusdasilva/Expansion Drive/Datasets/Atlas/Atlas.boc";
+			#else
+				return "/media/vinicius/data/Datasets/Atlas/Atlas.boc";
+			#endif		
+		case DUOMO:
+			#ifdef LAB
+				return "/media/viniciusdasilva/Expansion Drive/Datasets/Duomo/Duomo.oct";
+			#else
+				return "/media/vinicius/data/Datasets/Duomo/Duomo.boc";
+			#endif
+		case BUNNY:
+			return "/media/vinicius/data/Datasets/Bunny/bunny.boc";
+	}
+	
+	return "octree.boc";
 }
 
 void PointRendererWidget::saveOctree()
@@ -624,37 +696,20 @@ void PointRendererWidget::saveOctree()
 				{
 					auto now = Profiler::now( "Save octree operation" );
 					
-					#if MODEL == DAVID
-						#ifdef LAB
-							string filename = "/media/viniciusdasilva/Expansion Drive/Datasets/David/David.boc";
-						#else
-							string filename = "/media/vinicius/data/Datasets/David/David.boc";
-						#endif
-					#elif MODEL == ST_MATHEW
-						#ifdef LAB
-							string filename = "/media/viniciusdasilva/Expansion Drive/Datasets/StMathew/StMathew.boc";
-						#else
-							string filename = "/media/vinicius/data/Datasets/StMathew/StMathew.boc";
-						#endif
-					#elif MODEL == ATLAS
-						#ifdef LAB
-							string filename = "/media/viniciusdasilva/Expansion Drive/Datasets/Atlas/Atlas.boc";
-						#else
-							string filename = "/media/vinicius/data/Datasets/Atlas/Atlas.boc";
-						#endif		
-					#elif MODEL == DUOMO
-						#ifdef LAB
-							string filename = "/media/viniciusdasilva/Expansion Drive/Datasets/Duomo/Duomo.oct";
-						#else
-							string filename = "/media/vinicius/data/Datasets/Duomo/Duomo.boc";
-						#endif
-					#elif MODEL == BUNNY
-						string filename = "/media/vinicius/data/Datasets/Bunny/bunny.boc";
-					#endif
+					string filename = octreeFilename();
 					
 					//OctreeFile::writeDepth( filename, m_octree->root() );
 					OctreeFile<MortonCode> octFile;
-					octFile.writeBreadth( filename, m_octree->root() );
+					if( m_config.m_pointCompression == NO_COMPRESSION )
+					{
+						octFile.writeBreadth( filename, m_octree->root() );
+					}
+					else
+					{
+						PointCodec codec = PointCodec::fromCompression( m_config.m_pointCompression,
+																		m_config.m_compressionPositionBits );
+						octFile.writeCompressed( filename, m_octree->root(), codec );
+					}
 					
 					return Profiler::elapsedTime( now, "Save octree operation" );
 				}
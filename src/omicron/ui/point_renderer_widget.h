@@ -8,7 +8,7 @@
 #include "omicron/hierarchy/runtime_setup.h"
 #include "omicron/renderer/streaming_renderer.h"
 #include "omicron/memory/global_malloc.h"
-#include "omicron/hierarchy/reconstruction_params.h"
+#include "omicron/hierarchy/reconstruction_config.h"
 
 #if OCTREE_CONSTRUCTION == BINARY_OCTREE_FILE
 	#include "omicron/hierarchy/front_octree.h"
@@ -48,7 +48,8 @@ public:
 	using NodeLoader = typename Octree::NodeLoader;
 	using Renderer = SplatRenderer;
 
-	explicit PointRendererWidget( NodeLoader& loader, QWidget *parent );
+	/** @param config has the reconstruction parameters. Its dataset, if any, is opened in initialize(). */
+	explicit PointRendererWidget( NodeLoader& loader, const ReconstructionConfig& config, QWidget *parent );
 	~PointRendererWidget();
 	
 	void initialize( const unsigned int& frameRate, const int& renderingTimeTolerance );
@@ -134,6 +135,16 @@ private:
 	/** Renders auxiliary viewports for debugging purposes. */
 	void renderAuxViewport( const Viewport& viewport );
 	
+	/** Opens the default dataset of the configured model. */
+	void openDefaultDataset();
+	
+	/** @returns the name of the camera path and screenshot camera files of the configured model. Empty if the model
+	 * has none. */
+	string cameraFileName() const;
+	
+	/** @returns the file where the octree of the configured model is saved. */
+	string octreeFilename() const;
+	
 	/// Flag to draw or not trackball
 	bool draw_trackball;
 
@@ -150,6 +161,9 @@ private:
 	/** Key press booleans. */
 	QMap< int, bool > m_keys;
 	
+	/** Reconstruction parameters. */
+	ReconstructionConfig m_config;
+	
 	/** Current normalized distance threshold used to control octree node rendering. */
 	float m_projThresh;
 	
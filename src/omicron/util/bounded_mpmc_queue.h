@@ -0,0 +1,188 @@
+#ifndef BOUNDED_MPMC_QUEUE_H
+#define BOUNDED_MPMC_QUEUE_H
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <stdexcept>
+
+namespace omicron::util
+{
+	using namespace std;
+
+	/** Bounded multi-producer/multi-consumer lock-free FIFO queue. Each cell has a sequence number that tells if it is
+	 * ready to be written or read in the current lap of the ring buffer, so producers and consumers only contend on
+	 * their own position counter. The blocking push() gives backpressure: a producer waits while the queue is full. */
+	template< typename T >
+	class BoundedMpmcQueue
+	{
+	public:
+		/** @param capacity is the maximum number of elements in the queue. It is rounded up to a power of 2 and should be
+		 * at least 2, since with one cell the sequence number of a full cell would be the one of a free cell in the next
+		 * lap. */
+		BoundedMpmcQueue( const size_t capacity );
+
+		BoundedMpmcQueue( const BoundedMpmcQueue& ) = delete;
+		BoundedMpmcQueue& operator=( const BoundedMpmcQueue& ) = delete;
+
+		/** Pushes an element if the queue is not full. THREAD SAFE.
+		 * @returns true if the element was pushed. element is moved only in this case. */
+		bool tryPush( T&& element );
+
+		/** Pushes an element, waiting while the queue is full. THREAD SAFE. */
+		void push( T&& element );
+
+		/** Pops an element if the queue is not empty. THREAD SAFE.
+		 * @returns true if an element was popped into out_element. */
+		bool tryPop( T& out_element );
+
+		/** Pops an element, waiting while the queue is empty. THREAD SAFE. */
+		T pop();
+
+		/** @returns the number of elements in the queue. Elements being pushed concurrently are already counted, so a
+		 * consumer that saw size() > 0 is ensured to succeed in pop() if no other consumer is popping. */
+		size_t size() const;
+
+		bool empty() const { return size() == 0; }
+
+		size_t capacity() const { return m_mask + 1; }
+
+	private:
+		// Cache line aligned to avoid false sharing between neighbour cells.
+		typedef struct alignas( 64 ) Cell
+		{
+			atomic< size_t > m_sequence;
+			T m_data;
+		} Cell;
+
+		unique_ptr< Cell[] > m_cells;
+		size_t m_mask;
+
+		alignas( 64 ) atomic< size_t > m_enqueuePos;
+		alignas( 64 ) atomic< size_t > m_dequeuePos;
+	};
+
+	template< typename T >
+	BoundedMpmcQueue< T >::BoundedMpmcQueue( const size_t capacity )
+	: m_enqueuePos( 0 ),
+	m_dequeuePos( 0 )
+	{
+		if( capacity < 2 )
+		{
+			throw logic_error( "BoundedMpmcQueue capacity should be at least 2." );
+		}
+
+		size_t roundedCapacity = 1;
+		while( roundedCapacity < capacity )
+		{
+			roundedCapacity <<= 1;
+		}
+
+		m_cells.reset( new Cell[ roundedCapacity ] );
+		m_mask = roundedCapacity - 1;
+
+		for( size_t i = 0; i < roundedCapacity; ++i )
+		{
+			m_cells[ i ].m_sequence.store( i, memory_order_relaxed );
+		}
+	}
+
+	template< typename T >
+	bool BoundedMpmcQueue< T >::tryPush( T&& element )
+	{
+		size_t pos = m_enqueuePos.load( memory_order_relaxed );
+
+		while( true )
+		{
+			Cell& cell = m_cells[ pos & m_mask ];
+			size_t seq = cell.m_sequence.load( memory_order_acquire );
+			intptr_t diff = intptr_t( seq ) - intptr_t( pos );
+
+			if( diff == 0 )
+			{
+				// The cell is free in this lap. Claim it.
+				if( m_enqueuePos.compare_exchange_weak( pos, pos + 1, memory_order_relaxed ) )
+				{
+					cell.m_data = std::move( element );
+					cell.m_sequence.store( pos + 1, memory_order_release );
+					return true;
+				}
+			}
+			else if( diff < 0 )
+			{
+				// The cell still has an element from the previous lap. The queue is full.
+				return false;
+			}
+			else
+			{
+				pos = m_enqueuePos.load( memory_order_relaxed );
+			}
+		}
+	}
+
+	template< typename T >
+	inline void BoundedMpmcQueue< T >::push( T&& element )
+	{
+		while( !tryPush( std::move( element ) ) )
+		{
+			this_thread::yield();
+		}
+	}
+
+	template< typename T >
+	bool BoundedMpmcQueue< T >::tryPop( T& out_element )
+	{
+		size_t pos = m_dequeuePos.load( memory_order_relaxed );
+
+		while( true )
+		{
+			Cell& cell = m_cells[ pos & m_mask ];
+			size_t seq = cell.m_sequence.load( memory_order_acquire );
+			intptr_t diff = intptr_t( seq ) - intptr_t( pos + 1 );
+
+			if( diff == 0 )
+			{
+				// The cell has an element in this lap. Claim it.
+				if( m_dequeuePos.compare_exchange_weak( pos, pos + 1, memory_order_relaxed ) )
+				{
+					out_element = std::move( cell.m_data );
+					cell.m_data = T();
+					cell.m_sequence.store( pos + m_mask + 1, memory_order_release );
+					return true;
+				}
+			}
+			else if( diff < 0 )
+			{
+				// The cell was not written yet. The queue is empty.
+				return false;
+			}
+			else
+			{
+				pos = m_dequeuePos.load( memory_order_relaxed );
+			}
+		}
+	}
+
+	template< typename T >
+	inline T BoundedMpmcQueue< T >::pop()
+	{
+		T element;
+		while( !tryPop( element ) )
+		{
+			this_thread::yield();
+		}
+
+		return element;
+	}
+
+	template< typename T >
+	inline size_t BoundedMpmcQueue< T >::size() const
+	{
+		size_t dequeuePos = m_dequeuePos.load( memory_order_acquire );
+		size_t enqueuePos = m_enqueuePos.load( memory_order_acquire );
+
+		return ( enqueuePos > dequeuePos ) ? enqueuePos - dequeuePos : 0;
+	}
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+
+namespace omicron::util
+{
+	/** Counter-based pseudo-random generator. The i-th output is a pure function of ( key, i ), computed with the
+	 * SplitMix64 finalizer, so the sequence does not depend on which thread draws it or on what other threads drew
+	 * before. Instances are meant to be short-lived and local to the thread that uses them. */
+	class CounterRng
+	{
+	public:
+		/** @param key identifies the sequence, usually a morton code. */
+		CounterRng( const uint64_t key )
+		: m_key( mix( key ) ),
+		m_counter( 0ul )
+		{}
+
+		/** @returns the next 64-bit output. */
+		uint64_t next() { return mix( m_key + GOLDEN_GAMMA * ++m_counter ); }
+
+		/** @returns the next output in [ 0, bound ), using a multiply-shift reduction instead of a division. */
+		uint32_t uniform( const uint32_t bound ) { return uint32_t( ( ( next() >> 32 ) * bound ) >> 32 ); }
+
+		/** @returns the next output in [ 0, 1 ), with the 24 bits of precision of a float mantissa. */
+		float uniformFloat() { return float( next() >> 40 ) / float( 1u << 24 ); }
+
+		/** SplitMix64 finalizer. */
+		static uint64_t mix( uint64_t z )
+		{
+			z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ul;
+			z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebul;
+			return z ^ ( z >> 31 );
+		}
+
+	private:
+		static constexpr uint64_t GOLDEN_GAMMA = 0x9e3779b97f4a7c15ul;
+
+		uint64_t m_key;
+		uint64_t m_counter;
+	};
+}
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef RANS_CODER_H
+#define RANS_CODER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace omicron::util
+{
+	using namespace std;
+
+	using ByteVector = vector< uint8_t >;
+
+	/** Appends an unsigned LEB128 varint. */
+	inline void writeVarint( ByteVector& out, uint64_t value )
+	{
+		while( value >= 0x80 )
+		{
+			out.push_back( uint8_t( value | 0x80 ) );
+			value >>= 7;
+		}
+		out.push_back( uint8_t( value ) );
+	}
+
+	/** Reads an unsigned LEB128 varint, advancing ptr.
+	 * @throws runtime_error if the varint goes past end. */
+	inline uint64_t readVarint( const uint8_t*& ptr, const uint8_t* end )
+	{
+		uint64_t value = 0ul;
+		for( int shift = 0; shift < 64; shift += 7 )
+		{
+			if( ptr == end )
+			{
+				throw runtime_error( "Truncated varint." );
+			}
+
+			uint8_t byte = *ptr++;
+			value |= uint64_t( byte & 0x7f ) << shift;
+			if( !( byte & 0x80 ) )
+			{
+				return value;
+			}
+		}
+
+		throw runtime_error( "Malformed varint." );
+	}
+
+	/** Maps signed to unsigned integers so small magnitudes have small codes. */
+	inline uint64_t zigzag( const int64_t value ) { return ( uint64_t( value ) << 1 ) ^ uint64_t( value >> 63 ); }
+
+	inline int64_t unzigzag( const uint64_t value ) { return int64_t( value >> 1 ) ^ -int64_t( value & 1 ); }
+
+	/** Static order-0 byte entropy coder based on rANS with byte-wise renormalization. The symbol frequencies of the
+	 * whole input are normalized to PROB_SCALE and stored in the block, so each block is decoded independently. Blocks
+	 * that do not shrink are stored raw.
+	 *
+	 * Block layout: | mode | varint size | raw bytes | or | mode | varint size | symbol bitmap | varint frequencies of
+	 * present symbols | varint coded size | coded bytes |. */
+	class RansCoder
+	{
+	public:
+		/** Appends the coded block of the byte range [ data, data + size ) to out. */
+		static void encode( const uint8_t* data, const size_t size, ByteVector& out );
+
+		/** Decodes a block, advancing ptr past it and appending the decoded bytes to out.
+		 * @throws runtime_error if the block is malformed. */
+		static void decode( const uint8_t*& ptr, const uint8_t* end, ByteVector& out );
+
+		/** @returns an upper bound of the decoded size of a block with blockBytes bytes, so callers can validate sizes
+		 * read from untrusted input before allocating. */
+		static constexpr uint64_t maxDecodedSize( const uint64_t blockBytes ) { return blockBytes * MAX_SYMBOLS_PER_BYTE; }
+
+	private:
+		static constexpr uint32_t PROB_BITS = 12u;
+		static constexpr uint32_t PROB_SCALE = 1u << PROB_BITS;
+		/** Lower bound of the normalized state interval. */
+		static constexpr uint32_t STATE_LOW = 1u << 23;
+		/** Blocks smaller than this are stored raw, since the frequency table would not pay off. */
+		static constexpr size_t MIN_CODED_SIZE = 64ul;
+		/** Bound of the symbols per coded byte. No symbol has frequency PROB_SCALE, so each one costs more than
+		 * 1 / PROB_SCALE bits. The factor 2 covers the bits held by the final state. */
+		static constexpr uint64_t MAX_SYMBOLS_PER_BYTE = 16ul * PROB_SCALE;
+
+		enum Mode : uint8_t
+		{
+			RAW,
+			CODED
+		};
+
+		using Frequencies = array< uint32_t, 256 >;
+
+		/** Scales the symbol counts so they sum PROB_SCALE, keeping every present symbol. A single symbol would have
+		 * frequency PROB_SCALE and cost no bits, so it gets a companion symbol with frequency 1. */
+		static void normalize( Frequencies& freqs, const size_t size );
+	};
+
+	inline void RansCoder::encode( const uint8_t* data, const size_t size, ByteVector& out )
+	{
+		size_t blockBegin = out.size();
+
+		if( size >= MIN_CODED_SIZE )
+		{
+			Frequencies freqs;
+			freqs.fill( 0u );
+			for( size_t i = 0; i < size; ++i )
+			{
+				++freqs[ data[ i ] ];
+			}
+			normalize( freqs, size );
+
+			Frequencies cumulative;
+			uint32_t sum = 0u;
+			for( int s = 0; s < 256; ++s )
+			{
+				cumulative[ s ] = sum;
+				sum += freqs[ s ];
+			}
+
+			// Symbols are coded in reverse, so the decoder reads them forward. A symbol emits at most 2 bytes.
+			ByteVector coded( 2 * size + 8 );
+			uint8_t* ptr = coded.data() + coded.size();
+			uint32_t state = STATE_LOW;
+
+			for( size_t i = size; i-- > 0; )
+			{
+				uint32_t freq = freqs[ data[ i ] ];
+				uint32_t maxState = ( ( STATE_LOW >> PROB_BITS ) << 8 ) * freq;
+				while( state >= maxState )
+				{
+					*--ptr = uint8_t( state & 0xff );
+					state >>= 8;
+				}
+				state = ( ( state / freq ) << PROB_BITS ) + ( state % freq ) + cumulative[ data[ i ] ];
+			}
+
+			for( int i = 0; i < 4; ++i )
+			{
+				*--ptr = uint8_t( state & 0xff );
+				state >>= 8;
+			}
+
+			size_t codedSize = coded.data() + coded.size() - ptr;
+
+			out.push_back( CODED );
+			writeVarint( out, size );
+
+			array< uint8_t, 32 > bitmap;
+			bitmap.fill( 0u );
+			for( int s = 0; s < 256; ++s )
+			{
+				bitmap[ s >> 3 ] |= ( freqs[ s ] > 0u ) << ( s & 7 );
+			}
+			out.insert( out.end(), bitmap.begin(), bitmap.end() );
+
+			for( int s = 0; s < 256; ++s )
+			{
+				if( freqs[ s ] > 0u )
+				{
+					writeVarint( out, freqs[ s ] );
+				}
+			}
+
+			writeVarint( out, codedSize );
+			out.insert( out.end(), ptr, ptr + codedSize );
+
+			if( out.size() - blockBegin < size + 2 )
+			{
+				return;
+			}
+
+			out.resize( blockBegin );
+		}
+
+		out.push_back( RAW );
+		writeVarint( out, size );
+		out.insert( out.end(), data, data + size );
+	}
+
+	inline void RansCoder::decode( const uint8_t*& ptr, const uint8_t* end, ByteVector& out )
+	{
+		if( ptr == end )
+		{
+			throw runtime_error( "Truncated rANS block." );
+		}
+
+		uint8_t mode = *ptr++;
+		uint64_t size = readVarint( ptr, end );
+
+		if( mode == RAW )
+		{
+			if( uint64_t( end - ptr ) < size )
+			{
+				throw runtime_error( "Truncated raw block." );
+			}
+
+			out.insert( out.end(), ptr, ptr + size );
+			ptr += size;
+			return;
+		}
+
+		if( mode != CODED || end - ptr < 32 )
+		{
+			throw runtime_error( "Malformed rANS block." );
+		}
+
+		const uint8_t* bitmap = ptr;
+		ptr += 32;
+
+		Frequencies freqs;
+		Frequencies cumulative;
+		uint32_t sum = 0u;
+		for( int s = 0; s < 256; ++s )
+		{
+			// Bounding each frequency also keeps the sum from wrapping.
+			uint64_t freq = ( bitmap[ s >> 3 ] >> ( s & 7 ) ) & 1 ? readVarint( ptr, end ) : 0ul;
+			if( freq >= PROB_SCALE )
+			{
+				throw runtime_error( "Malformed rANS frequency table." );
+			}
+			freqs[ s ] = uint32_t( freq );
+			cumulative[ s ] = sum;
+			sum += freqs[ s ];
+		}
+
+		if( sum != PROB_SCALE )
+		{
+			throw runtime_error( "Malformed rANS frequency table." );
+		}
+
+		array< uint8_t, PROB_SCALE > symbols;
+		for( int s = 0; s < 256; ++s )
+		{
+			memset( symbols.data() + cumulative[ s ], s, freqs[ s ] );
+		}
+
+		uint64_t codedSize = readVarint( ptr, end );
+		if( uint64_t( end - ptr ) < codedSize || codedSize < 4 )
+		{
+			throw runtime_error( "Truncated rANS block." );
+		}
+		if( size > maxDecodedSize( codedSize ) )
+		{
+			throw runtime_error( "Malformed rANS block size." );
+		}
+
+		const uint8_t* codedEnd = ptr + codedSize;
+		uint32_t state = 0u;
+		for( int i = 0; i < 4; ++i )
+		{
+			state = ( state << 8 ) | *ptr++;
+		}
+
+		size_t outBegin = out.size();
+		out.resize( outBegin + size );
+		uint8_t* decoded = out.data() + outBegin;
+
+		for( uint64_t i = 0; i < size; ++i )
+		{
+			uint32_t slot = state & ( PROB_SCALE - 1 );
+			uint8_t symbol = symbols[ slot ];
+			decoded[ i ] = symbol;
+
+			state = freqs[ symbol ] * ( state >> PROB_BITS ) + slot - cumulative[ symbol ];
+			while( state < STATE_LOW && ptr < codedEnd )
+			{
+				state = ( state << 8 ) | *ptr++;
+			}
+		}
+
+		ptr = codedEnd;
+	}
+
+	inline void RansCoder::normalize( Frequencies& freqs, const size_t size )
+	{
+		int64_t sum = 0;
+		int maxSymbol = 0;
+		for( int s = 0; s < 256; ++s )
+		{
+			if( freqs[ s ] > 0u )
+			{
+				uint32_t count = freqs[ s ];
+				freqs[ s ] = std::max( uint32_t( ( uint64_t( count ) * PROB_SCALE ) / size ), 1u );
+				sum += freqs[ s ];
+			}
+			maxSymbol = ( freqs[ s ] > freqs[ maxSymbol ] ) ? s : maxSymbol;
+		}
+
+		// The rounding error is given to or taken from the most frequent symbols.
+		while( sum != PROB_SCALE )
+		{
+			int64_t diff = int64_t( PROB_SCALE ) - sum;
+			if( diff > 0 )
+			{
+				freqs[ maxSymbol ] += diff;
+				sum += diff;
+			}
+			else
+			{
+				int64_t taken = std::min( -diff, int64_t( freqs[ maxSymbol ] ) - 1 );
+				freqs[ maxSymbol ] -= taken;
+				sum -= taken;
+
+				for( int s = 0; s < 256; ++s )
+				{
+					maxSymbol = ( freqs[ s ] > freqs[ maxSymbol ] ) ? s : maxSymbol;
+				}
+			}
+		}
+
+		if( freqs[ maxSymbol ] == PROB_SCALE )
+		{
+			freqs[ maxSymbol ] = PROB_SCALE - 1;
+			freqs[ ( maxSymbol + 1 ) & 0xff ] = 1u;
+		}
+	}
+}
+
+#endif
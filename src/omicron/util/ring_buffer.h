@@ -0,0 +1,81 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <vector>
+#include <stdexcept>
+
+namespace omicron::util
+{
+	using namespace std;
+
+	/** Fixed capacity buffer that keeps the most recent elements. Storage is allocated once, so pushing is a copy into
+	 * a preallocated slot, cheap enough to be done every frame. When full, a push overwrites the oldest element.
+	 * NOT THREAD SAFE. */
+	template< typename T >
+	class RingBuffer
+	{
+	public:
+		/** @param capacity is the maximum number of kept elements. */
+		RingBuffer( const size_t capacity )
+		: m_elements( capacity ),
+		m_begin( 0ul ),
+		m_size( 0ul ),
+		m_nPushed( 0ul )
+		{
+			if( capacity == 0ul )
+			{
+				throw logic_error( "RingBuffer capacity must be greater than 0." );
+			}
+		}
+
+		void push( const T& element )
+		{
+			size_t capacity = m_elements.size();
+			size_t end = m_begin + m_size;
+			m_elements[ ( end < capacity ) ? end : end - capacity ] = element;
+
+			if( m_size < capacity )
+			{
+				++m_size;
+			}
+			else
+			{
+				m_begin = ( m_begin + 1 < capacity ) ? m_begin + 1 : 0ul;
+			}
+			++m_nPushed;
+		}
+
+		/** @returns the i-th kept element, from the oldest to the most recent. */
+		const T& operator[]( const size_t i ) const
+		{
+			size_t idx = m_begin + i;
+			return m_elements[ ( idx < m_elements.size() ) ? idx : idx - m_elements.size() ];
+		}
+
+		/** @returns the most recent element. */
+		const T& back() const { return ( *this )[ m_size - 1 ]; }
+
+		void clear() { m_begin = 0ul; m_size = 0ul; m_nPushed = 0ul; }
+
+		size_t size() const { return m_size; }
+
+		bool empty() const { return m_size == 0ul; }
+
+		size_t capacity() const { return m_elements.size(); }
+
+		/** @returns the number of elements pushed since creation or last clear(). */
+		size_t nPushed() const { return m_nPushed; }
+
+		/** @returns the number of elements overwritten because the buffer was full. */
+		size_t nDropped() const { return m_nPushed - m_size; }
+
+	private:
+		vector< T > m_elements;
+		/** Index of the oldest element. */
+		size_t m_begin;
+		size_t m_size;
+		size_t m_nPushed;
+	};
+}
+
+#endif
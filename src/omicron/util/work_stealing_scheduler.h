@@ -0,0 +1,142 @@
+#ifndef WORK_STEALING_SCHEDULER_H
+#define WORK_STEALING_SCHEDULER_H
+
+#include <omp.h>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include "omicron/memory/tbb_allocator.h"
+
+namespace omicron::util
+{
+	using namespace std;
+	using namespace omicron::memory;
+
+	/** Task scheduler with one task deque per worker. A worker pops tasks from the back of its own deque and, when it
+	 * runs out of work, steals tasks from the front of the other workers' deques. Tasks can push new tasks while
+	 * running. */
+	class WorkStealingScheduler
+	{
+	public:
+		/** A task receives the index of the worker that is executing it. */
+		using Task = function< void( int ) >;
+
+		WorkStealingScheduler( const int nWorkers );
+
+		/** Pushes a task into the deque of a worker. THREAD SAFE. */
+		void push( const int workerIdx, Task&& task );
+
+		/** Executes all pushed tasks using nWorkers OpenMP threads. Returns only when all tasks, including the ones
+		 * pushed while running, are done. If the OpenMP runtime gives less threads than requested, the orphan deques
+		 * are emptied by stealing. */
+		void run();
+
+		int nWorkers() const { return m_deques.size(); }
+
+		/** @returns the number of tasks stolen since the scheduler was created. */
+		ulong stolenTasks() const { return m_stolenTasks.load(); }
+
+	private:
+		// Cache line aligned to avoid false sharing between workers.
+		typedef struct alignas( 64 ) WorkerDeque
+		{
+			mutex m_mutex;
+			deque< Task, TbbAllocator< Task > > m_tasks;
+		} WorkerDeque;
+
+		/** Pops a task from the back of the worker's own deque. */
+		bool pop( const int workerIdx, Task& out_task );
+
+		/** Steals a task from the front of another worker's deque. */
+		bool steal( const int thiefIdx, Task& out_task );
+
+		vector< WorkerDeque > m_deques;
+
+		/** Number of tasks pushed but not finished yet. */
+		atomic_ulong m_pendingTasks;
+
+		atomic_ulong m_stolenTasks;
+	};
+
+	inline WorkStealingScheduler::WorkStealingScheduler( const int nWorkers )
+	: m_deques( std::max( nWorkers, 1 ) ),
+	m_pendingTasks( 0ul ),
+	m_stolenTasks( 0ul )
+	{}
+
+	inline void WorkStealingScheduler::push( const int workerIdx, Task&& task )
+	{
+		// The counter is increased before the task is visible, so run() cannot finish with a task in flight.
+		++m_pendingTasks;
+
+		WorkerDeque& workerDeque = m_deques[ workerIdx % m_deques.size() ];
+		lock_guard< mutex > lock( workerDeque.m_mutex );
+		workerDeque.m_tasks.push_back( std::move( task ) );
+	}
+
+	inline void WorkStealingScheduler::run()
+	{
+		#pragma omp parallel num_threads( m_deques.size() )
+		{
+			int workerIdx = omp_get_thread_num();
+			Task task;
+
+			while( m_pendingTasks.load() > 0ul )
+			{
+				if( pop( workerIdx, task ) || steal( workerIdx, task ) )
+				{
+					task( workerIdx );
+					task = nullptr;
+					--m_pendingTasks;
+				}
+				else
+				{
+					this_thread::yield();
+				}
+			}
+		}
+	}
+
+	inline bool WorkStealingScheduler::pop( const int workerIdx, Task& out_task )
+	{
+		WorkerDeque& workerDeque = m_deques[ workerIdx ];
+		lock_guard< mutex > lock( workerDeque.m_mutex );
+
+		if( workerDeque.m_tasks.empty() )
+		{
+			return false;
+		}
+
+		out_task = std::move( workerDeque.m_tasks.back() );
+		workerDeque.m_tasks.pop_back();
+
+		return true;
+	}
+
+	inline bool WorkStealingScheduler::steal( const int thiefIdx, Task& out_task )
+	{
+		int nDeques = m_deques.size();
+
+		for( int i = 1; i < nDeques; ++i )
+		{
+			WorkerDeque& victim = m_deques[ ( thiefIdx + i ) % nDeques ];
+			unique_lock< mutex > lock( victim.m_mutex, try_to_lock );
+
+			if( lock.owns_lock() && !victim.m_tasks.empty() )
+			{
+				out_task = std::move( victim.m_tasks.front() );
+				victim.m_tasks.pop_front();
+				++m_stolenTasks;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include "omicron/basic/morton_comparator.h"
 
 #include <gtest/gtest.h>
+#include <random>
 
 namespace omicron::test
 {
@@ -249,6 +250,59 @@ namespace omicron::test
         ASSERT_EQ( code.getLastChild()->getBits(), 0xF );
     }
     
+    TEST_F( MortonCodeTest, ValueTraversal )
+    {
+        static_assert( ShallowMortonCode().child( 1 ).lastChild().getBits() == 0xF, "Traversal should be constexpr." );
+        static_assert( MediumMortonCode().child( 1 ).child( 5 ).parent().getBits() == 0x1, "Traversal should be constexpr." );
+        
+        MediumMortonCode code;
+        code.build( 0x1A5ul );
+        
+        ASSERT_EQ( *code.traverseUp(), code.parent() );
+        ASSERT_EQ( *code.getFirstChild(), code.firstChild() );
+        ASSERT_EQ( *code.getLastChild(), code.lastChild() );
+        
+        vector< MediumMortonCodePtr > children = code.traverseDown();
+        for( int i = 0; i < 8; ++i )
+        {
+            ASSERT_EQ( *children[ i ], code.child( i ) );
+            ASSERT_EQ( code, code.child( i ).parent() );
+            ASSERT_EQ( i, code.child( i ).getChildIdx() );
+        }
+    }
+    
+    TEST_F( MortonCodeTest, DecodeArray )
+    {
+        mt19937 rng( 1 );
+        
+        // Round trip at the deepest levels, which exercises the BMI2 path for 64-bit codes when available.
+        uniform_int_distribution< unsigned long > mediumDist( 0ul, ( 1ul << 21 ) - 1 );
+        for( int i = 0; i < 1000; ++i )
+        {
+            unsigned long x = mediumDist( rng ), y = mediumDist( rng ), z = mediumDist( rng );
+            MediumMortonCode code;
+            code.build( x, y, z, 21 );
+            
+            MediumMortonCode::Coords coords = code.decodeArray();
+            ASSERT_EQ( x, coords[ 0 ] );
+            ASSERT_EQ( y, coords[ 1 ] );
+            ASSERT_EQ( z, coords[ 2 ] );
+            
+            vector< unsigned long > decoded = code.decode( 21 );
+            ASSERT_TRUE( std::equal( coords.begin(), coords.end(), decoded.begin() ) );
+        }
+        
+        uniform_int_distribution< unsigned int > shallowDist( 0u, ( 1u << 10 ) - 1 );
+        for( int i = 0; i < 1000; ++i )
+        {
+            unsigned int x = shallowDist( rng ), y = shallowDist( rng ), z = shallowDist( rng );
+            ShallowMortonCode code;
+            code.build( x, y, z, 10 );
+            
+            ASSERT_EQ( ( ShallowMortonCode::Coords{ x, y, z } ), code.decodeArray( 10 ) );
+        }
+    }
+    
     TEST_F( MortonCodeTest, getChildInterval )
     {
         ShallowMortonCode code;
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <fstream>
+#include "omicron/disk/binary_point_writter.h"
+#include "omicron/disk/mmap_point_reader.h"
+#include "omicron/disk/ply_point_reader.h"
+#include "omicron/basic/morton_code.h"
+#include "omicron/util/profiler.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace disk;
+
+	class MmapPointReaderTest : public ::testing::Test
+	{
+		void SetUp()
+		{
+			setlocale( LC_NUMERIC, "C" );
+		}
+	};
+
+	TEST_F( MmapPointReaderTest, WriteAndRead )
+	{
+		using Morton = MediumMortonCode;
+		using Dim = OctreeDimensions< Morton >;
+
+		Dim dim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 10 );
+		vector< Point > expected;
+		for( int i = 0; i < 1000; ++i )
+		{
+			Float coord = Float( i ) / 1000.f;
+			expected.push_back( Point( Vec3( 1.f, coord, 0.f ), Vec3( coord, coord, coord ) ) );
+		}
+
+		string filename = string( "data/mmap_point_reader_test" ) + BinaryPointHeader::EXTENSION;
+		{
+			BinaryPointWritter< Morton > writter( filename, dim );
+			for( const Point& p : expected )
+			{
+				writter.write( p );
+			}
+		}
+
+		{
+			MmapPointReader reader( filename );
+			const BinaryPointHeader& header = reader.header();
+
+			ASSERT_EQ( expected.size(), reader.getNumPoints() );
+			ASSERT_TRUE( reader.hasNormals() );
+			ASSERT_EQ( dim.m_nodeLvl, header.m_mortonLvl );
+			ASSERT_EQ( dim.calcMorton( expected.front() ).getBits(), header.m_firstMorton );
+			ASSERT_EQ( dim.calcMorton( expected.back() ).getBits(), header.m_lastMorton );
+
+			int i = 0;
+			reader.read(
+				[ & ]( const Point& p )
+				{
+					ASSERT_TRUE( expected[ i ].equal( p ) );
+					// Zero-copy: points come straight from the mapping.
+					ASSERT_EQ( reader.points() + i, &p );
+					++i;
+				}
+			);
+			ASSERT_EQ( expected.size(), i );
+		}
+
+		remove( filename.c_str() );
+	}
+
+	TEST_F( MmapPointReaderTest, ConvertPly )
+	{
+		using Morton = MediumMortonCode;
+		using Dim = OctreeDimensions< Morton >;
+
+		Dim dim( Vec3( 0.f, 0.f, 0.f ), Vec3( 12.f, 12.f, 12.f ), 7 );
+		string filename = string( "data/test_normals" ) + BinaryPointHeader::EXTENSION;
+
+		BinaryPointWritter< Morton >::convertPly( "data/test_normals.ply", filename, dim );
+
+		vector< Point > plyPoints;
+		PlyPointReader plyReader( "data/test_normals.ply" );
+		plyReader.read( [ & ]( const Point& p ) { plyPoints.push_back( p ); } );
+
+		vector< Point > binaryPoints;
+		MmapPointReader binaryReader( filename );
+		binaryReader.read( [ & ]( const Point& p ) { binaryPoints.push_back( p ); } );
+
+		ASSERT_EQ( plyPoints.size(), binaryPoints.size() );
+		for( int i = 0; i < plyPoints.size(); ++i )
+		{
+			ASSERT_TRUE( plyPoints[ i ].equal( binaryPoints[ i ] ) );
+		}
+
+		remove( filename.c_str() );
+	}
+
+	TEST_F( MmapPointReaderTest, InvalidHeader )
+	{
+		string filename = string( "data/invalid" ) + BinaryPointHeader::EXTENSION;
+		{
+			ofstream file( filename, ofstream::binary );
+			BinaryPointHeader header;
+			header.m_magic[ 0 ] = 'X';
+			file.write( reinterpret_cast< const char* >( &header ), sizeof( BinaryPointHeader ) );
+		}
+
+		ASSERT_THROW( MmapPointReader reader( filename ), runtime_error );
+		ASSERT_THROW( MmapPointReader reader( "data/inexistent" + string( BinaryPointHeader::EXTENSION ) ),
+					  runtime_error );
+
+		remove( filename.c_str() );
+	}
+}
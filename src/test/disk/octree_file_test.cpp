@@ -19,7 +19,16 @@ namespace omicron::test::disk
         void SetUp() {}
     };
 
-    void checkHierarchy(const NodePtr& rootPtr, const Surfel& rootSurfel, const Surfel& childSurfel0, const Surfel& childSurfel1, const Surfel& grandChildSurfel0, const Surfel& grandChildSurfel1)
+    /** @returns true if contents has surfel0 and surfel1, in this order or in any order if anyOrder is true. */
+    bool hasSurfels( const Array< Surfel >& contents, const Surfel& surfel0, const Surfel& surfel1, const bool anyOrder )
+    {
+        return ( contents[ 0 ] == surfel0 && contents[ 1 ] == surfel1 )
+            || ( anyOrder && contents[ 0 ] == surfel1 && contents[ 1 ] == surfel0 );
+    }
+
+    /** @param anyOrder indicates that the node contents may have been reordered, as in compressed files. */
+    void checkHierarchy(const NodePtr& rootPtr, const Surfel& rootSurfel, const Surfel& childSurfel0, const Surfel& childSurfel1, const Surfel& grandChildSurfel0, const Surfel& grandChildSurfel1,
+                        const bool anyOrder = false)
     {
         ASSERT_EQ( rootPtr->parent(), nullptr );
         ASSERT_EQ( rootPtr->getContents().size(), 1 );
@@ -31,8 +40,7 @@ namespace omicron::test::disk
         
         ASSERT_EQ( child.parent(), rootPtr.get() );
         ASSERT_EQ( child.getContents().size(), 2 );
-        ASSERT_EQ( child.getContents()[ 0 ], childSurfel0 );
-        ASSERT_EQ( child.getContents()[ 1 ], childSurfel1 );
+        ASSERT_TRUE( hasSurfels( child.getContents(), childSurfel0, childSurfel1, anyOrder ) );
         ASSERT_EQ( child.isLeaf(), false );
         ASSERT_EQ( child.child().size(), 1 );
         
@@ -40,8 +48,7 @@ namespace omicron::test::disk
         
         ASSERT_EQ( grandChild.parent(), &child );
         ASSERT_EQ( grandChild.getContents().size(), 2 );
-        ASSERT_EQ( grandChild.getContents()[ 0 ], grandChildSurfel0 );
-        ASSERT_EQ( grandChild.getContents()[ 1 ], grandChildSurfel1 );
+        ASSERT_TRUE( hasSurfels( grandChild.getContents(), grandChildSurfel0, grandChildSurfel1, anyOrder ) );
         ASSERT_EQ( grandChild.isLeaf(), true );
         ASSERT_EQ( grandChild.child().size(), 0 );
     }
@@ -118,5 +125,103 @@ namespace omicron::test::disk
         }
 
         cout << "Async breadth-first order test passed." << endl << endl;
+
+        // Fourth case: indexed file.
+        {
+            OctreeDimCalculator<Morton> octreeDimCalc;
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), rootSurfel.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), childSurfel0.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), childSurfel1.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), grandChildSurfel0.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), grandChildSurfel1.c));
+            OctreeDimensions<Morton> dim = octreeDimCalc.dimensions(3).dimensions();
+
+            OctreeFile<Morton> octFile;
+            octFile.writeIndexed( "test_octree_indexed.boc", root, dim );
+
+            NodePtr rootPtr = octFile.read( "test_octree_indexed.boc" );
+            checkHierarchy(rootPtr, rootSurfel, childSurfel0, childSurfel1, grandChildSurfel0, grandChildSurfel1);
+
+            // Lazy paging.
+            IndexedOctreeFile<Morton> indexedFile( "test_octree_indexed.boc" );
+            ASSERT_EQ( 3, indexedFile.nNodes() );
+            ASSERT_EQ( dim.m_nodeLvl, indexedFile.dim().m_nodeLvl );
+
+            NodePtr pagedRoot = indexedFile.loadRoot();
+            ASSERT_EQ( pagedRoot->child().size(), 0 );
+
+            Morton rootCode; rootCode.build( 0x1 );
+            ASSERT_TRUE( indexedFile.pageIn( *pagedRoot, rootCode ) );
+
+            Node& child = pagedRoot->child()[ 0 ];
+            Morton childCode = OctreeDimensions<Morton>( dim, 1 ).calcMorton( child );
+            ASSERT_EQ( child.child().size(), 0 );
+            ASSERT_TRUE( indexedFile.pageIn( child, childCode ) );
+
+            Node& grandChild = child.child()[ 0 ];
+            Morton grandChildCode = OctreeDimensions<Morton>( dim, 2 ).calcMorton( grandChild );
+            ASSERT_FALSE( indexedFile.pageIn( grandChild, grandChildCode ) );
+
+            checkHierarchy(pagedRoot, rootSurfel, childSurfel0, childSurfel1, grandChildSurfel0, grandChildSurfel1);
+
+            // Released children can be paged in again.
+            pagedRoot->releaseChildren();
+            ASSERT_TRUE( indexedFile.pageIn( *pagedRoot, rootCode ) );
+            ASSERT_EQ( pagedRoot->child()[ 0 ].getContents()[ 1 ], childSurfel1 );
+        }
+
+        cout << "Indexed order test passed." << endl << endl;
+
+        // Fifth case: quantized indexed file.
+        {
+            OctreeDimCalculator<Morton> octreeDimCalc;
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), rootSurfel.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), childSurfel0.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), childSurfel1.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), grandChildSurfel0.c));
+            octreeDimCalc.insertPoint(Point(Vec3(1.f, 0.f, 0.f), grandChildSurfel1.c));
+            OctreeDimensions<Morton> dim = octreeDimCalc.dimensions(3).dimensions();
+
+            OctreeFile<Morton> octFile;
+            octFile.writeIndexed( "test_octree_quantized.boc", root, dim, true );
+            NodePtr rootPtr = octFile.read( "test_octree_quantized.boc" );
+
+            vector<pair<const Node*, const Node*>> nodePairs = { { &root, rootPtr.get() },
+                { &root.child()[ 0 ], &rootPtr->child()[ 0 ] },
+                { &root.child()[ 0 ].child()[ 0 ], &rootPtr->child()[ 0 ].child()[ 0 ] } };
+
+            for( const pair<const Node*, const Node*>& nodePair : nodePairs )
+            {
+                const Node& expected = *nodePair.first;
+                const Node& quantized = *nodePair.second;
+
+                ASSERT_EQ( expected.isLeaf(), quantized.isLeaf() );
+                ASSERT_EQ( expected.getContents().size(), quantized.getContents().size() );
+                ASSERT_EQ( expected.child().size(), quantized.child().size() );
+
+                for( int i = 0; i < expected.getContents().size(); ++i )
+                {
+                    ASSERT_TRUE( expected.getContents()[ i ].c.isApprox( quantized.getContents()[ i ].c, 1.e-3f ) );
+                    ASSERT_TRUE( expected.getContents()[ i ].u.isApprox( quantized.getContents()[ i ].u, 1.e-3f ) );
+                    ASSERT_TRUE( expected.getContents()[ i ].v.isApprox( quantized.getContents()[ i ].v, 1.e-3f ) );
+                }
+            }
+        }
+
+        cout << "Quantized indexed order test passed." << endl << endl;
+
+        // Sixth case: compressed file.
+        {
+            OctreeFile<Morton> octFile;
+            octFile.writeCompressed( "test_octree_compressed.boc", root );
+            ASSERT_TRUE( OctreeFile<Morton>::isCompressed( "test_octree_compressed.boc" ) );
+            ASSERT_FALSE( OctreeFile<Morton>::isCompressed( "test_octree_breadth.boc" ) );
+
+            // Contents are sorted before compression.
+            NodePtr rootPtr = octFile.read( "test_octree_compressed.boc" );
+            checkHierarchy(rootPtr, rootSurfel, childSurfel0, childSurfel1, grandChildSurfel0, grandChildSurfel1, true);
+        }
+
+        cout << "Compressed order test passed." << endl << endl;
     }
 }
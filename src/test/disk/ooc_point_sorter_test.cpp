@@ -2,6 +2,8 @@
 #include <iostream>
 #include "omicron/basic/morton_code.h"
 #include "omicron/disk/ooc_point_sorter.h"
+#include "omicron/disk/mmap_point_reader.h"
+#include "omicron/util/counter_rng.h"
 
 using namespace std;
 using namespace util;
@@ -142,6 +144,120 @@ namespace omicron
 			}
 		}
 		
+		TEST_F( OocPointSorterTest, ParallelMerge )
+		{
+			using M = MediumMortonCode;
+			using OctreeDim = typename OocPointSorter< M >::OctreeDim;
+			
+			OctreeDim dim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 12 );
+			ulong nPoints = 20000;
+			
+			util::CounterRng rng( 1ul );
+			vector< ulong > expectedMortons;
+			{
+				PlyPointWritter writter( PlyPointReader( "data/simple_point_octree.ply" ), "data/ParallelMergeTest.ply",
+										 nPoints );
+				for( ulong i = 0; i < nPoints; ++i )
+				{
+					Vec3 pos( rng.uniformFloat(), rng.uniformFloat(), rng.uniformFloat() );
+					Point p( Vec3( 1.f, 0.f, 0.f ), pos );
+					writter.write( p );
+					expectedMortons.push_back( dim.calcMorton( p ).getBits() );
+				}
+			}
+			std::sort( expectedMortons.begin(), expectedMortons.end() );
+			
+			{
+				ofstream groupFile( "data/ParallelMergeTest.gp" );
+				groupFile << "data/ParallelMergeTest.ply";
+			}
+			
+			// Small quota and a few threads so there are several groups and merge ranges.
+			ReconstructionConfig config;
+			config.m_oocSortThreads = 3;
+			OocPointSorter< M > sorter( "data/ParallelMergeTest.gp", "data", dim, nPoints * sizeof( Point ),
+										nPoints * sizeof( Point ) / 5, config );
+			sorter.sort( true, true );
+			
+			string sortedFilename = string( "data/ParallelMergeTest" ) + BinaryPointHeader::EXTENSION;
+			{
+				MmapPointReader reader( sortedFilename );
+				ASSERT_EQ( nPoints, reader.getNumPoints() );
+				
+				vector< ulong > sortedMortons;
+				reader.read( [ & ]( const Point& p ) { sortedMortons.push_back( dim.calcMorton( p ).getBits() ); } );
+				
+				ASSERT_EQ( expectedMortons, sortedMortons );
+				ASSERT_EQ( expectedMortons.front(), reader.header().m_firstMorton );
+				ASSERT_EQ( expectedMortons.back(), reader.header().m_lastMorton );
+			}
+			
+			for( const string& filename : { string( "data/ParallelMergeTest.ply" ), string( "data/ParallelMergeTest.gp" ),
+											string( "data/ParallelMergeTest.oct" ), sortedFilename } )
+			{
+				remove( filename.c_str() );
+			}
+		}
+		
+		TEST_F( OocPointSorterTest, CompressedChunks )
+		{
+			using M = MediumMortonCode;
+			using OctreeDim = typename OocPointSorter< M >::OctreeDim;
+			
+			OctreeDim dim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 12 );
+			ulong nPoints = 20000;
+			
+			util::CounterRng rng( 2ul );
+			vector< Point > expectedPoints;
+			{
+				PlyPointWritter writter( PlyPointReader( "data/simple_point_octree.ply" ), "data/CompressedChunksTestIn.ply",
+										 nPoints );
+				for( ulong i = 0; i < nPoints; ++i )
+				{
+					Vec3 pos( rng.uniformFloat(), rng.uniformFloat(), rng.uniformFloat() );
+					Point p( Vec3( 1.f, 0.f, 0.f ), pos );
+					writter.write( p );
+					expectedPoints.push_back( p );
+				}
+			}
+			
+			{
+				ofstream groupFile( "data/CompressedChunksTest.gp" );
+				groupFile << "data/CompressedChunksTestIn.ply";
+			}
+			
+			// The sorted .ply file must have the same points as without compression, since the codec is lossless.
+			ReconstructionConfig config;
+			config.m_oocSortThreads = 3;
+			OocPointSorter< M > sorter( "data/CompressedChunksTest.gp", "data", dim, nPoints * sizeof( Point ),
+										nPoints * sizeof( Point ) / 5, config );
+			sorter.setChunkCodec( PointCodec() );
+			sorter.sort( true );
+			
+			stable_sort( expectedPoints.begin(), expectedPoints.end(),
+				[ & ]( const Point& a, const Point& b ) { return dim.calcMorton( a ) < dim.calcMorton( b ); }
+			);
+			
+			vector< Point > sortedPoints;
+			PlyPointReader( "data/CompressedChunksTest.ply" ).read(
+				[ & ]( const Point& p ) { sortedPoints.push_back( p ); }
+			);
+			
+			ASSERT_EQ( expectedPoints.size(), sortedPoints.size() );
+			for( ulong i = 0; i < sortedPoints.size(); ++i )
+			{
+				ASSERT_EQ( dim.calcMorton( expectedPoints[ i ] ), dim.calcMorton( sortedPoints[ i ] ) );
+			}
+			
+			for( const string& filename : { string( "data/CompressedChunksTestIn.ply" ),
+											string( "data/CompressedChunksTest.ply" ),
+											string( "data/CompressedChunksTest.gp" ),
+											string( "data/CompressedChunksTest.oct" ) } )
+			{
+				remove( filename.c_str() );
+			}
+		}
+		
 		TEST_F( OocPointSorterTest, HeavierDataset )
 		{
 			test( "/media/vinicius/Expansion Drive3/Datasets/David/test/test.gp",
@@ -39,6 +39,32 @@ namespace omicron::test
         ASSERT_TRUE( expectedPoint2.equal( *points[2], epsilon ) );
     }
     
+    TEST_F( PlyPointReaderTest, ReadBatches )
+    {
+        vector< Point > expected;
+        PlyPointReader pointReader( "data/extended_point_octree.ply" );
+        pointReader.read( [ & ]( const Point& p ){ expected.push_back( p ); } );
+        
+        ulong batchSize = 5;
+        vector< Point > batched;
+        PlyPointReader batchReader( "data/extended_point_octree.ply" );
+        batchReader.readBatches(
+            [ & ]( const PointBatch& batch )
+            {
+                ASSERT_GT( batch.size(), 0 );
+                ASSERT_LE( batch.size(), batchSize );
+                batched.insert( batched.end(), batch.begin(), batch.end() );
+            },
+            batchSize
+        );
+        
+        ASSERT_EQ( expected.size(), batched.size() );
+        for( int i = 0; i < expected.size(); ++i )
+        {
+            ASSERT_TRUE( expected[ i ].equal( batched[ i ] ) );
+        }
+    }
+    
     TEST_F( PlyPointReaderTest, ProfileDavidReading )
     {
         string taskName = "David reading";
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "omicron/disk/point_codec.h"
+#include "omicron/util/counter_rng.h"
+
+namespace omicron::test::disk
+{
+	using namespace std;
+	using namespace omicron::disk;
+
+	using PointVector = vector< Point, TbbAllocator< Point > >;
+	using SurfelArray = Array< Surfel >;
+
+	/** Points on a sorted grid-like path, as in sorter chunks. */
+	PointVector createCodecPoints( const uint nPoints )
+	{
+		PointVector points( nPoints );
+		util::CounterRng rng( 23ul );
+		for( uint i = 0; i < nPoints; ++i )
+		{
+			Vec3 pos( float( i ) / nPoints, rng.uniformFloat() * 0.01f, 0.5f );
+			Vec3 normal = Vec3( rng.uniformFloat() - 0.5f, rng.uniformFloat() - 0.5f, 1.f ).normalized();
+			points[ i ] = Point( normal, pos );
+		}
+
+		return points;
+	}
+
+	/** Surfels sampled along a smooth sorted path, with slowly rotating tangents. */
+	SurfelArray createCodecSurfels( const uint nSurfels )
+	{
+		SurfelArray surfels( nSurfels );
+		util::CounterRng rng( 29ul );
+		for( uint i = 0; i < nSurfels; ++i )
+		{
+			float t = float( i ) / nSurfels;
+			Vec3 c( t * 10.f - 5.f, sin( t * 6.f ) + rng.uniformFloat() * 0.01f, t * 2.f );
+			Vec3 u( cos( t * 3.f ), sin( t * 3.f ), rng.uniformFloat() * 0.05f );
+			Vec3 v = ( i % 7 == 0 ) ? Vec3( 0.f, 0.f, 0.f ) : Vec3( u.cross( Vec3( 0.f, 0.f, 1.f ) ) );
+			surfels[ i ] = Surfel( c, u * 0.01f, v * 0.005f );
+		}
+
+		return surfels;
+	}
+
+	TEST( PointCodecTest, Lossless )
+	{
+		PointVector points = createCodecPoints( 10000u );
+
+		ByteVector block;
+		PointCodec().encode( points.data(), points.size(), block );
+		ASSERT_LT( block.size(), points.size() * sizeof( Point ) );
+
+		const uint8_t* ptr = block.data();
+		PointVector decoded = PointCodec::decode< PointVector >( ptr, block.data() + block.size() );
+		ASSERT_EQ( block.data() + block.size(), ptr );
+		ASSERT_EQ( points.size(), decoded.size() );
+		for( uint i = 0; i < points.size(); ++i )
+		{
+			ASSERT_TRUE( points[ i ].getPos() == decoded[ i ].getPos() );
+			ASSERT_TRUE( points[ i ].getNormal() == decoded[ i ].getNormal() );
+		}
+
+		SurfelArray surfels = createCodecSurfels( 1000u );
+		stringstream stream;
+		PointCodec().write( stream, surfels.data(), surfels.size() );
+		PointCodec().write( stream, surfels.data(), 0 );
+
+		SurfelArray decodedSurfels = PointCodec::read< SurfelArray >( stream );
+		ASSERT_EQ( surfels.size(), decodedSurfels.size() );
+		for( uint i = 0; i < surfels.size(); ++i )
+		{
+			ASSERT_EQ( surfels[ i ], decodedSurfels[ i ] );
+		}
+		ASSERT_EQ( 0, PointCodec::read< SurfelArray >( stream ).size() );
+	}
+
+	TEST( PointCodecTest, NearLossless )
+	{
+		const uint positionBits = 16u;
+		PointCodec codec( PointCodec::NEAR_LOSSLESS, positionBits );
+		SurfelArray surfels = createCodecSurfels( 5000u );
+
+		AlignedBox3f box;
+		float maxULength = 0.f;
+		for( const Surfel& surfel : surfels )
+		{
+			box.extend( surfel.c );
+			maxULength = std::max( maxULength, surfel.u.norm() );
+		}
+		Vec3 maxError = PointCodec::maxPositionError( box.sizes(), positionBits );
+
+		ByteVector block;
+		codec.encode( surfels.data(), surfels.size(), block );
+		ASSERT_LT( block.size(), QuantizedSurfels::serializedSize( surfels.size() ) );
+
+		const uint8_t* ptr = block.data();
+		SurfelArray decoded = PointCodec::decode< SurfelArray >( ptr, block.data() + block.size() );
+		ASSERT_EQ( surfels.size(), decoded.size() );
+
+		for( uint i = 0; i < surfels.size(); ++i )
+		{
+			// Quantization error plus float rounding.
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				ASSERT_LE( fabs( surfels[ i ].c[ axis ] - decoded[ i ].c[ axis ] ), maxError[ axis ] + 1.e-6f );
+			}
+			ASSERT_LE( ( surfels[ i ].u - decoded[ i ].u ).norm(), maxULength * 1.e-3f );
+			ASSERT_TRUE( surfels[ i ].v.isApprox( decoded[ i ].v, 1.e-3f ) || surfels[ i ].v.isZero() );
+		}
+
+		// Zero vectors are kept.
+		ASSERT_TRUE( decoded[ 0 ].v.isZero() );
+
+		// Coincident positions are exact.
+		PointVector points( 100, Point( Vec3( 0.f, 0.f, 1.f ), Vec3( 0.3f, 0.2f, 0.1f ) ) );
+		block.clear();
+		codec.encode( points.data(), points.size(), block );
+		ptr = block.data();
+		for( const Point& point : PointCodec::decode< PointVector >( ptr, block.data() + block.size() ) )
+		{
+			ASSERT_TRUE( point.getPos() == Vec3( 0.3f, 0.2f, 0.1f ) );
+		}
+	}
+
+	TEST( PointCodecTest, InvalidBlocks )
+	{
+		ASSERT_THROW( PointCodec( PointCodec::NEAR_LOSSLESS, 0u ), logic_error );
+		ASSERT_THROW( PointCodec( PointCodec::NEAR_LOSSLESS, 22u ), logic_error );
+
+		PointVector points = createCodecPoints( 100u );
+		ByteVector block;
+		PointCodec().encode( points.data(), points.size(), block );
+
+		// Points cannot be decoded as surfels.
+		const uint8_t* ptr = block.data();
+		ASSERT_THROW( PointCodec::decode< SurfelArray >( ptr, block.data() + block.size() ), runtime_error );
+
+		ptr = block.data();
+		ASSERT_THROW( PointCodec::decode< PointVector >( ptr, block.data() + block.size() / 2 ), runtime_error );
+
+		// Element counts larger than the streams can hold are rejected before allocating.
+		ByteVector hugeCount( block.begin(), block.begin() + 4 );
+		util::writeVarint( hugeCount, 1ul << 60 );
+		hugeCount.insert( hugeCount.end(), block.begin() + 5, block.end() );
+		ptr = hugeCount.data();
+		ASSERT_THROW( PointCodec::decode< PointVector >( ptr, hugeCount.data() + hugeCount.size() ), runtime_error );
+
+		ByteVector largerCount( block.begin(), block.begin() + 4 );
+		util::writeVarint( largerCount, 101ul );
+		largerCount.insert( largerCount.end(), block.begin() + 5, block.end() );
+		ptr = largerCount.data();
+		ASSERT_THROW( PointCodec::decode< PointVector >( ptr, largerCount.data() + largerCount.size() ), runtime_error );
+	}
+}
@@ -1,9 +1,16 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <random>
 #include "omicron/disk/point_sorter.h"
+#include "omicron/disk/morton_radix_sorter.h"
 #include "omicron/basic/stream.h"
 #include "omicron/util/profiler.h"
 
+// The bundled googletest predates the TEST_SUITE names.
+#ifndef TYPED_TEST_SUITE
+	#define TYPED_TEST_SUITE TYPED_TEST_CASE
+#endif
+
 namespace omicron::test
 {
     using namespace std;
@@ -106,6 +113,63 @@ namespace omicron::test
         }
     }
     
+    template< typename M >
+    class MortonRadixSorterTest : public ::testing::Test
+    {};
+    
+    using testing::Types;
+    typedef Types< ShallowMortonCode, MediumMortonCode > MortonTypes;
+    TYPED_TEST_SUITE( MortonRadixSorterTest, MortonTypes );
+    
+    /** Compares the radix sort on precomputed morton keys with the comparator-based std::sort, profiling both. */
+    template< typename M >
+    void compareWithComparatorSort( const ulong nPoints )
+    {
+        using OctreeDim = OctreeDimensions< M >;
+        using PointDeque = typename disk::PointSet< M >::PointDeque;
+        
+        // Deepest level of each morton code type.
+        uint lvl = ( sizeof( decltype( M().getBits() ) ) * 8 - 1 ) / 3;
+        OctreeDim dim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), lvl );
+        
+        mt19937 rng( 1 );
+        uniform_real_distribution< Float > distribution( 0.f, 0.999f );
+        
+        PointDeque points( nPoints );
+        for( Point& p : points )
+        {
+            p = Point( Vec3( 1.f, 0.f, 0.f ), Vec3( distribution( rng ), distribution( rng ), distribution( rng ) ) );
+        }
+        PointDeque comparatorSorted = points;
+        PointDeque radixSorted = points;
+        
+        stringstream ss; ss << "lvl " << lvl << " " << points.size() << " points";
+        
+        auto start = Profiler::now( "std::sort with comparator, " + ss.str() );
+        std::sort( comparatorSorted.begin(), comparatorSorted.end(), dim );
+        Profiler::elapsedTime( start, "std::sort with comparator, " + ss.str() );
+        
+        start = Profiler::now( "Morton radix sort, " + ss.str() );
+        disk::MortonRadixSorter< M >( dim ).sort( radixSorted.begin(), radixSorted.end() );
+        Profiler::elapsedTime( start, "Morton radix sort, " + ss.str() );
+        
+        for( ulong i = 0; i < points.size(); ++i )
+        {
+            ASSERT_EQ( dim.calcMorton( comparatorSorted[ i ] ), dim.calcMorton( radixSorted[ i ] ) );
+        }
+    }
+    
+    TYPED_TEST( MortonRadixSorterTest, MatchesComparatorSort )
+    {
+        compareWithComparatorSort< TypeParam >( 1ul << 14 );
+    }
+    
+    /** Disabled by default, since it sorts 2M points. Run it with --gtest_also_run_disabled_tests. */
+    TYPED_TEST( MortonRadixSorterTest, DISABLED_Benchmark )
+    {
+        compareWithComparatorSort< TypeParam >( 1ul << 21 );
+    }
+    
     TEST_F( PointSorterTest, DISABLED_Stress )
     {
         vector< Point > sortedPoints;
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include "omicron/hierarchy/auto_tuner.h"
+
+namespace omicron::test::hierarchy
+{
+	using namespace std;
+	using namespace omicron::hierarchy;
+
+	TEST( AutoTunerTest, PicksFastestCandidate )
+	{
+		ReconstructionConfig base;
+		base.m_projThresh = 0.123f;
+
+		AutoTuner tuner( base, 6u, { 8ul, 16ul, 32ul }, 2u );
+		ASSERT_EQ( vector< int >( { 1, 2, 4, 6 } ), tuner.threadCandidates() );
+
+		// Fastest at 4 threads and work list size 16. The first repetition is slower.
+		uint nCalls = 0u;
+		ReconstructionConfig best = tuner.tune(
+			[ & ]( const ReconstructionConfig& config )
+			{
+				int time = abs( config.m_nThreads - 4 ) * 100 + abs( int( config.m_workListSize ) - 16 ) + 10;
+				return ( nCalls++ % 2 == 0 ) ? time * 2 : time;
+			}
+		);
+
+		ASSERT_EQ( 4u * 3u * 2u, nCalls );
+		ASSERT_EQ( 4, best.m_nThreads );
+		ASSERT_EQ( 16ul, best.m_workListSize );
+		ASSERT_FLOAT_EQ( 0.123f, best.m_projThresh );
+
+		ASSERT_EQ( 12ul, tuner.trials().size() );
+		const AutoTuner::Trial& first = tuner.trials()[ 0 ];
+		ASSERT_EQ( 1, first.m_nThreads );
+		ASSERT_EQ( 8ul, first.m_workListSize );
+		ASSERT_EQ( 318, first.m_creationTime );
+
+		Json::Value json = tuner.toJson();
+		ASSERT_EQ( 12u, json[ "trials" ].size() );
+		ASSERT_EQ( 4, json[ "best" ][ "hierarchyCreationThreads" ].asInt() );
+
+		ASSERT_THROW( AutoTuner( base, 1u, {} ), logic_error );
+		ASSERT_EQ( vector< int >( { 1 } ), AutoTuner( base, 1u ).threadCandidates() );
+	}
+}
@@ -2,254 +2,189 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include "omicron/util/counter_rng.h"
 
 namespace omicron::test
 {
     using namespace hierarchy;
-    
+
     class BvhTest : public ::testing::Test
     {
     protected:
         void SetUp() {}
     };
-    
-    /** Tests the entire LeafAabb's API. */
-    TEST_F( BvhTest, LeafAabb )
+
+    /** Random points in [ 0, 1 ]^3, clustered in one corner so the SAH splits are uneven. */
+    Bvh::PointVector createPoints( const uint nPoints )
+    {
+        Bvh::PointVector points;
+        util::CounterRng rng( 13ul );
+        for( uint i = 0; i < nPoints; ++i )
+        {
+            float x = rng.uniformFloat();
+            float y = rng.uniformFloat();
+            float z = rng.uniformFloat();
+            points.push_back( Point( Vec3( 0.f, 0.f, 1.f ), Vec3( x * x * x, y * y, z ) ) );
+        }
+
+        return points;
+    }
+
+    /** Tests the entire Aabb's API. */
+    TEST_F( BvhTest, Aabb )
     {
-        Point p0( Vec3( 1.f, 1.f, 1.f ), Vec3( 1.f, 1.f, 1.f ) );
-        
-        LeafAabb aabb( p0 );
-        
-        ASSERT_TRUE( aabb.isLeaf() );
-        
-        Point p1( Vec3( 2.f, 2.f, 2.f ), Vec3( 2.f, -1.f, 3.f ) );
-        aabb.insert( p1 );
-        
-        Point p2( Vec3( 3.f, 3.f, 3.f ), Vec3( 1.5, 0.f, 2.f ) );
-        
-        int currentLevel = 0;
-        aabb.traverseAndInsert( p2, currentLevel, std::numeric_limits< int >::max() );
-        
-        const Aabb::Boundaries& boundaries = aabb.boundaries();
-        
+        Aabb aabb( Vec3( 1.f, 1.f, 1.f ) );
+        aabb.insert( Vec3( 2.f, -1.f, 3.f ) );
+        aabb.insert( Vec3( 1.5, 0.f, 2.f ) );
+
+        Aabb::Boundaries boundaries = aabb.boundaries();
+
         cout << "Boundaries: " << endl << boundaries << endl << endl;
-        
+
         ASSERT_TRUE( aabb.origin().isApprox( Vec3( 1.f, -1.f, 1.f ) ) );
         ASSERT_TRUE( boundaries.m_origin.isApprox( Vec3( 1.f, -1.f, 1.f ) ) );
         ASSERT_TRUE( boundaries.m_extension.isApprox( Vec3( 1.f, 2.f, 2.f ) ) );
-        
-        Vec3 center = aabb.center();
-        
-        ASSERT_TRUE( center.isApprox( Vec3( 1.5f, 0.f, 2.f ) ) );
-        
-        const vector< Point >& points = aabb.points();
-        ASSERT_EQ( points.size(), 3 );
-        ASSERT_TRUE( points[ 0 ].equal( p0 ) );
-        ASSERT_TRUE( points[ 1 ].equal( p1 ) );
-        ASSERT_TRUE( points[ 2 ].equal( p2 ) );
+        ASSERT_TRUE( aabb.center().isApprox( Vec3( 1.5f, 0.f, 2.f ) ) );
+        ASSERT_FLOAT_EQ( 8.f, aabb.sahSurfaceArea() );
+
+        ASSERT_TRUE( aabb.contains( Vec3( 1.5f, 0.f, 2.f ) ) );
+        ASSERT_FALSE( aabb.contains( Vec3( 0.f, 0.f, 2.f ) ) );
+        ASSERT_TRUE( aabb.contains( Vec3( 0.99f, 0.f, 2.f ), 0.1f ) );
+
+        Aabb empty;
+        ASSERT_TRUE( empty.isEmpty() );
+        ASSERT_FLOAT_EQ( 0.f, empty.sahSurfaceArea() );
+
+        empty.insert( aabb );
+        ASSERT_FALSE( empty.isEmpty() );
+        ASSERT_TRUE( empty.origin().isApprox( aabb.origin() ) );
+        ASSERT_TRUE( empty.maxPoint().isApprox( aabb.maxPoint() ) );
+        ASSERT_TRUE( aabb.contains( empty ) );
     }
-    
-    TEST_F( BvhTest, InnerAabbSurfaceArea )
+
+    TEST_F( BvhTest, AabbSurfaceArea )
     {
-        Point p0( Vec3( 0.f, 0.f, 0.f ), Vec3( -1.f, -1.f, -1.f ) );
-        Point p1( Vec3( 1.f, 1.f, 1.f ), Vec3( 1.f, 1.f, 1.f ) );
-        
-        Aabb::AabbPtr child0( new LeafAabb( p0 ) );
-        Aabb::AabbPtr child1( new LeafAabb( p1 ) );
-        
-        InnerAabb parent( child0, child1 );
-
-        ASSERT_FALSE( parent.isLeaf() );
-        
-        float parentSurfaceArea = parent.sahSurfaceArea( parent.boundaries() );
-        float child0SurfaceArea = child0->sahSurfaceArea( child0->boundaries() );
-        float child1SurfaceArea = child1->sahSurfaceArea( child1->boundaries() );
-        
+        Aabb child0( Vec3( -1.f, -1.f, -1.f ) );
+        Aabb child1( Vec3( 1.f, 1.f, 1.f ) );
+
+        Aabb parent = child0;
+        parent.insert( child1 );
+
+        float parentSurfaceArea = parent.sahSurfaceArea();
+        float child0SurfaceArea = child0.sahSurfaceArea();
+        float child1SurfaceArea = child1.sahSurfaceArea();
+
         cout << "Parent SA: " << parentSurfaceArea << " Child0 SA: " << child0SurfaceArea << " Child1 SA: " << child1SurfaceArea << endl << endl;
-        
+
         ASSERT_LT( child0SurfaceArea, parentSurfaceArea );
         ASSERT_LT( child1SurfaceArea, parentSurfaceArea );
-        
+
         ASSERT_TRUE( parent.origin().isApprox( Vec3( -1.f, -1.f, -1.f ) ) );
         ASSERT_TRUE( parent.extension().isApprox( Vec3( 2.f, 2.f, 2.f ) ) );
     }
-    
-    TEST_F( BvhTest, BvhInsertion0 )
+
+    TEST_F( BvhTest, NodeLayout )
     {
+        ASSERT_EQ( 32, sizeof( BvhNode ) );
+
         Point p0( Vec3( 0.f, 0.f, 0.f ), Vec3( -1.f, -1.f, -1.f ) );
         Point p1( Vec3( 1.f, 1.f, 1.f ), Vec3( 1.f, 1.f, 1.f ) );
         Point p2( Vec3( 2.f, 2.f, 2.f ), Vec3( 2.f, 2.f, 2.f ) );
-        
-        Bvh bvh;
-        bvh.insert( p0 );
-        bvh.insert( p1 );
-        bvh.insert( p2 );
-        
-        const Aabb& root = bvh.root();
-        
-        ASSERT_TRUE( root.origin().isApprox( Vec3( -1.f, -1.f, -1.f ) ) );
-        ASSERT_TRUE( root.extension().isApprox( Vec3( 3.f, 3.f, 3.f ) ) );
+
+        Bvh bvh( Bvh::PointVector( { p2, p0, p1 } ), numeric_limits< int >::max(), 1u );
+
+        // Splitting p0 alone is cheaper than splitting p2 alone, so the expected hierarchy is ( p0, ( p1, p2 ) ).
+        const Bvh::NodeVector& nodes = bvh.nodes();
+        ASSERT_EQ( 5, nodes.size() );
+
+        const BvhNode& root = bvh.root();
         ASSERT_FALSE( root.isLeaf() );
-        
-        const InnerAabb::ChildrenVector& rootsChildren = dynamic_cast< const InnerAabb& >( root ).children();
-        ASSERT_EQ( rootsChildren.size(), 2 );
-        
-        const Aabb& expectedP0 = *rootsChildren[ 0 ];
+        ASSERT_TRUE( root.aabb().origin().isApprox( Vec3( -1.f, -1.f, -1.f ) ) );
+        ASSERT_TRUE( root.aabb().extension().isApprox( Vec3( 3.f, 3.f, 3.f ) ) );
+        ASSERT_EQ( 1, BvhNode::leftChild( 0 ) );
+        ASSERT_EQ( 2, root.rightChild() );
+
+        const BvhNode& expectedP0 = nodes[ 1 ];
         ASSERT_TRUE( expectedP0.isLeaf() );
-        ASSERT_TRUE( expectedP0.origin().isApprox( p0.getPos() ) );
-        ASSERT_TRUE( expectedP0.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        const Aabb& expectedP1P2Parent = *rootsChildren[ 1 ];
+        ASSERT_EQ( 0, expectedP0.firstPoint() );
+        ASSERT_EQ( 1, expectedP0.nPoints() );
+        ASSERT_TRUE( expectedP0.aabb().origin().isApprox( p0.getPos() ) );
+        ASSERT_TRUE( expectedP0.aabb().extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
+
+        const BvhNode& expectedP1P2Parent = nodes[ 2 ];
         ASSERT_FALSE( expectedP1P2Parent.isLeaf() );
-        ASSERT_TRUE( expectedP1P2Parent.origin().isApprox( p1.getPos() ) );
-        ASSERT_TRUE( expectedP1P2Parent.extension().isApprox( Vec3( 1.f, 1.f, 1.f ) ) );
-        
-        const InnerAabb::ChildrenVector& p1P2ParentsChildren = dynamic_cast< const InnerAabb& >( expectedP1P2Parent ).children();
-        ASSERT_EQ( p1P2ParentsChildren.size(), 2 );
-        
-        const Aabb& expectedP1 = *p1P2ParentsChildren[ 0 ];
+        ASSERT_TRUE( expectedP1P2Parent.aabb().origin().isApprox( p1.getPos() ) );
+        ASSERT_TRUE( expectedP1P2Parent.aabb().extension().isApprox( Vec3( 1.f, 1.f, 1.f ) ) );
+        ASSERT_EQ( 4, expectedP1P2Parent.rightChild() );
+
+        const BvhNode& expectedP1 = nodes[ 3 ];
         ASSERT_TRUE( expectedP1.isLeaf() );
-        ASSERT_TRUE( expectedP1.origin().isApprox( p1.getPos() ) );
-        ASSERT_TRUE( expectedP1.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        const Aabb& expectedP2 = *p1P2ParentsChildren[ 1 ];
+        ASSERT_EQ( 1, expectedP1.firstPoint() );
+        ASSERT_TRUE( bvh.points()[ 1 ].equal( p1 ) );
+
+        const BvhNode& expectedP2 = nodes[ 4 ];
         ASSERT_TRUE( expectedP2.isLeaf() );
-        ASSERT_TRUE( expectedP2.origin().isApprox( p2.getPos() ) );
-        ASSERT_TRUE( expectedP2.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
+        ASSERT_EQ( 2, expectedP2.firstPoint() );
+        ASSERT_TRUE( bvh.points()[ 2 ].equal( p2 ) );
+
         ASSERT_NO_THROW( bvh.isSane() );
     }
-    
-    TEST_F( BvhTest, BvhInsertion1 )
+
+    TEST_F( BvhTest, BulkBuild )
     {
-        Point p0( Vec3( 0.f, 0.f, 0.f ), Vec3( -1.f, -1.f, -1.f ) );
-        Point p1( Vec3( 1.f, 1.f, 1.f ), Vec3( 1.f, 1.f, 1.f ) );
-        Point p2( Vec3( 2.f, 2.f, 2.f ), Vec3( 2.f, 2.f, 0.5f ) );
-        
-        Bvh bvh;
-        bvh.insert( p0 );
-        bvh.insert( p1 );
-        bvh.insert( p2 );
-        
-        const Aabb& root = bvh.root();
-        
-        ASSERT_TRUE( root.origin().isApprox( Vec3( -1.f, -1.f, -1.f ) ) );
-        ASSERT_TRUE( root.extension().isApprox( Vec3( 3.f, 3.f, 2.f ) ) );
-        ASSERT_FALSE( root.isLeaf() );
-        
-        const InnerAabb::ChildrenVector& rootsChildren = dynamic_cast< const InnerAabb& >( root ).children();
-        ASSERT_EQ( rootsChildren.size(), 2 );
-        
-        const Aabb& expectedP0 = *rootsChildren[ 0 ];
-        ASSERT_TRUE( expectedP0.isLeaf() );
-        ASSERT_TRUE( expectedP0.origin().isApprox( p0.getPos() ) );
-        ASSERT_TRUE( expectedP0.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        const Aabb& expectedP1P2Parent = *rootsChildren[ 1 ];
-        ASSERT_FALSE( expectedP1P2Parent.isLeaf() );
-        ASSERT_TRUE( expectedP1P2Parent.origin().isApprox( Vec3( 1.f, 1.f, 0.5f ) ) );
-        ASSERT_TRUE( expectedP1P2Parent.extension().isApprox( Vec3( 1.f, 1.f, 0.5f ) ) );
-        
-        const InnerAabb::ChildrenVector& p1P2ParentsChildren = dynamic_cast< const InnerAabb& >( expectedP1P2Parent ).children();
-        ASSERT_EQ( p1P2ParentsChildren.size(), 2 );
-        
-        const Aabb& expectedP1 = *p1P2ParentsChildren[ 0 ];
-        ASSERT_TRUE( expectedP1.isLeaf() );
-        ASSERT_TRUE( expectedP1.origin().isApprox( p1.getPos() ) );
-        ASSERT_TRUE( expectedP1.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        const Aabb& expectedP2 = *p1P2ParentsChildren[ 1 ];
-        ASSERT_TRUE( expectedP2.isLeaf() );
-        ASSERT_TRUE( expectedP2.origin().isApprox( p2.getPos() ) );
-        ASSERT_TRUE( expectedP2.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        ASSERT_NO_THROW( bvh.isSane() );
+        const uint nPoints = 100000u;
+        const uint maxLeafPoints = 8u;
+
+        Bvh parallelBvh( createPoints( nPoints ), numeric_limits< int >::max(), maxLeafPoints, 4 );
+        ASSERT_NO_THROW( parallelBvh.isSane() );
+
+        Bvh::Statistics stats = parallelBvh.statistics();
+        cout << "BVH Statistics: " << endl << stats << endl << endl;
+
+        ASSERT_EQ( nPoints, stats.m_nPoints );
+        ASSERT_EQ( parallelBvh.nodes().size(), stats.m_nNodes );
+        ASSERT_EQ( stats.m_nLeaves * 2 - 1, stats.m_nNodes );
+        ASSERT_EQ( 2, stats.m_avgChildrenPerInner );
+        ASSERT_LE( stats.m_maxPointsPerLeaf, maxLeafPoints );
+        ASSERT_GE( stats.m_minPointsPerLeaf, 1 );
+        ASSERT_EQ( 0, stats.m_recursionCount );
+
+        // The hierarchy does not depend on the number of threads.
+        Bvh serialBvh( createPoints( nPoints ), numeric_limits< int >::max(), maxLeafPoints, 1 );
+        ASSERT_EQ( parallelBvh.nodes().size(), serialBvh.nodes().size() );
+        for( uint i = 0; i < serialBvh.nodes().size(); ++i )
+        {
+            const BvhNode& node = parallelBvh.nodes()[ i ];
+            const BvhNode& serialNode = serialBvh.nodes()[ i ];
+            ASSERT_EQ( serialNode.isLeaf(), node.isLeaf() );
+            ASSERT_EQ( serialNode.nPoints(), node.nPoints() );
+            ASSERT_EQ( serialNode.rightChild(), node.rightChild() );
+            ASSERT_TRUE( serialNode.aabb().origin() == node.aabb().origin() );
+            ASSERT_TRUE( serialNode.aabb().maxPoint() == node.aabb().maxPoint() );
+        }
     }
-    
-    TEST_F( BvhTest, BvhInsertion2 )
+
+    TEST_F( BvhTest, MaxLevelAndDuplicates )
     {
-        Point p0( Vec3( 0.f, 0.f, 0.f ), Vec3( -1.f, -1.f, 0.f ) );
-        Point p1( Vec3( 2.f, 2.f, 2.f ), Vec3( 2.f, 2.f, -1.0f ) );
-        Point p2( Vec3( 1.f, 1.f, 1.f ), Vec3( 0.f, 0.f, 1.f ) );
-        
-        Bvh bvh;
-        bvh.insert( p0 );
-        bvh.insert( p1 );
-        bvh.insert( p2 );
-        
-        const Aabb& root = bvh.root();
-        
-        ASSERT_TRUE( root.origin().isApprox( Vec3( -1.f, -1.f, -1.f ) ) );
-        ASSERT_TRUE( root.extension().isApprox( Vec3( 3.f, 3.f, 2.f ) ) );
-        ASSERT_FALSE( root.isLeaf() );
-        
-        const InnerAabb::ChildrenVector& rootsChildren = dynamic_cast< const InnerAabb& >( root ).children();
-        ASSERT_EQ( rootsChildren.size(), 2 );
-        
-        const Aabb& expectedP0P2Parent = *rootsChildren[ 0 ];
-        ASSERT_FALSE( expectedP0P2Parent.isLeaf() );
-        ASSERT_TRUE( expectedP0P2Parent.origin().isApprox( Vec3( -1.f, -1.f, 0.f ) ) );
-        ASSERT_TRUE( expectedP0P2Parent.extension().isApprox( Vec3( 1.f, 1.f, 1.f ) ) );
-        
-        const Aabb& expectedP1 = *rootsChildren[ 1 ];
-        ASSERT_TRUE( expectedP1.isLeaf() );
-        ASSERT_TRUE( expectedP1.origin().isApprox( p1.getPos() ) );
-        ASSERT_TRUE( expectedP1.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        const InnerAabb::ChildrenVector& p0P2ParentsChildren = dynamic_cast< const InnerAabb& >( expectedP0P2Parent ).children();
-        ASSERT_EQ( p0P2ParentsChildren.size(), 2 );
-        
-        const Aabb& expectedP0 = *p0P2ParentsChildren[ 0 ];
-        ASSERT_TRUE( expectedP0.isLeaf() );
-        ASSERT_TRUE( expectedP0.origin().isApprox( p0.getPos() ) );
-        ASSERT_TRUE( expectedP0.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        const Aabb& expectedP2 = *p0P2ParentsChildren[ 1 ];
-        ASSERT_TRUE( expectedP2.isLeaf() );
-        ASSERT_TRUE( expectedP2.origin().isApprox( p2.getPos() ) );
-        ASSERT_TRUE( expectedP2.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-        
-        ASSERT_NO_THROW( bvh.isSane() );
+        Bvh::PointVector points = createPoints( 1000u );
+        for( int i = 0; i < 100; ++i )
+        {
+            points.push_back( Point( Vec3( 0.f, 0.f, 1.f ), Vec3( 0.5f, 0.5f, 0.5f ) ) );
+        }
+
+        Bvh shallowBvh( Bvh::PointVector( points ), 4, 1u );
+        ASSERT_NO_THROW( shallowBvh.isSane() );
+        ASSERT_EQ( 4, shallowBvh.statistics().m_maxDepth );
+        ASSERT_EQ( 1100, shallowBvh.statistics().m_nPoints );
+
+        // Coincident points cannot be separated by the SAH, so they are split at the median.
+        Bvh deepBvh( std::move( points ), numeric_limits< int >::max(), 4u );
+        ASSERT_NO_THROW( deepBvh.isSane() );
+        ASSERT_LE( deepBvh.statistics().m_maxPointsPerLeaf, 4 );
+
+        ASSERT_THROW( Bvh( Bvh::PointVector() ).root(), logic_error );
     }
-    
-// 		TEST_F( BvhTest, BvhInsertion3 )
-// 		{
-// 			Point p0( Vec3( 0.f, 0.f, 0.f ), Vec3( -1.f, -1.f, -1.f ) );
-// 			Point p1( Vec3( 2.f, 2.f, 2.f ), Vec3( 2.f, 2.f, 1.f ) );
-// 			Point p2( Vec3( 1.f, 1.f, 1.f ), Vec3( 0.f, 0.f, 0.5f ) );
-// 			
-// 			Bvh bvh;
-// 			bvh.insert( p0 );
-// 			bvh.insert( p1 );
-// 			bvh.insert( p2 );
-// 			
-// 			const Aabb& root = bvh.root();
-// 			
-// 			ASSERT_TRUE( root.origin().isApprox( Vec3( -1.f, -1.f, -1.f ) ) );
-// 			ASSERT_TRUE( root.extension().isApprox( Vec3( 3.f, 3.f, 2.f ) ) );
-// 			ASSERT_FALSE( root.isLeaf() );
-// 			
-// 			const InnerAabb::ChildrenVector& rootsChildren = dynamic_cast< const InnerAabb& >( root ).children();
-// 			ASSERT_EQ( rootsChildren.size(), 3 );
-// 			
-// 			const Aabb& expectedP0 = *rootsChildren[ 0 ];
-// 			ASSERT_TRUE( expectedP0.isLeaf() );
-// 			ASSERT_TRUE( expectedP0.origin().isApprox( p0.getPos() ) );
-// 			ASSERT_TRUE( expectedP0.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-// 			
-// 			const Aabb& expectedP1 = *rootsChildren[ 1 ];
-// 			ASSERT_TRUE( expectedP1.isLeaf() );
-// 			ASSERT_TRUE( expectedP1.origin().isApprox( p1.getPos() ) );
-// 			ASSERT_TRUE( expectedP1.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-// 			
-// 			const Aabb& expectedP2 = *rootsChildren[ 2 ];
-// 			ASSERT_TRUE( expectedP2.isLeaf() );
-// 			ASSERT_TRUE( expectedP2.origin().isApprox( p2.getPos() ) );
-// 			ASSERT_TRUE( expectedP2.extension().isApprox( Vec3( 0.f, 0.f, 0.f ) ) );
-// 			
-// 			testAabb( root );
-// 		}
-    
+
     TEST_F( BvhTest, BvhReal )
     {
 // 			Bvh bvh( "../data/example/staypuff.ply" );
@@ -257,13 +192,11 @@ namespace omicron::test
         Bvh bvh( "/media/vinicius/data/Datasets/StMathew/StMathewWithFaces.ply", 24 );
 // 			Bvh bvh( "/home/vinicius/Projects/PointBasedGraphics/Cumulus/src/data/real/prova5M.ply", 24 );
 // 			Bvh bvh( "/media/vinicius/Expansion Drive3/Datasets/bunny/bunny/reconstruction/bun_zipper_normals_bin.ply", 7 );
-        
-        const Aabb& root = bvh.root();
-        
+
 // 			bvh.isSane();
-        
+
         Bvh::Statistics stats = bvh.statistics();
-        
+
         cout << "BVH Statistics: " << endl << stats << endl << endl;
     }
 }
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "omicron/hierarchy/front_chunks.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace hierarchy;
+
+	using Chunks = FrontChunks< int >;
+
+	// Items are grouped by value / 8, as siblings. Negative items are pending and have no group.
+	bool sameGroup( const int& a, const int& b ) { return a >= 0 && b >= 0 && a / 8 == b / 8; }
+	bool isPending( const int& item ) { return item < 0; }
+
+	/** Checks order, group integrity, chunk sizes and pending counts.
+	 * @returns all items in order. */
+	vector< int > checkChunks( const Chunks& chunks, const size_t maxChunkSize )
+	{
+		vector< int > items;
+		for( size_t i = 0; i < chunks.nChunks(); ++i )
+		{
+			const Chunks::Chunk& chunk = chunks.chunk( i );
+			EXPECT_FALSE( chunk.m_items.empty() );
+			EXPECT_LE( chunk.m_items.size(), maxChunkSize );
+
+			uint nPending = 0u;
+			for( int item : chunk.m_items )
+			{
+				nPending += isPending( item );
+			}
+			EXPECT_EQ( nPending, chunk.m_nPending );
+
+			if( i > 0 )
+			{
+				EXPECT_FALSE( sameGroup( chunks.chunk( i - 1 ).m_items.back(), chunk.m_items.front() ) );
+			}
+
+			items.insert( items.end(), chunk.m_items.begin(), chunk.m_items.end() );
+		}
+		EXPECT_EQ( items.size(), chunks.size() );
+
+		return items;
+	}
+
+	TEST( FrontChunksTest, PushBack )
+	{
+		Chunks chunks( 10 );
+		ASSERT_TRUE( chunks.empty() );
+
+		for( int i = 0; i < 25; ++i )
+		{
+			chunks.pushBack( ( i % 5 == 0 ) ? -1 : i, i % 5 == 0 );
+		}
+
+		ASSERT_EQ( 25ul, chunks.size() );
+		ASSERT_EQ( 3ul, chunks.nChunks() );
+		ASSERT_EQ( 2u, chunks.chunk( 0 ).m_nPending );
+		ASSERT_EQ( 1u, chunks.chunk( 2 ).m_nPending );
+	}
+
+	TEST( FrontChunksTest, CompactKeepsOrderAndGroups )
+	{
+		const size_t chunkSize = 16;
+		Chunks chunks( chunkSize );
+		for( int i = 0; i < 64; ++i )
+		{
+			chunks.pushBack( i, false );
+		}
+
+		// Simulates an evaluation: chunk 0 shrinks, chunk 1 grows a lot and chunk 2 is emptied. Chunk 3 gets pending
+		// items.
+		Chunks::Chunk& shrunk = chunks.chunk( 0 );
+		shrunk.m_items.resize( 3 );
+
+		Chunks::Chunk& grown = chunks.chunk( 1 );
+		vector< int > grownItems;
+		for( int i = 0; i < 100; ++i )
+		{
+			grownItems.push_back( 16 + i );
+		}
+		grown.m_items.assign( grownItems.begin(), grownItems.end() );
+
+		chunks.chunk( 2 ).m_items.clear();
+
+		Chunks::Chunk& pending = chunks.chunk( 3 );
+		pending.m_items = { -1, 200, 201, -1 };
+		pending.m_nPending = 2u;
+
+		chunks.compact( sameGroup, isPending );
+
+		vector< int > expected = { 0, 1, 2 };
+		expected.insert( expected.end(), grownItems.begin(), grownItems.end() );
+		expected.insert( expected.end(), { -1, 200, 201, -1 } );
+
+		// A piece can exceed the target size by at most a group.
+		vector< int > items = checkChunks( chunks, 2 * chunkSize + 8 );
+		ASSERT_EQ( expected, items );
+		ASSERT_GT( chunks.nChunks(), 3ul );
+	}
+
+	TEST( FrontChunksTest, CompactMovesStraddlingGroups )
+	{
+		const size_t chunkSize = 4;
+		Chunks chunks( chunkSize );
+
+		// Group 1 ( 8 to 15 ) straddles the two chunks.
+		for( int item : { 0, 1, 8, 9 } )
+		{
+			chunks.pushBack( item, false );
+		}
+		for( int item : { 10, 11, 16, -1 } )
+		{
+			chunks.pushBack( item, item == -1 );
+		}
+		ASSERT_EQ( 2ul, chunks.nChunks() );
+
+		chunks.compact( sameGroup, isPending );
+
+		vector< int > items = checkChunks( chunks, 2 * chunkSize );
+		ASSERT_EQ( vector< int >( { 0, 1, 8, 9, 10, 11, 16, -1 } ), items );
+		ASSERT_EQ( 2ul, chunks.nChunks() );
+		ASSERT_EQ( 6ul, chunks.chunk( 0 ).m_items.size() );
+		ASSERT_EQ( 1u, chunks.chunk( 1 ).m_nPending );
+
+		ASSERT_EQ( 0ul, chunks.chunkAt( 0 ) );
+		ASSERT_EQ( 1ul, chunks.chunkAt( 6 ) );
+		ASSERT_EQ( 2ul, chunks.chunkAt( 7 ) );
+		ASSERT_EQ( 2ul, chunks.chunkAt( 8 ) );
+	}
+}
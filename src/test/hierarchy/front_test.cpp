@@ -1,11 +1,141 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <list>
+#include <memory>
 #include "omicron/hierarchy/front.h"
+#include "omicron/hierarchy/hierarchy_appender.h"
 #include "omicron/basic/morton_code.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "omicron/renderer/headless_renderer.h"
+#include "hierarchy/random_hierarchy.h"
 
 namespace omicron::test
 {
     using namespace std;
+    using namespace omicron::hierarchy;
+    
+    using Morton = basic::MediumMortonCode;
+    using TestFront = omicron::hierarchy::Front< Morton >;
+    using Node = TestFront::Node;
+    using Dim = TestFront::OctreeDim;
+    using PointVector = HierarchyAppender< Morton >::PointVector;
+    
+    /** HeadlessRenderer with the rendering list of SplatRenderer, which keeps pointers to the rendered nodes between
+     * frames. Counts the listed nodes that are unloaded, since SplatRenderer would render them after the unload. */
+    class ListRenderer : public renderer::HeadlessRenderer
+    {
+    public:
+        ListRenderer() : m_iter( m_list.end() ), m_nListedUnloads( 0u ), m_nListedNotLoaded( 0u ) {}
+        
+        void resetIterator() { m_iter = m_list.begin(); }
+        
+        void render( Node& node )
+        {
+            HeadlessRenderer::render( node );
+            if( m_iter != m_list.end() && *m_iter == &node )
+            {
+                ++m_iter;
+            }
+            else
+            {
+                m_list.insert( m_iter, &node );
+            }
+        }
+        
+        void eraseFromList( const Node& node )
+        {
+            HeadlessRenderer::eraseFromList( node );
+            if( m_iter != m_list.end() && *m_iter == &node )
+            {
+                m_iter = m_list.erase( m_iter );
+            }
+        }
+        
+        void removeFromList( const Node& node )
+        {
+            auto it = find( m_list.begin(), m_list.end(), &node );
+            if( it != m_list.end() )
+            {
+                if( it == m_iter )
+                {
+                    ++m_iter;
+                }
+                m_list.erase( it );
+            }
+        }
+        
+        void removeFromList( const unordered_set< const Node* >& nodes )
+        {
+            for( auto it = m_list.begin(); it != m_list.end(); )
+            {
+                if( nodes.count( *it ) )
+                {
+                    if( it == m_iter )
+                    {
+                        ++m_iter;
+                    }
+                    it = m_list.erase( it );
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+        
+        void unloadInGpu( Node& node )
+        {
+            if( find( m_list.begin(), m_list.end(), &node ) != m_list.end() )
+            {
+                ++m_nListedUnloads;
+            }
+            HeadlessRenderer::unloadInGpu( node );
+        }
+        
+        void render_frame()
+        {
+            for( const Node* node : m_list )
+            {
+                if( !isLoaded( *node ) )
+                {
+                    ++m_nListedNotLoaded;
+                }
+            }
+        }
+        
+        /** @returns the number of nodes unloaded while in the list. */
+        uint nListedUnloads() const { return m_nListedUnloads; }
+        
+        /** @returns the number of listed nodes found not loaded at render_frame(). */
+        uint nListedNotLoaded() const { return m_nListedNotLoaded; }
+        
+    private:
+        list< Node* > m_list;
+        list< Node* >::iterator m_iter;
+        uint m_nListedUnloads;
+        uint m_nListedNotLoaded;
+    };
+    
+    /** Random points in the box [ 0, maxCoord )^3, sorted in morton order. */
+    PointVector createFrontPoints( const uint nPoints, const float maxCoord, const ulong seed, const Dim& leafDim )
+    {
+        PointVector points = createRandomPoints( nPoints, maxCoord, seed );
+        disk::MortonRadixSorter< Morton >( leafDim ).sort( points.begin(), points.end() );
+        
+        return points;
+    }
+    
+    /** Moves the camera from far away to inside the box [ 0, 1 ]^3 and back, so the front prunes and branches. */
+    void trackFrames( TestFront& front, ListRenderer& renderer, const uint nFrames )
+    {
+        for( uint i = 0u; i < nFrames; ++i )
+        {
+            float t = float( i % 20u ) / 20.f;
+            float distance = 0.2f + 3.f * abs( 1.f - 2.f * t );
+            renderer.setViewMatrix( Affine3f( Translation3f( -0.5f, -0.5f, -0.5f - distance ) ) );
+            front.trackFront( renderer, 0.001f );
+        }
+    }
         
     class FrontTest : public ::testing::Test
     {
@@ -35,4 +165,62 @@ namespace omicron::test
 // 			Morton morton2; morton2.build( 0x956ac16f00ul );
 // 			front.insertPlaceholder( morton2, 0 );
     }
+    
+    TEST_F( FrontTest, UpdateRemovesInvalidatedNodesFromRenderingList )
+    {
+        Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 6u );
+        unique_ptr< Node > root = createRandomHierarchy( createRandomPoints( 20000u, 0.5f, 3ul ), leafDim, 32u );
+        
+        TestFront::NodeLoader loader( nullptr, 1 );
+        TestFront front( "", leafDim, 1, loader, 1024ul * 1024ul * 1024ul, Morton::maxLvl(), ReconstructionConfig() );
+        front.insertRoot( *root );
+        front.notifyLeafLvlLoaded();
+        
+        ListRenderer renderer;
+        trackFrames( front, renderer, 15u );
+        ASSERT_GT( renderer.nLoaded(), 0ul );
+        
+        // The batch invalidates the root and the nodes of the first octant, which are in the rendering list.
+        HierarchyAppender< Morton > appender( *root, leafDim, ReconstructionConfig(),
+                                              createFrontPoints( 5000u, 1.f, 5ul, leafDim ) );
+        front.beginUpdate( [ & ]( const Morton& morton ) { return appender.isInvalidated( morton ); },
+                           appender.createdMortons(), appender.invalidatedNodes(), renderer );
+        appender.append();
+        front.endUpdate( [ & ]( const Morton& morton ) { return appender.find( morton ); } );
+        
+        trackFrames( front, renderer, 40u );
+        
+        ASSERT_EQ( 0u, renderer.nListedUnloads() );
+        ASSERT_EQ( 0u, renderer.nListedNotLoaded() );
+    }
+    
+    TEST_F( FrontTest, EvictionsRemoveNodesFromRenderingList )
+    {
+        Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 6u );
+        unique_ptr< Node > root = createRandomHierarchy( createRandomPoints( 20000u, 1.f, 7ul ), leafDim, 32u );
+        
+        // The GPU quota fits about a quarter of the points, so nodes of chunks not tracked in a frame are evicted.
+        ulong totalGpuMem = GpuAllocStatistics::totalGpuMem();
+        GpuAllocStatistics::setTotalGpuMem( 10ul * 5000ul * GpuAllocStatistics::pointSize() );
+        
+        ReconstructionConfig config;
+        config.m_segmentsPerFront = 4u;
+        config.m_frontChunkSize = 64ul;
+        
+        {
+            TestFront::NodeLoader loader( nullptr, 1 );
+            TestFront front( "", leafDim, 1, loader, 1024ul * 1024ul * 1024ul, Morton::maxLvl(), config );
+            front.insertRoot( *root );
+            front.notifyLeafLvlLoaded();
+            
+            ListRenderer renderer;
+            trackFrames( front, renderer, 60u );
+            
+            ASSERT_LE( GpuAllocStatistics::totalAllocated(), GpuAllocStatistics::gpuMemQuota() );
+            ASSERT_EQ( 0u, renderer.nListedUnloads() );
+            ASSERT_EQ( 0u, renderer.nListedNotLoaded() );
+        }
+        
+        GpuAllocStatistics::setTotalGpuMem( totalGpuMem );
+    }
 }
@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include "omicron/hierarchy/gpu_residency_manager.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace hierarchy;
+
+	using Manager = GpuResidencyManager< int >;
+
+	/** Simulates clouds in a 1D row of unit cells. The camera requests the cells inside a view radius every frame and
+	 * uses the resident ones, as the front would do. */
+	class ResidencySimulation
+	{
+	public:
+		ResidencySimulation( Manager& manager, const int nCells, const float viewRadius, const ulong cellBytes )
+		: m_manager( manager ),
+		m_nCells( nCells ),
+		m_viewRadius( viewRadius ),
+		m_cellBytes( cellBytes ),
+		m_frame( 0ul )
+		{}
+
+		AlignedBox3f box( const int cell ) const
+		{
+			return AlignedBox3f( Vec3( cell, 0.f, 0.f ), Vec3( cell + 1.f, 1.f, 1.f ) );
+		}
+
+		bool isVisible( const int cell, const Vec3& eye ) const
+		{
+			return fabs( box( cell ).center().x() - eye.x() ) < m_viewRadius;
+		}
+
+		/** Runs a frame with the camera in the given position. */
+		void frame( const Vec3& eye )
+		{
+			++m_frame;
+
+			for( int cell = 0; cell < m_nCells; ++cell )
+			{
+				if( isVisible( cell, eye ) )
+				{
+					if( m_resident.count( cell ) )
+					{
+						m_manager.touch( cell, m_frame );
+					}
+					else
+					{
+						m_manager.request( cell, m_cellBytes, Manager::priority( box( cell ), eye ), m_frame );
+					}
+				}
+			}
+
+			vector< int > loads;
+			vector< int > evictions;
+			m_manager.schedule( m_frame, loads, evictions );
+
+			for( int cell : evictions )
+			{
+				// Clouds used in the current frame are never evicted.
+				ASSERT_FALSE( isVisible( cell, eye ) );
+
+				ASSERT_EQ( 1ul, m_resident.erase( cell ) );
+			}
+			for( int cell : loads )
+			{
+				ASSERT_TRUE( m_resident.insert( cell ).second );
+			}
+
+			ASSERT_LE( m_manager.residentBytes(), m_manager.budget() );
+			ASSERT_EQ( m_resident.size() * m_cellBytes, m_manager.residentBytes() );
+			ASSERT_EQ( m_resident.size(), m_manager.nResident() );
+		}
+
+		/** @returns true if all visible cells are resident. */
+		bool isViewResident( const Vec3& eye ) const
+		{
+			for( int cell = 0; cell < m_nCells; ++cell )
+			{
+				if( isVisible( cell, eye ) && !m_resident.count( cell ) )
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		Manager& m_manager;
+		int m_nCells;
+		float m_viewRadius;
+		ulong m_cellBytes;
+		ulong m_frame;
+		set< int > m_resident;
+	};
+
+	TEST( GpuResidencyManagerTest, PriorityOrder )
+	{
+		// Only 2 clouds fit.
+		Manager manager( 200ul );
+		Vec3 eye( 0.f, 0.5f, 0.5f );
+
+		for( int cell = 1; cell <= 4; ++cell )
+		{
+			AlignedBox3f box( Vec3( cell * 2.f, 0.f, 0.f ), Vec3( cell * 2.f + 1.f, 1.f, 1.f ) );
+			manager.request( cell, 100ul, Manager::priority( box, eye ), 1ul );
+		}
+
+		vector< int > loads;
+		vector< int > evictions;
+		manager.schedule( 1ul, loads, evictions );
+
+		// The closest clouds are loaded first.
+		ASSERT_EQ( vector< int >( { 1, 2 } ), loads );
+		ASSERT_TRUE( evictions.empty() );
+		ASSERT_TRUE( manager.isPending( 3 ) );
+		ASSERT_TRUE( manager.isPending( 4 ) );
+
+		// Cloud 4 gets close. It evicts the farthest resident cloud, which was not used in this frame.
+		manager.touch( 1, 2ul );
+		manager.request( 4, 100ul, 100.f, 2ul );
+		loads.clear();
+		manager.schedule( 2ul, loads, evictions );
+
+		ASSERT_EQ( vector< int >( { 4 } ), loads );
+		ASSERT_EQ( vector< int >( { 2 } ), evictions );
+		ASSERT_TRUE( manager.isResident( 1 ) );
+		ASSERT_EQ( 1ul, manager.nEvicted() );
+	}
+
+	TEST( GpuResidencyManagerTest, PrefetchDoesNotDelayRequests )
+	{
+		// Only 2 clouds fit.
+		Manager manager( 200ul );
+
+		// A prefetch does not lower the priority of a request in the same frame, but raises it.
+		manager.request( 1, 100ul, 2.f, 1ul );
+		manager.prefetch( 1, 100ul, 0.5f, 1ul );
+		manager.request( 2, 100ul, 1.f, 1ul );
+		manager.prefetch( 3, 100ul, 1.5f, 1ul );
+		manager.request( 4, 100ul, 0.1f, 1ul );
+		manager.prefetch( 4, 100ul, 3.f, 1ul );
+
+		vector< int > loads;
+		vector< int > evictions;
+		manager.schedule( 1ul, loads, evictions );
+		ASSERT_EQ( vector< int >( { 4, 1 } ), loads );
+
+		// A prefetch in a later frame renews the request with its own priority.
+		manager.prefetch( 3, 100ul, 0.2f, 2ul );
+		manager.request( 2, 100ul, 1.f, 2ul );
+		loads.clear();
+		manager.schedule( 2ul, loads, evictions );
+		ASSERT_TRUE( loads.empty() );
+		ASSERT_TRUE( manager.isPending( 2 ) );
+		ASSERT_TRUE( manager.isPending( 3 ) );
+	}
+
+	TEST( GpuResidencyManagerTest, ReservedBytes )
+	{
+		Manager manager( 300ul );
+		vector< int > loads;
+		vector< int > evictions;
+
+		// The reserved bytes leave room for a single cloud.
+		manager.setReservedBytes( 150ul );
+		manager.request( 1, 100ul, 1.f, 1ul );
+		manager.request( 2, 100ul, 2.f, 1ul );
+		manager.schedule( 1ul, loads, evictions );
+		ASSERT_EQ( vector< int >( { 2 } ), loads );
+		ASSERT_TRUE( manager.isPending( 1 ) );
+
+		// Nothing fits when the reserved bytes exceed the budget, so nothing is evicted in vain.
+		manager.setReservedBytes( 400ul );
+		manager.request( 1, 100ul, 3.f, 2ul );
+		loads.clear();
+		manager.schedule( 2ul, loads, evictions );
+		ASSERT_TRUE( loads.empty() );
+		ASSERT_TRUE( evictions.empty() );
+		ASSERT_TRUE( manager.isPending( 1 ) );
+
+		manager.setReservedBytes( 0ul );
+		manager.request( 1, 100ul, 3.f, 3ul );
+		manager.schedule( 3ul, loads, evictions );
+		ASSERT_EQ( vector< int >( { 1 } ), loads );
+		ASSERT_TRUE( manager.isResident( 2 ) );
+	}
+
+	TEST( GpuResidencyManagerTest, StaleRequestsArePreempted )
+	{
+		Manager manager( 10ul, 4u );
+		vector< int > loads;
+		vector< int > evictions;
+		manager.request( 1, 10ul, 1.f, 1ul );
+		manager.schedule( 1ul, loads, evictions );
+		ASSERT_TRUE( manager.isResident( 1 ) );
+
+		// Cloud 1 is used in the frame, so the request waits.
+		manager.touch( 1, 2ul );
+		manager.request( 7, 10ul, 2.f, 2ul );
+		loads.clear();
+		manager.schedule( 2ul, loads, evictions );
+		ASSERT_TRUE( manager.isPending( 7 ) );
+		ASSERT_TRUE( loads.empty() );
+
+		// The request is not renewed and is dropped once stale, instead of evicting cloud 1.
+		manager.schedule( 10ul, loads, evictions );
+		ASSERT_TRUE( loads.empty() );
+		ASSERT_TRUE( evictions.empty() );
+		ASSERT_FALSE( manager.isPending( 7 ) );
+		ASSERT_TRUE( manager.isResident( 1 ) );
+		ASSERT_EQ( 1ul, manager.nPreempted() );
+	}
+
+	TEST( GpuResidencyManagerTest, CameraPathSimulation )
+	{
+		const int nCells = 200;
+		const ulong cellBytes = 1000ul;
+		const float viewRadius = 10.f;
+
+		// The budget fits the visible cells plus a margin.
+		Manager manager( 30 * cellBytes, 8u, 64u );
+		ResidencySimulation sim( manager, nCells, viewRadius, cellBytes );
+
+		// The camera stays still until the view is resident.
+		Vec3 eye( 20.f, 0.5f, 5.f );
+		for( int i = 0; i < 3; ++i )
+		{
+			sim.frame( eye );
+		}
+		ASSERT_TRUE( sim.isViewResident( eye ) );
+
+		// Slow pan. The view keeps resident because the cells left behind are evicted for the new ones.
+		for( int i = 0; i < 100; ++i )
+		{
+			eye.x() += 0.5f;
+			sim.frame( eye );
+			sim.frame( eye );
+			ASSERT_TRUE( sim.isViewResident( eye ) );
+		}
+		ASSERT_GT( manager.nEvicted(), 0ul );
+
+		// The least recent cells are evicted first, so the resident ones are around the camera.
+		for( int cell : sim.m_resident )
+		{
+			ASSERT_LT( fabs( cell + 0.5f - eye.x() ), viewRadius + 30.f );
+		}
+
+	}
+
+	TEST( GpuResidencyManagerTest, FastCameraPreemption )
+	{
+		const int nCells = 400;
+		const ulong cellBytes = 1000ul;
+		const float viewRadius = 10.f;
+
+		// Few loads per frame, so a fast camera leaves requests behind.
+		Manager manager( 30 * cellBytes, 2u, 4u );
+		ResidencySimulation sim( manager, nCells, viewRadius, cellBytes );
+
+		Vec3 eye( 10.f, 0.5f, 5.f );
+		for( int i = 0; i < 70; ++i )
+		{
+			eye.x() += 5.f;
+			sim.frame( eye );
+
+			// Stale requests are dropped, so they do not pile up. A request is dropped at most 2 stale periods after its
+			// last renewal.
+			ASSERT_LE( manager.nPending(), 2 * viewRadius + 5 * ( 2 * 2 + 1 ) );
+		}
+		ASSERT_GT( manager.nPreempted(), 0ul );
+
+		// The camera stops and its view is loaded.
+		for( int i = 0; i < 10; ++i )
+		{
+			sim.frame( eye );
+		}
+		ASSERT_TRUE( sim.isViewResident( eye ) );
+		ASSERT_EQ( 0ul, manager.nPending() );
+	}
+}
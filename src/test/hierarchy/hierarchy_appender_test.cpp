@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "omicron/basic/morton_code.h"
+#include "omicron/hierarchy/hierarchy_appender.h"
+#include "omicron/hierarchy/top_down_creator.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "hierarchy/random_hierarchy.h"
+
+namespace omicron::test::hierarchy
+{
+	using namespace std;
+	using namespace omicron::hierarchy;
+
+	using Morton = basic::MediumMortonCode;
+	using Appender = HierarchyAppender< Morton >;
+	using Node = Appender::Node;
+	using Dim = Appender::OctreeDim;
+	using PointVector = Appender::PointVector;
+
+	/** Checks parent pointers, morton codes and sibling order. @returns the number of points in the leaves. */
+	ulong checkAppendedSubtree( const Node& node, const Node* parent, const Dim& dim, const Morton& morton )
+	{
+		EXPECT_EQ( parent, node.parent() );
+		EXPECT_FALSE( node.empty() );
+		for( const Surfel& surfel : node.getContents() )
+		{
+			EXPECT_EQ( morton, dim.calcMorton( surfel ) );
+		}
+
+		if( node.isLeaf() )
+		{
+			return node.getContents().size();
+		}
+
+		ulong nPoints = 0ul;
+		Dim childDim = dim.levelBellow();
+		for( uint i = 0; i < node.child().size(); ++i )
+		{
+			const Node& child = node.child()[ i ];
+			Morton childMorton = childDim.calcMorton( child );
+			EXPECT_EQ( morton, childMorton.parent() );
+			if( i > 0 )
+			{
+				EXPECT_TRUE( childDim.calcMorton( node.child()[ i - 1 ] ) < childMorton );
+			}
+
+			nPoints += checkAppendedSubtree( child, &node, childDim, childMorton );
+		}
+
+		return nPoints;
+	}
+
+	TEST( HierarchyAppenderTest, Append )
+	{
+		const uint nPoints = 20000u;
+		const uint nNewPoints = 5000u;
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 6u );
+		Dim rootDim( leafDim, 0u );
+		Morton rootMorton; rootMorton.build( 0x1 );
+
+		// The old points are in the first octant only, so the batch creates new sibling groups and new nodes under
+		// existing ones.
+		unique_ptr< Node > root = createRandomHierarchy( createRandomPoints( nPoints, 0.5f, 3ul ), leafDim, 32u );
+		ASSERT_EQ( 1u, root->child().size() );
+
+		PointVector newPoints = createRandomPoints( nNewPoints, 1.f, 5ul );
+		disk::MortonRadixSorter< Morton >( leafDim ).sort( newPoints.begin(), newPoints.end() );
+
+		Appender appender( *root, leafDim, ReconstructionConfig(), newPoints );
+
+		// The root is changed and its only child is moved to the new sibling group.
+		Morton firstOctant; firstOctant.build( 0x8 );
+		ASSERT_TRUE( appender.isInvalidated( rootMorton ) );
+		ASSERT_TRUE( appender.isInvalidated( firstOctant ) );
+		ASSERT_EQ( &root->child()[ 0 ], appender.find( firstOctant ) );
+
+		Morton lastOctant; lastOctant.build( 0xf );
+		ASSERT_FALSE( appender.isInvalidated( lastOctant ) );
+		ASSERT_EQ( nullptr, appender.find( lastOctant ) );
+
+		// Created subtree roots are in hierarchy width order and end with the new octants.
+		const vector< Morton >& created = appender.createdMortons();
+		ASSERT_GE( created.size(), 7u );
+		for( uint i = 1; i < created.size(); ++i )
+		{
+			ASSERT_TRUE( created[ i - 1 ].getAncestorInLvl( 1 ) <= created[ i ].getAncestorInLvl( 1 ) );
+		}
+		for( uint i = 0; i < 7u; ++i )
+		{
+			ASSERT_EQ( 0x9ul + i, created[ created.size() - 7u + i ].getBits() );
+		}
+
+		appender.append();
+
+		ASSERT_EQ( 8u, root->child().size() );
+		ASSERT_NE( nullptr, appender.find( lastOctant ) );
+		ASSERT_EQ( &root->child()[ 7 ], appender.find( lastOctant ) );
+		ASSERT_GT( appender.nCreatedNodes(), 0ul );
+		ASSERT_EQ( ulong( nPoints + nNewPoints ), checkAppendedSubtree( *root, nullptr, rootDim, rootMorton ) );
+	}
+
+	TEST( HierarchyAppenderTest, CostProportionalToBatch )
+	{
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 7u );
+		Dim rootDim( leafDim, 0u );
+		Morton rootMorton; rootMorton.build( 0x1 );
+
+		unique_ptr< Node > root = createRandomHierarchy( createRandomPoints( 50000u, 1.f, 7ul ), leafDim, 16u );
+		pair< uint, uint > stats = root->subtreeStatistics();
+
+		PointVector newPoints = createRandomPoints( 3u, 1.f, 11ul );
+		disk::MortonRadixSorter< Morton >( leafDim ).sort( newPoints.begin(), newPoints.end() );
+
+		Appender appender( *root, leafDim, ReconstructionConfig(), newPoints );
+		appender.append();
+
+		// At most one path to the leaf level per new point.
+		ASSERT_LE( appender.nResampledNodes(), 3ul * ( leafDim.m_nodeLvl + 1 ) );
+		ASSERT_LE( appender.nCreatedNodes() + stats.first, root->subtreeStatistics().first );
+		ASSERT_EQ( 50003ul, checkAppendedSubtree( *root, nullptr, rootDim, rootMorton ) );
+
+		// Empty batches change nothing.
+		Appender emptyAppender( *root, leafDim, ReconstructionConfig(), PointVector() );
+		ASSERT_TRUE( emptyAppender.invalidatedNodes().empty() );
+		emptyAppender.append();
+		ASSERT_EQ( 0ul, emptyAppender.nResampledNodes() );
+	}
+
+	TEST( HierarchyAppenderTest, InvalidBatches )
+	{
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 4u );
+		unique_ptr< Node > root = createRandomHierarchy( createRandomPoints( 100u, 1.f, 13ul ), leafDim, 8u );
+
+		PointVector unsorted;
+		unsorted.push_back( Point( Vec3( 0.f, 0.f, 1.f ), Vec3( 0.9f, 0.9f, 0.9f ) ) );
+		unsorted.push_back( Point( Vec3( 0.f, 0.f, 1.f ), Vec3( 0.1f, 0.1f, 0.1f ) ) );
+		ASSERT_THROW( Appender( *root, leafDim, ReconstructionConfig(), unsorted ), logic_error );
+
+		PointVector outside;
+		outside.push_back( Point( Vec3( 0.f, 0.f, 1.f ), Vec3( 0.5f, 1.5f, 0.5f ) ) );
+		ASSERT_THROW( Appender( *root, leafDim, ReconstructionConfig(), outside ), runtime_error );
+	}
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <memory>
+#include "omicron/hierarchy/hierarchy_creator.h"
+#include "omicron/disk/morton_radix_sorter.h"
+#include "omicron/disk/binary_point_writter.h"
+#include "hierarchy/random_hierarchy.h"
+
+namespace omicron::test::hierarchy
+{
+	using namespace std;
+	using namespace omicron::hierarchy;
+
+	using Morton = basic::MediumMortonCode;
+	using Creator = HierarchyCreator< Morton >;
+	using Node = Creator::Node;
+	using Dim = Creator::OctreeDim;
+	using CreatorFront = Creator::Front;
+
+	/** Reads points from memory, so creation tests do not depend on external datasets. */
+	class VectorPointReader : public disk::PointReader
+	{
+	public:
+		VectorPointReader( const RandomPointVector& points ) : m_points( points ) {}
+
+		void readBatches( const function< void( const disk::PointBatch& ) >& onBatchDone, ulong batchSize ) override
+		{
+			for( ulong i = 0ul; i < m_points.size(); i += batchSize )
+			{
+				onBatchDone( disk::PointBatch( m_points.data() + i, std::min( batchSize, m_points.size() - i ) ) );
+			}
+		}
+
+	private:
+		const RandomPointVector& m_points;
+	};
+
+	/** Random points in the box [ 0, maxCoord )^3, sorted in the morton order of the leaf lvl. */
+	RandomPointVector createSortedPoints( const uint nPoints, const float maxCoord, const ulong seed, const Dim& leafDim )
+	{
+		RandomPointVector points = createRandomPoints( nPoints, maxCoord, seed );
+		disk::MortonRadixSorter< Morton >( leafDim ).sort( points.begin(), points.end() );
+
+		return points;
+	}
+
+	/** Creates a hierarchy with the HierarchyCreator. */
+	unique_ptr< Node > createHierarchy( const RandomPointVector& points, const Dim& leafDim,
+										const ReconstructionConfig& config )
+	{
+		CreatorFront::NodeLoader loader( nullptr, 1 );
+		CreatorFront front( "", leafDim, config.m_nThreads, loader, config.m_ramQuota, Morton::maxLvl(), config );
+
+		Creator creator( Creator::ReaderPtr( new VectorPointReader( points ) ), leafDim,
+						 #ifdef HIERARCHY_CREATION_RENDERING
+							 front,
+						 #endif
+						 config.m_workListSize, config.m_ramQuota, config.m_nThreads, config );
+
+		return unique_ptr< Node >( creator.createAsync().get().first );
+	}
+
+	/** @returns true if node is a chain of single children ending in a leaf. NODE_COLAPSE turns such chains into leaves,
+	 * except when a node is in the boundary sibling group of a work chunk, so they depend on how the work was split. */
+	bool isCollapsible( const Node& node )
+	{
+		const Node* current = &node;
+		while( !current->isLeaf() && current->child().size() == 1 )
+		{
+			current = &current->child()[ 0 ];
+		}
+
+		return current->isLeaf();
+	}
+
+	/** Checks that both hierarchies have the same nodes with bitwise equal contents. A collapsed leaf matches the
+	 * non-collapsed nodes, since its contents are sampled the same way. */
+	void checkSameNodes( const Node& expected, const Node& node )
+	{
+		ASSERT_EQ( expected.getContents().size(), node.getContents().size() );
+		ASSERT_EQ( 0, memcmp( expected.getContents().data(), node.getContents().data(),
+							  expected.getContents().size() * sizeof( Surfel ) ) );
+
+		if( expected.isLeaf() != node.isLeaf() )
+		{
+			ASSERT_TRUE( isCollapsible( expected.isLeaf() ? node : expected ) );
+			return;
+		}
+
+		ASSERT_EQ( expected.child().size(), node.child().size() );
+
+		for( int i = 0; i < expected.child().size(); ++i )
+		{
+			checkSameNodes( expected.child()[ i ], node.child()[ i ] );
+		}
+	}
+
+	TEST( HierarchyCreatorTest, FullLeafQueue )
+	{
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 6u );
+		RandomPointVector points = createSortedPoints( 20000u, 1.f, 11ul, leafDim );
+
+		ReconstructionConfig config;
+		config.m_nThreads = 2;
+		config.m_workListSize = 4ul;
+		unique_ptr< Node > expected = createHierarchy( points, leafDim, config );
+
+		// The disk access thread waits for queue space after every few leaves, so creation only finishes if a full
+		// queue is dispatched.
+		config.m_leafWorkQueueSize = 2ul;
+		unique_ptr< Node > root = createHierarchy( points, leafDim, config );
+
+		checkSameNodes( *expected, *root );
+	}
+
+	TEST( HierarchyCreatorTest, SameNodesForAnyThreadCount )
+	{
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 7u );
+		RandomPointVector points = createSortedPoints( 50000u, 1.f, 13ul, leafDim );
+
+		ReconstructionConfig config;
+		config.m_nThreads = 1;
+		config.m_workListSize = 8ul;
+		unique_ptr< Node > expected = createHierarchy( points, leafDim, config );
+
+		// More threads split the work in other chunks, but the sampling only depends on the sibling groups.
+		for( int nThreads : { 2, 4, 7 } )
+		{
+			config.m_nThreads = nThreads;
+			unique_ptr< Node > root = createHierarchy( points, leafDim, config );
+			checkSameNodes( *expected, *root );
+		}
+	}
+
+	TEST( HierarchyCreatorTest, BinaryFileWithOtherDim )
+	{
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 6u );
+		RandomPointVector points = createSortedPoints( 1000u, 1.f, 17ul, leafDim );
+
+		string filename = string( "data/hierarchy_creator_test" ) + disk::BinaryPointHeader::EXTENSION;
+		{
+			disk::BinaryPointWritter< Morton > writter( filename, leafDim );
+			writter.write( disk::PointBatch( points.data(), points.size() ) );
+		}
+
+		ReconstructionConfig config;
+		CreatorFront::NodeLoader loader( nullptr, 1 );
+		auto createCreator = [ & ]( const Dim& dim )
+		{
+			CreatorFront front( "", dim, config.m_nThreads, loader, config.m_ramQuota, Morton::maxLvl(), config );
+			Creator creator( filename, dim,
+							 #ifdef HIERARCHY_CREATION_RENDERING
+								 front,
+							 #endif
+							 config.m_workListSize, config.m_ramQuota, config.m_nThreads, config );
+		};
+
+		ASSERT_NO_THROW( createCreator( leafDim ) );
+		ASSERT_THROW( createCreator( Dim( leafDim, 7u ) ), runtime_error );
+		ASSERT_THROW( createCreator( Dim( Vec3( 0.5f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 6u ) ), runtime_error );
+		ASSERT_THROW( createCreator( Dim( Vec3( 0.f, 0.f, 0.f ), Vec3( 2.f, 1.f, 1.f ), 6u ) ), runtime_error );
+
+		remove( filename.c_str() );
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef RANDOM_HIERARCHY_H
+#define RANDOM_HIERARCHY_H
+
+#include <memory>
+#include "omicron/hierarchy/top_down_creator.h"
+#include "omicron/util/counter_rng.h"
+
+/** Random points and hierarchies created from them, for tests that update or track finished hierarchies. */
+namespace omicron::test
+{
+	using namespace std;
+
+	using RandomPointVector = vector< Point, TbbAllocator< Point > >;
+
+	/** Random points in the box [ 0, maxCoord )^3. */
+	inline RandomPointVector createRandomPoints( const uint nPoints, const float maxCoord, const ulong seed )
+	{
+		RandomPointVector points( nPoints );
+		util::CounterRng rng( seed );
+		for( uint i = 0; i < nPoints; ++i )
+		{
+			float x = rng.uniformFloat();
+			float y = rng.uniformFloat();
+			float z = rng.uniformFloat();
+			points[ i ] = Point( Vec3( 0.f, 0.f, 1.f ), Vec3( x, y, z ) * maxCoord );
+		}
+
+		return points;
+	}
+
+	/** Creates a hierarchy from the points with the TopDownCreator. */
+	template< typename Morton >
+	unique_ptr< typename omicron::hierarchy::TopDownCreator< Morton >::Node > createRandomHierarchy(
+		const RandomPointVector& points, const omicron::hierarchy::OctreeDimensions< Morton >& leafDim,
+		const uint maxNodePoints )
+	{
+		using Creator = omicron::hierarchy::TopDownCreator< Morton >;
+		using Node = typename Creator::Node;
+		using Config = omicron::hierarchy::ReconstructionConfig;
+
+		typename Node::ContentsArray surfels( points.size() );
+		for( uint i = 0; i < points.size(); ++i )
+		{
+			surfels[ i ] = Surfel( points[ i ], Config().m_leafSurfelTangentSize );
+		}
+
+		return unique_ptr< Node >( Creator( leafDim, 2, Config(), maxNodePoints ).create( surfels ) );
+	}
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "omicron/disk/point_codec.h"
+#include "omicron/hierarchy/runtime_setup.h"
+
+namespace omicron::test::hierarchy
+{
+	using namespace std;
+	using namespace omicron::hierarchy;
+
+	TEST( ReconstructionConfigTest, DefaultsAreCompileTimeParams )
+	{
+		ReconstructionConfig config;
+		ASSERT_EQ( MODEL, config.m_model );
+		ASSERT_EQ( HIERARCHY_CREATION_THREADS, config.m_nThreads );
+		ASSERT_EQ( WORK_LIST_SIZE, config.m_workListSize );
+		ASSERT_EQ( RAM_QUOTA, config.m_ramQuota );
+		ASSERT_EQ( Sorting( SORTING ), config.m_sorting );
+		ASSERT_EQ( OOC_SORT_THREADS, config.m_oocSortThreads );
+		ASSERT_FLOAT_EQ( PROJ_THRESHOLD, config.m_projThresh );
+		ASSERT_FLOAT_EQ( PARENT_POINTS_RATIO_VALUE, config.m_parentPointsRatio );
+		ASSERT_EQ( SEGMENTS_PER_FRONT, config.m_segmentsPerFront );
+		ASSERT_EQ( PREFETCH_FRAMES, config.m_prefetchFrames );
+		ASSERT_FLOAT_EQ( PREFETCH_PRIORITY_SCALE, config.m_prefetchPriorityScale );
+		ASSERT_EQ( GPU_MEMORY, config.m_gpuMemory );
+
+		// The runtime tables match the compile-time ones.
+		ASSERT_TRUE( config.m_leafSurfelTangentSize.isApprox( ReconstructionParams::leafSurfelTangentSize( MODEL ) ) );
+		ASSERT_FLOAT_EQ( CAMERA_PATH_SPEED, ReconstructionParams::cameraPathSpeed( MODEL ) );
+		ASSERT_EQ( EXPECTED_SUBSTITUTED_PLACEHOLDERS, ReconstructionParams::expectedSubstitutedPlaceholders( MODEL ) );
+		for( uint level = 0u; level < 10u; ++level )
+		{
+			ASSERT_TRUE( config.tangentMultipliers( level ).isApprox( ReconstructionParams::calcMultipliers( level ) ) );
+		}
+		ASSERT_TRUE( config.tangentMultipliers( 100u ).isApprox( Vector2f( 1.f, 1.f ) ) );
+	}
+
+	TEST( ReconstructionConfigTest, Json )
+	{
+		ReconstructionConfig config;
+
+		Json::Value json;
+		json[ "model" ] = "david";
+		json[ "parentPointsRatio" ] = 0.25f;
+		json[ "hierarchyCreationThreads" ] = 3;
+		json[ "sorting" ] = "heap";
+		json[ "tangentMultipliers" ][ "6" ].append( 9.f );
+		json[ "tangentMultipliers" ][ "6" ].append( 8.f );
+		json[ "tangentMultipliers" ][ "20" ].append( 1.5f );
+		json[ "tangentMultipliers" ][ "20" ].append( 1.25f );
+		config.apply( json );
+
+		ASSERT_EQ( DAVID, config.m_model );
+		ASSERT_EQ( 3, config.m_nThreads );
+		ASSERT_EQ( HEAP_SORT, config.m_sorting );
+		ASSERT_TRUE( config.m_leafSurfelTangentSize.isApprox( Vector2f( 0.000037f, 0.00003f ) ) );
+		// David table for 1/4, except the explicit level.
+		ASSERT_TRUE( config.tangentMultipliers( 7u ).isApprox( Vector2f( 4.2f, 4.2f ) ) );
+		ASSERT_TRUE( config.tangentMultipliers( 6u ).isApprox( Vector2f( 9.f, 8.f ) ) );
+
+		// Round trip. All levels with multipliers are written.
+		ReconstructionConfig loaded;
+		loaded.apply( config.toJson() );
+		ASSERT_EQ( config.toJson(), loaded.toJson() );
+		ASSERT_TRUE( loaded.tangentMultipliers( 20u ).isApprox( Vector2f( 1.5f, 1.25f ) ) );
+
+		Json::Value unknown;
+		unknown[ "threads" ] = 2;
+		ASSERT_THROW( config.apply( unknown ), runtime_error );
+
+		Json::Value wrongType;
+		wrongType[ "workListSize" ] = "large";
+		ASSERT_THROW( config.apply( wrongType ), runtime_error );
+
+		// An invalid object does not change the configuration.
+		Json::Value invalid;
+		invalid[ "workListSize" ] = 7;
+		invalid[ "frontChunkSize" ] = 0;
+		ASSERT_THROW( config.apply( invalid ), runtime_error );
+		ASSERT_EQ( loaded.toJson(), config.toJson() );
+
+		ASSERT_THROW( ReconstructionConfig().apply( "prefetchPriorityScale", "2" ), runtime_error );
+		ASSERT_THROW( ReconstructionConfig().apply( "leafWorkQueueSize", "1" ), runtime_error );
+
+		ASSERT_THROW( config.apply( "model", "teapot" ), runtime_error );
+	}
+
+	TEST( ReconstructionConfigTest, PointCompression )
+	{
+		ReconstructionConfig config;
+		ASSERT_EQ( POINT_COMPRESSION, config.m_pointCompression );
+		ASSERT_EQ( COMPRESSION_POSITION_BITS, config.m_compressionPositionBits );
+
+		config.apply( "pointCompression", "nearLossless" );
+		config.apply( "compressionPositionBits", "12" );
+		ASSERT_EQ( NEAR_LOSSLESS_COMPRESSION, config.m_pointCompression );
+		ASSERT_EQ( "nearLossless", config.toJson()[ "pointCompression" ].asString() );
+
+		disk::PointCodec codec = disk::PointCodec::fromCompression( config.m_pointCompression,
+																	 config.m_compressionPositionBits );
+		ASSERT_EQ( disk::PointCodec::NEAR_LOSSLESS, codec.mode() );
+		ASSERT_EQ( 12u, codec.positionBits() );
+
+		config.apply( "pointCompression", "lossless" );
+		codec = disk::PointCodec::fromCompression( config.m_pointCompression, config.m_compressionPositionBits );
+		ASSERT_EQ( disk::PointCodec::LOSSLESS, codec.mode() );
+		ASSERT_THROW( disk::PointCodec::fromCompression( NO_COMPRESSION, 12u ), logic_error );
+
+		ASSERT_THROW( config.apply( "pointCompression", "zip" ), runtime_error );
+		ASSERT_THROW( ReconstructionConfig().apply( "compressionPositionBits", "22" ), runtime_error );
+	}
+
+	TEST( ReconstructionConfigTest, CommandLine )
+	{
+		string filename = "reconstruction_config_test.json";
+		{
+			ofstream out( filename );
+			out << "{ \"workListSize\" : 32, \"projThreshold\" : 0.1, \"dataset\" : \"from_file.oct\" }";
+		}
+
+		vector< string > argStrings = { "app", "--projThreshold=0.02", "dataset.ply", "--config=" + filename,
+										"--model=bunny", "--leafSurfelTangentSize=[0.5,0.25]", "path.txt" };
+		vector< char* > argv;
+		for( string& arg : argStrings )
+		{
+			argv.push_back( &arg[ 0 ] );
+		}
+
+		vector< string > positional;
+		ReconstructionConfig config = ReconstructionConfig::fromArgs( int( argv.size() ), argv.data(), positional );
+		remove( filename.c_str() );
+
+		ASSERT_EQ( vector< string >( { "dataset.ply", "path.txt" } ), positional );
+		ASSERT_EQ( 32ul, config.m_workListSize );
+		// Overrides win over the file, whatever the order.
+		ASSERT_FLOAT_EQ( 0.02f, config.m_projThresh );
+		ASSERT_EQ( "from_file.oct", config.m_dataset );
+		ASSERT_EQ( BUNNY, config.m_model );
+		ASSERT_TRUE( config.m_leafSurfelTangentSize.isApprox( Vector2f( 0.5f, 0.25f ) ) );
+
+		RuntimeSetup runtime( config );
+		ASSERT_EQ( config.m_nThreads, runtime.m_config.m_nThreads );
+		ASSERT_EQ( 32ul, runtime.m_config.m_workListSize );
+		ASSERT_EQ( config.m_ramQuota, runtime.m_config.m_ramQuota );
+
+		vector< string > badStrings = { "app", "--projThreshold" };
+		vector< char* > badArgv = { &badStrings[ 0 ][ 0 ], &badStrings[ 1 ][ 0 ] };
+		ASSERT_THROW( ReconstructionConfig::fromArgs( 2, badArgv.data(), positional ), runtime_error );
+		ASSERT_THROW( ReconstructionConfig::fromFile( "missing_config.json" ), runtime_error );
+	}
+}
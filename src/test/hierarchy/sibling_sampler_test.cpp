@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "omicron/hierarchy/o1_octree_node.h"
+#include "omicron/hierarchy/sibling_sampler.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace basic;
+	using namespace hierarchy;
+
+	using Node = O1OctreeNode< Surfel >;
+	using NodeArray = Node::NodeArray;
+	using Sampler = SiblingSampler< Node >;
+
+	/** Creates nNodes leaves with nodeSize[ i ] surfels each. Surfel centers are unique, encoding node and index. */
+	NodeArray createSiblings( const vector< int >& nodeSizes )
+	{
+		NodeArray siblings( nodeSizes.size() );
+		for( int i = 0; i < nodeSizes.size(); ++i )
+		{
+			Array< Surfel > surfels( nodeSizes[ i ] );
+			for( int j = 0; j < nodeSizes[ i ]; ++j )
+			{
+				surfels[ j ] = Surfel( Vec3( i, j, 0.f ), Vec3( 1.f, 0.f, 0.f ), Vec3( 0.f, 1.f, 0.f ) );
+			}
+			siblings[ i ] = Node( std::move( surfels ), true );
+		}
+
+		return siblings;
+	}
+
+	Array< Surfel > sample( const NodeArray& siblings, const ulong key, const uint nSamples )
+	{
+		Sampler sampler;
+		for( const Node& sibling : siblings )
+		{
+			sampler.push( sibling );
+		}
+		return sampler.sample( key, nSamples, Vector2f( 2.f, 3.f ) );
+	}
+
+	TEST( SiblingSamplerTest, SamplesFromSiblings )
+	{
+		vector< int > sizes = { 3, 0, 10, 1, 7 };
+		NodeArray siblings = createSiblings( sizes );
+
+		Sampler sampler;
+		for( const Node& sibling : siblings )
+		{
+			sampler.push( sibling );
+		}
+		ASSERT_EQ( 5, sampler.nSiblings() );
+		ASSERT_EQ( 21, sampler.nPoints() );
+
+		Array< Surfel > samples = sampler.sample( 0x9ul, 1000, Vector2f( 2.f, 3.f ) );
+		ASSERT_EQ( 1000, samples.size() );
+
+		vector< int > hits( sizes.size(), 0 );
+		for( const Surfel& s : samples )
+		{
+			int node = int( s.c.x() );
+			int idx = int( s.c.y() );
+			ASSERT_TRUE( node >= 0 && node < sizes.size() );
+			ASSERT_TRUE( idx >= 0 && idx < sizes[ node ] );
+			ASSERT_EQ( Vec3( 2.f, 0.f, 0.f ), s.u );
+			ASSERT_EQ( Vec3( 0.f, 3.f, 0.f ), s.v );
+			++hits[ node ];
+		}
+
+		// Empty siblings are never chosen and the others are chosen roughly proportionally to their sizes.
+		ASSERT_EQ( 0, hits[ 1 ] );
+		ASSERT_NEAR( 1000. * 10. / 21., hits[ 2 ], 80. );
+	}
+
+	TEST( SiblingSamplerTest, Deterministic )
+	{
+		NodeArray siblings = createSiblings( { 50, 20, 30 } );
+
+		Array< Surfel > expected = sample( siblings, 0x1a3ul, 64 );
+		ASSERT_EQ( 64, expected.size() );
+
+		// The same key gives the same sample in any thread.
+		vector< Array< Surfel > > results( 4 );
+		vector< thread > threads;
+		for( int i = 0; i < results.size(); ++i )
+		{
+			threads.push_back( thread( [ & ]( int t ) { results[ t ] = sample( siblings, 0x1a3ul, 64 ); }, i ) );
+		}
+		for( thread& t : threads )
+		{
+			t.join();
+		}
+
+		for( const Array< Surfel >& result : results )
+		{
+			ASSERT_EQ( expected.size(), result.size() );
+			for( int i = 0; i < expected.size(); ++i )
+			{
+				ASSERT_EQ( expected[ i ].c, result[ i ].c );
+			}
+		}
+
+		// Another key gives another sample.
+		Array< Surfel > other = sample( siblings, 0x1a4ul, 64 );
+		bool differs = false;
+		for( int i = 0; i < expected.size(); ++i )
+		{
+			differs = differs || expected[ i ].c != other[ i ].c;
+		}
+		ASSERT_TRUE( differs );
+	}
+
+	TEST( SiblingSamplerTest, Limits )
+	{
+		NodeArray empty = createSiblings( { 0, 0 } );
+		ASSERT_EQ( 0, sample( empty, 1ul, 1 ).size() );
+
+		NodeArray siblings = createSiblings( vector< int >( 9, 1 ) );
+		Sampler sampler;
+		for( int i = 0; i < Sampler::MAX_SIBLINGS; ++i )
+		{
+			sampler.push( siblings[ i ] );
+		}
+		ASSERT_THROW( sampler.push( siblings[ 8 ] ), logic_error );
+	}
+}
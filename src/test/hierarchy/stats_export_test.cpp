@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "omicron/hierarchy/stats_export.h"
+
+namespace omicron::test::hierarchy
+{
+	using namespace std;
+	using namespace omicron::hierarchy;
+
+	TEST( StatsExportTest, JsonAndCsv )
+	{
+		CumulusStats cumulus( 0.001f, 3ul );
+		cumulus.m_datasetName = "dataset";
+
+		OctreeStats octreeStats;
+		for( int i = 0; i < 5; ++i )
+		{
+			FrameStats frame( float( i ), 1.f, 100.f * float( i ), 0.f, 10.f, 5.f, float( i ), 0.f );
+			octreeStats.addFrame( frame );
+			cumulus.addFrame( octreeStats, 0.5f );
+		}
+
+		Json::Value json = toJson( cumulus );
+		ASSERT_EQ( "dataset", json[ "dataset" ].asString() );
+		ASSERT_EQ( 5, json[ "octree" ][ "frames" ].asInt() );
+		ASSERT_EQ( 2u, json[ "droppedFrames" ].asUInt() );
+		ASSERT_EQ( 3u, json[ "timeSeries" ].size() );
+
+		// The oldest frames were dropped.
+		const Json::Value& oldest = json[ "timeSeries" ][ 0 ];
+		ASSERT_EQ( 2u, oldest[ "frame" ].asUInt() );
+		ASSERT_FLOAT_EQ( 2.f, oldest[ "traversalTime" ].asFloat() );
+		ASSERT_FLOAT_EQ( 200.f, oldest[ "renderedPoints" ].asFloat() );
+		ASSERT_FLOAT_EQ( 2.f, oldest[ "prunes" ].asFloat() );
+		ASSERT_FLOAT_EQ( 0.5f, oldest[ "gpuOverhead" ].asFloat() );
+
+		Json::Value config = reconstructionParamsJson();
+		ASSERT_EQ( HIERARCHY_CREATION_THREADS, config[ "hierarchyCreationThreads" ].asInt() );
+		ASSERT_FLOAT_EQ( PROJ_THRESHOLD, config[ "projThreshold" ].asFloat() );
+
+		stringstream csv;
+		writeFramesCsv( csv, cumulus );
+		string line;
+		int nLines = 0;
+		while( getline( csv, line ) )
+		{
+			++nLines;
+		}
+		// Header and kept frames.
+		ASSERT_EQ( 4, nLines );
+	}
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "omicron/basic/morton_code.h"
+#include "omicron/hierarchy/top_down_creator.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+#include "omicron/util/counter_rng.h"
+
+namespace omicron::test::hierarchy
+{
+	using namespace std;
+	using namespace omicron::hierarchy;
+
+	using Morton = basic::MediumMortonCode;
+	using Creator = TopDownCreator< Morton >;
+	using Node = Creator::Node;
+	using Dim = Creator::OctreeDim;
+
+	/** Random points in the unit cube, denser near the origin so subtrees have different depths. */
+	Node::ContentsArray createPoints( const uint nPoints )
+	{
+		Node::ContentsArray points( nPoints );
+		util::CounterRng rng( 7ul );
+		for( uint i = 0; i < nPoints; ++i )
+		{
+			float x = rng.uniformFloat();
+			float y = rng.uniformFloat();
+			float z = rng.uniformFloat();
+			points[ i ] = Surfel( Vec3( x * x, y * y, z ), Vec3( 1.f, 0.f, 0.f ), Vec3( 0.f, 1.f, 0.f ) );
+		}
+
+		return points;
+	}
+
+	/** Checks the subtree structure and returns the number of points in its leaves. */
+	ulong checkSubtree( const Node& node, const Node* parent, const Dim& dim, const Morton& morton, const uint maxPoints )
+	{
+		EXPECT_EQ( parent, node.parent() );
+		for( const Surfel& surfel : node.getContents() )
+		{
+			EXPECT_EQ( morton, dim.calcMorton( surfel ) );
+		}
+
+		if( node.isLeaf() )
+		{
+			EXPECT_TRUE( node.getContents().size() <= maxPoints || dim.m_nodeLvl == 7u );
+			return node.getContents().size();
+		}
+
+		EXPECT_EQ( maxPoints, node.getContents().size() );
+		EXPECT_GT( node.child().size(), 0u );
+
+		ulong nPoints = 0ul;
+		Dim childDim = dim.levelBellow();
+		Morton previous;
+		for( uint i = 0; i < node.child().size(); ++i )
+		{
+			const Node& child = node.child()[ i ];
+			Morton childMorton = childDim.calcMorton( child );
+			EXPECT_EQ( morton, childMorton.parent() );
+			if( i > 0 )
+			{
+				EXPECT_TRUE( previous < childMorton );
+			}
+			previous = childMorton;
+
+			nPoints += checkSubtree( child, &node, childDim, childMorton, maxPoints );
+		}
+
+		return nPoints;
+	}
+
+	bool equalContents( const Node& a, const Node& b )
+	{
+		if( a.getContents().size() != b.getContents().size() || a.child().size() != b.child().size() )
+		{
+			return false;
+		}
+		for( uint i = 0; i < a.getContents().size(); ++i )
+		{
+			const Surfel& sa = a.getContents()[ i ];
+			const Surfel& sb = b.getContents()[ i ];
+			if( sa.c != sb.c || sa.u != sb.u || sa.v != sb.v )
+			{
+				return false;
+			}
+		}
+		for( uint i = 0; i < a.child().size(); ++i )
+		{
+			if( !equalContents( a.child()[ i ], b.child()[ i ] ) )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	TEST( TopDownCreatorTest, Creation )
+	{
+		const uint nPoints = 100000u;
+		const uint maxPoints = 64u;
+		Node::ContentsArray points = createPoints( nPoints );
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 7u );
+
+		Creator parallelCreator( leafDim, 4, ReconstructionConfig(), maxPoints, 1024ul );
+		unique_ptr< Node > root( parallelCreator.create( points ) );
+		ASSERT_GT( parallelCreator.spawnedTasks(), 0ul );
+
+		Dim rootDim( leafDim, 0u );
+		Morton rootMorton; rootMorton.build( 0x1 );
+		ASSERT_EQ( ulong( nPoints ), checkSubtree( *root, nullptr, rootDim, rootMorton, maxPoints ) );
+
+		// Independent of the number of threads and of the task cutoff.
+		Creator serialCreator( leafDim, 1, ReconstructionConfig(), maxPoints, nPoints + 1ul );
+		unique_ptr< Node > serialRoot( serialCreator.create( points ) );
+		ASSERT_EQ( 0ul, serialCreator.spawnedTasks() );
+		ASSERT_TRUE( equalContents( *root, *serialRoot ) );
+
+		ASSERT_THROW( serialCreator.create( Node::ContentsArray() ), logic_error );
+	}
+
+	TEST( TopDownCreatorTest, SamplingKey )
+	{
+		const uint nPoints = 1000u;
+		const uint maxPoints = 16u;
+		Node::ContentsArray points = createPoints( nPoints );
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 5u );
+
+		Creator creator( leafDim, 1, ReconstructionConfig(), maxPoints );
+		unique_ptr< Node > root( creator.create( points ) );
+
+		// The root is sampled from the input order with the sequence keyed by its morton code, which is the leading bit.
+		util::CounterRng rng( 0x1ul );
+		for( uint i = 0; i < maxPoints; ++i )
+		{
+			const Surfel& expected = points[ rng.uniform( nPoints ) ];
+			ASSERT_EQ( expected.c, root->getContents()[ i ].c );
+		}
+	}
+
+	TEST( TopDownCreatorTest, TangentMultipliers )
+	{
+		Node::ContentsArray points = createPoints( 1000u );
+		Dim leafDim( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 1.f ), 2u );
+
+		ReconstructionConfig config;
+		config.setTangentMultipliers( 1u, Vector2f( 2.f, 3.f ) );
+		config.setTangentMultipliers( 2u, Vector2f( 5.f, 7.f ) );
+
+		Creator creator( leafDim, 2, config, 10u, 1ul );
+		unique_ptr< Node > root( creator.create( points ) );
+
+		// Root points are sampled from the leaves and scaled by the multipliers of levels 1 and 2.
+		for( const Surfel& surfel : root->getContents() )
+		{
+			ASSERT_FLOAT_EQ( 10.f, surfel.u.norm() );
+			ASSERT_FLOAT_EQ( 21.f, surfel.v.norm() );
+		}
+		for( const Node& child : root->child() )
+		{
+			ASSERT_FALSE( child.isLeaf() );
+			for( const Surfel& surfel : child.getContents() )
+			{
+				ASSERT_FLOAT_EQ( 5.f, surfel.u.norm() );
+				ASSERT_FLOAT_EQ( 7.f, surfel.v.norm() );
+			}
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "omicron/memory/tbb_allocator.h"
+#include "omicron/util/profiler.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace memory;
+	using namespace util;
+
+	TEST( AllocStatisticsTest, ExactAndApproximate )
+	{
+		const int nThreads = 8;
+		const int nOps = 100000;
+
+		ulong exactBefore = AllocStatistics::totalAllocated();
+
+		// Threads allocate odd sizes and deallocate even sizes, some of them from other threads' allocations.
+		vector< thread > threads;
+		for( int t = 0; t < nThreads; ++t )
+		{
+			threads.push_back( thread(
+				[ & ]( int t )
+				{
+					for( int i = 0; i < nOps; ++i )
+					{
+						AllocStatistics::notifyAlloc( 2 * ( i % 64 ) + 1 + t );
+					}
+					for( int i = 0; i < nOps; ++i )
+					{
+						AllocStatistics::notifyDealloc( 2 * ( i % 64 ) + t );
+					}
+				}, t
+			) );
+		}
+		for( thread& t : threads )
+		{
+			t.join();
+		}
+
+		// Each alloc is 1 byte bigger than its dealloc.
+		ulong exactAfter = AllocStatistics::totalAllocated();
+		ASSERT_EQ( exactBefore + nThreads * nOps, exactAfter );
+
+		ulong approx = AllocStatistics::approxTotalAllocated();
+		ulong error = ( approx > exactAfter ) ? approx - exactAfter : exactAfter - approx;
+		ASSERT_LE( error, AllocStatistics::maxApproximationError() );
+	}
+
+	/** Compares the sharded counters with the single global atomic counter used before. The global counter is updated
+	 * by all threads, so its cache line bounces between cores. */
+	TEST( AllocStatisticsTest, ContentionBenchmark )
+	{
+		const int nThreads = std::max( 2u, thread::hardware_concurrency() );
+		const int nOps = 2000000;
+
+		auto run = [ & ]( auto notify )
+		{
+			vector< thread > threads;
+			for( int t = 0; t < nThreads; ++t )
+			{
+				threads.push_back( thread(
+					[ & ]()
+					{
+						for( int i = 0; i < nOps; ++i )
+						{
+							notify( size_t( 64 ) );
+						}
+					}
+				) );
+			}
+			for( thread& t : threads )
+			{
+				t.join();
+			}
+		};
+
+		stringstream ss; ss << nThreads << " threads, " << nOps << " notifications each";
+
+		atomic_ulong global( 0ul );
+		auto start = Profiler::now( "Global atomic counter, " + ss.str() );
+		run( [ & ]( size_t bytes ) { global += bytes; } );
+		int globalTime = Profiler::elapsedTime( start, "Global atomic counter, " + ss.str() );
+
+		ulong before = AllocStatistics::totalAllocated();
+		start = Profiler::now( "Sharded AllocStatistics, " + ss.str() );
+		run( [ & ]( size_t bytes ) { AllocStatistics::notifyAlloc( bytes ); } );
+		int shardedTime = Profiler::elapsedTime( start, "Sharded AllocStatistics, " + ss.str() );
+
+		ulong notified = ulong( nThreads ) * nOps * 64;
+		ASSERT_EQ( notified, global.load() );
+		ASSERT_EQ( before + notified, AllocStatistics::totalAllocated() );
+
+		cout << "Global / sharded time: " << float( globalTime ) / std::max( shardedTime, 1 ) << endl << endl;
+
+		run( [ & ]( size_t bytes ) { AllocStatistics::notifyDealloc( bytes ); } );
+		ASSERT_EQ( before, AllocStatistics::totalAllocated() );
+	}
+}
@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <list>
+#include <thread>
+#include <vector>
+#include "omicron/basic/array.h"
+#include "omicron/basic/point.h"
+#include "omicron/renderer/splat_renderer/surfel.hpp"
+#include "omicron/memory/level_arena.h"
+#include "omicron/memory/tbb_allocator.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace basic;
+	using namespace memory;
+
+	TEST( LevelArenaTest, ScopedAllocations )
+	{
+		ulong pagesBefore = LevelArena::pagesInUse();
+		ulong allocatedBefore = AllocStatistics::totalAllocated();
+
+		Array< Surfel > outside( 10 );
+		ASSERT_FALSE( LevelArena::owns( outside.data() ) );
+
+		{
+			LevelArena arena( 5, 0 );
+			vector< Array< Surfel > > arrays;
+
+			{
+				ArenaScope scope( arena );
+				ASSERT_EQ( &arena, LevelArena::current() );
+
+				for( int i = 0; i < 100; ++i )
+				{
+					arrays.push_back( Array< Surfel >( 100, Surfel( Vec3( i, i, i ), Vec3::Zero(), Vec3::Zero() ) ) );
+				}
+			}
+			ASSERT_EQ( nullptr, LevelArena::current() );
+
+			for( int i = 0; i < arrays.size(); ++i )
+			{
+				ASSERT_TRUE( LevelArena::owns( arrays[ i ].data() ) );
+				ASSERT_EQ( 0u, uintptr_t( arrays[ i ].data() ) % LevelArena::ALIGNMENT );
+				ASSERT_EQ( Vec3( i, i, i ), arrays[ i ][ 99 ].c );
+			}
+
+			ASSERT_EQ( pagesBefore + 1, LevelArena::pagesInUse() );
+			ASSERT_EQ( 1ul, LevelArena::pagesInUse( 5 ) );
+
+			// Blocks bigger than MAX_BLOCK_SIZE fall back to the scalable allocator.
+			{
+				ArenaScope scope( arena );
+				Array< Surfel > big( LevelArena::MAX_BLOCK_SIZE / sizeof( Surfel ) + 1 );
+				ASSERT_FALSE( LevelArena::owns( big.data() ) );
+			}
+		}
+
+		// The blocks and the arena are gone, so the page is dropped.
+		ASSERT_EQ( pagesBefore, LevelArena::pagesInUse() );
+		ASSERT_EQ( 0ul, LevelArena::pagesInUse( 5 ) );
+	}
+
+	TEST( LevelArenaTest, BlocksOutliveArena )
+	{
+		ulong pagesBefore = LevelArena::pagesInUse();
+		Array< Surfel > survivor;
+
+		{
+			LevelArena arena( 3, 0 );
+			ArenaScope scope( arena );
+			survivor = Array< Surfel >( 10, Surfel( Vec3( 1.f, 2.f, 3.f ), Vec3::Zero(), Vec3::Zero() ) );
+
+			// New batches start new pages.
+			Array< Surfel > first( 10 );
+			arena.startBatch( 1 );
+			Array< Surfel > second( 10 );
+			ASSERT_EQ( 3u, arena.level() );
+			ASSERT_EQ( 1ul, arena.batch() );
+			ASSERT_NE( uintptr_t( first.data() ) / LevelArena::PAGE_SIZE,
+					   uintptr_t( second.data() ) / LevelArena::PAGE_SIZE );
+		}
+
+		ASSERT_EQ( pagesBefore + 1, LevelArena::pagesInUse() );
+		ASSERT_EQ( Vec3( 1.f, 2.f, 3.f ), survivor[ 9 ].c );
+
+		survivor.clear();
+		ASSERT_EQ( pagesBefore, LevelArena::pagesInUse() );
+	}
+
+	TEST( LevelArenaTest, PageRollover )
+	{
+		ulong pagesBefore = LevelArena::pagesInUse();
+
+		{
+			LevelArena arena( 7, 0 );
+			// Reserved, so the vector does not copy the blocks when growing.
+			vector< Array< Surfel > > blocks;
+			blocks.reserve( 9 );
+			ArenaScope scope( arena );
+
+			// Each block takes almost an eighth of a page, so the first page fits 7 blocks with the page and block
+			// headers.
+			for( int i = 0; i < 9; ++i )
+			{
+				blocks.push_back( Array< Surfel >( LevelArena::MAX_BLOCK_SIZE / sizeof( Surfel ) ) );
+			}
+			ASSERT_EQ( pagesBefore + 2, LevelArena::pagesInUse() );
+
+			// Releasing the blocks of the first page drops it even though the arena is alive.
+			for( int i = 0; i < 7; ++i )
+			{
+				blocks[ i ].clear();
+			}
+			ASSERT_EQ( pagesBefore + 1, LevelArena::pagesInUse() );
+		}
+
+		ASSERT_EQ( pagesBefore, LevelArena::pagesInUse() );
+	}
+
+	TEST( LevelArenaTest, LiveBlockStatistics )
+	{
+		size_t blockSize = LevelArena::blockSize( 100 * sizeof( Surfel ) );
+		vector< Array< Surfel > > arrays;
+		arrays.reserve( 8000 );
+		ulong allocatedBefore = AllocStatistics::totalAllocated();
+
+		{
+			// One long-lived arena for many small batches, as in hierarchy creation. Only live blocks are reported,
+			// not the reserved pages.
+			LevelArena arena( 4, 0 );
+			ArenaScope scope( arena );
+			for( int i = 0; i < 8000; ++i )
+			{
+				arrays.push_back( Array< Surfel >( 100 ) );
+			}
+
+			ASSERT_EQ( allocatedBefore + 8000 * blockSize, AllocStatistics::totalAllocated() );
+			ASSERT_LE( LevelArena::pagesInUse( 4 ), 8000 * blockSize / LevelArena::PAGE_SIZE + 1 );
+
+			arrays.resize( 4000 );
+			ASSERT_EQ( allocatedBefore + 4000 * blockSize, AllocStatistics::totalAllocated() );
+		}
+
+		arrays.clear();
+		ASSERT_EQ( allocatedBefore, AllocStatistics::totalAllocated() );
+		ASSERT_EQ( 0ul, LevelArena::pagesInUse( 4 ) );
+	}
+
+	TEST( LevelArenaTest, CrossThreadDeallocation )
+	{
+		ulong pagesBefore = LevelArena::pagesInUse();
+		vector< Array< Surfel > > arrays( 4 );
+
+		vector< thread > threads;
+		for( int t = 0; t < arrays.size(); ++t )
+		{
+			threads.push_back( thread(
+				[ & ]( int t )
+				{
+					LevelArena arena( t, t );
+					ArenaScope scope( arena );
+					arrays[ t ] = Array< Surfel >( 1000 );
+				}, t
+			) );
+		}
+		for( thread& t : threads )
+		{
+			t.join();
+		}
+
+		ASSERT_EQ( pagesBefore + arrays.size(), LevelArena::pagesInUse() );
+
+		arrays.clear();
+		ASSERT_EQ( pagesBefore, LevelArena::pagesInUse() );
+	}
+
+	TEST( LevelArenaTest, OnlyOptedInTypes )
+	{
+		ulong pagesBefore = LevelArena::pagesInUse();
+
+		{
+			LevelArena arena( 2, 0 );
+			ArenaScope scope( arena );
+
+			// List nodes and other temporaries made in a scope are not taken from the arena.
+			Array< Point > points( 10 );
+			list< Surfel, TbbAllocator< Surfel > > surfelList( 10 );
+			ASSERT_FALSE( LevelArena::owns( points.data() ) );
+			ASSERT_FALSE( LevelArena::owns( &surfelList.front() ) );
+			ASSERT_EQ( pagesBefore, LevelArena::pagesInUse() );
+
+			Array< Surfel > contents( 10 );
+			ASSERT_TRUE( LevelArena::owns( contents.data() ) );
+			ASSERT_EQ( pagesBefore + 1, LevelArena::pagesInUse() );
+		}
+
+		ASSERT_EQ( pagesBefore, LevelArena::pagesInUse() );
+	}
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include "omicron/renderer/box_batch_tests.h"
+#include "omicron/renderer/camera_path.h"
+#include "omicron/renderer/headless_renderer.h"
+#include "omicron/util/counter_rng.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace renderer;
+
+	/** Random boxes of many sizes around [ 0, 1 ]^3, including flat boxes and boxes touching the z = 0 plane. */
+	BoxBatch createRandomBoxes( const uint nBoxes )
+	{
+		util::CounterRng rng( 37ul );
+		BoxBatch boxes;
+		for( uint i = 0u; i < nBoxes; ++i )
+		{
+			Vector3f min;
+			Vector3f size;
+			for( int j = 0; j < 3; ++j )
+			{
+				min[ j ] = rng.uniformFloat() * 3.f - 1.f;
+				size[ j ] = rng.uniformFloat() * pow( 0.5f, float( i % 12 ) );
+			}
+
+			switch( i % 5 )
+			{
+				case 0: size.z() = 0.f; break;
+				case 1: min.z() = 0.f; break;
+				case 2: min.z() = -size.z(); break;
+			}
+
+			boxes.push_back( AlignedBox3f( min, min + size ) );
+		}
+
+		return boxes;
+	}
+
+	/** Checks that all instruction sets give the results of the single box tests. */
+	void checkBatchTests( const BoxBatchTests& tests, const BoxBatch& boxes, const float projThresh )
+	{
+		for( BoxBatchTests::Isa isa : { BoxBatchTests::SCALAR, BoxBatchTests::SSE, BoxBatchTests::AVX } )
+		{
+			if( !BoxBatchTests::isSupported( isa ) )
+			{
+				continue;
+			}
+
+			BoxTestMasks masks;
+			tests.test( boxes, projThresh, masks, isa );
+			ASSERT_EQ( boxes.size(), masks.size() );
+
+			for( size_t i = 0ul; i < boxes.size(); ++i )
+			{
+				ASSERT_EQ( tests.isCullable( boxes.box( i ) ), masks.isCullable( i ) ) << "Isa " << isa << " box " << i;
+				ASSERT_EQ( tests.isRenderable( boxes.box( i ), projThresh ), masks.isRenderable( i ) )
+					<< "Isa " << isa << " box " << i;
+			}
+
+			// Bits beyond the last box are not set.
+			if( boxes.size() % 64 != 0 )
+			{
+				ASSERT_EQ( 0ul, masks.cullable().back() >> ( boxes.size() % 64 ) );
+				ASSERT_EQ( 0ul, masks.renderable().back() >> ( boxes.size() % 64 ) );
+			}
+		}
+	}
+
+	TEST( BoxBatchTestsTest, SingleBoxTests )
+	{
+		HeadlessRenderer renderer;
+		renderer.setViewMatrix( Affine3f( Translation3f( 0.f, 0.f, -2.f ) ) );
+		renderer.begin_frame();
+		BoxBatchTests tests( Matrix4f( renderer.projectionMatrix() * renderer.viewMatrix().matrix() ) );
+
+		AlignedBox3f center( Vector3f::Constant( -0.1f ), Vector3f::Constant( 0.1f ) );
+		AlignedBox3f behind( Vector3f( -0.1f, -0.1f, 2.5f ), Vector3f( 0.1f, 0.1f, 3.f ) );
+		AlignedBox3f beside( Vector3f( 10.f, -0.1f, -0.1f ), Vector3f( 10.2f, 0.1f, 0.1f ) );
+
+		ASSERT_FALSE( tests.isCullable( center ) );
+		ASSERT_TRUE( tests.isCullable( behind ) );
+		ASSERT_TRUE( tests.isCullable( beside ) );
+
+		// The squared projected diagonal of the center box is about 0.06 in normalized device coordinates.
+		ASSERT_TRUE( tests.isRenderable( center, 0.1f ) );
+		ASSERT_FALSE( tests.isRenderable( center, 0.01f ) );
+
+		ASSERT_EQ( renderer.isCullable( center ), tests.isCullable( center ) );
+		ASSERT_EQ( renderer.isRenderable( center, 0.1f ), tests.isRenderable( center, 0.1f ) );
+
+		BoxTestMasks masks;
+		tests.test( BoxBatch(), 0.1f, masks );
+		ASSERT_EQ( 0ul, masks.size() );
+	}
+
+	TEST( BoxBatchTestsTest, BatchMatchesScalar )
+	{
+		HeadlessRenderer renderer;
+		CameraPath path( "data/atlas_camera_path.txt" );
+
+		// Sizes that are not multiples of the SIMD widths, so the scalar tail is also tested.
+		for( uint nBoxes : { 7u, 64u, 1001u, 4099u } )
+		{
+			BoxBatch boxes = createRandomBoxes( nBoxes );
+
+			for( uint frame = 0u; frame < path.nFrames( 10u ); frame += 11u )
+			{
+				renderer.setViewMatrix( path.viewAtFrame( frame, 10u ) );
+				BoxBatchTests tests( Matrix4f( renderer.projectionMatrix() * renderer.viewMatrix().matrix() ) );
+
+				for( float projThresh : { 0.001f, 0.05f, 1.f } )
+				{
+					checkBatchTests( tests, boxes, projThresh );
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "omicron/renderer/camera_path.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace renderer;
+
+	TEST( CameraPathTest, LoadsTucanoFormat )
+	{
+		string filename = "camera_path_test.txt";
+		{
+			ofstream out( filename );
+			out << "2" << endl
+				<< "0.5 1 2 1" << endl
+				<< "0 0 0 1" << endl
+				<< "0 0 0 1" << endl
+				<< "0" << endl
+				<< "1 2 4 2" << endl
+				<< "0 0.707107 0 0.707107" << endl
+				<< "0 0.707107 0 0.707107" << endl
+				<< "0" << endl;
+		}
+
+		CameraPath path( filename );
+		remove( filename.c_str() );
+
+		ASSERT_EQ( 2ul, path.keys().size() );
+		ASSERT_TRUE( path.keys()[ 0 ].m_position.isApprox( Vector3f( 0.5f, 1.f, 2.f ) ) );
+		// Homogeneous positions are normalized.
+		ASSERT_TRUE( path.keys()[ 1 ].m_position.isApprox( Vector3f( 0.5f, 1.f, 2.f ) ) );
+		ASSERT_TRUE( path.keys()[ 1 ].m_orientation.isApprox( Quaternionf( AngleAxisf( 0.5f * M_PI, Vector3f::UnitY() ) ),
+															  1e-5f ) );
+
+		ASSERT_THROW( CameraPath( "missing_camera_path.txt" ), runtime_error );
+	}
+
+	TEST( CameraPathTest, Replay )
+	{
+		CameraPath path;
+		ASSERT_EQ( 0u, path.nFrames( 10u ) );
+
+		path.addKey( Vector3f( 0.f, 0.f, 0.f ), Quaternionf::Identity() );
+		path.addKey( Vector3f( 2.f, 0.f, 0.f ), Quaternionf( AngleAxisf( 0.5f * M_PI, Vector3f::UnitY() ) ) );
+		path.addKey( Vector3f( 2.f, 4.f, 0.f ), Quaternionf( AngleAxisf( 0.5f * M_PI, Vector3f::UnitY() ) ) );
+
+		uint framesPerSegment = 10u;
+		ASSERT_EQ( 21u, path.nFrames( framesPerSegment ) );
+
+		// Keys are hit exactly.
+		for( uint i = 0u; i < path.keys().size(); ++i )
+		{
+			Affine3f camera = path.cameraAtFrame( i * framesPerSegment, framesPerSegment );
+			ASSERT_TRUE( camera.translation().isApprox( path.keys()[ i ].m_position ) );
+			ASSERT_TRUE( Quaternionf( camera.rotation() ).isApprox( path.keys()[ i ].m_orientation, 1e-5f ) );
+		}
+
+		// Halfway between the first two keys.
+		Affine3f camera = path.cameraAtFrame( 5u, framesPerSegment );
+		ASSERT_TRUE( camera.translation().isApprox( Vector3f( 1.f, 0.f, 0.f ) ) );
+		ASSERT_TRUE( Quaternionf( camera.rotation() ).isApprox(
+			Quaternionf( AngleAxisf( 0.25f * M_PI, Vector3f::UnitY() ) ), 1e-5f ) );
+
+		// The view matrix maps the eye to the origin.
+		Affine3f view = path.viewAtFrame( 15u, framesPerSegment );
+		ASSERT_TRUE( ( view * Vector3f( 2.f, 2.f, 0.f ) ).isZero( 1e-5f ) );
+	}
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include "omicron/renderer/camera_path.h"
+#include "omicron/renderer/camera_predictor.h"
+#include "omicron/renderer/headless_renderer.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace renderer;
+
+	/** Boxes of a regular grid covering [ -1, 2 ]^3. */
+	vector< AlignedBox3f > createGridBoxes( const int nCellsPerAxis )
+	{
+		vector< AlignedBox3f > boxes;
+		float cellSize = 3.f / nCellsPerAxis;
+		for( int x = 0; x < nCellsPerAxis; ++x )
+		{
+			for( int y = 0; y < nCellsPerAxis; ++y )
+			{
+				for( int z = 0; z < nCellsPerAxis; ++z )
+				{
+					Vector3f min = Vector3f( x, y, z ) * cellSize - Vector3f::Constant( 1.f );
+					boxes.push_back( AlignedBox3f( min, min + Vector3f::Constant( cellSize ) ) );
+				}
+			}
+		}
+
+		return boxes;
+	}
+
+	TEST( CameraPredictorTest, ConstantMotion )
+	{
+		ASSERT_THROW( CameraPredictor( 1u ), logic_error );
+
+		CameraPredictor predictor( 4u );
+		ASSERT_THROW( predictor.predictCamera( 1.f ), logic_error );
+
+		Vector3f velocity( 0.01f, -0.02f, 0.03f );
+		AngleAxisf rotationPerFrame( 0.05f, Vector3f( 1.f, 2.f, 0.5f ).normalized() );
+		Quaternionf initial( AngleAxisf( 0.3f, Vector3f::UnitX() ) );
+
+		auto cameraAt = [ & ]( const float frame )
+		{
+			AngleAxisf rotation( rotationPerFrame.angle() * frame, rotationPerFrame.axis() );
+			return Affine3f( Translation3f( Vector3f( 0.5f, 0.5f, 2.f ) + velocity * frame ) * ( rotation * initial ) );
+		};
+
+		predictor.push( cameraAt( 0.f ).inverse() );
+		ASSERT_FALSE( predictor.canPredict() );
+		// Without history, the prediction is the last camera.
+		ASSERT_TRUE( predictor.predictCamera( 5.f ).isApprox( cameraAt( 0.f ), 1e-5f ) );
+
+		for( int frame = 1; frame < 10; ++frame )
+		{
+			predictor.push( cameraAt( frame ).inverse() );
+		}
+		ASSERT_TRUE( predictor.canPredict() );
+		ASSERT_TRUE( predictor.linearVelocity().isApprox( velocity, 1e-4f ) );
+		ASSERT_NEAR( rotationPerFrame.angle(), predictor.angularVelocity().angle(), 1e-4f );
+
+		for( float ahead : { 1.f, 5.f, 20.f } )
+		{
+			Affine3f predicted = predictor.predictCamera( ahead );
+			Affine3f expected = cameraAt( 9.f + ahead );
+			ASSERT_TRUE( predicted.translation().isApprox( expected.translation(), 1e-4f ) );
+			ASSERT_TRUE( Quaternionf( predicted.rotation() ).angularDistance( Quaternionf( expected.rotation() ) )
+						 < 1e-3f );
+			ASSERT_TRUE( predictor.predictView( ahead ).isApprox( predicted.inverse(), 1e-5f ) );
+		}
+
+		// A still camera is predicted still.
+		predictor.clear();
+		for( int frame = 0; frame < 4; ++frame )
+		{
+			predictor.push( cameraAt( 3.f ).inverse() );
+		}
+		ASSERT_TRUE( predictor.predictCamera( 10.f ).isApprox( cameraAt( 3.f ), 1e-5f ) );
+	}
+
+	TEST( CameraPredictorTest, ViewTestsMatchRenderer )
+	{
+		HeadlessRenderer renderer;
+		CameraPath path( "data/atlas_camera_path.txt" );
+		vector< AlignedBox3f > boxes = createGridBoxes( 12 );
+
+		for( uint frame = 0u; frame < path.nFrames( 10u ); frame += 7u )
+		{
+			renderer.setViewMatrix( path.viewAtFrame( frame, 10u ) );
+			renderer.begin_frame();
+			ViewTests view( renderer.projectionMatrix(), renderer.viewMatrix() );
+
+			ASSERT_TRUE( view.eyePosition().isApprox( renderer.eyePosition(), 1e-5f ) );
+			for( const AlignedBox3f& box : boxes )
+			{
+				ASSERT_EQ( renderer.isCullable( box ), view.isCullable( box ) );
+				ASSERT_EQ( renderer.isRenderable( box, 0.05f ), view.isRenderable( box, 0.05f ) );
+			}
+		}
+	}
+
+	/** Replays a recorded camera path. The boxes that become visible some frames ahead are found more often in the
+	 * predicted view than in the current one, so they can be queued for loading before they are needed. */
+	TEST( CameraPredictorTest, RecordedPathLookAhead )
+	{
+		HeadlessRenderer renderer;
+		CameraPath path( "data/atlas_camera_path.txt" );
+		vector< AlignedBox3f > boxes = createGridBoxes( 16 );
+
+		const uint framesPerSegment = 30u;
+		const uint framesAhead = 8u;
+		CameraPredictor predictor;
+
+		float currentError = 0.f;
+		float predictedError = 0.f;
+		uint nNewlyVisible = 0u;
+		uint nFoundByCurrent = 0u;
+		uint nFoundByPrediction = 0u;
+
+		for( uint frame = 0u; frame + framesAhead < path.nFrames( framesPerSegment ); ++frame )
+		{
+			Affine3f view = path.viewAtFrame( frame, framesPerSegment );
+			predictor.push( view );
+			if( !predictor.canPredict() )
+			{
+				continue;
+			}
+
+			Affine3f futureCamera = path.cameraAtFrame( frame + framesAhead, framesPerSegment );
+			currentError += ( view.inverse().translation() - futureCamera.translation() ).norm();
+			predictedError += ( predictor.predictCamera( framesAhead ).translation() - futureCamera.translation() ).norm();
+
+			ViewTests current( renderer.projectionMatrix(), view );
+			ViewTests predicted( renderer.projectionMatrix(), predictor.predictView( framesAhead ) );
+			ViewTests future( renderer.projectionMatrix(), futureCamera.inverse() );
+
+			for( const AlignedBox3f& box : boxes )
+			{
+				if( !future.isCullable( box ) && current.isCullable( box ) )
+				{
+					++nNewlyVisible;
+					nFoundByCurrent += !current.isCullable( box );
+					nFoundByPrediction += !predicted.isCullable( box );
+				}
+			}
+		}
+
+		ASSERT_GT( nNewlyVisible, 0u );
+		ASSERT_EQ( 0u, nFoundByCurrent );
+		ASSERT_GT( nFoundByPrediction, nNewlyVisible / 2 );
+		ASSERT_LT( predictedError, 0.5f * currentError );
+	}
+}
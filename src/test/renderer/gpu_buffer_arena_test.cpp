@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <map>
+#include <vector>
+#include "omicron/renderer/gpu_buffer_arena.h"
+#include "omicron/hierarchy/gpu_alloc_statistics.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace renderer;
+	using hierarchy::GpuAllocStatistics;
+
+	/** Backend that keeps buffers in main memory and records draws. */
+	class MockGpuBufferBackend
+	: public GpuBufferBackend
+	{
+	public:
+		typedef struct Draw
+		{
+			BufferId m_buffer;
+			uint m_first;
+			uint m_count;
+		} Draw;
+
+		MockGpuBufferBackend()
+		: m_nextId( 1u ),
+		m_nCreated( 0u )
+		{}
+
+		BufferId createBuffer( const size_t bytes ) override
+		{
+			++m_nCreated;
+			m_buffers[ m_nextId ] = vector< char >( bytes );
+			return m_nextId++;
+		}
+
+		void destroyBuffer( const BufferId buffer ) override
+		{
+			ASSERT_EQ( 1ul, m_buffers.erase( buffer ) );
+		}
+
+		void upload( const BufferId buffer, const size_t offset, const size_t bytes, const void* data ) override
+		{
+			vector< char >& memory = m_buffers.at( buffer );
+			ASSERT_LE( offset + bytes, memory.size() );
+			memcpy( memory.data() + offset, data, bytes );
+		}
+
+		void draw( const BufferId buffer, const uint first, const uint count ) override
+		{
+			m_draws.push_back( Draw{ buffer, first, count } );
+		}
+
+		map< BufferId, vector< char > > m_buffers;
+		vector< Draw > m_draws;
+		BufferId m_nextId;
+		uint m_nCreated;
+	};
+
+	using Slot = GpuBufferArena::Slot;
+
+	TEST( GpuBufferArenaTest, SizeClassesAndUpload )
+	{
+		MockGpuBufferBackend backend;
+		ulong gpuAllocatedBefore = GpuAllocStatistics::totalAllocated();
+
+		{
+			// Elements are ints. Slots have 4, 8 and 16 elements and buffers have 256 bytes.
+			GpuBufferArena arena( backend, sizeof( int ), 4u, 3u, 256ul );
+			ASSERT_EQ( 16u, arena.maxSlotElements() );
+
+			Slot oversized;
+			ASSERT_FALSE( arena.allocate( 17u, oversized ) );
+			ASSERT_EQ( 0ul, arena.nBuffers() );
+
+			vector< Slot > slots( 20 );
+			for( int i = 0; i < slots.size(); ++i )
+			{
+				uint nElements = 1 + i % 16;
+				ASSERT_TRUE( arena.allocate( nElements, slots[ i ] ) );
+				ASSERT_EQ( nElements, slots[ i ].m_nElements );
+				ASSERT_GE( arena.slotElements( slots[ i ].m_sizeClass ), nElements );
+
+				vector< int > data( nElements, i );
+				arena.upload( slots[ i ], data.data() );
+			}
+			ASSERT_EQ( slots.size(), arena.nUsedSlots() );
+			ASSERT_EQ( backend.m_buffers.size(), arena.nBuffers() );
+
+			// Slots are rounded up to their size class and the rest of the buffers is slack.
+			ASSERT_EQ( 4ul * sizeof( int ), arena.footprint( 3u ) );
+			ASSERT_EQ( 16ul * sizeof( int ), arena.footprint( 9u ) );
+			ASSERT_EQ( 17ul * sizeof( int ), arena.footprint( 17u ) );
+			size_t usedBytes = 0ul;
+			for( const Slot& slot : slots )
+			{
+				usedBytes += arena.footprint( slot.m_nElements );
+			}
+			ASSERT_EQ( arena.allocatedBytes() - usedBytes, arena.slackBytes() );
+			ASSERT_EQ( gpuAllocatedBefore + arena.allocatedBytes(), GpuAllocStatistics::totalAllocated() );
+
+			// Slots do not overlap, so all uploads are intact.
+			for( int i = 0; i < slots.size(); ++i )
+			{
+				const int* elements = reinterpret_cast< const int* >( backend.m_buffers[ slots[ i ].m_buffer ].data() );
+				for( uint j = 0; j < slots[ i ].m_nElements; ++j )
+				{
+					ASSERT_EQ( i, elements[ slots[ i ].m_first + j ] );
+				}
+			}
+
+			// Slots are drawn with their first element as offset.
+			arena.draw( slots[ 5 ] );
+			ASSERT_EQ( 1ul, backend.m_draws.size() );
+			ASSERT_EQ( slots[ 5 ].m_buffer, backend.m_draws[ 0 ].m_buffer );
+			ASSERT_EQ( slots[ 5 ].m_first, backend.m_draws[ 0 ].m_first );
+			ASSERT_EQ( 6u, backend.m_draws[ 0 ].m_count );
+		}
+
+		// The arena destroys its buffers.
+		ASSERT_TRUE( backend.m_buffers.empty() );
+		ASSERT_EQ( gpuAllocatedBefore, GpuAllocStatistics::totalAllocated() );
+	}
+
+	TEST( GpuBufferArenaTest, ReuseAndEviction )
+	{
+		MockGpuBufferBackend backend;
+
+		// One size class with 8 slots per buffer.
+		GpuBufferArena arena( backend, sizeof( int ), 4u, 1u, 8ul * 4ul * sizeof( int ) );
+
+		vector< Slot > slots( 24 );
+		for( Slot& slot : slots )
+		{
+			ASSERT_TRUE( arena.allocate( 4u, slot ) );
+		}
+		ASSERT_EQ( 3ul, arena.nBuffers() );
+
+		// Released slots are reused before new buffers are created.
+		Slot released = slots[ 3 ];
+		arena.release( released );
+		ASSERT_TRUE( arena.allocate( 2u, slots[ 3 ] ) );
+		ASSERT_EQ( released.m_buffer, slots[ 3 ].m_buffer );
+		ASSERT_EQ( released.m_first, slots[ 3 ].m_first );
+		ASSERT_EQ( 3u, backend.m_nCreated );
+
+		// The first empty buffer is kept. The second one is destroyed.
+		for( int i = 0; i < 16; ++i )
+		{
+			arena.release( slots[ i ] );
+		}
+		ASSERT_EQ( 2ul, arena.nBuffers() );
+		ASSERT_EQ( 2ul, backend.m_buffers.size() );
+		ASSERT_EQ( 8ul, arena.nUsedSlots() );
+		// The kept empty buffer is slack.
+		ASSERT_EQ( 8ul * 4ul * sizeof( int ), arena.slackBytes() );
+
+		// The kept buffer serves the next allocations.
+		for( int i = 0; i < 8; ++i )
+		{
+			ASSERT_TRUE( arena.allocate( 4u, slots[ i ] ) );
+		}
+		ASSERT_EQ( 2ul, arena.nBuffers() );
+		ASSERT_EQ( 3u, backend.m_nCreated );
+	}
+}
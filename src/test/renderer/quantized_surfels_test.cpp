@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+#include "omicron/renderer/splat_renderer/quantized_surfels.h"
+
+namespace omicron
+{
+	namespace test
+	{
+		class QuantizedSurfelsTest : public ::testing::Test
+		{
+		protected:
+			void SetUp() {}
+		};
+
+		Array< Surfel > randomSurfels( const AlignedBox3f& box, const int nSurfels )
+		{
+			mt19937 generator( 7 );
+			uniform_real_distribution< float > unit( 0.f, 1.f );
+			uniform_real_distribution< float > signedUnit( -1.f, 1.f );
+
+			Array< Surfel > surfels( nSurfels );
+			for( Surfel& surfel : surfels )
+			{
+				Vec3 c = box.min() + Vec3( unit( generator ), unit( generator ), unit( generator ) ).cwiseProduct( box.sizes() );
+				Vec3 normal = Vec3( signedUnit( generator ), signedUnit( generator ), signedUnit( generator ) ).normalized();
+				Vec3 u = normal.unitOrthogonal() * ( 0.001f + 0.01f * unit( generator ) );
+				Vec3 v = normal.cross( u ).normalized() * ( 0.001f + 0.01f * unit( generator ) );
+
+				surfel = Surfel( c, u, v );
+			}
+
+			return surfels;
+		}
+
+		void checkDecoded( const Array< Surfel >& expected, const QuantizedSurfels& quantized )
+		{
+			ASSERT_EQ( expected.size(), quantized.size() );
+
+			Vec3 maxPosError = quantized.maxPositionError();
+
+			for( uint i = 0; i < expected.size(); ++i )
+			{
+				Surfel decoded = quantized[ i ];
+
+				for( int axis = 0; axis < 3; ++axis )
+				{
+					ASSERT_NEAR( expected[ i ].c[ axis ], decoded.c[ axis ], maxPosError[ axis ] );
+				}
+
+				// Octahedral encoding with 16 bits has angular error far below 0.001 rad.
+				ASSERT_GT( expected[ i ].u.normalized().dot( decoded.u.normalized() ), 0.99999f );
+				ASSERT_GT( expected[ i ].v.normalized().dot( decoded.v.normalized() ), 0.99999f );
+				ASSERT_NEAR( expected[ i ].u.norm(), decoded.u.norm(), 1.e-6f );
+				ASSERT_NEAR( expected[ i ].v.norm(), decoded.v.norm(), 1.e-6f );
+			}
+		}
+
+		TEST_F( QuantizedSurfelsTest, EncodeDecode )
+		{
+			AlignedBox3f box( Vec3( 0.25f, 0.5f, 0.f ), Vec3( 0.375f, 0.625f, 0.125f ) );
+			Array< Surfel > surfels = randomSurfels( box, 1000 );
+
+			QuantizedSurfels quantized( surfels, box );
+			checkDecoded( surfels, quantized );
+
+			// Half of the raw surfel storage, plus a header.
+			ASSERT_EQ( quantized.serializedSize() - QuantizedSurfels::serializedSize( 0 ),
+					   surfels.size() * sizeof( Surfel ) / 2 );
+
+			Array< Surfel > decoded = quantized.decode();
+			for( uint i = 0; i < surfels.size(); ++i )
+			{
+				ASSERT_TRUE( decoded[ i ].c.isApprox( quantized[ i ].c ) );
+			}
+		}
+
+		TEST_F( QuantizedSurfelsTest, Persistence )
+		{
+			AlignedBox3f box( Vec3( -1.f, -1.f, -1.f ), Vec3( 1.f, 1.f, 1.f ) );
+			Array< Surfel > surfels = randomSurfels( box, 100 );
+			QuantizedSurfels quantized( surfels, box );
+
+			stringstream stream;
+			quantized.persist( stream );
+			string bytes = stream.str();
+			ASSERT_EQ( quantized.serializedSize(), bytes.size() );
+
+			QuantizedSurfels fromStream( stream );
+			checkDecoded( surfels, fromStream );
+
+			QuantizedSurfels fromBytes( bytes.data() );
+			checkDecoded( surfels, fromBytes );
+		}
+
+		TEST_F( QuantizedSurfelsTest, DegenerateInput )
+		{
+			// Flat box and zero tangents.
+			AlignedBox3f box( Vec3( 0.f, 0.f, 0.f ), Vec3( 1.f, 1.f, 0.f ) );
+			Array< Surfel > surfels( 1, Surfel( Vec3( 0.5f, 0.5f, 0.f ), Vec3( 0.f, 0.f, 0.f ), Vec3( 0.f, 0.f, -0.1f ) ) );
+
+			QuantizedSurfels quantized( surfels, box );
+			Surfel decoded = quantized[ 0 ];
+
+			ASSERT_TRUE( decoded.c.isApprox( surfels[ 0 ].c, 1.e-4f ) );
+			ASSERT_EQ( Vec3( 0.f, 0.f, 0.f ), decoded.u );
+			ASSERT_TRUE( decoded.v.isApprox( surfels[ 0 ].v, 1.e-4f ) );
+
+			QuantizedSurfels empty( Array< Surfel >(), box );
+			ASSERT_TRUE( empty.empty() );
+			ASSERT_EQ( 0, empty.decode().size() );
+		}
+	}
+}
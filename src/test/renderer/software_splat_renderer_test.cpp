@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include "omicron/renderer/software_splat_renderer.h"
+#include "omicron/util/counter_rng.h"
+
+namespace omicron::test
+{
+	using namespace std;
+	using namespace renderer;
+
+	/** Splat facing the camera, which is at the origin looking to -z. */
+	Surfel createFacingSurfel( const Vector3f& center, const float radius )
+	{
+		return Surfel( center, Vector3f( radius, 0.f, 0.f ), Vector3f( 0.f, radius, 0.f ) );
+	}
+
+	/** @returns the window depth of an eye space z. */
+	float windowDepth( const Matrix4f& projection, const float z )
+	{
+		return ( -projection( 2, 3 ) / z - projection( 2, 2 ) + 1.f ) * 0.5f;
+	}
+
+	TEST( SoftwareSplatRendererTest, SingleSplat )
+	{
+		SoftwareSplatRenderer renderer( 64u, 64u );
+		vector< Surfel > surfels = { createFacingSurfel( Vector3f( 0.f, 0.f, -1.f ), 0.1f ) };
+
+		renderer.begin_frame();
+		renderer.render( surfels.data(), surfels.size() );
+		renderer.render_frame();
+
+		// Front lit surfel: 0.15 ambient + 0.6 diffuse of the 0.5 gray, plus 0.1 specular, after the gamma sqrt.
+		uint8_t expected = uint8_t( lround( sqrt( 0.15f * 0.5f + 0.6f * 0.5f + 0.1f ) * 255.f ) );
+		for( int i = 0; i < 3; ++i )
+		{
+			ASSERT_EQ( expected, renderer.pixel( 32u, 32u )[ i ] );
+			ASSERT_EQ( 255, renderer.pixel( 0u, 0u )[ i ] );
+		}
+
+		ASSERT_NEAR( windowDepth( renderer.projectionMatrix(), -1.f - 5e-3f ), renderer.depth( 32u, 32u ), 1e-6f );
+		ASSERT_EQ( 1.f, renderer.depth( 0u, 0u ) );
+
+		// The splat is symmetric around the image center.
+		for( uint y = 0u; y < 64u; ++y )
+		{
+			for( uint x = 0u; x < 32u; ++x )
+			{
+				ASSERT_EQ( renderer.pixel( x, y )[ 0 ], renderer.pixel( 63u - x, y )[ 0 ] );
+				ASSERT_EQ( renderer.pixel( x, y )[ 0 ], renderer.pixel( x, 63u - y )[ 0 ] );
+			}
+		}
+
+		// Backfaces are culled.
+		surfels[ 0 ].v = -surfels[ 0 ].v;
+		renderer.begin_frame();
+		renderer.render( surfels.data(), surfels.size() );
+		renderer.render_frame();
+		ASSERT_EQ( 255, renderer.pixel( 32u, 32u )[ 0 ] );
+
+		renderer.parameters().m_backfaceCulling = false;
+		renderer.render_frame();
+		ASSERT_NE( 255, renderer.pixel( 32u, 32u )[ 0 ] );
+	}
+
+	TEST( SoftwareSplatRendererTest, Occlusion )
+	{
+		SoftwareSplatRenderer front( 64u, 64u );
+		SoftwareSplatRenderer back( 64u, 64u );
+
+		vector< Surfel > frontToBack = { createFacingSurfel( Vector3f( 0.f, 0.f, -1.f ), 0.1f ),
+										 createFacingSurfel( Vector3f( 0.f, 0.f, -2.f ), 0.5f ) };
+		vector< Surfel > backToFront = { frontToBack[ 1 ], frontToBack[ 0 ] };
+
+		front.begin_frame();
+		front.render( frontToBack.data(), frontToBack.size() );
+		front.render_frame();
+
+		back.begin_frame();
+		back.render( backToFront.data(), backToFront.size() );
+		back.render_frame();
+
+		// The visibility pass makes the result independent of the rendering order.
+		ASSERT_EQ( front.image(), back.image() );
+		ASSERT_NEAR( windowDepth( front.projectionMatrix(), -1.f - 5e-3f ), front.depth( 32u, 32u ), 1e-6f );
+
+		// The far splat is only visible around the near one.
+		ASSERT_NEAR( windowDepth( front.projectionMatrix(), -2.f - 5e-3f ), front.depth( 32u, 22u ), 1e-6f );
+		ASSERT_NE( 255, front.pixel( 32u, 22u )[ 0 ] );
+	}
+
+	TEST( SoftwareSplatRendererTest, SoftZBuffer )
+	{
+		SoftwareSplatRenderer renderer( 64u, 64u );
+		vector< Surfel > surfels = { createFacingSurfel( Vector3f( -0.02f, 0.f, -1.f ), 0.1f ),
+									 createFacingSurfel( Vector3f( 0.02f, 0.f, -1.f ), 0.1f ) };
+
+		renderer.begin_frame();
+		renderer.render( surfels.data(), 1ul );
+		renderer.render_frame();
+		float singleAlpha = renderer.alpha( 32u, 32u );
+		ASSERT_GT( singleAlpha, 0.f );
+		ASSERT_LT( singleAlpha, 1.f );
+
+		// Splats at the same depth are blended.
+		renderer.begin_frame();
+		renderer.render( surfels.data(), surfels.size() );
+		renderer.render_frame();
+		ASSERT_GT( renderer.alpha( 32u, 32u ), singleAlpha * 1.5f );
+
+		// Without the soft z-buffer, the first splat wins.
+		renderer.parameters().m_softZBuffer = false;
+		ASSERT_THROW( renderer.render_frame(), logic_error );
+
+		renderer.parameters().m_ewaFilter = false;
+		renderer.render_frame();
+		ASSERT_EQ( 1.f, renderer.alpha( 32u, 32u ) );
+	}
+
+	TEST( SoftwareSplatRendererTest, ThreadIndependence )
+	{
+		// Overlapping random splats, many of them across tile borders.
+		vector< Surfel > surfels;
+		util::CounterRng rng( 31ul );
+
+		for( int i = 0; i < 5000; ++i )
+		{
+			Vector3f c( rng.uniformFloat() - 0.5f, rng.uniformFloat() - 0.5f, -1.f - rng.uniformFloat() );
+			Vector3f n = Vector3f( rng.uniformFloat() - 0.5f, rng.uniformFloat() - 0.5f, 1.f ).normalized();
+			Vector3f u = n.cross( Vector3f::UnitY() ).normalized();
+			Vector3f v = n.cross( u );
+			surfels.push_back( Surfel( c, u * 0.02f, v * ( 0.01f + 0.02f * rng.uniformFloat() ) ) );
+		}
+
+		for( ReconstructionAlgorithm method : { ZPBG01, BHZK05, WHA07, ZRB04 } )
+		{
+			SoftwareSplatRenderer serial( 100u, 70u, 60.f, 0.001f, 10.f, 1 );
+			SoftwareSplatRenderer parallel( 100u, 70u, 60.f, 0.001f, 10.f, 4 );
+			serial.parameters().m_pointSizeMethod = method;
+			parallel.parameters().m_pointSizeMethod = method;
+
+			for( SoftwareSplatRenderer* renderer : { &serial, &parallel } )
+			{
+				renderer->begin_frame();
+				renderer->render( surfels.data(), 2000ul );
+				renderer->render( surfels.data() + 2000, surfels.size() - 2000ul );
+				renderer->render_frame();
+			}
+
+			ASSERT_EQ( serial.image(), parallel.image() ) << "Method " << method;
+			for( uint y = 0u; y < 70u; ++y )
+			{
+				for( uint x = 0u; x < 100u; ++x )
+				{
+					ASSERT_EQ( serial.depth( x, y ), parallel.depth( x, y ) );
+				}
+			}
+
+			// Something is rendered.
+			ASSERT_NE( vector< uint8_t >( serial.image().size(), 255 ), serial.image() ) << "Method " << method;
+		}
+	}
+
+	TEST( SoftwareSplatRendererTest, FewerThreadsThanRequested )
+	{
+		SoftwareSplatRenderer renderer( 64u, 64u, 60.f, 0.001f, 10.f, 4 );
+		vector< Surfel > surfels;
+		for( int i = 0; i < 64; ++i )
+		{
+			surfels.push_back( createFacingSurfel( Vector3f( -0.5f + float( i ) / 64.f, 0.f, -1.f ), 0.05f ) );
+		}
+
+		renderer.begin_frame();
+		renderer.render( surfels.data(), surfels.size() );
+		renderer.render_frame();
+		ASSERT_NE( vector< uint8_t >( renderer.image().size(), 255 ), renderer.image() );
+
+		// Nested in an active parallel region, the renderer gets a single thread. The bins of the other threads from
+		// the previous frame must not be rendered.
+		int maxActiveLevels = omp_get_max_active_levels();
+		omp_set_max_active_levels( 1 );
+
+		#pragma omp parallel num_threads( 2 )
+		{
+			#pragma omp single
+			{
+				renderer.begin_frame();
+				renderer.render_frame();
+			}
+		}
+
+		omp_set_max_active_levels( maxActiveLevels );
+
+		ASSERT_EQ( vector< uint8_t >( renderer.image().size(), 255 ), renderer.image() );
+	}
+
+	TEST( SoftwareSplatRendererTest, SavePpm )
+	{
+		SoftwareSplatRenderer renderer( 40u, 30u );
+		vector< Surfel > surfels = { createFacingSurfel( Vector3f( 0.1f, 0.1f, -1.f ), 0.1f ) };
+
+		renderer.begin_frame();
+		renderer.render( surfels.data(), surfels.size() );
+		renderer.render_frame();
+
+		string filename = "software_splat_renderer_test.ppm";
+		renderer.savePpm( filename );
+
+		ifstream in( filename, ios::binary );
+		string magic;
+		uint width, height, maxValue;
+		in >> magic >> width >> height >> maxValue;
+		in.get();
+		ASSERT_EQ( "P6", magic );
+		ASSERT_EQ( 40u, width );
+		ASSERT_EQ( 30u, height );
+		ASSERT_EQ( 255u, maxValue );
+
+		// Rows are written top-down.
+		vector< uint8_t > pixels( 40 * 30 * 3 );
+		in.read( reinterpret_cast< char* >( pixels.data() ), pixels.size() );
+		ASSERT_EQ( pixels.size(), in.gcount() );
+		for( uint y = 0u; y < 30u; ++y )
+		{
+			ASSERT_TRUE( equal( pixels.begin() + ( 29 - y ) * 40 * 3, pixels.begin() + ( 30 - y ) * 40 * 3,
+								renderer.pixel( 0u, y ) ) );
+		}
+
+		in.close();
+		remove( filename.c_str() );
+
+		ASSERT_THROW( renderer.savePpm( "/nonexistent_dir/image.ppm" ), runtime_error );
+	}
+}
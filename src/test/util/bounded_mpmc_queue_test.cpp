@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+#include <iostream>
+#include <list>
+#include <set>
+#include <map>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include "omicron/basic/morton_code.h"
+#include "omicron/util/bounded_mpmc_queue.h"
+
+namespace omicron::test::util
+{
+	using namespace std;
+	using namespace omicron::basic;
+	using namespace omicron::util;
+
+	TEST( BoundedMpmcQueueTest, FifoAndCapacity )
+	{
+		BoundedMpmcQueue< int > queue( 5 );
+		ASSERT_EQ( 8, queue.capacity() );
+		ASSERT_TRUE( queue.empty() );
+
+		for( int i = 0; i < 8; ++i )
+		{
+			ASSERT_TRUE( queue.tryPush( int( i ) ) );
+		}
+		ASSERT_FALSE( queue.tryPush( 8 ) );
+		ASSERT_EQ( 8, queue.size() );
+
+		for( int i = 0; i < 8; ++i )
+		{
+			int value;
+			ASSERT_TRUE( queue.tryPop( value ) );
+			ASSERT_EQ( i, value );
+		}
+
+		int value;
+		ASSERT_FALSE( queue.tryPop( value ) );
+		ASSERT_TRUE( queue.empty() );
+
+		ASSERT_THROW( BoundedMpmcQueue< int >( 1 ), logic_error );
+	}
+
+	/** Mimics the disk access thread and leaf lvl workers of HierarchyCreator. The producer cuts the sorted leaf codes
+	 * into lists ignoring sibling groups, so groups span list boundaries. A small queue forces backpressure. */
+	TEST( BoundedMpmcQueueTest, LeafWorkStress )
+	{
+		using Morton = MediumMortonCode;
+		using CodeList = list< Morton >;
+		using WorkItem = pair< ulong, CodeList >;
+
+		const int lvl = 7;
+		const int nCodes = 200000;
+		const ulong listSize = 5;
+		const int nConsumers = 8;
+
+		mt19937 rng( 1 );
+		uniform_int_distribution< ulong > coordDistribution( 0, ( 1ul << lvl ) - 1 );
+
+		set< ulong > codeSet;
+		while( codeSet.size() < nCodes )
+		{
+			Morton code; code.build( coordDistribution( rng ), coordDistribution( rng ), coordDistribution( rng ), lvl );
+			codeSet.insert( code.getBits() );
+		}
+		vector< ulong > codes( codeSet.begin(), codeSet.end() );
+
+		BoundedMpmcQueue< WorkItem > queue( 4 );
+		atomic_bool isProducerDone( false );
+
+		thread producer(
+			[ & ]()
+			{
+				ulong seq = 0;
+				CodeList codeList;
+				for( ulong bits : codes )
+				{
+					Morton code; code.build( bits );
+					codeList.push_back( code );
+
+					if( codeList.size() == listSize )
+					{
+						queue.push( WorkItem( seq++, std::move( codeList ) ) );
+						codeList = CodeList();
+					}
+				}
+
+				if( !codeList.empty() )
+				{
+					queue.push( WorkItem( seq++, std::move( codeList ) ) );
+				}
+
+				isProducerDone = true;
+			}
+		);
+
+		vector< vector< WorkItem > > consumed( nConsumers );
+		vector< thread > consumers;
+		for( int i = 0; i < nConsumers; ++i )
+		{
+			consumers.push_back( thread(
+				[ &, i ]()
+				{
+					WorkItem item;
+					while( true )
+					{
+						bool isDone = isProducerDone;
+						if( queue.tryPop( item ) )
+						{
+							consumed[ i ].push_back( std::move( item ) );
+						}
+						else if( isDone && queue.empty() )
+						{
+							break;
+						}
+						else
+						{
+							this_thread::yield();
+						}
+					}
+				}
+			) );
+		}
+
+		producer.join();
+		for( thread& consumer : consumers )
+		{
+			consumer.join();
+		}
+
+		// Each consumer sees the lists in FIFO order.
+		map< ulong, CodeList > lists;
+		for( vector< WorkItem >& consumerItems : consumed )
+		{
+			for( int i = 1; i < consumerItems.size(); ++i )
+			{
+				ASSERT_LT( consumerItems[ i - 1 ].first, consumerItems[ i ].first );
+			}
+			for( WorkItem& item : consumerItems )
+			{
+				ASSERT_TRUE( lists.insert( std::move( item ) ).second ) << "List " << item.first << " duplicated.";
+			}
+		}
+
+		ASSERT_EQ( ( nCodes + listSize - 1 ) / listSize, lists.size() );
+		ASSERT_EQ( 0, lists.begin()->first );
+		ASSERT_EQ( lists.size() - 1, lists.rbegin()->first );
+
+		// No code is lost or duplicated, and sibling groups that span lists are kept contiguous.
+		vector< ulong > concatenated;
+		int nBoundarySiblingGroups = 0;
+		for( auto it = lists.begin(); it != lists.end(); ++it )
+		{
+			if( it != lists.begin() )
+			{
+				Morton prevParent = *std::prev( it )->second.back().traverseUp();
+				Morton nextParent = *it->second.front().traverseUp();
+
+				if( prevParent == nextParent )
+				{
+					++nBoundarySiblingGroups;
+				}
+			}
+
+			for( const Morton& code : it->second )
+			{
+				concatenated.push_back( code.getBits() );
+			}
+		}
+
+		ASSERT_EQ( codes, concatenated );
+		ASSERT_GT( nBoundarySiblingGroups, 0 );
+
+		set< ulong > visitedParents;
+		for( int i = 0; i < concatenated.size(); ++i )
+		{
+			ulong parent = concatenated[ i ] >> 3;
+			if( i == 0 || parent != ( concatenated[ i - 1 ] >> 3 ) )
+			{
+				ASSERT_TRUE( visitedParents.insert( parent ).second ) << "Sibling group split.";
+			}
+		}
+
+		cout << "Lists: " << lists.size() << " Sibling groups across lists: " << nBoundarySiblingGroups << endl << endl;
+	}
+
+	TEST( BoundedMpmcQueueTest, MultiProducerStress )
+	{
+		const int nProducers = 4;
+		const int nConsumers = 4;
+		const int nItemsPerProducer = 100000;
+
+		BoundedMpmcQueue< pair< int, int > > queue( 16 );
+		atomic_int nConsumedItems( 0 );
+
+		vector< thread > producers;
+		for( int p = 0; p < nProducers; ++p )
+		{
+			producers.push_back( thread(
+				[ &, p ]()
+				{
+					for( int i = 0; i < nItemsPerProducer; ++i )
+					{
+						queue.push( pair< int, int >( p, i ) );
+					}
+				}
+			) );
+		}
+
+		vector< vector< pair< int, int > > > consumed( nConsumers );
+		vector< thread > consumers;
+		for( int c = 0; c < nConsumers; ++c )
+		{
+			consumers.push_back( thread(
+				[ &, c ]()
+				{
+					pair< int, int > item;
+					while( nConsumedItems < nProducers * nItemsPerProducer )
+					{
+						if( queue.tryPop( item ) )
+						{
+							consumed[ c ].push_back( item );
+							++nConsumedItems;
+						}
+						else
+						{
+							this_thread::yield();
+						}
+					}
+				}
+			) );
+		}
+
+		for( thread& producer : producers ) { producer.join(); }
+		for( thread& consumer : consumers ) { consumer.join(); }
+
+		vector< vector< int > > counts( nProducers, vector< int >( nItemsPerProducer, 0 ) );
+		for( vector< pair< int, int > >& consumerItems : consumed )
+		{
+			vector< int > lastItem( nProducers, -1 );
+			for( pair< int, int >& item : consumerItems )
+			{
+				// Items from the same producer are popped in FIFO order.
+				ASSERT_LT( lastItem[ item.first ], item.second );
+				lastItem[ item.first ] = item.second;
+				++counts[ item.first ][ item.second ];
+			}
+		}
+
+		for( vector< int >& producerCounts : counts )
+		{
+			ASSERT_TRUE( all_of( producerCounts.begin(), producerCounts.end(), []( int count ) { return count == 1; } ) );
+		}
+		ASSERT_TRUE( queue.empty() );
+	}
+}
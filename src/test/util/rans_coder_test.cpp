@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "omicron/util/counter_rng.h"
+#include "omicron/util/rans_coder.h"
+
+namespace omicron::test::util
+{
+	using namespace std;
+	using namespace omicron::util;
+
+	/** Encodes and decodes input. @returns the encoded size. */
+	size_t checkRoundTrip( const ByteVector& input )
+	{
+		ByteVector encoded;
+		RansCoder::encode( input.data(), input.size(), encoded );
+
+		ByteVector decoded;
+		const uint8_t* ptr = encoded.data();
+		RansCoder::decode( ptr, encoded.data() + encoded.size(), decoded );
+
+		EXPECT_EQ( encoded.data() + encoded.size(), ptr );
+		EXPECT_EQ( input, decoded );
+
+		return encoded.size();
+	}
+
+	TEST( RansCoderTest, Varint )
+	{
+		ByteVector bytes;
+		vector< uint64_t > values = { 0ul, 1ul, 127ul, 128ul, 300ul, 1ul << 35, numeric_limits< uint64_t >::max() };
+		for( uint64_t value : values )
+		{
+			writeVarint( bytes, value );
+		}
+		ASSERT_EQ( 23ul, bytes.size() );
+
+		const uint8_t* ptr = bytes.data();
+		for( uint64_t value : values )
+		{
+			ASSERT_EQ( value, readVarint( ptr, bytes.data() + bytes.size() ) );
+		}
+
+		const uint8_t truncated[] = { 0x80, 0x80 };
+		ptr = truncated;
+		ASSERT_THROW( readVarint( ptr, truncated + 2 ), runtime_error );
+
+		for( int64_t value : { 0l, 1l, -1l, 64l, -65l, numeric_limits< int64_t >::min() } )
+		{
+			ASSERT_EQ( value, unzigzag( zigzag( value ) ) );
+		}
+		ASSERT_EQ( 1ul, zigzag( -1l ) );
+		ASSERT_EQ( 2ul, zigzag( 1l ) );
+	}
+
+	TEST( RansCoderTest, RoundTrip )
+	{
+		// Empty and small inputs are stored raw.
+		ASSERT_EQ( 2ul, checkRoundTrip( ByteVector() ) );
+		ASSERT_EQ( 5ul, checkRoundTrip( ByteVector( { 1, 2, 3 } ) ) );
+
+		// Skewed distribution compresses.
+		CounterRng rng( 17ul );
+		ByteVector skewed( 100000 );
+		for( uint8_t& byte : skewed )
+		{
+			uint32_t r = rng.uniform( 100u );
+			byte = ( r < 80u ) ? 0u : ( r < 95u ) ? 1u : uint8_t( rng.uniform( 256u ) );
+		}
+		ASSERT_LT( checkRoundTrip( skewed ), skewed.size() / 2 );
+
+		// A single symbol compresses to almost nothing.
+		ASSERT_LT( checkRoundTrip( ByteVector( 10000, 42 ) ), 64ul );
+
+		// Uniform random bytes do not compress and fall back to raw storage.
+		ByteVector random( 10000 );
+		for( uint8_t& byte : random )
+		{
+			byte = uint8_t( rng.uniform( 256u ) );
+		}
+		ASSERT_LE( checkRoundTrip( random ), random.size() + 3 );
+
+		// Consecutive blocks are decoded independently.
+		ByteVector blocks;
+		RansCoder::encode( skewed.data(), skewed.size(), blocks );
+		RansCoder::encode( random.data(), random.size(), blocks );
+
+		ByteVector decoded;
+		const uint8_t* ptr = blocks.data();
+		RansCoder::decode( ptr, blocks.data() + blocks.size(), decoded );
+		RansCoder::decode( ptr, blocks.data() + blocks.size(), decoded );
+		ASSERT_EQ( blocks.data() + blocks.size(), ptr );
+		ASSERT_TRUE( equal( skewed.begin(), skewed.end(), decoded.begin() ) );
+		ASSERT_TRUE( equal( random.begin(), random.end(), decoded.begin() + skewed.size() ) );
+	}
+
+	TEST( RansCoderTest, MalformedBlocks )
+	{
+		ByteVector encoded;
+		ByteVector input( 1000, 7 );
+		input[ 10 ] = 8;
+		RansCoder::encode( input.data(), input.size(), encoded );
+
+		ByteVector decoded;
+		const uint8_t* ptr = encoded.data();
+		ASSERT_THROW( RansCoder::decode( ptr, encoded.data() + encoded.size() - 1, decoded ), runtime_error );
+
+		encoded[ 0 ] = 7;
+		ptr = encoded.data();
+		ASSERT_THROW( RansCoder::decode( ptr, encoded.data() + encoded.size(), decoded ), runtime_error );
+
+		// The header is | mode | size varint (2 bytes) | bitmap | freq varints of 7 and 8 | coded size |.
+		auto withHeader = [ & ]( const uint64_t size, const uint64_t freq7, const uint64_t freq8 )
+		{
+			ByteVector block( 1, 1 );
+			writeVarint( block, size );
+			block.insert( block.end(), encoded.begin() + 3, encoded.begin() + 35 );
+			writeVarint( block, freq7 );
+			writeVarint( block, freq8 );
+
+			const uint8_t* freqsPtr = encoded.data() + 35;
+			const uint8_t* encodedEnd = encoded.data() + encoded.size();
+			readVarint( freqsPtr, encodedEnd );
+			readVarint( freqsPtr, encodedEnd );
+			block.insert( block.end(), freqsPtr, encodedEnd );
+			return block;
+		};
+
+		ByteVector valid = withHeader( 1000ul, 4095ul, 1ul );
+		ptr = valid.data();
+		ASSERT_NO_THROW( RansCoder::decode( ptr, valid.data() + valid.size(), decoded ) );
+
+		// Huge sizes are rejected before allocating.
+		ByteVector hugeSize = withHeader( 1ul << 60, 4095ul, 1ul );
+		ptr = hugeSize.data();
+		ASSERT_THROW( RansCoder::decode( ptr, hugeSize.data() + hugeSize.size(), decoded ), runtime_error );
+
+		// Frequencies that wrap the 32 bit sum to PROB_SCALE are rejected.
+		ByteVector wrappedSum = withHeader( 1000ul, ( 1ul << 32 ) - 1ul, 4097ul );
+		ptr = wrappedSum.data();
+		ASSERT_THROW( RansCoder::decode( ptr, wrappedSum.data() + wrappedSum.size(), decoded ), runtime_error );
+
+		ByteVector fullFreq = withHeader( 1000ul, 4096ul, 0ul );
+		ptr = fullFreq.data();
+		ASSERT_THROW( RansCoder::decode( ptr, fullFreq.data() + fullFreq.size(), decoded ), runtime_error );
+	}
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include "omicron/util/ring_buffer.h"
+
+namespace omicron::test::util
+{
+	using namespace std;
+	using namespace omicron::util;
+
+	TEST( RingBufferTest, KeepsMostRecent )
+	{
+		ASSERT_THROW( RingBuffer< int >( 0ul ), logic_error );
+
+		RingBuffer< int > buffer( 4ul );
+		ASSERT_TRUE( buffer.empty() );
+		ASSERT_EQ( 4ul, buffer.capacity() );
+
+		for( int i = 0; i < 3; ++i )
+		{
+			buffer.push( i );
+		}
+		ASSERT_EQ( 3ul, buffer.size() );
+		ASSERT_EQ( 0ul, buffer.nDropped() );
+		ASSERT_EQ( 0, buffer[ 0 ] );
+		ASSERT_EQ( 2, buffer.back() );
+
+		// Wraps around, overwriting the oldest elements.
+		for( int i = 3; i < 10; ++i )
+		{
+			buffer.push( i );
+		}
+		ASSERT_EQ( 4ul, buffer.size() );
+		ASSERT_EQ( 10ul, buffer.nPushed() );
+		ASSERT_EQ( 6ul, buffer.nDropped() );
+		for( size_t i = 0; i < buffer.size(); ++i )
+		{
+			ASSERT_EQ( int( 6 + i ), buffer[ i ] );
+		}
+		ASSERT_EQ( 9, buffer.back() );
+
+		buffer.clear();
+		ASSERT_TRUE( buffer.empty() );
+		ASSERT_EQ( 0ul, buffer.nPushed() );
+		buffer.push( 42 );
+		ASSERT_EQ( 42, buffer[ 0 ] );
+	}
+}